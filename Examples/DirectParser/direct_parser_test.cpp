@@ -0,0 +1,114 @@
+//
+// Checks that a parser generated with --direct-parser gives the same results as the table-driven parser
+//
+// tables.h is generated from calculator.tp without any options and direct.h is generated with --direct-parser.
+// Each program is parsed with both, and the results of evaluating the statements in the ASTs must match.
+//
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <map>
+#include "tables.h"
+#include "direct.h"
+
+using namespace std;
+
+// Set to true if any check fails
+static bool s_Failed = false;
+
+//
+// Reports the result of a check
+//
+static void check(const string& name, bool result) {
+    cout << name << (result ? ": ok" : ": FAILED") << endl;
+    if (!result) s_Failed = true;
+}
+
+//
+// Evaluates the ASTs generated by either of the parsers
+//
+template<class language> class calculator {
+private:
+    /// \brief The values assigned to the variables
+    map<string, long> m_Variables;
+
+public:
+    long evaluate(const typename language::Factor_n* factor) {
+        if (factor->number.item())          return atol(factor->number->template content<char>().c_str());
+        if (factor->identifier.item())      return m_Variables[factor->identifier->template content<char>()];
+        if (factor->Factor.item())          return -evaluate(factor->Factor.item());
+        return evaluate(factor->Expression.item());
+    }
+
+    long evaluate(const typename language::Term_n* term) {
+        if (term->Term.item())              return evaluate(term->Term.item()) * evaluate(term->Factor.item());
+        return evaluate(term->Factor.item());
+    }
+
+    long evaluate(const typename language::Expression_n* expr) {
+        if (expr->_plus_.item())            return evaluate(expr->Expression.item()) + evaluate(expr->Term.item());
+        if (expr->_minus_.item())           return evaluate(expr->Expression.item()) - evaluate(expr->Term.item());
+        return evaluate(expr->Term.item());
+    }
+
+    /// \brief Parses the specified program, and returns the value of each statement (or 'rejected')
+    string run(const string& program) {
+        util::arena                 astArena;
+        stringstream                input(program);
+        typename language::state*   parser = language::template create_Program<char>(input, astArena);
+        stringstream                result;
+
+        if (!language::parse(parser)) {
+            result << "rejected";
+        } else {
+            const typename language::Program_n* root = dynamic_cast<const typename language::Program_n*>(parser->get_item().item());
+
+            for (typename language::list_of_Statement_n::iterator stmt = root->list_of_Statement->begin(); stmt != root->list_of_Statement->end(); ++stmt) {
+                const typename language::Statement_n* statement = (*stmt)->Statement.item();
+                long value = evaluate(statement->Expression.item());
+
+                if (statement->identifier.item()) {
+                    m_Variables[statement->identifier->template content<char>()] = value;
+                }
+                result << value << ";";
+            }
+        }
+
+        delete parser;
+        return result.str();
+    }
+};
+
+//
+// Parses a program with both parsers, and checks that the results are the same as each other and as the expected result
+//
+static void check_program(const string& name, const string& program, const string& expected) {
+    string tables = calculator<Tables>().run(program);
+    string direct = calculator<Direct>().run(program);
+
+    check(name + "-Tables", tables == expected);
+    check(name + "-Direct", direct == tables);
+}
+
+//
+// Runs the checks
+//
+int main(int argc, const char** argv) {
+    // Precedence and associativity are decided by the shape of the AST
+    check_program("Precedence", "1 + 2 * 3; 10 - 4 - 3; (1 + 2) * 3;", "7;3;9;");
+    check_program("Negation", "--2; -(1 - 4) * -2;", "2;-6;");
+
+    // Statements that start with an identifier go through the guard, which the direct-coded parser can't write out
+    check_program("Assignment", "x = 4; y = x * x; y - x;", "4;16;12;");
+    check_program("Identifier", "x; x + 1;", "0;1;");
+
+    // Syntax errors must be reported by both
+    check_program("Unterminated", "1 + 2", "rejected");
+    check_program("MissingOperand", "1 + * 2;", "rejected");
+    check_program("BadAssignment", "x = ;", "rejected");
+    check_program("Empty", "", "rejected");
+
+    return s_Failed ? 1 : 0;
+}
@@ -16,8 +16,9 @@ void pretty_print(const JSON::Value_n* value, int indentAmount);
 // Parses stdin as JSON and pretty prints it to stdout
 //
 int main(int argc, const char** argv) {
-    // Create the parser - unicode from wcin
-    JSON::state* parser = JSON::create_Object<wchar_t>(wcin);
+    // Create the parser - unicode from wcin. The AST is built in an arena, so it can be freed all at once
+    util::arena  astArena;
+    JSON::state* parser = JSON::create_Object<wchar_t>(wcin, astArena);
 
     // Generate the AST
     bool success = parser->parse();
@@ -45,6 +46,9 @@ int main(int argc, const char** argv) {
     pretty_print(root);
     wcout << endl;
 
+    // The parser must be finished with before the arena that contains the AST
+    delete parser;
+
     // Exit success
     return 0;
 }
@@ -0,0 +1,119 @@
+//
+// Checks the ASTs generated for pruning.tp with the options that prune them
+//
+// pruned.h is generated with --elide-punctuation and --collapse-unit-rules, and named.h with --elide-terminal and
+// --collapse-nonterminal. The constructors used here only exist if the AST classes have the expected shape, so this
+// won't compile if pruning leaves two rules with the same constructor.
+//
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "pruned.h"
+#include "named.h"
+
+using namespace std;
+
+// Set to true if any check fails
+static bool s_Failed = false;
+
+//
+// Reports the result of a check
+//
+static void check(const string& name, bool result) {
+    cout << name << (result ? ": ok" : ": FAILED") << endl;
+    if (!result) s_Failed = true;
+}
+
+//
+// Fetches the item in a list of items at the specified position
+//
+template<class list_type> const Pruned::syntax_node* pruned_item(const list_type* list, size_t index) {
+    if (list == NULL || index >= (size_t) (list->end() - list->begin())) return NULL;
+    return (*(list->begin() + index))->Item.item();
+}
+
+template<class list_type> const Named::syntax_node* named_item(const list_type* list, size_t index) {
+    if (list == NULL || index >= (size_t) (list->end() - list->begin())) return NULL;
+    return (*(list->begin() + index))->Item.item();
+}
+
+//
+// Checks the AST generated with --elide-punctuation and --collapse-unit-rules
+//
+static void check_pruned(const string& program) {
+    // The sign is all that tells the rules for <Signed> apart, so it must be kept
+    Pruned::Signed_n unsignedNumber((util::syntax_ptr<Pruned::number_n>()));
+    Pruned::Signed_n plusNumber((util::syntax_ptr<Pruned::_plus__n>()), util::syntax_ptr<Pruned::number_n>());
+    Pruned::Signed_n minusNumber((util::syntax_ptr<Pruned::_minus__n>()), util::syntax_ptr<Pruned::number_n>());
+
+    // <Directive> and <Body> can't both be collapsed to plain syntax_nodes in <Declaration>
+    Pruned::Declaration_n directiveDeclaration((util::syntax_ptr<Pruned::identifier_n>()), util::syntax_ptr<Pruned::Directive_n>());
+    Pruned::Declaration_n bodyDeclaration((util::syntax_ptr<Pruned::identifier_n>()), util::syntax_ptr<Pruned::Body_n>());
+
+    // Brackets that don't tell rules apart are elided
+    Pruned::Body_n body((util::syntax_ptr<Pruned::Signed_n>()));
+
+    // Parse the program
+    util::arena     astArena;
+    stringstream    input(program);
+    Pruned::state*  parser = Pruned::create_Program<char>(input, astArena);
+
+    check("Pruned-Accept", parser->parse());
+
+    // <Program> and <Item> are collapsed, so the list of items is at the root
+    const Pruned::list_of_Item_n*   items       = dynamic_cast<const Pruned::list_of_Item_n*>(parser->get_item().item());
+    const Pruned::Signed_n*         first       = dynamic_cast<const Pruned::Signed_n*>(pruned_item(items, 0));
+    const Pruned::Signed_n*         second      = dynamic_cast<const Pruned::Signed_n*>(pruned_item(items, 1));
+    const Pruned::Declaration_n*    third       = dynamic_cast<const Pruned::Declaration_n*>(pruned_item(items, 2));
+    const Pruned::Declaration_n*    fourth      = dynamic_cast<const Pruned::Declaration_n*>(pruned_item(items, 3));
+
+    check("Pruned-Items", items != NULL && items->end() - items->begin() == 4);
+    check("Pruned-Unsigned", first != NULL && first->number.item() && !first->_plus_.item() && !first->_minus_.item());
+    check("Pruned-Minus", second != NULL && second->_minus_.item() && second->number->content<char>() == "2");
+    check("Pruned-Directive", third != NULL && third->Directive.item() && third->Directive->forward.item());
+    check("Pruned-Body", fourth != NULL && fourth->Body.item() && fourth->Body->Signed.item() && fourth->Body->Signed->_plus_.item());
+
+    delete parser;
+}
+
+//
+// Checks the AST generated with --elide-terminal and --collapse-nonterminal
+//
+static void check_named(const string& program) {
+    // The signs were named to be elided, but are kept as they're all that tells the rules for <Signed> apart
+    Named::Signed_n plusNumber((util::syntax_ptr<Named::_plus__n>()), util::syntax_ptr<Named::number_n>());
+    Named::Signed_n minusNumber((util::syntax_ptr<Named::_minus__n>()), util::syntax_ptr<Named::number_n>());
+
+    // Punctuation that wasn't named is kept
+    Named::Body_n body((util::syntax_ptr<Named::_openparen__n>()), util::syntax_ptr<Named::Signed_n>(), util::syntax_ptr<Named::_closeparen__n>());
+
+    // Parse the program
+    util::arena     astArena;
+    stringstream    input(program);
+    Named::state*   parser = Named::create_Program<char>(input, astArena);
+
+    check("Named-Accept", parser->parse());
+
+    // Only <Item> is collapsed, so the items in the list are the signed numbers and declarations
+    const Named::Program_n*     root    = dynamic_cast<const Named::Program_n*>(parser->get_item().item());
+    const Named::list_of_Item_n* items  = root ? root->list_of_Item.item() : NULL;
+
+    check("Named-Root", root != NULL && items != NULL);
+    check("Named-Signed", dynamic_cast<const Named::Signed_n*>(named_item(items, 1)) != NULL);
+    check("Named-Declaration", dynamic_cast<const Named::Declaration_n*>(named_item(items, 2)) != NULL);
+
+    delete parser;
+}
+
+//
+// Runs the checks
+//
+int main(int argc, const char** argv) {
+    string program = "1; -2; x = forward; y = (+3);";
+
+    check_pruned(program);
+    check_named(program);
+
+    return s_Failed ? 1 : 0;
+}
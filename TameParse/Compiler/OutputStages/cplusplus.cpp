@@ -31,11 +31,13 @@
 #include <locale>
 
 #include "TameParse/Compiler/OutputStages/cplusplus.h"
+#include "TameParse/Language/process.h"
 
 using namespace std;
 using namespace dfa;
 using namespace contextfree;
 using namespace compiler;
+using namespace language;
 
 /// \brief A suffix used to distinguish node types from the variables that reference them
 static const string s_TypeSuffix = "_n";
@@ -421,9 +423,12 @@ void output_cplusplus::begin_output() {
     *m_HeaderFile << "#define TAMEPARSE_PARSER_" << toupper(get_identifier(m_FilenamePrefix, true)) << "\n";
     *m_HeaderFile << "\n";
 
+    *m_HeaderFile << "#include \"TameParse/Util/arena.h\"\n";
     *m_HeaderFile << "#include \"TameParse/Util/syntax_ptr.h\"\n";
     *m_HeaderFile << "#include \"TameParse/Dfa/lexer.h\"\n";
     *m_HeaderFile << "#include \"TameParse/Lr/parser.h\"\n";
+    *m_HeaderFile << "#include \"TameParse/Lr/event_parser.h\"\n";
+    *m_HeaderFile << "#include \"TameParse/Lr/segmented_parser.h\"\n";
     *m_HeaderFile << "#include \"TameParse/Lr/parser_tables.h\"\n";
     *m_HeaderFile << "\n";
     
@@ -673,15 +678,21 @@ void output_cplusplus::source_lexer_state_machine() {
     // Finish off the table
     *m_SourceFile << "\n    };\n";
 
-    // Add a final state to point to the end of the array
+    // States after the last one with any transitions have no entries
+    while ((int)stateToEntryOffset.size() < count_lexer_states()) {
+        stateToEntryOffset.push_back(entryPos);
+    }
+
+    // Add a final state to point to the end of the array (the state machine finds the entries for a state by
+    // looking at the row for the following state, so this must be written out too)
     stateToEntryOffset.push_back(entryPos);
 
     // Write out the rows table
-    *m_SourceFile << "\nstatic const dfa::state_machine_compact_table<false>::entry* s_LexerStates[" << stateToEntryOffset.size()-1 << "] = {\n        ";
+    *m_SourceFile << "\nstatic const dfa::state_machine_compact_table<false>::entry* s_LexerStates[" << stateToEntryOffset.size() << "] = {\n        ";
 
     // Write the actual rows
     bool first = true;
-    for (vector<int>::iterator offset = stateToEntryOffset.begin(); offset != stateToEntryOffset.end()-1; ++offset) {
+    for (vector<int>::iterator offset = stateToEntryOffset.begin(); offset != stateToEntryOffset.end(); ++offset) {
         // Commas between entries
         if (!first) *m_SourceFile << ", ";
 
@@ -721,9 +732,54 @@ void output_cplusplus::source_lexer_state_machine() {
     *m_SourceFile << "\ntypedef dfa::state_machine_tables<wchar_t, dfa::hard_coded_symbol_table<wchar_t, 2> > lexer_state_machine;\n";
     *m_SourceFile << "static const lexer_state_machine s_StateMachine(s_SymbolMap, s_LexerStates, " << stateToEntryOffset.size()-1 << ");\n";
 
+    // Write out the keywords that were left out of the DFA, if there are any
+    const keyword_table* keywords = lexer_keywords();
+    
+    if (keywords && !keywords->empty()) {
+        // The text of the keywords
+        *m_SourceFile << "\nstatic const int s_KeywordText[] = {\n        ";
+        for (int chr = 0; chr < keywords->text_length(); ++chr) {
+            if (chr > 0) {
+                *m_SourceFile << ", ";
+                if ((chr % 20) == 0) *m_SourceFile << "\n        ";
+            }
+            *m_SourceFile << keywords->text()[chr];
+        }
+        *m_SourceFile << "\n    };\n";
+        
+        // The hash table entries
+        *m_SourceFile << "\nstatic const dfa::keyword_table::entry s_KeywordEntries[] = {\n        ";
+        for (int entryId = 0; entryId < keywords->count_entries(); ++entryId) {
+            const keyword_table::entry& keyword = keywords->entries()[entryId];
+            
+            if (entryId > 0) {
+                *m_SourceFile << ",\n        ";
+            }
+            *m_SourceFile << "{ " << keyword.matched << ", " << keyword.symbol << ", " << keyword.case_insensitive << ", " << keyword.offset << ", " << keyword.length << " }";
+        }
+        *m_SourceFile << "\n    };\n";
+        
+        // The bucket displacements
+        *m_SourceFile << "\nstatic const int s_KeywordDisplacement[] = {\n        ";
+        for (int bucket = 0; bucket < keywords->count_buckets(); ++bucket) {
+            if (bucket > 0) {
+                *m_SourceFile << ", ";
+                if ((bucket % 20) == 0) *m_SourceFile << "\n        ";
+            }
+            *m_SourceFile << keywords->displacement()[bucket];
+        }
+        *m_SourceFile << "\n    };\n";
+        
+        *m_SourceFile << "\nstatic const dfa::keyword_table s_Keywords(s_KeywordEntries, " << keywords->count_entries() << ", s_KeywordDisplacement, " << keywords->count_buckets() << ", s_KeywordText);\n";
+    }
+    
     // Create the lexer itself
     *m_SourceFile << "\ntypedef dfa::dfa_lexer_base<const lexer_state_machine&, 0, 0, false, const lexer_state_machine&> lexer_definition;\n";
-    *m_SourceFile << "static lexer_definition s_LexerDefinition(s_StateMachine, " << stateToEntryOffset.size()-1 << ", s_AcceptingStates);\n";
+    *m_SourceFile << "static lexer_definition s_LexerDefinition(s_StateMachine, " << stateToEntryOffset.size()-1 << ", s_AcceptingStates";
+    if (keywords && !keywords->empty()) {
+        *m_SourceFile << ", &s_Keywords";
+    }
+    *m_SourceFile << ");\n";
 
     // Finally, the lexer class itself
     *m_SourceFile << "\nconst dfa::lexer " << get_identifier(m_ClassName, false) << "::lexer(&s_LexerDefinition, false);\n";
@@ -842,11 +898,81 @@ public:
     }   
 };
 
+/// \brief Writes out an array of integers
+static void write_int_array(const string& tableName, const int* values, int count, ostream& output) {
+    output << "static int " << tableName << "[] = {";
+    
+    for (int pos = 0; pos < count; ++pos) {
+        // Comma
+        if (pos > 0) {
+            output << ", ";
+        }
+        
+        // Newline
+        if ((pos%20) == 0) {
+            output << "\n    ";
+        }
+        
+        output << values[pos];
+    }
+    
+    // Arrays can't be empty
+    if (count == 0) {
+        output << "\n    0";
+    }
+    
+    output << "\n};\n";
+}
+
+/// \brief Writes out a comb table
+static void write_comb_table(const string& tableName, const lr::parser_tables::comb_table& comb, int numStates, ostream& output) {
+    output << "\n";
+    write_int_array(tableName + "_displacement", comb.displacement, numStates, output);
+    write_int_array(tableName + "_check", comb.check, comb.size, output);
+    write_int_array(tableName + "_index", comb.index, comb.size, output);
+    
+    output << "static lr::parser_tables::comb_table " << tableName << " = { " 
+           << comb.size << ", " << tableName << "_displacement, " << tableName << "_check, " << tableName << "_index };\n";
+}
+
+/// \brief Writes out the automata for the regular guards
+static void write_guard_table(const string& tableName, const lr::parser_tables::guard_table& guards, int numStates, ostream& output) {
+    int numTransitions = guards.firstTransition[guards.numStates];
+    
+    output << "\n";
+    write_int_array(tableName + "_initial", guards.initialState, numStates, output);
+    write_int_array(tableName + "_accept", guards.accept, guards.numStates, output);
+    write_int_array(tableName + "_first", guards.firstTransition, guards.numStates+1, output);
+    write_int_array(tableName + "_symbol", guards.symbol, numTransitions, output);
+    write_int_array(tableName + "_next", guards.nextState, numTransitions, output);
+    
+    output << "static lr::parser_tables::guard_table " << tableName << " = { " 
+           << guards.numStates << ", " << tableName << "_initial, " << tableName << "_accept, " << tableName << "_first, "
+           << tableName << "_symbol, " << tableName << "_next };\n";
+}
+
 /// \brief Writes out the header items for the parser tables
 void output_cplusplus::header_parser_tables() {
+    // Work out which parser features the tables need, so the parser can leave out the checks for the others
+    int features = get_parser_tables().features();
+
+    string featureList;
+    if (features & lr::parser_features::guards)          featureList += " | lr::parser_features::guards";
+    if (features & lr::parser_features::weak_symbols)    featureList += " | lr::parser_features::weak_symbols";
+    if (features & lr::parser_features::diverts)         featureList += " | lr::parser_features::diverts";
+
+    if (featureList.empty()) {
+        featureList = "lr::parser_features::none";
+    } else {
+        featureList = featureList.substr(3);
+    }
+
     *m_HeaderFile   << "\n"
                 << "public:\n"
-                << "    static const lr::parser_tables lr_tables;\n";
+                << "    static const lr::parser_tables lr_tables;\n"
+                << "    enum { lr_features = " << featureList << " };\n";
+
+    m_UsedClassNames.insert("lr_features");
 }
 
 /// \brief Writes out the source code for the parser tables
@@ -976,6 +1102,22 @@ void output_cplusplus::source_parser_tables() {
     
     *m_SourceFile << "\n};\n";
     
+    // Write out the comb tables if the parser should look up actions directly
+    bool writeCombs = !cons().get_option(L"dense-parser-tables").empty() && tables.terminal_comb() && tables.nonterminal_comb() && tables.gotos();
+    
+    if (writeCombs) {
+        write_comb_table("s_TerminalComb", *tables.terminal_comb(), tables.count_states(), *m_SourceFile);
+        write_comb_table("s_NonterminalComb", *tables.nonterminal_comb(), tables.count_states(), *m_SourceFile);
+        
+        *m_SourceFile << "\n";
+        write_int_array("s_Gotos", tables.gotos(), tables.nonterminal_comb()->size, *m_SourceFile);
+    }
+    
+    // Write out the automata for any guards that are regular
+    if (tables.guards()) {
+        write_guard_table("s_Guards", *tables.guards(), tables.count_states(), *m_SourceFile);
+    }
+    
     // Generate the parser tables
     *m_SourceFile   << "\nconst lr::parser_tables " << get_identifier(m_ClassName, false) << "::lr_tables(" 
                     << tables.count_states() << ", " << tables.end_of_input() << ", " 
@@ -983,11 +1125,24 @@ void output_cplusplus::source_parser_tables() {
                     << ", s_TerminalActions, s_NonterminalActions, s_ActionCounts, s_EndGuardStates, " 
                     << tables.count_end_of_guards() << ", " << tables.count_reduce_rules() << ", "
                     << "s_ReduceRules, " << tables.count_weak_to_strong() << ", "
-                    << "s_WeakToStrong"
-                    << ");\n";
+                    << "s_WeakToStrong";
+    
+    if (writeCombs) {
+        *m_SourceFile << ", &s_TerminalComb, &s_NonterminalComb, s_Gotos";
+    } else if (tables.guards()) {
+        *m_SourceFile << ", NULL, NULL, NULL";
+    }
+    
+    if (tables.guards()) {
+        *m_SourceFile << ", &s_Guards";
+    }
+    
+    *m_SourceFile   << ");\n";
 
     // Add to the list of used class names
     m_UsedClassNames.insert("lr_tables");
+    m_UsedClassNames.insert("direct_code");
+    m_UsedClassNames.insert("parse");
 }
 
 //              ================
@@ -996,6 +1151,8 @@ void output_cplusplus::source_parser_tables() {
 
 /// \brief Writes out the AST tables
 void output_cplusplus::define_ast_tables() {
+    find_pruned_ast_items();
+
     header_ast_forward_declarations();
     header_ast_class_declarations();
     header_parser_actions();
@@ -1009,20 +1166,29 @@ void output_cplusplus::define_ast_tables() {
     // Output the parser definition
     *m_HeaderFile   << "\npublic:\n"
                     << "    typedef util::syntax_ptr<syntax_node> syntax_node_container;\n"
-                    << "    typedef lr::parser<syntax_node_container, parser_actions> ast_parser_type;\n"
+                    << "    typedef lr::parser<syntax_node_container, parser_actions, lr::no_parser_trace, lr_features> ast_parser_type;\n"
                     << "    static const ast_parser_type ast_parser;\n";
     
     *m_SourceFile   << "\nconst " << get_identifier(m_ClassName, false) << "::ast_parser_type " << get_identifier(m_ClassName, false) << "::ast_parser(&lr_tables, false);\n";
 
     // Generate functions for creating new parsers
     header_start_symbols();
+    
+    // Generate the direct-coded version of the parser, if requested
+    header_direct_parser();
+    source_direct_parser();
 }
 
 /// \brief Writes out inline functions to generate initial parser states for specific start symbols
 void output_cplusplus::header_start_symbols() {
     // Begin writing out the definitions
     *m_HeaderFile   << "\npublic:\n"
-                    << "    typedef ast_parser_type::state state;\n";
+                    << "    typedef ast_parser_type::state state;\n"
+                    << "\n"
+                    << "    inline static parser_actions* create_segment_actions(dfa::lexeme_stream* stream) {\n"
+                    << "        return new parser_actions(stream, true);\n"
+                    << "    }\n"
+                    << "\n";
 
     // Fetch the start symbols
     const vector<wstring>& startSymbols = get_start_symbols();
@@ -1049,6 +1215,48 @@ void output_cplusplus::header_start_symbols() {
                         << "\n"
                         << "    template<typename char_type, typename custom_stream_alike> inline static state* create_" << startName << "(custom_stream_alike& input) {\n"
                         << "        return create_" << startName << "(lexer.create_stream_from<char_type, custom_stream_alike>(input), true);\n"
+                        << "    }\n"
+                        << "\n";
+
+        // Variants that build the AST in an arena
+        *m_HeaderFile   << "    inline static state* create_" << startName << "(dfa::lexeme_stream* stream, util::arena& arena, bool deleteStream = false) {\n"
+                        << "        return ast_parser.create_parser(new parser_actions(stream, deleteStream, &arena), " << initialState << ");\n"
+                        << "    }\n"
+                        << "\n"
+                        << "    template<typename char_type, typename traits> inline static state* create_" << startName << "(std::basic_istream<char_type, traits>& input, util::arena& arena) {\n"
+                        << "        return create_" << startName << "(lexer.create_stream_from<char_type, traits>(input), arena, true);\n"
+                        << "    }\n"
+                        << "\n"
+                        << "    template<typename char_type, typename custom_stream_alike> inline static state* create_" << startName << "(custom_stream_alike& input, util::arena& arena) {\n"
+                        << "        return create_" << startName << "(lexer.create_stream_from<char_type, custom_stream_alike>(input), arena, true);\n"
+                        << "    }\n"
+                        << "\n";
+
+        // Variants that send parser events to a handler instead of building an AST
+        *m_HeaderFile   << "    template<typename handler_type> inline static typename lr::event_parser_actions<handler_type>::parser_type::state* create_events_" << startName << "(dfa::lexeme_stream* stream, handler_type& handler, bool deleteStream = false) {\n"
+                        << "        typedef typename lr::event_parser_actions<handler_type>::parser_type event_parser;\n"
+                        << "        return event_parser(&lr_tables, false).create_parser(new lr::event_parser_actions<handler_type>(stream, handler, deleteStream), " << initialState << ");\n"
+                        << "    }\n"
+                        << "\n"
+                        << "    template<typename char_type, typename traits, typename handler_type> inline static typename lr::event_parser_actions<handler_type>::parser_type::state* create_events_" << startName << "(std::basic_istream<char_type, traits>& input, handler_type& handler) {\n"
+                        << "        return create_events_" << startName << "(lexer.create_stream_from<char_type, traits>(input), handler, true);\n"
+                        << "    }\n"
+                        << "\n"
+                        << "    template<typename char_type, typename custom_stream_alike, typename handler_type> inline static typename lr::event_parser_actions<handler_type>::parser_type::state* create_events_" << startName << "(custom_stream_alike& input, handler_type& handler) {\n"
+                        << "        return create_events_" << startName << "(lexer.create_stream_from<char_type, custom_stream_alike>(input), handler, true);\n"
+                        << "    }\n"
+                        << "\n";
+
+        // Variants that split the input at a synchronising terminal and parse the segments concurrently
+        *m_HeaderFile   << "    inline static bool parse_segments_" << startName << "(dfa::lexeme_stream& input, int syncTerminal, std::vector<syntax_node_container>& items, int numThreads = 0, bool syncEndsSegment = false) {\n"
+                        << "        return lr::parse_segments(ast_parser, input, syncTerminal, " << initialState << ", items, numThreads, syncEndsSegment, create_segment_actions);\n"
+                        << "    }\n"
+                        << "\n"
+                        << "    template<typename char_type, typename traits> inline static bool parse_segments_" << startName << "(std::basic_istream<char_type, traits>& input, int syncTerminal, std::vector<syntax_node_container>& items, int numThreads = 0, bool syncEndsSegment = false) {\n"
+                        << "        dfa::lexeme_stream* stream = lexer.create_stream_from<char_type, traits>(input);\n"
+                        << "        bool result = parse_segments_" << startName << "(*stream, syncTerminal, items, numThreads, syncEndsSegment);\n"
+                        << "        delete stream;\n"
+                        << "        return result;\n"
                         << "    }\n";
 
         // Move the initial state on
@@ -1056,12 +1264,476 @@ void output_cplusplus::header_start_symbols() {
     }
 }
 
+/// \brief True if the parser should be written out as code rather than being interpreted from the tables
+bool output_cplusplus::write_direct_parser() {
+    return !cons().get_option(L"direct-parser").empty();
+}
+
+/// \brief Returns true if the direct-coded parser can perform every action in the specified state
+///
+/// States with guards, weak reductions or anything else that needs more than a single action to be looked up
+/// are left to the table interpreter. This is also true of any state that has more than one action for a symbol.
+static bool can_write_direct_state(const lr::parser_tables& tables, int stateId) {
+    // Check the terminal actions
+    const lr::parser_tables::action*    terminalActions = tables.terminal_actions()[stateId];
+    int                                 numTerminals    = tables.action_counts()[stateId].numTerminals;
+    
+    for (int actionId = 0; actionId < numTerminals; ++actionId) {
+        const lr::parser_tables::action& act = terminalActions[actionId];
+        
+        switch (act.type) {
+            case lr::lr_action::act_shift:
+            case lr::lr_action::act_reduce:
+            case lr::lr_action::act_ignore:
+            case lr::lr_action::act_accept:
+                break;
+                
+            default:
+                return false;
+        }
+        
+        if (actionId > 0 && terminalActions[actionId-1].symbolId == act.symbolId) {
+            return false;
+        }
+    }
+    
+    // Check the nonterminal actions (only the end of input symbol matters here: gotos are generated separately)
+    const lr::parser_tables::action*    nonterminalActions  = tables.nonterminal_actions()[stateId];
+    int                                 numNonterminals     = tables.action_counts()[stateId].numNonterminals;
+    int                                 numEndOfInput       = 0;
+    
+    for (int actionId = 0; actionId < numNonterminals; ++actionId) {
+        const lr::parser_tables::action& act = nonterminalActions[actionId];
+        
+        if (act.symbolId != tables.end_of_input()) continue;
+        if (act.type != lr::lr_action::act_reduce && act.type != lr::lr_action::act_accept) return false;
+        
+        ++numEndOfInput;
+    }
+    
+    return numEndOfInput <= 1;
+}
+
+/// \brief Writes out the code that performs a single action in a direct-coded parser
+static void write_direct_action(const lr::parser_tables& tables, const lr::parser_tables::action& act, const string& indent, ostream& output) {
+    switch (act.type) {
+        case lr::lr_action::act_shift:
+            output << indent << "parserState.shift_direct(la, " << act.nextState << ");\n"
+                   << indent << "continue;\n";
+            break;
+            
+        case lr::lr_action::act_reduce:
+        {
+            const lr::parser_tables::reduce_rule& rule = tables.rule(act.nextState);
+            output << indent << "parserState.reduce_direct<direct_code>(" << rule.identifier << ", " << rule.ruleId << ", " << rule.length << ");\n"
+                   << indent << "continue;\n";
+            break;
+        }
+            
+        case lr::lr_action::act_ignore:
+            output << indent << "parserState.ignore_direct(la);\n"
+                   << indent << "continue;\n";
+            break;
+            
+        case lr::lr_action::act_accept:
+            output << indent << "return lr::parser_result::accept;\n";
+            break;
+    }
+}
+
+/// \brief Writes out the declarations for the direct-coded parser
+void output_cplusplus::header_direct_parser() {
+    *m_HeaderFile << "\npublic:\n";
+    
+    if (!write_direct_parser()) {
+        // Just use the table interpreter
+        *m_HeaderFile   << "    inline static bool parse(state* parserState) {\n"
+                        << "        return parserState->parse();\n"
+                        << "    }\n";
+        return;
+    }
+    
+    *m_HeaderFile   << "    class direct_code {\n"
+                    << "    public:\n"
+                    << "        static int goto_state(int state, int nonterminalId);\n"
+                    << "        static lr::parser_result::result step(state& parserState);\n"
+                    << "    };\n"
+                    << "\n"
+                    << "    inline static bool parse(state* parserState) {\n"
+                    << "        return parserState->parse_direct<direct_code>();\n"
+                    << "    }\n";
+}
+
+/// \brief Writes out the states of the parser as code
+void output_cplusplus::source_direct_parser() {
+    if (!write_direct_parser()) return;
+    
+    const lr::parser_tables&    tables      = get_parser_tables();
+    string                      className   = get_identifier(m_ClassName, false);
+    
+    // Gather the goto actions for each nonterminal
+    typedef map<int, vector<pair<int, int> > > goto_map;
+    goto_map gotos;
+    
+    for (int stateId = 0; stateId < tables.count_states(); ++stateId) {
+        const lr::parser_tables::action*    nonterminalActions  = tables.nonterminal_actions()[stateId];
+        int                                 numNonterminals     = tables.action_counts()[stateId].numNonterminals;
+        
+        for (int actionId = 0; actionId < numNonterminals; ++actionId) {
+            const lr::parser_tables::action& act = nonterminalActions[actionId];
+            if (act.type != lr::lr_action::act_goto) continue;
+            
+            // Only the first goto action for a symbol is used (as for parser_tables::find_goto)
+            vector<pair<int, int> >& ntGotos = gotos[act.symbolId];
+            if (!ntGotos.empty() && ntGotos.back().first == stateId) continue;
+            
+            ntGotos.push_back(pair<int, int>(stateId, act.nextState));
+        }
+    }
+    
+    // Write out the goto function
+    *m_SourceFile   << "\nint " << className << "::direct_code::goto_state(int state, int nonterminalId) {\n"
+                    << "    switch (nonterminalId) {\n";
+    
+    for (goto_map::const_iterator nt = gotos.begin(); nt != gotos.end(); ++nt) {
+        *m_SourceFile   << "        case " << nt->first << ":\n"
+                        << "            switch (state) {\n";
+        
+        for (vector<pair<int, int> >::const_iterator gotoAct = nt->second.begin(); gotoAct != nt->second.end(); ++gotoAct) {
+            *m_SourceFile << "                case " << gotoAct->first << ": return " << gotoAct->second << ";\n";
+        }
+        
+        *m_SourceFile   << "            }\n"
+                        << "            break;\n";
+    }
+    
+    *m_SourceFile   << "    }\n"
+                    << "    return -1;\n"
+                    << "}\n";
+    
+    // Write out the step function: each state that can be performed directly gets a case in a switch statement
+    *m_SourceFile   << "\nlr::parser_result::result " << className << "::direct_code::step(state& parserState) {\n"
+                    << "    for (;;) {\n"
+                    << "        const dfa::lexeme_container& la = parserState.look();\n"
+                    << "\n"
+                    << "        switch (parserState.current_state()) {\n";
+    
+    for (int stateId = 0; stateId < tables.count_states(); ++stateId) {
+        if (!can_write_direct_state(tables, stateId)) continue;
+        
+        *m_SourceFile   << "            case " << stateId << ":\n"
+                        << "                if (la.item()) {\n"
+                        << "                    switch (la->matched()) {\n";
+        
+        // Group together the terminals that have the same action
+        typedef map<pair<int, int>, vector<int> > action_map;
+        action_map                          actions;
+        const lr::parser_tables::action*    terminalActions = tables.terminal_actions()[stateId];
+        int                                 numTerminals    = tables.action_counts()[stateId].numTerminals;
+        
+        for (int actionId = 0; actionId < numTerminals; ++actionId) {
+            const lr::parser_tables::action& act = terminalActions[actionId];
+            actions[pair<int, int>(act.type, act.nextState)].push_back(act.symbolId);
+        }
+        
+        for (action_map::const_iterator act = actions.begin(); act != actions.end(); ++act) {
+            for (vector<int>::const_iterator terminal = act->second.begin(); terminal != act->second.end(); ++terminal) {
+                *m_SourceFile << "                        case " << *terminal << ":\n";
+            }
+            
+            lr::parser_tables::action thisAction;
+            thisAction.type         = act->first.first;
+            thisAction.nextState    = act->first.second;
+            thisAction.symbolId     = act->second.front();
+            
+            write_direct_action(tables, thisAction, "                            ", *m_SourceFile);
+        }
+        
+        *m_SourceFile   << "                    }\n";
+        
+        // Write out the action for the end of input, if there is one
+        const lr::parser_tables::action*    nonterminalActions  = tables.nonterminal_actions()[stateId];
+        int                                 numNonterminals     = tables.action_counts()[stateId].numNonterminals;
+        
+        for (int actionId = 0; actionId < numNonterminals; ++actionId) {
+            if (nonterminalActions[actionId].symbolId == tables.end_of_input()) {
+                *m_SourceFile << "                } else {\n";
+                write_direct_action(tables, nonterminalActions[actionId], "                    ", *m_SourceFile);
+            }
+        }
+        
+        *m_SourceFile   << "                }\n"
+                        << "                break;\n";
+    }
+    
+    // Anything that wasn't handled (guards, weak reductions and syntax errors) is left to the table interpreter
+    *m_SourceFile   << "        }\n"
+                    << "\n"
+                    << "        return parserState.process();\n"
+                    << "    }\n"
+                    << "}\n";
+}
+
+/// \brief True if the specified name is in a list of names supplied as an option
+static bool option_contains(const vector<wstring>& names, const wstring& name) {
+    return find(names.begin(), names.end(), name) != names.end();
+}
+
+/// \brief Works out which terminals should be left out of the AST and which rules should be collapsed into their child
+///
+/// Terminals are elided if they are named by the elide-terminal option or if they are punctuation (literal strings made
+/// up entirely of non-alphanumeric characters) and the elide-punctuation option is set. Rules for the nonterminals
+/// named by the collapse-nonterminal option (or every nonterminal if collapse-unit-rules is set) are collapsed if they
+/// have only one item with a value in the AST: the parser will return that item instead of creating a new node.
+///
+/// Pruning must not make two rules for the same nonterminal impossible to tell apart (for example, eliding the
+/// sign from '+' <Number> and '-' <Number>), or give them the same constructor. Nonterminals that would be stored as
+/// plain syntax_nodes in rules like this are no longer collapsed, and any rules that still clash are left unpruned.
+void output_cplusplus::find_pruned_ast_items() {
+    m_ElidedTerminals.clear();
+    m_UnbuiltTerminals.clear();
+    m_UnprunedRules.clear();
+    m_CollapsedNonterminals.clear();
+    m_CollapsedRules.clear();
+
+    // Fetch the options
+    vector<wstring> elideTerminals          = cons().get_option_list(L"elide-terminal");
+    vector<wstring> collapseNonterminals    = cons().get_option_list(L"collapse-nonterminal");
+    bool            elidePunctuation        = !cons().get_option(L"elide-punctuation").empty();
+    bool            collapseAll             = !cons().get_option(L"collapse-unit-rules").empty();
+    set<wstring>    usedNames;
+
+    // Work out which terminals to elide
+    for (terminal_symbol_iterator term = begin_terminal_symbol(); term != end_terminal_symbol(); ++term) {
+        // Literal strings and characters can be named with or without their quotes
+        const wstring&  name        = terminals().name_for_symbol(term->identifier);
+        bool            isLiteral   = !name.empty() && (name[0] == L'\'' || name[0] == L'"');
+        wstring         literal     = isLiteral ? process::dequote_string(name) : name;
+
+        // Punctuation is a literal string with no letters or digits in it
+        bool isPunctuation = isLiteral && !literal.empty();
+        for (wstring::const_iterator chr = literal.begin(); isPunctuation && chr != literal.end(); ++chr) {
+            if (isalnum(*chr, loc)) isPunctuation = false;
+        }
+
+        if (option_contains(elideTerminals, name)) {
+            usedNames.insert(name);
+        } else if (isLiteral && option_contains(elideTerminals, literal)) {
+            usedNames.insert(literal);
+        } else if (!elidePunctuation || !isPunctuation) {
+            continue;
+        }
+
+        m_ElidedTerminals.insert(term->identifier);
+    }
+
+    // Work out which nonterminals can have their rules collapsed
+    set<int> collapsible;
+
+    for (nonterminal_symbol_iterator nonterm = begin_nonterminal_symbol(); nonterm != end_nonterminal_symbol(); ++nonterm) {
+        // Repeating items are flattened into lists, and guards have no nodes, so these are never collapsed
+        item::kind ntKind = nonterm->item->type();
+        if (ntKind == item::guard || ntKind == item::repeat || ntKind == item::repeat_zero_or_one) continue;
+
+        // Nonterminals can be named with or without their angle brackets
+        if (option_contains(collapseNonterminals, nonterm->name)) {
+            usedNames.insert(nonterm->name);
+        } else if (option_contains(collapseNonterminals, L"<" + nonterm->name + L">")) {
+            usedNames.insert(L"<" + nonterm->name + L">");
+        } else if (!collapseAll) {
+            continue;
+        }
+
+        collapsible.insert(nonterm->identifier);
+    }
+
+    // Stop pruning rules that would be confused with one another until there are none left
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        collapse_unit_rules(collapsible);
+
+        for (nonterminal_symbol_iterator nonterm = begin_nonterminal_symbol(); nonterm != end_nonterminal_symbol(); ++nonterm) {
+            if (nonterm->item->type() == item::guard) continue;
+
+            // Group the rules for this nonterminal by the shape of the node they create
+            const ast_nonterminal&      ntDefn = get_ast_nonterminal(nonterm->identifier);
+            map<string, vector<int> >   rulesForShape;
+
+            for (ast_nonterminal_rules::const_iterator ruleDefn = ntDefn.rules.begin(); ruleDefn != ntDefn.rules.end(); ++ruleDefn) {
+                string shape = pruned_rule_shape(nonterm->item, ruleDefn->first, ruleDefn->second);
+                if (!shape.empty()) {
+                    rulesForShape[shape].push_back(ruleDefn->first);
+                }
+            }
+
+            for (map<string, vector<int> >::const_iterator shape = rulesForShape.begin(); shape != rulesForShape.end(); ++shape) {
+                if (shape->second.size() < 2) continue;
+
+                // Nonterminals stored as a plain syntax_node can't be told apart, so stop collapsing them first
+                bool uncollapsed = false;
+                for (vector<int>::const_iterator ruleId = shape->second.begin(); ruleId != shape->second.end(); ++ruleId) {
+                    if (m_CollapsedRules.find(*ruleId) != m_CollapsedRules.end()) continue;
+
+                    const ast_rule_item_list& rule = ntDefn.rules.find(*ruleId)->second;
+                    for (ast_rule_item_list::const_iterator ruleItem = rule.begin(); ruleItem != rule.end(); ++ruleItem) {
+                        if (ruleItem->isTerminal || !has_ast_value(*ruleId, *ruleItem)) continue;
+
+                        int nonterminalId = gram().identifier_for_item(ruleItem->item);
+                        if (m_CollapsedNonterminals.find(nonterminalId) == m_CollapsedNonterminals.end()) continue;
+
+                        collapsible.erase(nonterminalId);
+                        uncollapsed = true;
+                    }
+                }
+
+                if (uncollapsed) {
+                    changed = true;
+                    continue;
+                }
+
+                // Leave the rules unpruned if they still share a shape
+                for (vector<int>::const_iterator ruleId = shape->second.begin(); ruleId != shape->second.end(); ++ruleId) {
+                    if (m_UnprunedRules.insert(*ruleId).second) {
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    // The parser doesn't need to create nodes for terminals that are elided from every rule
+    m_UnbuiltTerminals = m_ElidedTerminals;
+
+    for (nonterminal_symbol_iterator nonterm = begin_nonterminal_symbol(); nonterm != end_nonterminal_symbol(); ++nonterm) {
+        if (nonterm->item->type() == item::guard) continue;
+
+        const ast_nonterminal& ntDefn = get_ast_nonterminal(nonterm->identifier);
+        for (ast_nonterminal_rules::const_iterator ruleDefn = ntDefn.rules.begin(); ruleDefn != ntDefn.rules.end(); ++ruleDefn) {
+            if (m_UnprunedRules.find(ruleDefn->first) == m_UnprunedRules.end()) continue;
+
+            for (ast_rule_item_list::const_iterator ruleItem = ruleDefn->second.begin(); ruleItem != ruleDefn->second.end(); ++ruleItem) {
+                if (ruleItem->isTerminal) {
+                    m_UnbuiltTerminals.erase(ruleItem->symbolId);
+                }
+            }
+        }
+    }
+
+    // Warn about any symbols that weren't found
+    vector<wstring> allNames = elideTerminals;
+    allNames.insert(allNames.end(), collapseNonterminals.begin(), collapseNonterminals.end());
+
+    for (vector<wstring>::const_iterator name = allNames.begin(); name != allNames.end(); ++name) {
+        if (usedNames.find(*name) != usedNames.end()) continue;
+
+        wstringstream msg;
+        msg << L"Cannot prune unknown symbol from the AST: " << *name;
+        cons().report_error(error(error::sev_warning, filename(), L"UNKNOWN_PRUNED_SYMBOL", msg.str(), position(-1, -1, -1)));
+    }
+}
+
+/// \brief Collapses the rules of the specified nonterminals that have only one item with a value in the AST
+void output_cplusplus::collapse_unit_rules(const set<int>& collapsible) {
+    m_CollapsedRules.clear();
+    m_CollapsedNonterminals.clear();
+
+    for (set<int>::const_iterator nonterminalId = collapsible.begin(); nonterminalId != collapsible.end(); ++nonterminalId) {
+        const ast_nonterminal& ntDefn = get_ast_nonterminal(*nonterminalId);
+
+        for (ast_nonterminal_rules::const_iterator ruleDefn = ntDefn.rules.begin(); ruleDefn != ntDefn.rules.end(); ++ruleDefn) {
+            // Unpruned rules always create their own node
+            if (m_UnprunedRules.find(ruleDefn->first) != m_UnprunedRules.end()) continue;
+
+            int     numValues   = 0;
+            size_t  child       = 0;
+
+            for (size_t index = 0; index < ruleDefn->second.size(); ++index) {
+                if (!has_ast_value(ruleDefn->first, ruleDefn->second[index])) continue;
+
+                numValues++;
+                child = index;
+            }
+
+            if (numValues == 1) {
+                m_CollapsedRules[ruleDefn->first] = child;
+                m_CollapsedNonterminals.insert(*nonterminalId);
+            }
+        }
+    }
+}
+
+/// \brief Describes the AST node built by a rule after pruning, or returns an empty string if it can't be mistaken for another rule
+///
+/// Rules with the same shape either have the same constructor or are collapsed into the same type of child. Rules
+/// where every item was elided are told apart by the rule ID passed to their constructor.
+string output_cplusplus::pruned_rule_shape(const item_container& nonterminal, int ruleId, const ast_rule_item_list& rule) {
+    // Collapsed rules can be told apart by the type of their child
+    map<int, size_t>::const_iterator collapsed = m_CollapsedRules.find(ruleId);
+    if (collapsed != m_CollapsedRules.end()) {
+        return "collapsed " + class_name_for_item(rule[collapsed->second].item) + s_TypeSuffix;
+    }
+
+    if (is_elided_rule(ruleId, rule)) return "";
+
+    // Only the rules that declare a constructor in a repeating item can be confused
+    if (nonterminal->type() == item::repeat && !rule.empty() && rule[0].isEbnfRepetition) return "";
+    if (nonterminal->type() == item::repeat_zero_or_one && rule.empty()) return "";
+
+    // Other rules are told apart by the parameters of their constructor
+    string shape = "constructor";
+    for (ast_rule_item_list::const_iterator ruleItem = rule.begin(); ruleItem != rule.end(); ++ruleItem) {
+        if (!has_ast_value(ruleId, *ruleItem)) continue;
+        if (ruleItem->isEbnfRepetition) continue;
+
+        shape += " " + ast_class_for_item(*ruleItem);
+    }
+
+    return shape;
+}
+
+/// \brief True if the specified item in a rule has a value in the AST (it is not a guard or an elided terminal)
+bool output_cplusplus::has_ast_value(int ruleId, const ast_rule_item& ruleItem) const {
+    if (ruleItem.item->type() == item::guard) return false;
+    if (!ruleItem.isTerminal) return true;
+    if (m_ElidedTerminals.find(ruleItem.symbolId) == m_ElidedTerminals.end()) return true;
+
+    // Unpruned rules keep their elided terminals
+    return m_UnprunedRules.find(ruleId) != m_UnprunedRules.end();
+}
+
+/// \brief True if the specified rule has items, but none of them have a value in the AST
+bool output_cplusplus::is_elided_rule(int ruleId, const ast_rule_item_list& rule) const {
+    bool hasItems = false;
+
+    for (ast_rule_item_list::const_iterator ruleItem = rule.begin(); ruleItem != rule.end(); ++ruleItem) {
+        if (ruleItem->item->type() == item::guard) continue;
+        if (ruleItem->isEbnfRepetition) continue;
+        if (has_ast_value(ruleId, *ruleItem)) return false;
+
+        hasItems = true;
+    }
+
+    return hasItems;
+}
+
+/// \brief The name of the AST class used to store the specified rule item
+///
+/// Nonterminals with collapsed rules can be replaced by their child, so these are stored as a plain syntax_node.
+std::string output_cplusplus::ast_class_for_item(const ast_rule_item& ruleItem) {
+    if (!ruleItem.isTerminal && m_CollapsedNonterminals.find(gram().identifier_for_item(ruleItem.item)) != m_CollapsedNonterminals.end()) {
+        return "syntax_node";
+    }
+
+    return class_name_for_item(ruleItem.item) + s_TypeSuffix;
+}
+
 /// \brief Writes out the forward declarations for the classes that represent items in the grammar
 void output_cplusplus::header_ast_forward_declarations() {
     // Write out the AST syntax base class
     *m_HeaderFile   << "\n"
                     << "public:\n"
-                    << "    class syntax_node {\n"
+                    << "    class syntax_node : public util::syntax_ptr_item {\n"
                     << "    public:\n"
                     << "        virtual ~syntax_node();\n"
                     << "        virtual std::wstring to_string();\n"
@@ -1182,6 +1854,10 @@ void output_cplusplus::header_ast_class_declarations() {
         // The names of the variables that are defined for this rule
         set<string> definedVariables;
 
+        // Rules with no values share a position field, and rules where every item was elided share a constructor
+        bool declaredPosition           = false;
+        bool declaredElidedConstructor  = false;
+
         // Iterate through the rules
         for (ast_nonterminal_rules::const_iterator ruleDefn = ntDefn.rules.begin(); ruleDefn != ntDefn.rules.end(); ++ruleDefn) {
             int ruleIdentifier = ruleDefn->first;
@@ -1190,11 +1866,17 @@ void output_cplusplus::header_ast_class_declarations() {
             *m_HeaderFile << "\n    public:\n";
             *m_HeaderFile << "        // Rule " << ruleIdentifier << "\n";
 
+            // Rules that are collapsed into their child never create a node of this type
+            if (m_CollapsedRules.find(ruleIdentifier) != m_CollapsedRules.end()) {
+                *m_HeaderFile << "        // (collapsed into its child)\n";
+                continue;
+            }
+
             // Iterate through the items in this rule to create the variables used to store them
             bool validItems = false;
             for (ast_rule_item_list::const_iterator ruleItem = ruleDefn->second.begin(); ruleItem != ruleDefn->second.end(); ++ruleItem) {
-                // Guard items don't get variables
-                if (ruleItem->item->type() == item::guard) continue;
+                // Guard items and elided terminals don't get variables
+                if (!has_ast_value(ruleDefn->first, *ruleItem)) continue;
 
                 // The EBNF repeat item doesn't get its own variable within a content item
                 if (ruleItem->isEbnfRepetition) {
@@ -1212,10 +1894,10 @@ void output_cplusplus::header_ast_class_declarations() {
 
                 if (definedVariables.find(varName) == definedVariables.end()) {
                     // Get the type name for this variable
-                    string typeName = class_name_for_item(ruleItem->item);
+                    string typeName = ast_class_for_item(*ruleItem);
 
                     // Add a variable declaration
-                    *m_HeaderFile << "        const util::syntax_ptr<" << typeName << s_TypeSuffix << "> " << varName << ";\n";
+                    *m_HeaderFile << "        const util::syntax_ptr<" << typeName << "> " << varName << ";\n";
 
                     // This item is now defined for this class
                     definedVariables.insert(varName);
@@ -1225,11 +1907,14 @@ void output_cplusplus::header_ast_class_declarations() {
             }
 
             // If there are no valid items then we need to declare a position field
-            if (!validItems) {
-                // Presumably there's only one of these
+            if (!validItems && !declaredPosition) {
                 *m_HeaderFile << "        dfa::position m_Position;";
+                declaredPosition = true;
             }
 
+            // Rules where every item was elided have a single constructor that takes the rule ID
+            bool elidedRule = is_elided_rule(ruleDefn->first, ruleDefn->second);
+
             // Declare the constructor for this rule if necessary
             bool declareConstructor = true;
 
@@ -1251,6 +1936,11 @@ void output_cplusplus::header_ast_class_declarations() {
                 }
             }
 
+            if (elidedRule) {
+                if (declaredElidedConstructor) declareConstructor = false;
+                declaredElidedConstructor = true;
+            }
+
             // Declare a constructor for this rule
             if (declareConstructor) {
                 *m_HeaderFile   << "\n    public:\n"
@@ -1260,8 +1950,8 @@ void output_cplusplus::header_ast_class_declarations() {
                 bool    first = true;
                 int     index = 0;
                 for (ast_rule_item_list::const_iterator ruleItem = ruleDefn->second.begin(); ruleItem != ruleDefn->second.end(); ++ruleItem) {
-                    // Ignore guards
-                    if (ruleItem->item->type() == item::guard) continue;
+                    // Ignore guards and elided terminals
+                    if (!has_ast_value(ruleDefn->first, *ruleItem)) continue;
 
                     // Ignore repetitions
                     if (ruleItem->isEbnfRepetition) continue;
@@ -1276,7 +1966,7 @@ void output_cplusplus::header_ast_class_declarations() {
                     }
 
                     // Declare as a reference to the syntax pointer
-                    *m_HeaderFile << "const util::syntax_ptr<class " << typeName << s_TypeSuffix << ">& " << typeName << "_" << index;
+                    *m_HeaderFile << "const util::syntax_ptr<class " << ast_class_for_item(*ruleItem) << ">& " << typeName << "_" << index;
 
                     // No longer the first rule
                     first = false;
@@ -1284,7 +1974,9 @@ void output_cplusplus::header_ast_class_declarations() {
                 }
 
                 // If there were no valid items, then we need to add a position to this constructor
-                if (!validItems) {
+                if (elidedRule) {
+                    *m_HeaderFile << "int rule, const dfa::position& pos";
+                } else if (!validItems) {
                     *m_HeaderFile << "const dfa::position& pos";
                 }
 
@@ -1365,8 +2057,29 @@ void output_cplusplus::source_ast_class_constructors() {
             ntName += s_ContentSuffix;
         }
 
+        // Rules where every item was elided share a constructor
+        bool wroteElidedConstructor = false;
+
         // Write out a constructor for each rule for this nonterminal
         for (ast_nonterminal_rules::const_iterator ruleDefn = ntDefn.rules.begin(); ruleDefn != ntDefn.rules.end(); ++ruleDefn) {
+            // Rules that are collapsed into their child don't need a constructor
+            if (m_CollapsedRules.find(ruleDefn->first) != m_CollapsedRules.end()) {
+                continue;
+            }
+
+            // Rules where every item was elided take the rule ID as a parameter
+            if (is_elided_rule(ruleDefn->first, ruleDefn->second)) {
+                if (wroteElidedConstructor) continue;
+                wroteElidedConstructor = true;
+
+                *m_SourceFile   << "\n// Rules with no values\n"
+                                << get_identifier(m_ClassName, false) << "::" << ntName << "::" << ntName << "(int rule, const dfa::position& pos)\n"
+                                << ": m_Rule(rule)\n"
+                                << ", m_Position(pos) {\n"
+                                << "}\n";
+                continue;
+            }
+
             // Decide if we need to declare a constructor for this rule
             // The EBNF closures only need a single constructor, as we flatten them into vectors
             if (nonterm->item->type() == item::repeat) {
@@ -1395,8 +2108,8 @@ void output_cplusplus::source_ast_class_constructors() {
             bool    first = true;
             int     index = 0;
             for (ast_rule_item_list::const_iterator ruleItem = ruleDefn->second.begin(); ruleItem != ruleDefn->second.end(); ++ruleItem) {
-                // Ignore guards
-                if (ruleItem->item->type() == item::guard) continue;
+                // Ignore guards and elided terminals
+                if (!has_ast_value(ruleDefn->first, *ruleItem)) continue;
 
                 // Ignore repetitions
                 if (ruleItem->isEbnfRepetition) continue;
@@ -1411,7 +2124,7 @@ void output_cplusplus::source_ast_class_constructors() {
                 }
 
                 // Declare as a reference to the syntax pointer
-                *m_SourceFile << "const util::syntax_ptr<class " << typeName << s_TypeSuffix << ">& " << typeName << "_" << index;
+                *m_SourceFile << "const util::syntax_ptr<class " << ast_class_for_item(*ruleItem) << ">& " << typeName << "_" << index;
 
                 // No longer the first rule
                 first = false;
@@ -1436,8 +2149,8 @@ void output_cplusplus::source_ast_class_constructors() {
             // Fill in the initialisers from the rule
             index = 0;
             for (ast_rule_item_list::const_iterator ruleItem = ruleDefn->second.begin(); ruleItem != ruleDefn->second.end(); ++ruleItem) {
-                // Ignore guards
-                if (ruleItem->item->type() == item::guard) continue;
+                // Ignore guards and elided terminals
+                if (!has_ast_value(ruleDefn->first, *ruleItem)) continue;
 
                 // Ignore repetitions
                 if (ruleItem->isEbnfRepetition) continue;
@@ -1496,14 +2209,17 @@ void output_cplusplus::source_ast_position_functions() {
         
         // The container of the initial position depends on which rule was matched
         for (ast_nonterminal_rules::const_iterator ruleDefn = astNt.rules.begin(); ruleDefn != astNt.rules.end(); ++ruleDefn) {
+            // Rules that are collapsed into their child never create a node of this type
+            if (m_CollapsedRules.find(ruleDefn->first) != m_CollapsedRules.end()) continue;
+
             // In case we get this rule...
             *m_SourceFile << "\n    case " << ruleDefn->first << ":\n";
 
             // Iterate through the items in the rule to find the first one that has a variable declared
             bool foundValid = false;
             for (ast_rule_item_list::const_iterator ruleItem = ruleDefn->second.begin(); ruleItem != ruleDefn->second.end(); ++ruleItem) {
-                // Guard items don't get variables
-                if (ruleItem->item->type() == item::guard) continue;
+                // Guard items and elided terminals don't get variables
+                if (!has_ast_value(ruleDefn->first, *ruleItem)) continue;
 
                 // Neither does the 'repeat' item of a * or + closure
                 if (repeatingItem && ruleItem->item->type() == nonterm->item->type() && ruleItem->item->symbol() == nonterm->item->symbol()) {
@@ -1538,14 +2254,17 @@ void output_cplusplus::source_ast_position_functions() {
 
         // The container of the final position depends on which rule was matched
         for (ast_nonterminal_rules::const_iterator ruleDefn = astNt.rules.begin(); ruleDefn != astNt.rules.end(); ++ruleDefn) {
+            // Rules that are collapsed into their child never create a node of this type
+            if (m_CollapsedRules.find(ruleDefn->first) != m_CollapsedRules.end()) continue;
+
             // In case we get this rule...
             *m_SourceFile << "\n    case " << ruleDefn->first << ":\n";
 
             // Iterate through the items in the rule to find the last one that has a variable declared
             bool foundValid = false;
             for (ast_rule_item_list::const_reverse_iterator ruleItem = ruleDefn->second.rbegin(); ruleItem != ruleDefn->second.rend(); ++ruleItem) {
-                // Guard items don't get variables
-                if (ruleItem->item->type() == item::guard) continue;
+                // Guard items and elided terminals don't get variables
+                if (!has_ast_value(ruleDefn->first, *ruleItem)) continue;
 
                 // Neither does the 'repeat' item of a * or + closure
                 if (repeatingItem && ruleItem->item->type() == nonterm->item->type() && ruleItem->item->symbol() == nonterm->item->symbol()) {
@@ -1596,20 +2315,22 @@ void output_cplusplus::header_parser_actions() {
                     << "    class parser_actions {\n"
                     << "    public:\n"
                     << "        typedef util::syntax_ptr<syntax_node> node;\n"
-                    << "        typedef lr::parser<node, parser_actions> parser;\n"
+                    << "        typedef lr::parser<node, parser_actions, lr::no_parser_trace, lr_features> parser;\n"
                     << "        typedef parser::reduce_list reduce_list;\n"
                     << "\n"
                     << "    private:\n"
                     << "        dfa::lexeme_stream* m_Stream;\n"
                     << "        bool m_OwnStream;\n"
+                    << "        util::arena* m_Arena;\n"
                     << "\n"
                     << "        parser_actions(parser_actions& noCopying);\n"
                     << "        parser_actions& operator=(const parser_actions& noCopying);\n"
                     << "\n"
                     << "    public:\n"
-                    << "        parser_actions(dfa::lexeme_stream* stream, bool ownStream = false)\n"
+                    << "        parser_actions(dfa::lexeme_stream* stream, bool ownStream = false, util::arena* arena = NULL)\n"
                     << "        : m_Stream(stream)\n"
-                    << "        , m_OwnStream(ownStream) { }\n"
+                    << "        , m_OwnStream(ownStream)\n"
+                    << "        , m_Arena(arena) { }\n"
                     << "\n"
                     << "        ~parser_actions() {\n"
                     << "            if (m_OwnStream && m_Stream) {\n"
@@ -1648,13 +2369,19 @@ void output_cplusplus::source_shift_actions() {
         name += s_TypeSuffix;
 
         // Declare a shift action for this symbol
-        *m_SourceFile   << "\n    case " << term->identifier << ": // " << get_identifier(terminals().name_for_symbol(term->identifier), true) << "\n"
-                        << "        return node(new " << name << "(lexeme));\n";
+        *m_SourceFile   << "\n    case " << term->identifier << ": // " << get_identifier(terminals().name_for_symbol(term->identifier), true) << "\n";
+
+        // Elided terminals don't get a node
+        if (m_UnbuiltTerminals.find(term->identifier) != m_UnbuiltTerminals.end()) {
+            *m_SourceFile << "        return node();\n";
+        } else {
+            *m_SourceFile << "        return node(new (m_Arena) " << name << "(lexeme), m_Arena);\n";
+        }
     }
                     
     // Default actions is to create an empty node
     *m_SourceFile   << "\n    default:\n"
-                    << "        return node(new terminal(lexeme));\n"
+                    << "        return node(new (m_Arena) terminal(lexeme), m_Arena);\n"
                     << "    }\n"
                     << "}\n";
 }
@@ -1693,6 +2420,14 @@ void output_cplusplus::source_reduce_actions() {
             *m_SourceFile   << "\n    case " << ruleDefn->first << ":\n"
                             << "    {\n";
 
+            // Rules that are collapsed just return their child
+            map<int, size_t>::const_iterator collapsed = m_CollapsedRules.find(ruleDefn->first);
+            if (collapsed != m_CollapsedRules.end()) {
+                *m_SourceFile   << "        return reduce[" << collapsed->second << "];\n"
+                                << "    }\n";
+                continue;
+            }
+
             // TODO: we have the rules for this in three separate places now: factor into a function
             bool hasConstructor = true;
             bool repeating      = false;
@@ -1727,10 +2462,10 @@ void output_cplusplus::source_reduce_actions() {
             if (hasConstructor || nonterm->item->type() == item::repeat) {
                 if (nonterm->item->type() == item::repeat || nonterm->item->type() == item::repeat_zero_or_one) {
                     // For repeating items, we construct the content into a variable
-                    *m_SourceFile << "        util::syntax_ptr<class " << ntContentClass << "> content(new " << ntContentClass << "(";
+                    *m_SourceFile << "        util::syntax_ptr<class " << ntContentClass << "> content(new (m_Arena) " << ntContentClass << "(";
                 } else {
                     // For non-repeating items, just return the item directly
-                    *m_SourceFile << "        return node(new " << ntContentClass << "(";
+                    *m_SourceFile << "        return node(new (m_Arena) " << ntContentClass << "(";
                 }
 
                 // Generate the constructor parameters
@@ -1739,14 +2474,14 @@ void output_cplusplus::source_reduce_actions() {
                     // Get the item at this index
                     const ast_rule_item& ruleItem = ruleDefn->second[index];
 
-                    // Guard items are ignored
-                    if (ruleItem.item->type() == item::guard) continue;
+                    // Guard items and elided terminals are ignored
+                    if (!has_ast_value(ruleDefn->first, ruleItem)) continue;
 
                     // ... as are repetition items
                     if (ruleItem.isEbnfRepetition) continue;
 
                     // Other items are put into the constructor
-                    string typeName = class_name_for_item(ruleItem.item);
+                    string typeName = ast_class_for_item(ruleItem);
 
                     // Add commas to separate the values
                     if (!first) {
@@ -1754,19 +2489,18 @@ void output_cplusplus::source_reduce_actions() {
                     }
                     first = false;
 
-                    // The reduce list is passed in in reverse
-                    size_t reduceIndex = ruleDefn->second.size() - index - 1;
-
-                    // Cast to the type
-                    *m_SourceFile  << "reduce[" << reduceIndex << "].cast_to<" << typeName << s_TypeSuffix << ">()";
+                    // Cast to the type (the reduce list is in rule order)
+                    *m_SourceFile  << "reduce[" << index << "].cast_to<" << typeName << ">()";
                 }
 
                 // If there aren't any valid items, then pass in the lookahead position (these items will take a position parameter)
-                if (first) {
+                if (first && is_elided_rule(ruleDefn->first, ruleDefn->second)) {
+                    *m_SourceFile << ruleDefn->first << ", lookaheadPosition";
+                } else if (first) {
                     *m_SourceFile << "lookaheadPosition";
                 }
 
-                *m_SourceFile << "));\n";
+                *m_SourceFile << "), m_Arena);\n";
             }
 
             // For repeating items either create or retrieve the node
@@ -1774,7 +2508,7 @@ void output_cplusplus::source_reduce_actions() {
                 // The constructor is delcared for the item that contains the repetition
                 if (!hasConstructor && nonterm->item->type() == item::repeat_zero_or_one) {
                     // This is the empty rule in a zero-or-more repetition: create an empty item
-                    *m_SourceFile << "        return node(new " << ntName << "());\n";
+                    *m_SourceFile << "        return node(new (m_Arena) " << ntName << "(), m_Arena);\n";
                 } else {
                     // Get the node where the definition is being built up
                     *m_SourceFile << "        util::syntax_ptr<class " << ntName << "> list(";
@@ -1782,10 +2516,10 @@ void output_cplusplus::source_reduce_actions() {
                     // If the first item is a repetition then use that, otherwise create a new item
                     if (!ruleDefn->second.empty() && ruleDefn->second[0].isEbnfRepetition) {
                         // The first item is the repetition
-                        *m_SourceFile << "reduce[" << ruleDefn->second.size()-1 << "].cast_to<" << ntName << ">());\n";
+                        *m_SourceFile << "reduce[0].cast_to<" << ntName << ">());\n";
                     } else {
                         // Need to create a new item
-                        *m_SourceFile << "new " << ntName << "());\n";
+                        *m_SourceFile << "new (m_Arena) " << ntName << "(), m_Arena);\n";
 
                         // Set the position (hideous const cast, sigh)
                         *m_SourceFile << "        const_cast<" << ntName << "*>(list.item())->set_position(lookaheadPosition);\n";
@@ -65,6 +65,21 @@ namespace compiler {
         /// \brief The used class (and other identifier) names for the class (which should not be re-used)
         std::set<std::string> m_UsedClassNames;
 
+        /// \brief The terminal symbols that are left out of the AST
+        std::set<int> m_ElidedTerminals;
+
+        /// \brief The elided terminals that aren't needed by any rule, so the parser doesn't create nodes for them
+        std::set<int> m_UnbuiltTerminals;
+
+        /// \brief Rules that are left as they are, as pruning them would make them impossible to tell apart from another rule
+        std::set<int> m_UnprunedRules;
+
+        /// \brief The nonterminals with at least one rule that is collapsed into its only child
+        std::set<int> m_CollapsedNonterminals;
+
+        /// \brief Maps the IDs of rules that are collapsed into their only child to the index of that child within the rule
+        std::map<int, size_t> m_CollapsedRules;
+
     public:
         /// \brief Creates a new output stage
         output_cplusplus(console_container& console, const std::wstring& filename, lexer_stage* lexer, language_stage* language, lr_parser_stage* parser, const std::wstring& filenamePrefix, const std::wstring& className, const std::wstring& namespaceName);
@@ -113,6 +128,24 @@ namespace compiler {
         /// \brief Writes out the source code for the parser tables
         void source_parser_tables();
 
+        /// \brief Works out which terminals should be left out of the AST and which rules should be collapsed into their child
+        void find_pruned_ast_items();
+
+        /// \brief Collapses the rules of the specified nonterminals that have only one item with a value in the AST
+        void collapse_unit_rules(const std::set<int>& collapsible);
+
+        /// \brief Describes the AST node built by a rule after pruning, or returns an empty string if it can't be mistaken for another rule
+        std::string pruned_rule_shape(const contextfree::item_container& nonterminal, int ruleId, const ast_rule_item_list& rule);
+
+        /// \brief True if the specified item in a rule has a value in the AST (it is not a guard or an elided terminal)
+        bool has_ast_value(int ruleId, const ast_rule_item& ruleItem) const;
+
+        /// \brief True if the specified rule has items, but none of them have a value in the AST
+        bool is_elided_rule(int ruleId, const ast_rule_item_list& rule) const;
+
+        /// \brief The name of the AST class used to store the specified rule item
+        std::string ast_class_for_item(const ast_rule_item& ruleItem);
+
         /// \brief Writes out the forward declarations for the classes that represent nonterminals
         void header_ast_forward_declarations();
 
@@ -140,6 +173,15 @@ namespace compiler {
         /// \brief Writes out inline functions to generate initial parser states for specific start symbols
         void header_start_symbols();
 
+        /// \brief True if the parser should be written out as code rather than being interpreted from the tables
+        bool write_direct_parser();
+
+        /// \brief Writes out the declarations for the direct-coded parser
+        void header_direct_parser();
+
+        /// \brief Writes out the states of the parser as code
+        void source_direct_parser();
+
     protected:
         // Functions that represent various steps of the output of a language.
         // These are intended to make it easy to write out a file in the specified language.
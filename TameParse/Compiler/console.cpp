@@ -25,6 +25,8 @@
 //  IN THE SOFTWARE.
 //
 
+#include <cstdio>
+
 #include "TameParse/Compiler/console.h"
 
 using namespace std;
@@ -126,3 +128,15 @@ std::vector<std::wstring> console::split_path(const std::wstring& pathname) {
     // This is the result
     return res;
 }
+
+/// \brief Renames a file, replacing any existing file with the new name. Returns false if the file couldn't be renamed.
+///
+/// The default implementation uses std::rename, which replaces the file atomically on POSIX systems.
+bool console::rename_file(const std::wstring& oldName, const std::wstring& newName) {
+    return std::rename(convert_filename(oldName).c_str(), convert_filename(newName).c_str()) == 0;
+}
+
+/// \brief Deletes the file with the specified name, returning false if it couldn't be removed
+bool console::remove_file(const std::wstring& filename) {
+    return std::remove(convert_filename(filename).c_str()) == 0;
+}
@@ -131,6 +131,14 @@ namespace compiler {
         ///
         /// (This is an annoying compromise added to deal with C++'s completely useless support for locales and unicode)
         virtual std::ostream* open_binary_file_for_writing(const std::wstring& filename) = 0;
+
+        /// \brief Renames a file, replacing any existing file with the new name. Returns false if the file couldn't be renamed.
+        ///
+        /// The default implementation uses std::rename, which replaces the file atomically on POSIX systems.
+        virtual bool rename_file(const std::wstring& oldName, const std::wstring& newName);
+
+        /// \brief Deletes the file with the specified name, returning false if it couldn't be removed
+        virtual bool remove_file(const std::wstring& filename);
     };
     
     typedef util::container<console> console_container;
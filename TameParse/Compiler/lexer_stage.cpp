@@ -30,7 +30,12 @@
 //       wouldn't really fix the problem, and would just create a new 'giant constructor of doom' problem)
 
 #include <sstream>
+#include <memory>
+#include <iterator>
+#include <random>
+#include <chrono>
 #include "TameParse/Compiler/lexer_stage.h"
+#include "TameParse/version.h"
 
 using namespace std;
 using namespace dfa;
@@ -103,6 +108,89 @@ namespace compiler {
             // Unit types should be the same otherwise
             return m_UnitType == compareToLanguageAction->m_UnitType;
         }
+        
+        /// \brief The type of language unit that this action was defined in
+        inline language_unit::unit_type unit_type() const { return m_UnitType; }
+        
+        /// \brief True if this action is for a weak symbol
+        inline bool is_weak() const { return m_IsWeak; }
+    };
+    
+    ///
+    /// \brief Computes a hash of the values that are used to build a lexer
+    ///
+    /// This is a 64-bit FNV-1a hash. It only needs to be stable between runs (so the standard library hash functions
+    /// won't do) and good enough that two different lexer definitions are very unlikely to be given the same name.
+    ///
+    class lexer_definition_hash {
+    private:
+        /// \brief The hash so far
+        unsigned long long m_Hash;
+        
+    public:
+        lexer_definition_hash()
+        : m_Hash(14695981039346656037ULL) {
+        }
+        
+        /// \brief Adds an integer value to this hash
+        void add(int value) {
+            for (int byte = 0; byte < 4; ++byte) {
+                m_Hash ^= (unsigned long long) ((value >> (byte * 8)) & 0xff);
+                m_Hash *= 1099511628211ULL;
+            }
+        }
+        
+        /// \brief Adds a string to this hash
+        void add(const wstring& value) {
+            add((int) value.size());
+            for (wstring::const_iterator chr = value.begin(); chr != value.end(); ++chr) {
+                add((int) *chr);
+            }
+        }
+        
+        /// \brief Adds the bytes in a narrow string to this hash
+        void add(const string& value) {
+            add((int) value.size());
+            for (string::const_iterator chr = value.begin(); chr != value.end(); ++chr) {
+                add((int) (unsigned char) *chr);
+            }
+        }
+        
+        /// \brief Adds a set of integers to this hash
+        void add(const set<int>& values) {
+            add((int) values.size());
+            for (set<int>::const_iterator value = values.begin(); value != values.end(); ++value) {
+                add(*value);
+            }
+        }
+        
+        /// \brief Adds a set of lexer definitions to this hash
+        void add(lexer_data::iterator begin, lexer_data::iterator end) {
+            for (lexer_data::iterator itemList = begin; itemList != end; ++itemList) {
+                add(itemList->first);
+                add((int) itemList->second.size());
+                
+                for (lexer_data::item_list::const_iterator item = itemList->second.begin(); item != itemList->second.end(); ++item) {
+                    add((int) item->type);
+                    add(item->definition);
+                    add(item->case_insensitive ? 1 : 0);
+                    add(item->case_sensitive ? 1 : 0);
+                    add(item->symbol);
+                    add((int) item->definition_type);
+                    add(item->is_weak ? 1 : 0);
+                }
+            }
+        }
+        
+        /// \brief The hash as a string of hex digits
+        wstring to_string() const {
+            wstringstream result;
+            result << hex;
+            result.width(16);
+            result.fill(L'0');
+            result << m_Hash;
+            return result.str();
+        }
     };
 
     /// \brief Class that extends ndfa_regex to support taking expressions from a lexer_data object
@@ -198,7 +286,8 @@ lexer_stage::lexer_stage(console_container& console, const std::wstring& filenam
 , m_Language(languageCompiler)
 , m_WeakSymbols(languageCompiler->grammar())
 , m_Dfa(NULL)
-, m_Lexer(NULL) {
+, m_Lexer(NULL)
+, m_Keywords(NULL) {
 }
 
 /// \brief Destroys the lexer compiler
@@ -211,6 +300,10 @@ lexer_stage::~lexer_stage() {
     if (m_Lexer) {
         delete m_Lexer;
     }
+    
+    if (m_Keywords) {
+        delete m_Keywords;
+    }
 }
 
 /// \brief Reports any errors that might have occurred in the specified regular expression
@@ -268,28 +361,13 @@ void lexer_stage::check_regex(dfa::ndfa_regex* ndfa, const std::wstring& regex,
     }
 }
 
-/// \brief Compiles the lexer
-void lexer_stage::compile() {
-    // Grab the input
-    const lexer_data*       lex             = m_Language->lexer();
-    terminal_dictionary*    terminals       = m_Language->terminals();
-    const set<int>*         weakSymbolIds   = m_Language->weak_symbols();
-    
-    // Reset the weak symbols
-    m_WeakSymbols = lr::weak_symbols(m_Language->grammar());
-    
-    // Sanity check
-    if (!lex || !terminals || !weakSymbolIds) {
-        cons().report_error(error(error::sev_bug, filename(), L"BUG_LEXER_BAD_PARAMETERS", L"Missing input for the lexer stage", position(-1, -1, -1)));
-        return;
-    }
-    
-    // Output a staging message
-    cons().verbose_stream() << L"  = Constructing final lexer" << endl;
-
-    // Create the ndfa
+/// \brief Adds the symbols defined by the lexer data for the language to an NDFA
+///
+/// Literal items in the excluded set are left out, as are all literals if regexOnly is true. Errors in the regular
+/// expressions and lexer items are only reported if reportErrors is true.
+void lexer_stage::add_lexer_items(ndfa_regex* stage0, const set<const lexer_item*>& excluded, bool regexOnly, bool reportErrors) {
     typedef lexer_data::item_list item_list;
-    ndfa_lexer_compiler*    stage0 = new ndfa_lexer_compiler(lex);
+    const lexer_data* lex = m_Language->lexer();
 
     ndfa::builder   ignoreBuilder   = stage0->get_cons();
     bool            firstIgnore     = true;
@@ -303,7 +381,7 @@ void lexer_stage::compile() {
         // Iterate through each individual item
         for (item_list::const_iterator item = itemList->second.begin(); item != itemList->second.end(); ++item) {
             // Check the regular expressions for validity
-            if (item->type == lexer_item::regex) {
+            if (item->type == lexer_item::regex && reportErrors) {
                 check_regex(stage0, item->definition, item->filename, item->position);
             }
         }
@@ -315,7 +393,9 @@ void lexer_stage::compile() {
         for (item_list::const_iterator item = itemList->second.begin(); item != itemList->second.end(); ++item) {
             // Ignore items without a valid accept action (this is a bug)
             if (item->definition_type == language_unit::unit_null) {
-                cons().report_error(error(error::sev_bug, filename(), L"BUG_MISSING_ACTION", L"Missing action for lexer symbol", position(-1, -1, -1)));
+                if (reportErrors) {
+                    cons().report_error(error(error::sev_bug, filename(), L"BUG_MISSING_ACTION", L"Missing action for lexer symbol", position(-1, -1, -1)));
+                }
                 continue;
             }
 
@@ -341,7 +421,9 @@ void lexer_stage::compile() {
             switch (item->type) {
                 case lexer_item::regex:
                     // Check
-                    check_regex(stage0, item->definition, item->filename, item->position);
+                    if (reportErrors) {
+                        check_regex(stage0, item->definition, item->filename, item->position);
+                    }
 
                     // Compile
                     if (blandIgnore) {
@@ -363,6 +445,11 @@ void lexer_stage::compile() {
                     break;
 
                 case lexer_item::literal:
+                    // Leave out keywords that are found with the keyword table, and all literals if only regular expressions are wanted
+                    if (regexOnly || excluded.find(&*item) != excluded.end()) {
+                        break;
+                    }
+
                     if (blandIgnore) {
                         // Combine 'bland' ignored items into a single symbol
                         if (!firstIgnore) {
@@ -402,6 +489,232 @@ void lexer_stage::compile() {
         // Set the symbol
         ignoreBuilder >> language_accept_action(ignoreSymbol, language_unit::unit_ignore_definition, false);
     }
+}
+
+/// \brief Chooses the literal symbols that can be left out of the DFA and found using the keyword table instead
+///
+/// A literal can be left out if every way of writing it is matched by the same symbol in the rest of the lexer, and
+/// the literal would be chosen over that symbol. Leaving it out then doesn't change where lexemes end, and the
+/// lexeme can be changed to the literal's symbol by looking up its text after the DFA has matched it.
+void lexer_stage::find_keywords(set<const lexer_item*>& keywordItems, keyword_map& keywordStrong) {
+    typedef lexer_data::item_list item_list;
+    const lexer_data*   lex             = m_Language->lexer();
+    const set<int>*     weakSymbolIds   = m_Language->weak_symbols();
+    
+    // Find the literals that might be keywords, and count how many literals share the same text (ignoring case).
+    // Literals that share their text with another literal are left in the DFA so that it can choose between them.
+    map<wstring, int>           literalCount;
+    vector<const lexer_item*>   candidates;
+    
+    for (lexer_data::iterator itemList = lex->begin(); itemList != lex->end(); ++itemList) {
+        for (item_list::const_iterator item = itemList->second.begin(); item != itemList->second.end(); ++item) {
+            if (item->type != lexer_item::literal) continue;
+            
+            wstring folded;
+            bool    isAscii = true;
+            for (wstring::const_iterator chr = item->definition.begin(); chr != item->definition.end(); ++chr) {
+                if (*chr < 0 || *chr >= 0x80) isAscii = false;
+                folded += (wchar_t) keyword_table::fold(*chr);
+            }
+            
+            ++literalCount[folded];
+            
+            if (isAscii && !item->definition.empty() 
+                && item->definition_type != language_unit::unit_null 
+                && item->definition_type != language_unit::unit_ignore_definition) {
+                candidates.push_back(&*item);
+            }
+        }
+    }
+    
+    if (candidates.empty()) return;
+    
+    // Build a DFA from just the regular expressions. A literal is accepted by the same regular expressions no matter
+    // what else is in the lexer, so this tells us which symbol would be matched if the literal was left out.
+    ndfa_lexer_compiler* regexNdfa = new ndfa_lexer_compiler(lex);
+    add_lexer_items(regexNdfa, set<const lexer_item*>(), true, false);
+    
+    ndfa* regexUnique = regexNdfa->to_ndfa_with_unique_symbols();
+    delete regexNdfa;
+    
+    ndfa* regexDfa = regexUnique->to_dfa();
+    delete regexUnique;
+    
+    // Build the keyword table
+    m_Keywords = new keyword_table();
+    
+    for (vector<const lexer_item*>::const_iterator candidate = candidates.begin(); candidate != candidates.end(); ++candidate) {
+        const lexer_item*   item            = *candidate;
+        bool                caseInsensitive = item->case_insensitive;
+        wstring             folded;
+        
+        for (wstring::const_iterator chr = item->definition.begin(); chr != item->definition.end(); ++chr) {
+            folded += (wchar_t) keyword_table::fold(*chr);
+        }
+        if (literalCount[folded] != 1) continue;
+        
+        // Run the DFA over every case variant of the keyword at once
+        set<int> states;
+        states.insert(0);
+        
+        for (wstring::const_iterator chr = item->definition.begin(); chr != item->definition.end() && !states.empty(); ++chr) {
+            int variants[2] = { *chr, *chr };
+            if (caseInsensitive) {
+                variants[0] = (int) keyword_table::fold(*chr);
+                variants[1] = (variants[0] >= 'a' && variants[0] <= 'z') ? variants[0] - ('a' - 'A') : variants[0];
+            }
+            
+            set<int> nextStates;
+            for (set<int>::const_iterator stateId = states.begin(); stateId != states.end(); ++stateId) {
+                const state& thisState = regexDfa->get_state(*stateId);
+                
+                for (int variant = 0; variant < 2; ++variant) {
+                    int target = -1;
+                    for (state::iterator transit = thisState.begin(); transit != thisState.end(); ++transit) {
+                        if (regexDfa->symbols()[transit->symbol_set()][variants[variant]]) {
+                            target = transit->new_state();
+                            break;
+                        }
+                    }
+                    
+                    // If any variant is rejected, then this can't be a keyword
+                    if (target < 0) {
+                        nextStates.clear();
+                        break;
+                    }
+                    nextStates.insert(target);
+                }
+                
+                if (nextStates.empty()) break;
+            }
+            
+            states = nextStates;
+        }
+        
+        if (states.empty()) continue;
+        
+        // Every variant must end in a state where the same symbol is matched, and where the keyword would be chosen over it
+        language_accept_action  keywordAction(item->symbol, item->definition_type, item->is_weak);
+        int                     matched         = -1;
+        int                     strongest       = -1;
+        bool                    isKeyword       = true;
+        
+        for (set<int>::const_iterator stateId = states.begin(); stateId != states.end() && isKeyword; ++stateId) {
+            const ndfa::accept_action_list& actions = regexDfa->actions_for_state(*stateId);
+            if (actions.empty()) {
+                isKeyword = false;
+                break;
+            }
+            
+            // Pick the highest action and the strongest symbol (this is the symbol that a weak keyword is equivalent to)
+            ndfa::accept_action_list::const_iterator action = actions.begin();
+            accept_action*  highest         = *action;
+            int             stateStrongest  = 0x7fffffff;
+            
+            for (; action != actions.end(); ++action) {
+                if (*highest < **action) {
+                    highest = *action;
+                }
+                
+                int sym = (*action)->symbol();
+                if (weakSymbolIds->find(sym) == weakSymbolIds->end() && sym < stateStrongest) {
+                    stateStrongest = sym;
+                }
+            }
+            
+            if (stateStrongest == 0x7fffffff) stateStrongest = -1;
+            
+            if (!(*highest < keywordAction)) {
+                isKeyword = false;
+            } else if (stateId == states.begin()) {
+                matched     = highest->symbol();
+                strongest   = stateStrongest;
+            } else if (matched != highest->symbol() || strongest != stateStrongest) {
+                isKeyword = false;
+            }
+        }
+        
+        if (!isKeyword) continue;
+        
+        // Add to the table
+        keyword_table::symbols text;
+        for (wstring::const_iterator chr = item->definition.begin(); chr != item->definition.end(); ++chr) {
+            text += (int) *chr;
+        }
+        
+        if (!m_Keywords->add_keyword(text, matched, item->symbol, caseInsensitive)) continue;
+        
+        keywordItems.insert(item);
+        if (weakSymbolIds->find(item->symbol) != weakSymbolIds->end()) {
+            keywordStrong[item->symbol] = strongest;
+        } else {
+            keywordStrong[item->symbol] = -1;
+        }
+    }
+    
+    delete regexDfa;
+    
+    // Leave the keywords in the DFA if they can't be put in a hash table
+    if (!m_Keywords->compile()) {
+        cons().verbose_stream() << L"    Unable to build a hash table for the keywords: leaving them in the DFA" << endl;
+        
+        keywordItems.clear();
+        keywordStrong.clear();
+        delete m_Keywords;
+        m_Keywords = NULL;
+        return;
+    }
+    
+    cons().verbose_stream() << L"    Number of keywords in the hash table:   " << m_Keywords->count_entries() << endl;
+}
+
+/// \brief Compiles the lexer
+void lexer_stage::compile() {
+    // Grab the input
+    const lexer_data*       lex             = m_Language->lexer();
+    terminal_dictionary*    terminals       = m_Language->terminals();
+    const set<int>*         weakSymbolIds   = m_Language->weak_symbols();
+    
+    // Reset the weak symbols and keywords
+    m_WeakSymbols = lr::weak_symbols(m_Language->grammar());
+    
+    if (m_Keywords) {
+        delete m_Keywords;
+        m_Keywords = NULL;
+    }
+    
+    // Sanity check
+    if (!lex || !terminals || !weakSymbolIds) {
+        cons().report_error(error(error::sev_bug, filename(), L"BUG_LEXER_BAD_PARAMETERS", L"Missing input for the lexer stage", position(-1, -1, -1)));
+        return;
+    }
+    
+    // Output a staging message
+    cons().verbose_stream() << L"  = Constructing final lexer" << endl;
+    
+    // Use the cached lexer if the definition hasn't changed since it was written
+    wstring cacheFile = cache_filename();
+    
+    if (!cacheFile.empty() && load_cache(cacheFile)) {
+        cons().verbose_stream() << L"    Loaded the lexer DFA from " << cacheFile << endl;
+        cons().verbose_stream() << L"    Number of states in the lexer DFA:      " << m_Dfa->count_states() << endl;
+        
+        m_Lexer = new lexer(*m_Dfa, m_Keywords);
+        cons().verbose_stream() << L"    Approximate size of final lexer:        " << (m_Lexer->size() + 512) / 1024 << L" kilobytes" << endl;
+        return;
+    }
+
+    // Choose the keywords that will be left out of the DFA
+    set<const lexer_item*> keywordItems;
+    keyword_map            keywordStrong;
+    
+    if (!cons().get_option(L"keyword-hash").empty()) {
+        find_keywords(keywordItems, keywordStrong);
+    }
+    
+    // Create the ndfa
+    ndfa_lexer_compiler* stage0 = new ndfa_lexer_compiler(lex);
+    add_lexer_items(stage0, keywordItems, false, true);
 
     // Write out some stats about the ndfa
     cons().verbose_stream() << L"    Number states in the NDFA:              " << stage0->count_states() << endl;
@@ -422,7 +735,18 @@ void lexer_stage::compile() {
     stage0 = NULL;
     
     // Compile the NDFA to a DFA
-    dfa::ndfa* stage2 = stage1->to_dfa();
+    dfa::ndfa*  stage2;
+    wstring     lexerThreads = cons().get_option(L"lexer-threads");
+    
+    if (lexerThreads.empty()) {
+        stage2 = stage1->to_dfa();
+    } else {
+        // Build the DFA using several threads (the result is the same as for the serial algorithm)
+        int numThreads = 0;
+        wstringstream(lexerThreads) >> numThreads;
+        
+        stage2 = stage1->to_dfa_parallel(0, numThreads);
+    }
     delete stage1;
     stage1 = NULL;
     
@@ -433,7 +757,7 @@ void lexer_stage::compile() {
     
     // Identify any terminals that are always replaced by other terminals (warning)
     set<int>            unusedTerminals;
-    map<int, set<int> > clashes;
+    clash_map           clashes;
     for (int terminalId = 0; terminalId < m_Language->terminals()->count_symbols(); ++terminalId) {
         unusedTerminals.insert(terminalId);
     }
@@ -463,38 +787,14 @@ void lexer_stage::compile() {
         unusedTerminals.erase(highest->symbol());
     }
     
-    // Report warnings for any terminals that are never generated by the lexer
-    for (set<int>::const_iterator unusedSymbol = unusedTerminals.begin(); unusedSymbol != unusedTerminals.end(); ++unusedSymbol) {
-        // Don't report ignored symbols if they can never be generated
-        if (m_Language->ignored_symbols()->find(*unusedSymbol) != m_Language->ignored_symbols()->end()) {
-            continue;
-        }
-
-        // Get the position of this terminal
-        position        pos     = m_Language->terminal_definition_pos(*unusedSymbol);
-        const wstring&  file    = m_Language->terminal_definition_file(*unusedSymbol);
-        
-        // Get the name of the terminal
-        const wstring& name = m_Language->terminals()->name_for_symbol(*unusedSymbol);
-        
-        // Build the warning message
-        wstringstream msg;
-        msg << L"Lexer symbol can never be generated: " << name;
-        
-        cons().report_error(error(error::sev_warning, file, L"SYMBOL_CANNOT_BE_GENERATED", msg.str(), pos));
-        
-        // Get the symbols that clash with this one
-        set<int>& clashSet = clashes[*unusedSymbol];
-        if (!clashSet.empty()) {
-            // Write out the symbols that are generated instead
-            for (set<int>::iterator clashSymbol = clashSet.begin(); clashSymbol != clashSet.end(); ++clashSymbol) {
-                wstringstream msg2;
-                msg2 << L"'" << name << L"' clashes with: " << m_Language->terminals()->name_for_symbol(*clashSymbol);
-                cons().report_error(error(error::sev_detail, m_Language->terminal_definition_file(*clashSymbol), L"SYMBOL_CLASHES_WITH", msg2.str(), m_Language->terminal_definition_pos(*clashSymbol)));
-            }
-        }
+    // Keywords are generated by the keyword table rather than the DFA
+    for (keyword_map::const_iterator keyword = keywordStrong.begin(); keyword != keywordStrong.end(); ++keyword) {
+        unusedTerminals.erase(keyword->first);
     }
     
+    // Report warnings for any terminals that are never generated by the lexer
+    report_unused_terminals(unusedTerminals, clashes);
+    
     // TODO: also identify any terminals that clash with terminals at the same level (warning)
     
     // Build up the weak symbols set if there are any
@@ -517,6 +817,16 @@ void lexer_stage::compile() {
         int finalSymCount = terminals->count_symbols();
         
         cons().verbose_stream() << L"    Number of extra weak symbols:           " << finalSymCount - initialSymCount << endl;
+        
+        // Weak keywords that were left out of the DFA are equivalent to the symbol that the DFA matches instead
+        for (keyword_map::const_iterator keyword = keywordStrong.begin(); keyword != keywordStrong.end(); ++keyword) {
+            if (keyword->second < 0) continue;
+            
+            item_set weakKeyword(m_Language->grammar());
+            weakKeyword.insert(item_container(new terminal(keyword->first), true));
+            
+            m_WeakSymbols.add_symbols(item_container(new terminal(keyword->second), true), weakKeyword);
+        }
     }
     
     // Compact the resulting DFA
@@ -554,9 +864,500 @@ void lexer_stage::compile() {
     m_Dfa = stage4;
     
     // Build the final lexer
-    m_Lexer = new lexer(*m_Dfa);
+    m_Lexer = new lexer(*m_Dfa, m_Keywords);
     
     // Write some parting words
     // (Well, this is really kibibytes but I can't take blibblebytes seriously as a unit of measurement)
     cons().verbose_stream() << L"    Approximate size of final lexer:        " << (m_Lexer->size() + 512) / 1024 << L" kilobytes" << endl;
+    
+    // Store the result in the cache (so long as nothing went wrong)
+    if (!cacheFile.empty() && cons().exit_code() == 0) {
+        save_cache(cacheFile, unusedTerminals, clashes);
+    }
+}
+
+/// \brief Reports warnings for any terminals that can never be generated by the lexer
+void lexer_stage::report_unused_terminals(const set<int>& unusedTerminals, const clash_map& clashes) {
+    for (set<int>::const_iterator unusedSymbol = unusedTerminals.begin(); unusedSymbol != unusedTerminals.end(); ++unusedSymbol) {
+        // Don't report ignored symbols if they can never be generated
+        if (m_Language->ignored_symbols()->find(*unusedSymbol) != m_Language->ignored_symbols()->end()) {
+            continue;
+        }
+
+        // Get the position of this terminal
+        position        pos     = m_Language->terminal_definition_pos(*unusedSymbol);
+        const wstring&  file    = m_Language->terminal_definition_file(*unusedSymbol);
+        
+        // Get the name of the terminal
+        const wstring& name = m_Language->terminals()->name_for_symbol(*unusedSymbol);
+        
+        // Build the warning message
+        wstringstream msg;
+        msg << L"Lexer symbol can never be generated: " << name;
+        
+        cons().report_error(error(error::sev_warning, file, L"SYMBOL_CANNOT_BE_GENERATED", msg.str(), pos));
+        
+        // Get the symbols that clash with this one
+        clash_map::const_iterator clashSet = clashes.find(*unusedSymbol);
+        if (clashSet != clashes.end()) {
+            // Write out the symbols that are generated instead
+            for (set<int>::const_iterator clashSymbol = clashSet->second.begin(); clashSymbol != clashSet->second.end(); ++clashSymbol) {
+                wstringstream msg2;
+                msg2 << L"'" << name << L"' clashes with: " << m_Language->terminals()->name_for_symbol(*clashSymbol);
+                cons().report_error(error(error::sev_detail, m_Language->terminal_definition_file(*clashSymbol), L"SYMBOL_CLASHES_WITH", msg2.str(), m_Language->terminal_definition_pos(*clashSymbol)));
+            }
+        }
+    }
+}
+
+/// \brief The name of the file where the compiled lexer should be cached, or the empty string if caching is disabled
+///
+/// The name is derived from a hash of everything that is used to build the lexer, so a lexer definition that
+/// has changed will use a different file.
+wstring lexer_stage::cache_filename() const {
+    // Caching is only enabled if a cache directory is specified
+    wstring cacheDirectory = cons().get_option(L"lexer-cache");
+    if (cacheDirectory.empty()) return L"";
+    
+    // Hash the values that are used to build the lexer. The lexer data for the language already includes the
+    // definitions from any language that it inherits from.
+    lexer_definition_hash hash;
+    
+    for (string::const_iterator versionChr = tameparse::version::version_string.begin(); versionChr != tameparse::version::version_string.end(); ++versionChr) {
+        hash.add((int) *versionChr);
+    }
+    
+    hash.add(cons().get_option(L"disable-compact-dfa"));
+    hash.add(cons().get_option(L"disable-merged-dfa"));
+    hash.add(cons().get_option(L"keyword-hash"));
+    
+    hash.add(m_Language->lexer()->begin_expr(), m_Language->lexer()->end_expr());
+    hash.add(m_Language->lexer()->begin(), m_Language->lexer()->end());
+    hash.add(*m_Language->weak_symbols());
+    hash.add(*m_Language->used_ignored_symbols());
+    hash.add(*m_Language->ignored_symbols());
+    hash.add(m_Language->terminals()->count_symbols());
+    
+    // Build the final filename
+    wstring result = cacheDirectory;
+    if (result[result.size()-1] != L'/' && result[result.size()-1] != L'\\') {
+        result += L'/';
+    }
+    
+    result += hash.to_string();
+    result += L".lexer";
+    
+    return result;
+}
+
+/// \brief Header written at the start of a lexer cache file
+static const char* s_CacheHeader = "TameParse-lexer-cache";
+
+/// \brief Version of the lexer cache file format
+static const int s_CacheVersion = 3;
+
+/// \brief Name of the section at the end of a lexer cache file, which holds a checksum of everything before it
+static const char* s_CacheEnd = "end";
+
+/// \brief Works out the checksum written at the end of a cache file with the specified contents
+static string cache_checksum(const string& contents) {
+    lexer_definition_hash hash;
+    hash.add(contents);
+    
+    wstring checksum = hash.to_string();
+    return string(checksum.begin(), checksum.end());
+}
+
+/// \brief Removes the end section from the contents of a cache file, returning false if it is missing or doesn't match
+///
+/// A cache file that was cut short can still look valid to the reader, as a truncated number still parses. The end
+/// section is always the last thing written, so this rejects files that weren't written out completely.
+static bool strip_cache_end(string& contents) {
+    string endSection = string("\n") + s_CacheEnd + " ";
+    
+    size_t endPos = contents.rfind(endSection);
+    if (endPos == string::npos) return false;
+    
+    string body = contents.substr(0, endPos + 1);
+    if (contents.substr(endPos + endSection.size()) != cache_checksum(body) + "\n") return false;
+    
+    contents = body;
+    return true;
+}
+
+/// \brief Reads a section header from a cache file, returning the number of items in the section (or -1 if the header is wrong)
+static int read_cache_section(istream& cache, const char* name) {
+    string  sectionName;
+    int     count = -1;
+    
+    cache >> sectionName >> count;
+    if (!cache || sectionName != name) return -1;
+    
+    return count;
+}
+
+/// \brief Tries to load the DFA and weak symbols from the specified cache file, returning false if it can't be used
+bool lexer_stage::load_cache(const wstring& cacheFile) {
+    // Cache misses are silent: the file normally won't exist if the definition has changed
+    auto_ptr<istream> cacheStream(cons().open_file(cacheFile));
+    if (!cacheStream.get()) return false;
+    
+    // Read the whole file so the checksum can be checked before any of it is used
+    string contents((istreambuf_iterator<char>(*cacheStream)), istreambuf_iterator<char>());
+    if (!strip_cache_end(contents)) return false;
+    
+    auto_ptr<istream> cache(new istringstream(contents));
+    
+    // Check the header
+    string  header;
+    int     version = -1;
+    
+    *cache >> header >> version;
+    if (header != s_CacheHeader || version != s_CacheVersion) return false;
+    
+    // Read everything before changing anything, so a damaged file just causes the lexer to be rebuilt
+    typedef vector<pair<int, int> >             transition_list;
+    typedef vector<pair<int, accept_action*> >  accept_list;
+    
+    // Symbol sets, in identifier order
+    int numSymbols = read_cache_section(*cache, "symbols");
+    if (numSymbols < 0) return false;
+    
+    vector<symbol_set> symbols(numSymbols);
+    for (int symbolId = 0; symbolId < numSymbols; ++symbolId) {
+        int numRanges = -1;
+        *cache >> numRanges;
+        
+        for (int rangeId = 0; rangeId < numRanges; ++rangeId) {
+            int lower, upper;
+            *cache >> lower >> upper;
+            symbols[symbolId] |= range<int>(lower, upper);
+        }
+    }
+    
+    // States and their transitions
+    int numStates = read_cache_section(*cache, "states");
+    if (numStates < 1) return false;
+    
+    vector<transition_list> transitions(numStates);
+    for (int stateId = 0; stateId < numStates; ++stateId) {
+        int numTransitions = -1;
+        *cache >> numTransitions;
+        
+        for (int transitId = 0; transitId < numTransitions; ++transitId) {
+            int symbolSet, newState;
+            *cache >> symbolSet >> newState;
+            
+            if (symbolSet < 0 || symbolSet >= numSymbols || newState < 0 || newState >= numStates) return false;
+            transitions[stateId].push_back(pair<int, int>(symbolSet, newState));
+        }
+    }
+    
+    // Accept actions (these are either plain accept actions, or actions that were generated for a language unit)
+    int numAccept = read_cache_section(*cache, "accept");
+    if (numAccept < 0) return false;
+    
+    accept_list accept;
+    for (int acceptId = 0; acceptId < numAccept && *cache; ++acceptId) {
+        int stateId, kind, symbol, eager, unitType, isWeak;
+        *cache >> stateId >> kind >> symbol >> eager >> unitType >> isWeak;
+        
+        if (kind == 0) {
+            accept.push_back(pair<int, accept_action*>(stateId, new accept_action(symbol, eager != 0)));
+        } else {
+            accept.push_back(pair<int, accept_action*>(stateId, new language_accept_action(symbol, (language_unit::unit_type) unitType, isWeak != 0)));
+        }
+    }
+    
+    // Terminal symbols that were split from another terminal while generating the weak symbols, and their parents
+    int                     numSplit = read_cache_section(*cache, "split");
+    vector<pair<int, int> > split;
+    
+    for (int splitId = 0; splitId < numSplit; ++splitId) {
+        int symbol, parent;
+        *cache >> symbol >> parent;
+        split.push_back(pair<int, int>(symbol, parent));
+    }
+    
+    // The strong to weak symbol map
+    int                         numStrong = numSplit < 0 ? -1 : read_cache_section(*cache, "weak");
+    map<int, vector<int> >      strongToWeak;
+    
+    for (int strongId = 0; strongId < numStrong; ++strongId) {
+        int strong, numWeak = -1;
+        *cache >> strong >> numWeak;
+        
+        vector<int>& weakSyms = strongToWeak[strong];
+        for (int weakId = 0; weakId < numWeak; ++weakId) {
+            int weak;
+            *cache >> weak;
+            weakSyms.push_back(weak);
+        }
+    }
+    
+    // The terminals that can never be generated
+    int         numUnused = numStrong < 0 ? -1 : read_cache_section(*cache, "unused");
+    set<int>    unusedTerminals;
+    clash_map   clashes;
+    
+    for (int unusedId = 0; unusedId < numUnused; ++unusedId) {
+        int unused, numClashes = -1;
+        *cache >> unused >> numClashes;
+        
+        unusedTerminals.insert(unused);
+        for (int clashId = 0; clashId < numClashes; ++clashId) {
+            int clash;
+            *cache >> clash;
+            clashes[unused].insert(clash);
+        }
+    }
+    
+    // The keywords that were left out of the DFA
+    int                     numKeywords = numUnused < 0 ? -1 : read_cache_section(*cache, "keywords");
+    auto_ptr<keyword_table> keywords(numKeywords > 0 ? new keyword_table() : NULL);
+    
+    for (int keywordId = 0; keywordId < numKeywords; ++keywordId) {
+        int matched, symbol, caseInsensitive, length = -1;
+        *cache >> matched >> symbol >> caseInsensitive >> length;
+        
+        keyword_table::symbols text;
+        for (int chrId = 0; chrId < length; ++chrId) {
+            int chr;
+            *cache >> chr;
+            text += chr;
+        }
+        
+        if (!keywords->add_keyword(text, matched, symbol, caseInsensitive != 0)) numKeywords = -1;
+    }
+    
+    if (keywords.get() && numKeywords > 0 && !keywords->compile()) {
+        numKeywords = -1;
+    }
+    
+    // Give up if anything was missing
+    if (!*cache || numKeywords < 0) {
+        for (accept_list::iterator action = accept.begin(); action != accept.end(); ++action) {
+            delete action->second;
+        }
+        return false;
+    }
+    
+    // Build the DFA
+    ndfa* result = new ndfa();
+    
+    for (vector<symbol_set>::const_iterator symbolSet = symbols.begin(); symbolSet != symbols.end(); ++symbolSet) {
+        result->symbols().identifier_for_symbols(*symbolSet);
+    }
+    
+    for (int stateId = 1; stateId < numStates; ++stateId) {
+        result->add_state();
+    }
+    
+    for (int stateId = 0; stateId < numStates; ++stateId) {
+        for (transition_list::const_iterator transit = transitions[stateId].begin(); transit != transitions[stateId].end(); ++transit) {
+            result->add_transition(stateId, symbols[transit->first], transit->second);
+        }
+    }
+    
+    for (accept_list::iterator action = accept.begin(); action != accept.end(); ++action) {
+        result->accept(action->first, *action->second);
+        delete action->second;
+    }
+    
+    // Recreate the terminals that were split off to deal with weak symbols (these are numbered in the order they are created)
+    terminal_dictionary* terminals = m_Language->terminals();
+    
+    for (vector<pair<int, int> >::const_iterator splitSymbol = split.begin(); splitSymbol != split.end(); ++splitSymbol) {
+        int newSymbol = terminals->split(splitSymbol->second);
+        
+        if (newSymbol != splitSymbol->first) {
+            cons().report_error(error(error::sev_bug, filename(), L"BUG_LEXER_CACHE_MISMATCH", L"Cached lexer does not match the terminal symbols in the language", position(-1, -1, -1)));
+        }
+    }
+    
+    // Recreate the weak symbols
+    item_set weakSymSet(m_Language->grammar());
+    for (set<int>::const_iterator weakSymId = m_Language->weak_symbols()->begin(); weakSymId != m_Language->weak_symbols()->end(); ++weakSymId) {
+        weakSymSet.insert(item_container(new terminal(*weakSymId), true));
+    }
+    
+    lr::weak_symbols::item_map weakMap;
+    for (map<int, vector<int> >::const_iterator strong = strongToWeak.begin(); strong != strongToWeak.end(); ++strong) {
+        item_set& weakEquivalents = weakMap.insert(lr::weak_symbols::item_map::value_type(item_container(new terminal(strong->first), true), item_set(m_Language->grammar()))).first->second;
+        
+        for (vector<int>::const_iterator weak = strong->second.begin(); weak != strong->second.end(); ++weak) {
+            weakEquivalents.insert(item_container(new terminal(*weak), true));
+        }
+    }
+    
+    // The constructor doesn't mark any symbols as weak, so add the weak symbols from the language separately
+    m_WeakSymbols = lr::weak_symbols(weakMap, m_Language->grammar());
+    m_WeakSymbols.add_weak_symbols(weakSymSet);
+    
+    // Report the same warnings as we would have done when building the lexer
+    report_unused_terminals(unusedTerminals, clashes);
+    
+    m_Dfa       = result;
+    m_Keywords  = keywords.release();
+    return true;
+}
+
+/// \brief Writes the DFA and weak symbols to the specified cache file
+///
+/// The file is written under a temporary name and renamed into place once it is complete, so another parsetool
+/// using the same cache directory never sees a partially written file.
+void lexer_stage::save_cache(const wstring& cacheFile, const set<int>& unusedTerminals, const clash_map& clashes) {
+    // Build the contents of the file in memory, so the checksum can be written at the end
+    ostringstream   cacheContents;
+    ostream*        cache = &cacheContents;
+    
+    *cache << s_CacheHeader << " " << s_CacheVersion << "\n";
+    
+    // Symbol sets
+    const symbol_map& symbols = m_Dfa->symbols();
+    
+    *cache << "symbols " << symbols.count_sets() << "\n";
+    for (int symbolId = 0; symbolId < symbols.count_sets(); ++symbolId) {
+        const symbol_set& symbolSet = symbols[symbolId];
+        
+        int numRanges = 0;
+        for (symbol_set::iterator symRange = symbolSet.begin(); symRange != symbolSet.end(); ++symRange) {
+            ++numRanges;
+        }
+        
+        *cache << numRanges;
+        for (symbol_set::iterator symRange = symbolSet.begin(); symRange != symbolSet.end(); ++symRange) {
+            *cache << " " << symRange->lower() << " " << symRange->upper();
+        }
+        *cache << "\n";
+    }
+    
+    // States
+    *cache << "states " << m_Dfa->count_states() << "\n";
+    for (int stateId = 0; stateId < m_Dfa->count_states(); ++stateId) {
+        const state& thisState = m_Dfa->get_state(stateId);
+        
+        *cache << thisState.count_transitions();
+        for (state::iterator transit = thisState.begin(); transit != thisState.end(); ++transit) {
+            *cache << " " << transit->symbol_set() << " " << transit->new_state();
+        }
+        *cache << "\n";
+    }
+    
+    // Accept actions
+    int numAccept = 0;
+    for (int stateId = 0; stateId < m_Dfa->count_states(); ++stateId) {
+        numAccept += (int) m_Dfa->actions_for_state(stateId).size();
+    }
+    
+    *cache << "accept " << numAccept << "\n";
+    for (int stateId = 0; stateId < m_Dfa->count_states(); ++stateId) {
+        const ndfa::accept_action_list& actions = m_Dfa->actions_for_state(stateId);
+        
+        for (ndfa::accept_action_list::const_iterator action = actions.begin(); action != actions.end(); ++action) {
+            const language_accept_action* languageAction = dynamic_cast<const language_accept_action*>(*action);
+            
+            *cache << stateId << " " << (languageAction ? 1 : 0) << " " << (*action)->symbol() << " " << ((*action)->eager() ? 1 : 0) << " ";
+            
+            if (languageAction) {
+                *cache << (int) languageAction->unit_type() << " " << (languageAction->is_weak() ? 1 : 0) << "\n";
+            } else {
+                *cache << "0 0\n";
+            }
+        }
+    }
+    
+    // Terminals that were split from another terminal: these are the weak symbols that weren't in the original language
+    const set<int>*         languageWeak = m_Language->weak_symbols();
+    set<int>                splitSymbols;
+    map<int, vector<int> >  strongToWeak;
+    
+    for (lr::weak_symbols::strong_iterator strong = m_WeakSymbols.begin_strong(); strong != m_WeakSymbols.end_strong(); ++strong) {
+        vector<int>& weakSyms = strongToWeak[strong->first->symbol()];
+        
+        for (item_set::const_iterator weak = strong->second.begin(); weak != strong->second.end(); ++weak) {
+            int weakSym = (*weak)->symbol();
+            weakSyms.push_back(weakSym);
+            
+            if (languageWeak->find(weakSym) == languageWeak->end()) {
+                splitSymbols.insert(weakSym);
+            }
+        }
+    }
+    
+    *cache << "split " << splitSymbols.size() << "\n";
+    for (set<int>::const_iterator splitSymbol = splitSymbols.begin(); splitSymbol != splitSymbols.end(); ++splitSymbol) {
+        *cache << *splitSymbol << " " << m_Language->terminals()->parent_of(*splitSymbol) << "\n";
+    }
+    
+    // Map of strong to weak symbols
+    *cache << "weak " << strongToWeak.size() << "\n";
+    for (map<int, vector<int> >::const_iterator strong = strongToWeak.begin(); strong != strongToWeak.end(); ++strong) {
+        *cache << strong->first << " " << strong->second.size();
+        for (vector<int>::const_iterator weak = strong->second.begin(); weak != strong->second.end(); ++weak) {
+            *cache << " " << *weak;
+        }
+        *cache << "\n";
+    }
+    
+    // Unused terminals
+    *cache << "unused " << unusedTerminals.size() << "\n";
+    for (set<int>::const_iterator unused = unusedTerminals.begin(); unused != unusedTerminals.end(); ++unused) {
+        clash_map::const_iterator clashSet = clashes.find(*unused);
+        
+        if (clashSet == clashes.end()) {
+            *cache << *unused << " 0\n";
+            continue;
+        }
+        
+        *cache << *unused << " " << clashSet->second.size();
+        for (set<int>::const_iterator clash = clashSet->second.begin(); clash != clashSet->second.end(); ++clash) {
+            *cache << " " << *clash;
+        }
+        *cache << "\n";
+    }
+    
+    // Keywords
+    int numKeywords = m_Keywords ? m_Keywords->count_entries() : 0;
+    
+    *cache << "keywords " << numKeywords << "\n";
+    for (int keywordId = 0; keywordId < numKeywords; ++keywordId) {
+        const keyword_table::entry& keyword = m_Keywords->entries()[keywordId];
+        
+        *cache << keyword.matched << " " << keyword.symbol << " " << keyword.case_insensitive << " " << keyword.length;
+        for (int chrId = 0; chrId < keyword.length; ++chrId) {
+            *cache << " " << m_Keywords->text()[keyword.offset + chrId];
+        }
+        *cache << "\n";
+    }
+    
+    // Finish with the checksum
+    string contents = cacheContents.str();
+    contents += string(s_CacheEnd) + " " + cache_checksum(contents) + "\n";
+    
+    // Give the temporary file a name that's unlikely to be used by another process writing the same cache file
+    wstringstream tempName;
+    tempName << cacheFile << L"." << hex << random_device()() << (unsigned long long) chrono::high_resolution_clock::now().time_since_epoch().count() << L".tmp";
+    wstring tempFile = tempName.str();
+    
+    // Write out the file
+    auto_ptr<ostream> tempStream(cons().open_binary_file_for_writing(tempFile));
+    bool written = tempStream.get() && *tempStream;
+    
+    if (written) {
+        tempStream->write(contents.data(), (streamsize) contents.size());
+        tempStream->flush();
+        written = !tempStream->fail();
+    }
+    tempStream.reset();
+    
+    // Move it into place. If this fails, another process may have written the same file already (which is fine)
+    if (!written || !cons().rename_file(tempFile, cacheFile)) {
+        cons().remove_file(tempFile);
+        
+        auto_ptr<istream> existing(cons().open_file(cacheFile));
+        if (!existing.get()) {
+            cons().report_error(error(error::sev_warning, cacheFile, L"CANT_WRITE_LEXER_CACHE", L"Unable to write to the lexer cache", position(-1, -1, -1)));
+        }
+    }
 }
@@ -29,10 +29,13 @@
 #define _COMPILER_LEXER_STAGE_H
 
 #include <set>
+#include <map>
+#include <string>
 
 #include "TameParse/Compiler/language_stage.h"
 #include "TameParse/Dfa/ndfa_regex.h"
 #include "TameParse/Dfa/lexer.h"
+#include "TameParse/Dfa/keyword_table.h"
 #include "TameParse/ContextFree/terminal_dictionary.h"
 #include "TameParse/Compiler/compilation_stage.h"
 #include "TameParse/Lr/weak_symbols.h"
@@ -52,6 +55,9 @@ namespace compiler {
         /// \brief The compiled lexer
         dfa::lexer* m_Lexer;
         
+        /// \brief NULL, or the keywords that were left out of the DFA
+        dfa::keyword_table* m_Keywords;
+        
         /// \brief The weak symbols object
         lr::weak_symbols m_WeakSymbols;
         
@@ -70,8 +76,38 @@ namespace compiler {
         void compile();
 
     private:
+        /// \brief Maps terminals that can never be generated to the terminals that are generated instead
+        typedef std::map<int, std::set<int> > clash_map;
+        
+        /// \brief Maps keywords that were left out of the DFA to the strong symbol they are equivalent to (or -1 if they aren't weak)
+        typedef std::map<int, int> keyword_map;
+        
         /// \brief Reports any errors that might have occurred in the specified regular expression
         void check_regex(dfa::ndfa_regex* ndfa, const std::wstring& regex, const std::wstring* filename, const dfa::position& pos);
+        
+        /// \brief Adds the symbols defined by the lexer data for the language to an NDFA
+        ///
+        /// Literal items in the excluded set are left out, as are all literals if regexOnly is true. Errors in the regular
+        /// expressions and lexer items are only reported if reportErrors is true.
+        void add_lexer_items(dfa::ndfa_regex* ndfa, const std::set<const lexer_item*>& excluded, bool regexOnly, bool reportErrors);
+        
+        /// \brief Chooses the literal symbols that can be left out of the DFA and found using the keyword table instead
+        void find_keywords(std::set<const lexer_item*>& keywordItems, keyword_map& keywordStrong);
+        
+        /// \brief Reports warnings for any terminals that can never be generated by the lexer
+        void report_unused_terminals(const std::set<int>& unusedTerminals, const clash_map& clashes);
+        
+        /// \brief The name of the file where the compiled lexer should be cached, or the empty string if caching is disabled
+        ///
+        /// The name is derived from a hash of everything that is used to build the lexer, so a lexer definition that
+        /// has changed will use a different file.
+        std::wstring cache_filename() const;
+        
+        /// \brief Tries to load the DFA and weak symbols from the specified cache file, returning false if it can't be used
+        bool load_cache(const std::wstring& cacheFile);
+        
+        /// \brief Writes the DFA and weak symbols to the specified cache file
+        void save_cache(const std::wstring& cacheFile, const std::set<int>& unusedTerminals, const clash_map& clashes);
 
     public:
         /// \brief The DFA generated by this stage
@@ -85,6 +121,9 @@ namespace compiler {
         
         /// \brief The lexer that was compiled by this stage
         inline dfa::lexer* get_lexer() { return m_Lexer; }
+        
+        /// \brief NULL, or the keywords that the lexer finds by looking up the text of the lexemes matched by its DFA
+        inline const dfa::keyword_table* keywords() const { return m_Keywords; }
     };
 }
 
@@ -198,6 +198,9 @@ namespace compiler {
         /// \brief The total number of states in the lexer
         inline int count_lexer_states() { return m_LexerStage->dfa()->count_states(); }
 
+        /// \brief NULL, or the keywords that the lexer finds by looking up the text of the lexemes matched by its DFA
+        inline const dfa::keyword_table* lexer_keywords() { return m_LexerStage->keywords(); }
+
         /// \brief The first item in the symbol map
         symbol_map_iterator begin_symbol_map();
 
@@ -36,6 +36,7 @@
 #include "TameParse/Dfa/state_machine.h"
 #include "TameParse/Dfa/lexeme.h"
 #include "TameParse/Dfa/position.h"
+#include "TameParse/Dfa/keyword_table.h"
 
 namespace dfa {
     ///
@@ -149,6 +150,9 @@ namespace dfa {
         /// \brief Array containing a list of possible accept actions for accepting states
         const int* m_Accept;
         
+        /// \brief NULL, or the keywords that should be looked up after a lexeme is matched
+        const keyword_table* m_Keywords;
+        
         dfa_lexer_base& operator=(const dfa_lexer_base& copyFrom);
         dfa_lexer_base(const dfa_lexer_base& copyFrom);
         
@@ -177,9 +181,11 @@ namespace dfa {
         /// \brief Constructs a lexer from a DFA
         ///
         /// A DFA is an NDFA which has been transformed by to_ndfa_with_unique_symbols() and to_dfa(), in that order.
-        dfa_lexer_base(const ndfa& dfa)
+        /// If a keyword table is supplied, it must remain valid for as long as this lexer exists.
+        dfa_lexer_base(const ndfa& dfa, const keyword_table* keywords = NULL)
         : m_StateMachine(dfa)
-        , m_MaxState(dfa.count_states()) {
+        , m_MaxState(dfa.count_states())
+        , m_Keywords(keywords) {
             // Allocate space for the accepting states
             int* accept = new int[m_MaxState];
             m_Accept    = accept;
@@ -191,10 +197,11 @@ namespace dfa {
         }
 
         /// \brief Constructs a lexer from a state machine
-        dfa_lexer_base(state_machine_ref stateMachine, int maxState, const int* accept)
+        dfa_lexer_base(state_machine_ref stateMachine, int maxState, const int* accept, const keyword_table* keywords = NULL)
         : m_StateMachine(stateMachine)
         , m_MaxState(maxState)
-        , m_Accept(accept) {
+        , m_Accept(accept)
+        , m_Keywords(keywords) {
         }
 
         /// \brief Destructor
@@ -217,6 +224,9 @@ namespace dfa {
             /// \brief Array of symbols that are accepted in each state
             const int* m_Accept;
             
+            /// \brief NULL, or the keywords that should be looked up after a lexeme is matched
+            const keyword_table* m_Keywords;
+            
             /// \brief The stream that this will read symbols from
             lexer_symbol_stream* m_Stream;
             
@@ -236,9 +246,10 @@ namespace dfa {
             
         public:
             /// \brief Creates a new stream that works with the specified state machine, list of accepting actions and symbol stream
-            dfa_stream(state_machine_ref sm, const int* acc, lexer_symbol_stream* str)
+            dfa_stream(state_machine_ref sm, const int* acc, const keyword_table* keywords, lexer_symbol_stream* str)
             : m_StateMachine(sm)
             , m_Accept(acc)
+            , m_Keywords(keywords)
             , m_Stream(str)
             , m_InitialState(firstState) {
             }
@@ -310,6 +321,12 @@ namespace dfa {
                 // If the accept position is -1 or 0, change it to 1 so we reject at least one character
                 if (acceptPos <= 0) acceptPos = 1;
                 
+                // Keywords that were left out of the DFA are recognised by their text
+                if (m_Keywords && acceptSymbol >= 0) {
+                    int keyword = m_Keywords->find(acceptSymbol, m_Buffer.begin(), m_Buffer.begin() + acceptPos);
+                    if (keyword >= 0) acceptSymbol = keyword;
+                }
+                
                 // Create the lexeme for this item
                 result = new lexeme(m_Buffer.begin(), m_Buffer.begin() + acceptPos, m_Position.current_position(), acceptSymbol, acceptPos);
                 
@@ -342,7 +359,7 @@ namespace dfa {
         ///
         virtual lexeme_stream* create_stream(lexer_symbol_stream* stream) const {
             if (!stream) return NULL;
-            return new dfa_stream(m_StateMachine, m_Accept, stream);
+            return new dfa_stream(m_StateMachine, m_Accept, m_Keywords, stream);
         }
         
         /// \brief Estimated size in bytes of this lexer
@@ -364,7 +381,7 @@ namespace dfa {
         /// \brief Constructs a lexer from a DFA
         ///
         /// A DFA is an NDFA which has been transformed by to_ndfa_with_unique_symbols() and to_dfa(), in that order.
-        inline dfa_lexer(const ndfa& dfa) : base(dfa) {
+        inline dfa_lexer(const ndfa& dfa, const keyword_table* keywords = NULL) : base(dfa, keywords) {
         }
     };
 }
@@ -0,0 +1,247 @@
+//
+//  keyword_table.cpp
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include <algorithm>
+#include <map>
+
+#include "TameParse/Dfa/keyword_table.h"
+
+using namespace std;
+using namespace dfa;
+
+/// \brief Creates an empty keyword table
+keyword_table::keyword_table()
+: m_Entries(NULL)
+, m_NumEntries(0)
+, m_Displacement(NULL)
+, m_NumBuckets(0)
+, m_Text(NULL) {
+    find_limits();
+}
+
+/// \brief Creates a keyword table from tables generated by an earlier call to compile()
+keyword_table::keyword_table(const entry* entries, int numEntries, const int* displacement, int numBuckets, const int* text)
+: m_Entries(entries)
+, m_NumEntries(numEntries)
+, m_Displacement(displacement)
+, m_NumBuckets(numBuckets)
+, m_Text(text) {
+    find_limits();
+}
+
+/// \brief Works out the length and symbol ranges of the entries in this table
+void keyword_table::find_limits() {
+    // These values reject everything if the table is empty
+    m_MinLength     = 0;
+    m_MaxLength     = -1;
+    m_MinMatched    = 0;
+    m_MaxMatched    = -1;
+    
+    for (int entryId = 0; entryId < m_NumEntries; ++entryId) {
+        const entry& thisEntry = m_Entries[entryId];
+        
+        if (entryId == 0 || thisEntry.length < m_MinLength)     m_MinLength     = thisEntry.length;
+        if (entryId == 0 || thisEntry.length > m_MaxLength)     m_MaxLength     = thisEntry.length;
+        if (entryId == 0 || thisEntry.matched < m_MinMatched)   m_MinMatched    = thisEntry.matched;
+        if (entryId == 0 || thisEntry.matched > m_MaxMatched)   m_MaxMatched    = thisEntry.matched;
+    }
+}
+
+/// \brief Adds a new keyword to this table
+bool keyword_table::add_keyword(const symbols& text, int matched, int symbol, bool caseInsensitive) {
+    // Keywords must be made up of ASCII characters
+    symbols folded;
+    for (symbols::const_iterator chr = text.begin(); chr != text.end(); ++chr) {
+        if (*chr < 0 || *chr >= 0x80) return false;
+        folded += (int) fold(*chr);
+    }
+    
+    // The hash ignores case, so there can't be two keywords with the same text
+    if (std::find(m_Folded.begin(), m_Folded.end(), folded) != m_Folded.end()) return false;
+    m_Folded.push_back(folded);
+    
+    // Add the new entry (they're put in the right order by compile())
+    entry newEntry;
+    newEntry.matched            = matched;
+    newEntry.symbol             = symbol;
+    newEntry.case_insensitive   = caseInsensitive ? 1 : 0;
+    newEntry.offset             = (int) m_NewText.size();
+    newEntry.length             = (int) text.size();
+    
+    m_NewEntries.push_back(newEntry);
+    m_NewText.insert(m_NewText.end(), text.begin(), text.end());
+    
+    return true;
+}
+
+/// \brief Orders buckets so that the largest is first
+static bool larger_bucket(const vector<int>& a, const vector<int>& b) {
+    return a.size() > b.size();
+}
+
+/// \brief Builds the hash table for the keywords added by add_keyword()
+///
+/// This uses the 'hash and displace' algorithm: keywords are divided into buckets using one hash function. Starting
+/// with the largest, each bucket is then assigned a seed for a second hash function that moves all of its keywords
+/// into free slots. Buckets containing a single keyword are just put in any slot that is left over.
+bool keyword_table::compile(unsigned int maxSeeds) {
+    int numEntries = (int) m_NewEntries.size();
+    int numBuckets = numEntries > 0 ? numEntries : 1;
+    
+    // Put the keywords in order, so the same table is built whatever order they were added in
+    map<symbols, int> sorted;
+    for (int entryId = 0; entryId < numEntries; ++entryId) {
+        sorted[m_Folded[entryId]] = entryId;
+    }
+    
+    vector<entry>   sortedEntries;
+    vector<int>     sortedText;
+    vector<symbols> sortedFolded;
+    
+    for (map<symbols, int>::const_iterator keyword = sorted.begin(); keyword != sorted.end(); ++keyword) {
+        entry thisEntry = m_NewEntries[keyword->second];
+        
+        sortedText.insert(sortedText.end(), m_NewText.begin() + thisEntry.offset, m_NewText.begin() + thisEntry.offset + thisEntry.length);
+        thisEntry.offset = (int) sortedText.size() - thisEntry.length;
+        
+        sortedEntries.push_back(thisEntry);
+        sortedFolded.push_back(keyword->first);
+    }
+    
+    m_NewEntries    = sortedEntries;
+    m_NewText       = sortedText;
+    m_Folded        = sortedFolded;
+    
+    // Sort the keywords into buckets
+    vector<vector<int> > buckets(numBuckets);
+    vector<int>          bucketIds(numBuckets);
+    
+    for (int entryId = 0; entryId < numEntries; ++entryId) {
+        const int* text = &m_NewText[0] + m_NewEntries[entryId].offset;
+        int bucket = (int) (hash(0, text, text + m_NewEntries[entryId].length) % (unsigned int) numBuckets);
+        
+        buckets[bucket].push_back(entryId);
+    }
+    
+    // Remember which bucket is which, then put them in order of size
+    for (int bucketId = 0; bucketId < numBuckets; ++bucketId) {
+        buckets[bucketId].push_back(bucketId);
+    }
+    stable_sort(buckets.begin(), buckets.end(), larger_bucket);
+    
+    // Assign slots to the buckets
+    vector<int>     slotForEntry(numEntries, -1);
+    vector<bool>    usedSlots(numEntries, false);
+    vector<int>     displacement(numBuckets, 0);
+    
+    vector<vector<int> >::iterator bucket = buckets.begin();
+    for (; bucket != buckets.end() && bucket->size() > 2; ++bucket) {
+        // The last item in the bucket is its ID
+        int bucketId = bucket->back();
+        int numKeys  = (int) bucket->size() - 1;
+        
+        // Try seeds until we find one that puts every keyword in this bucket in a free slot
+        unsigned int seed;
+        for (seed = 1; seed <= maxSeeds && seed <= 0x7fffffffu; ++seed) {
+            vector<int> slots;
+            
+            for (int keyId = 0; keyId < numKeys; ++keyId) {
+                const entry& thisEntry = m_NewEntries[(*bucket)[keyId]];
+                const int* text = &m_NewText[0] + thisEntry.offset;
+                int slot = (int) (hash(seed, text, text + thisEntry.length) % (unsigned int) numEntries);
+                
+                if (usedSlots[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) break;
+                slots.push_back(slot);
+            }
+            
+            if ((int) slots.size() < numKeys) continue;
+            
+            // Found a seed that works
+            for (int keyId = 0; keyId < numKeys; ++keyId) {
+                usedSlots[slots[keyId]]             = true;
+                slotForEntry[(*bucket)[keyId]]      = slots[keyId];
+            }
+            displacement[bucketId] = (int) seed;
+            break;
+        }
+        
+        // Give up if there's no seed that works (the displacement must also stay positive to be told apart from a slot)
+        if (seed > maxSeeds || seed > 0x7fffffffu) {
+            m_Entries       = NULL;
+            m_NumEntries    = 0;
+            m_Displacement  = NULL;
+            m_NumBuckets    = 0;
+            m_Text          = NULL;
+            
+            find_limits();
+            return false;
+        }
+    }
+    
+    // Buckets with a single keyword just go in the next free slot
+    int freeSlot = 0;
+    for (; bucket != buckets.end() && bucket->size() == 2; ++bucket) {
+        while (usedSlots[freeSlot]) ++freeSlot;
+        
+        usedSlots[freeSlot]                 = true;
+        slotForEntry[(*bucket)[0]]          = freeSlot;
+        displacement[bucket->back()]        = -1 - freeSlot;
+    }
+    
+    // Store the entries in slot order
+    m_NewDisplacement = displacement;
+    
+    vector<entry>   entries(m_NewEntries.size());
+    vector<symbols> folded(m_Folded.size());
+    for (int entryId = 0; entryId < numEntries; ++entryId) {
+        entries[slotForEntry[entryId]]  = m_NewEntries[entryId];
+        folded[slotForEntry[entryId]]   = m_Folded[entryId];
+    }
+    m_NewEntries    = entries;
+    m_Folded        = folded;
+    
+    // Use the new tables
+    m_Entries       = m_NewEntries.empty() ? NULL : &m_NewEntries[0];
+    m_NumEntries    = numEntries;
+    m_Displacement  = &m_NewDisplacement[0];
+    m_NumBuckets    = numBuckets;
+    m_Text          = m_NewText.empty() ? NULL : &m_NewText[0];
+    
+    find_limits();
+    return true;
+}
+
+/// \brief The number of characters in the text table
+int keyword_table::text_length() const {
+    int result = 0;
+    
+    for (int entryId = 0; entryId < m_NumEntries; ++entryId) {
+        result = max(result, m_Entries[entryId].offset + m_Entries[entryId].length);
+    }
+    
+    return result;
+}
@@ -0,0 +1,222 @@
+//
+//  keyword_table.h
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef _DFA_KEYWORD_TABLE_H
+#define _DFA_KEYWORD_TABLE_H
+
+#include <string>
+#include <vector>
+
+namespace dfa {
+    ///
+    /// \brief Minimal perfect hash table that maps the text of keywords to the symbols they should generate
+    ///
+    /// Keywords that are also matched by a more general symbol (usually an identifier) can be left out of the DFA
+    /// for a lexer and found by looking up the text of the lexeme in this table instead. Each keyword records the
+    /// symbol that the DFA will match for its text: lexemes matching any other symbol are left alone.
+    ///
+    /// Keywords must consist only of ASCII characters, and case insensitive keywords match any ASCII case variant.
+    /// The table can either be built by calling add_keyword() followed by compile(), or it can refer to tables
+    /// that were generated by an earlier call to compile() (this is how generated parsers use this class).
+    ///
+    class keyword_table {
+    public:
+        /// \brief A keyword in this table
+        struct entry {
+            /// \brief The symbol that the lexer DFA matches for this keyword
+            int matched;
+            
+            /// \brief The symbol that should be generated for this keyword
+            int symbol;
+            
+            /// \brief Non-zero if this keyword is case insensitive
+            int case_insensitive;
+            
+            /// \brief Offset into the text table of the first character of this keyword
+            int offset;
+            
+            /// \brief The number of characters in this keyword
+            int length;
+        };
+        
+        /// \brief String of symbols (the lexer uses integer symbols)
+        typedef std::basic_string<int> symbols;
+        
+    private:
+        /// \brief The entries in this table, in slot order
+        const entry* m_Entries;
+        
+        /// \brief The number of entries in this table
+        int m_NumEntries;
+        
+        /// \brief The displacement for each bucket (negative values are the slot for buckets with a single entry, as -1-slot)
+        const int* m_Displacement;
+        
+        /// \brief The number of buckets
+        int m_NumBuckets;
+        
+        /// \brief The text of the keywords in this table
+        const int* m_Text;
+        
+        /// \brief The length of the shortest and longest keywords
+        int m_MinLength;
+        int m_MaxLength;
+        
+        /// \brief The lowest and highest values of the 'matched' symbols in this table
+        int m_MinMatched;
+        int m_MaxMatched;
+        
+        /// \brief Storage for tables built by compile()
+        std::vector<entry>  m_NewEntries;
+        std::vector<int>    m_NewDisplacement;
+        std::vector<int>    m_NewText;
+        
+        /// \brief The folded text of the keywords added by add_keyword() (used to spot duplicates)
+        std::vector<symbols> m_Folded;
+        
+    private:
+        /// \brief Disabled copy constructor
+        keyword_table(const keyword_table& copyFrom);
+        
+        /// \brief Disabled assignment
+        keyword_table& operator=(const keyword_table& assignFrom);
+        
+        /// \brief Works out the length and symbol ranges of the entries in this table
+        void find_limits();
+        
+    public:
+        /// \brief Creates an empty keyword table
+        keyword_table();
+        
+        /// \brief Creates a keyword table from tables generated by an earlier call to compile()
+        ///
+        /// The tables are not copied, so they must remain valid for as long as this object exists.
+        keyword_table(const entry* entries, int numEntries, const int* displacement, int numBuckets, const int* text);
+        
+        /// \brief Adds a new keyword to this table
+        ///
+        /// Returns false if the keyword can't be added: this happens if it contains non-ASCII characters, or if there is
+        /// already a keyword with the same text (ignoring case).
+        bool add_keyword(const symbols& text, int matched, int symbol, bool caseInsensitive);
+        
+        /// \brief The number of seeds that compile() tries for each bucket of keywords before giving up
+        static const unsigned int default_max_seeds = 1u << 20;
+        
+        /// \brief Builds the hash table for the keywords added by add_keyword()
+        ///
+        /// Returns false if no seed up to maxSeeds fits one of the buckets of keywords into the free slots. The table is
+        /// left empty in this case, and the keywords must be matched some other way (for instance by the lexer DFA).
+        bool compile(unsigned int maxSeeds = default_max_seeds);
+        
+    public:
+        /// \brief Folds the case of a symbol
+        static inline unsigned int fold(int symbol) {
+            return (symbol >= 'A' && symbol <= 'Z') ? (unsigned int) (symbol + ('a' - 'A')) : (unsigned int) symbol;
+        }
+        
+        /// \brief Hashes a string of symbols, ignoring case
+        template<typename iterator> static inline unsigned int hash(unsigned int seed, iterator begin, iterator end) {
+            // FNV-1a followed by a finalising mix, so that different seeds produce unrelated values
+            unsigned int result = 2166136261u ^ (seed * 0x9e3779b9u);
+            for (iterator symbol = begin; symbol != end; ++symbol) {
+                result ^= fold(*symbol);
+                result *= 16777619u;
+            }
+            
+            result ^= result >> 16;
+            result *= 0x85ebca6bu;
+            result ^= result >> 13;
+            
+            return result;
+        }
+        
+        /// \brief Returns the symbol of the keyword with the specified text, or -1 if there is no keyword with this text
+        /// that the lexer would match as the specified symbol
+        template<typename iterator> inline int find(int matched, iterator begin, iterator end) const {
+            // Quickly reject anything that can't be a keyword
+            if (matched < m_MinMatched || matched > m_MaxMatched) return -1;
+            
+            int length = (int) (end - begin);
+            if (length < m_MinLength || length > m_MaxLength) return -1;
+            
+            // Find the slot for this text
+            int displacement = m_Displacement[hash(0, begin, end) % (unsigned int) m_NumBuckets];
+            int slot;
+            
+            if (displacement < 0) {
+                slot = -1 - displacement;
+            } else {
+                slot = (int) (hash((unsigned int) displacement, begin, end) % (unsigned int) m_NumEntries);
+            }
+            
+            // Check that this is the right keyword
+            const entry& candidate = m_Entries[slot];
+            if (candidate.matched != matched || candidate.length != length) return -1;
+            
+            const int* text = m_Text + candidate.offset;
+            if (candidate.case_insensitive) {
+                for (iterator symbol = begin; symbol != end; ++symbol, ++text) {
+                    if (fold(*symbol) != fold(*text)) return -1;
+                }
+            } else {
+                for (iterator symbol = begin; symbol != end; ++symbol, ++text) {
+                    if (*symbol != *text) return -1;
+                }
+            }
+            
+            return candidate.symbol;
+        }
+        
+        /// \brief Returns the symbol of the keyword with the specified text, or -1 if there is no keyword with this text
+        /// that the lexer would match as the specified symbol
+        inline int find(int matched, const symbols& text) const { return find(matched, text.begin(), text.end()); }
+        
+    public:
+        /// \brief True if this table contains no keywords
+        inline bool empty() const { return m_NumEntries == 0; }
+        
+        /// \brief The number of entries in this table
+        inline int count_entries() const { return m_NumEntries; }
+        
+        /// \brief The entries in this table
+        inline const entry* entries() const { return m_Entries; }
+        
+        /// \brief The number of buckets in this table
+        inline int count_buckets() const { return m_NumBuckets; }
+        
+        /// \brief The displacement table for the buckets
+        inline const int* displacement() const { return m_Displacement; }
+        
+        /// \brief The text of the keywords
+        inline const int* text() const { return m_Text; }
+        
+        /// \brief The number of characters in the text table
+        int text_length() const;
+    };
+}
+
+#endif
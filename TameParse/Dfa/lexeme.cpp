@@ -31,22 +31,37 @@ using namespace dfa;
 
 /// \brief Creates a nonsensical empty lexeme
 lexeme::lexeme()
-: m_Matched(-1) {
+: m_Matched(-1)
+, m_SharedWith((lexeme*) NULL)
+, m_Content(&m_Symbols) {
     
 }
 
 /// \brief Copy constructor
 lexeme::lexeme(const lexeme& copyFrom) 
-: m_Position(copyFrom.m_Position) 
+: container_item()
+, m_Position(copyFrom.m_Position) 
 , m_Symbols(copyFrom.m_Symbols)
-, m_Matched(copyFrom.m_Matched) {
+, m_Matched(copyFrom.m_Matched)
+, m_SharedWith(copyFrom.m_SharedWith)
+, m_Content(copyFrom.m_SharedWith.item() ? copyFrom.m_Content : &m_Symbols) {
 }
 
 /// \brief Creates a new lexeme
 lexeme::lexeme(const symbols& syms, const position& pos, int matched) 
 : m_Position(pos)
 , m_Symbols(syms)
-, m_Matched(matched) {
+, m_Matched(matched)
+, m_SharedWith((lexeme*) NULL)
+, m_Content(&m_Symbols) {
+}
+
+/// \brief Creates a lexeme with the same content and position as an existing lexeme, but a different matched symbol
+lexeme::lexeme(const lexeme_container& original, int matched)
+: m_Position(original->m_Position)
+, m_Matched(matched)
+, m_SharedWith(original->m_SharedWith.item() ? original->m_SharedWith : original)
+, m_Content(original->m_Content) {
 }
 
 /// \brief Destructor
@@ -64,7 +79,7 @@ lexeme* lexeme::clone() const {
 position lexeme::final_pos() const {
     // Use a position tracker to calculate the final position
     position_tracker tracker(m_Position);
-    tracker.update_position(m_Symbols.begin(), m_Symbols.end());
+    tracker.update_position(m_Content->begin(), m_Content->end());
 
     return tracker.current_position();
 }
@@ -74,8 +89,8 @@ bool lexeme::operator<(const lexeme& compareTo) const {
     if (m_Matched < compareTo.m_Matched) return true;
     if (m_Matched > compareTo.m_Matched) return false;
     
-    if (m_Symbols < compareTo.m_Symbols) return true;
-    if (m_Symbols > compareTo.m_Symbols) return false;
+    if (*m_Content < *compareTo.m_Content) return true;
+    if (*m_Content > *compareTo.m_Content) return false;
     
     if (m_Position < compareTo.m_Position) return true;
     
@@ -34,10 +34,18 @@
 #include "TameParse/Dfa/position.h"
 
 namespace dfa {
+    class lexeme;
+    
+    /// \brief Container for a lexeme
+    typedef util::container<lexeme> lexeme_container;
+    
     ///
     /// \brief Representation of a lexeme (a symbol accepted by a lexer)
     ///
-    class lexeme {
+    /// Lexemes keep their own reference count, so putting a new lexeme in a lexeme_container does not allocate
+    /// anything else.
+    ///
+    class lexeme : public util::container_item {
     public:
         /// \brief Type representing the symbols in a lexeme (we use an integer string as the basic symbol type of our lexer is int)
         typedef std::basic_string<int> symbols;
@@ -52,6 +60,12 @@ namespace dfa {
         /// \brief The symbol ID that was matched by this lexeme
         int m_Matched;
         
+        /// \brief The lexeme that this lexeme shares its content with (refers to NULL if the content is in m_Symbols)
+        lexeme_container m_SharedWith;
+        
+        /// \brief The symbols that make up this lexeme (either m_Symbols or the symbols of the lexeme in m_SharedWith)
+        const symbols* m_Content;
+        
         /// \brief Disabled assignment
         lexeme& operator=(const lexeme& assignFrom);
         
@@ -65,11 +79,19 @@ namespace dfa {
         /// \brief Creates a new lexeme
         lexeme(const symbols& syms, const position& pos, int matched);
         
+        /// \brief Creates a lexeme with the same content and position as an existing lexeme, but a different matched symbol
+        ///
+        /// The content is shared with the original lexeme rather than copied. This is used when a weak symbol is shifted as its
+        /// strong equivalent. The original container must own its lexeme.
+        lexeme(const lexeme_container& original, int matched);
+        
         /// \brief Creates a new lexeme from a sequence of symbols
         template<typename iterator_type> lexeme(iterator_type begin, iterator_type end, const position& pos, int matched, size_t length = 0)
         : m_Position(pos)
+        , m_Symbols()
         , m_Matched(matched)
-        , m_Symbols() {
+        , m_SharedWith((lexeme*) NULL)
+        , m_Content(&m_Symbols) {
             // Reserve space for the symbols if we can
             if (length != 0) m_Symbols.reserve(length);
             
@@ -102,7 +124,7 @@ namespace dfa {
         inline int matched() const { return m_Matched; }
         
         /// \brief The content that makes up this lexeme
-        inline const symbols& content() const { return m_Symbols; }
+        inline const symbols& content() const { return *m_Content; }
         
         /// \brief The initial location of this lexeme
         inline const position& pos() const { return m_Position; }
@@ -118,19 +140,16 @@ namespace dfa {
         template<typename symbol_type> inline std::basic_string<symbol_type> content() const {
             // Create the result and reserve the appropriate amount of space
             std::basic_string<symbol_type> result;
-            result.reserve(m_Symbols.size());
+            result.reserve(m_Content->size());
             
             // Copy the symbols across, using a simple cast operation
-            for (symbols::const_iterator symbol=m_Symbols.begin(); symbol != m_Symbols.end(); ++symbol) {
+            for (symbols::const_iterator symbol=m_Content->begin(); symbol != m_Content->end(); ++symbol) {
                 result += (symbol_type)*symbol;
             }
             
             return result;
         }
     };
-    
-    /// \brief Container for a lexeme
-    typedef util::container<lexeme> lexeme_container;
 }
 
 #endif
@@ -50,11 +50,11 @@ lexer::lexer(ndfa_regex* ndfa)
 ///
 /// The DFA will be compiled immediately into a lexer, and can be discarded after this call. Note that this
 /// call will produce an invalid lexer if the supplied object is not deterministic.
-lexer::lexer(const ndfa& dfa)
+lexer::lexer(const ndfa& dfa, const keyword_table* keywords)
 : m_Ndfa(NULL)
 , m_Lexer(NULL)
 , m_OwnsLexer(true) {
-    m_Lexer = new dfa_lexer<wchar_t, state_machine_flat_table>(dfa);
+    m_Lexer = new dfa_lexer<wchar_t, state_machine_flat_table>(dfa, keywords);
 }
 
 /// \brief Creates an instance of this class that will use the specified basic_lexer
@@ -65,7 +65,10 @@ namespace dfa {
         ///
         /// The DFA will be compiled immediately into a lexer, and can be discarded after this call. Note that this
         /// call will produce an invalid lexer if the supplied object is not deterministic.
-        explicit lexer(const ndfa& dfa);
+        ///
+        /// If a keyword table is supplied, it is used to find the keywords that were left out of the DFA. It is not
+        /// copied, so it must remain valid for as long as this lexer exists.
+        explicit lexer(const ndfa& dfa, const keyword_table* keywords = NULL);
         
         /// \brief Creates an instance of this class that will use the specified basic_lexer
         ///
@@ -343,11 +343,11 @@ ndfa::builder& ndfa::builder::operator>>(const symbol_set& symbols) {
         symbol_set transformed = symbols;
 
         if (m_AddLowercase) {
-            transformed |= s_Unicode.to_lower(symbols);
+            s_Unicode.add_lowercase(transformed, symbols);
         }
 
         if (m_AddUppercase) {
-            transformed |= s_Unicode.to_upper(symbols);
+            s_Unicode.add_uppercase(transformed, symbols);
         }
 
         add_with_surrogates(transformed);
@@ -438,11 +438,17 @@ void ndfa::builder::rejoin() {
 /// \brief Internal method: computes the closure of the specified set of states (modifies the set to include 
 /// all states reachable by epsilon transitions)
 void ndfa::closure(set<int>& states) const {
+    // Get the symbol ID of the epsilon set
+    closure(states, m_Symbols->identifier_for_symbols(epsilon()));
+}
+
+/// \brief Internal method: computes the closure of the specified set of states, given the ID of the epsilon symbol set
+///
+/// This doesn't need to modify the symbol map, so it is safe to call from several threads at once
+void ndfa::closure(set<int>& states, int epsSymbol) const {
     /// Set of states that need to be checked for epsilon transitions
     set<int> newStates = states;
     
-    // Get the symbol ID of the epsilon set
-    int epsSymbol = m_Symbols->identifier_for_symbols(epsilon());
     if (epsSymbol == -1) return;
     
     // Iterate until we've added no new states
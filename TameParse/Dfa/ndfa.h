@@ -40,6 +40,8 @@
 #include "TameParse/Dfa/epsilon.h"
 
 namespace dfa {
+    class parallel_subset_builder;
+    
     ///
     /// \brief Class representing a NDFA (non-deterministic finite state automaton)
     ///
@@ -91,6 +93,11 @@ namespace dfa {
         /// \brief Creates a new NDFA with the specified data
         ndfa(state_list* states, symbol_map* symbols, accept_action_for_state* accept);
         
+        /// \brief Adds a transition from the old state to the new state using the ID of a symbol set that is already in the symbol map
+        inline void add_transition_for_set(int oldState, int symbolSetId, int newState) {
+            (*m_States)[oldState]->add(transition(symbolSetId, newState));
+        }
+        
     public:
         /// \brief Copies an existing NDFA
         ndfa(const ndfa& copyFrom);
@@ -393,10 +400,15 @@ namespace dfa {
         }
         
     private:
+        friend class parallel_subset_builder;
+        
         /// \brief Internal method: computes the closure of the specified set of states (modifies the set to include 
         /// all states reachable by epsilon transitions)
         void closure(std::set<int>& states) const;
         
+        /// \brief Internal method: computes the closure of the specified set of states, given the ID of the epsilon symbol set
+        void closure(std::set<int>& states, int epsSymbol) const;
+        
     public:
         /// \brief Creates a new NDFA that is equivalent to this one, except there will be no overlapping symbol sets
         ///
@@ -419,6 +431,21 @@ namespace dfa {
         /// You can supply a list of initial states to create a DFA with multiple start conditions. These will become states 0, 1, 2, etc in the final DFA.
         ndfa* to_dfa(const std::vector<int>& initialState) const;
         
+        /// \brief Creates a DFA from this NDFA, using several threads to perform the subset construction
+        ///
+        /// The result is identical to the result of to_dfa(): the states are discovered in parallel, but are numbered in the
+        /// same order that the serial algorithm would use. Set numThreads to 0 to use one thread per processor. This will
+        /// fall back to to_dfa() if only one thread is requested or the library was built without thread support.
+        ndfa* to_dfa_parallel(const std::vector<int>& initialState, int numThreads = 0) const;
+        
+        /// \brief Creates a DFA from this NDFA, using several threads to perform the subset construction
+        inline ndfa* to_dfa_parallel(int initialState = 0, int numThreads = 0) const {
+            std::vector<int> initial;
+            initial.push_back(initialState);
+            
+            return to_dfa_parallel(initial, numThreads);
+        }
+        
         /// \brief Compacts a DFA, reducing the number of states
         ///
         /// For DFAs with only a single initial state, this may have one extra state than is required. If firstAction is set
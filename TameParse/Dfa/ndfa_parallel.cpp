@@ -0,0 +1,465 @@
+//
+//  ndfa_parallel.cpp
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+//
+// The multithreaded version of ndfa::to_dfa.
+//
+// This works in two phases. In the first phase, a pool of threads discovers all of the DFA states (as sets of NDFA
+// states) and the transitions between them. States are given a temporary ID when they are first seen, which depends
+// on the order the threads happen to run in. In the second phase, the serial algorithm is replayed over the transitions
+// that were found, which assigns the same state IDs that to_dfa() would have produced. The second phase only has to
+// renumber states, so it is cheap compared to computing the closures and transition sets.
+//
+
+#include <stack>
+
+#include "TameParse/Dfa/ndfa.h"
+#include "TameParse/Dfa/transition.h"
+
+#if __cplusplus >= 201103L
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+
+using namespace std;
+using namespace dfa;
+
+namespace dfa {
+    /// \brief Set of NDFA states that make up a single DFA state
+    typedef set<int> parallel_state_set;
+
+    /// \brief Transitions from a DFA state, as (symbol set, temporary state ID) pairs in symbol set order
+    typedef vector<pair<int, int> > parallel_transitions;
+
+    /// \brief Hashes a set of NDFA states
+    class hash_state_set {
+    public:
+        inline size_t operator()(const parallel_state_set& states) const {
+            size_t hash = states.size();
+            for (parallel_state_set::const_iterator state = states.begin(); state != states.end(); ++state) {
+                hash = hash * 31 + (size_t) *state;
+            }
+            return hash;
+        }
+    };
+
+    ///
+    /// \brief Concurrent map from sets of NDFA states to temporary DFA state IDs
+    ///
+    /// The map is split into a number of shards, each protected by its own lock, so threads only contend when they are
+    /// looking up sets that happen to hash to the same shard.
+    ///
+    class concurrent_state_map {
+    private:
+        /// \brief Map used within a single shard
+        typedef unordered_map<parallel_state_set, int, hash_state_set> shard_map;
+
+        /// \brief Number of shards in this map
+        static const int s_NumShards = 64;
+
+        /// \brief A single shard
+        struct shard {
+            mutex       lock;
+            shard_map   states;
+        };
+
+        /// \brief The shards making up this map
+        shard m_Shards[s_NumShards];
+
+        /// \brief The next temporary state ID to assign
+        atomic<int> m_NextId;
+
+    public:
+        concurrent_state_map()
+        : m_NextId(0) {
+        }
+
+        ///
+        /// \brief Finds or assigns the temporary ID for the specified set of states
+        ///
+        /// The result is the ID and a pointer to the set as stored in the map (which will remain valid until the map is
+        /// destroyed). isNew is set to true if this call assigned the ID.
+        ///
+        int find_or_add(const parallel_state_set& states, const parallel_state_set*& stored, bool& isNew) {
+            shard& target = m_Shards[hash_state_set()(states) % s_NumShards];
+            lock_guard<mutex> guard(target.lock);
+
+            shard_map::iterator found = target.states.find(states);
+            if (found != target.states.end()) {
+                stored  = &found->first;
+                isNew   = false;
+                return found->second;
+            }
+
+            int newId   = m_NextId++;
+            found       = target.states.insert(shard_map::value_type(states, newId)).first;
+            stored      = &found->first;
+            isNew       = true;
+            return newId;
+        }
+
+        /// \brief The number of IDs that have been assigned
+        inline int count() const { return m_NextId; }
+
+        /// \brief Fills in a vector mapping temporary IDs to state sets (only valid once all the threads have finished)
+        void sets_by_id(vector<const parallel_state_set*>& result) const {
+            result.assign(count(), NULL);
+            for (int shardId = 0; shardId < s_NumShards; ++shardId) {
+                const shard_map& states = m_Shards[shardId].states;
+                for (shard_map::const_iterator entry = states.begin(); entry != states.end(); ++entry) {
+                    result[entry->second] = &entry->first;
+                }
+            }
+        }
+    };
+
+    /// \brief DFA state waiting to be processed (temporary ID and the set of NDFA states it represents)
+    typedef pair<int, const parallel_state_set*> parallel_work_item;
+
+    ///
+    /// \brief Work-stealing queue of DFA states that still need to be processed
+    ///
+    /// Each thread has its own queue; threads take work from the back of their own queue and steal from the front of
+    /// other threads' queues when they run out.
+    ///
+    class work_stealing_queue {
+    private:
+        /// \brief Work for a single thread
+        struct thread_queue {
+            mutex                       lock;
+            deque<parallel_work_item>   items;
+        };
+
+        /// \brief The queues for each thread
+        vector<thread_queue*> m_Queues;
+
+        /// \brief Number of items that have been queued but not finished
+        atomic<int> m_Outstanding;
+
+    public:
+        explicit work_stealing_queue(int numThreads)
+        : m_Outstanding(0) {
+            for (int threadId = 0; threadId < numThreads; ++threadId) {
+                m_Queues.push_back(new thread_queue());
+            }
+        }
+
+        ~work_stealing_queue() {
+            for (vector<thread_queue*>::iterator queue = m_Queues.begin(); queue != m_Queues.end(); ++queue) {
+                delete *queue;
+            }
+        }
+
+        /// \brief Adds a new item to the queue for the specified thread
+        void push(int threadId, const parallel_work_item& item) {
+            ++m_Outstanding;
+
+            thread_queue& queue = *m_Queues[threadId];
+            lock_guard<mutex> guard(queue.lock);
+            queue.items.push_back(item);
+        }
+
+        /// \brief Retrieves the next item for the specified thread, stealing work from other threads if there is none left
+        ///
+        /// Returns false once there is no more work to do
+        bool pop(int threadId, parallel_work_item& item) {
+            int numThreads = (int) m_Queues.size();
+
+            for (;;) {
+                // Try our own queue
+                {
+                    thread_queue& queue = *m_Queues[threadId];
+                    lock_guard<mutex> guard(queue.lock);
+                    if (!queue.items.empty()) {
+                        item = queue.items.back();
+                        queue.items.pop_back();
+                        return true;
+                    }
+                }
+
+                // Try to steal from another thread
+                for (int offset = 1; offset < numThreads; ++offset) {
+                    thread_queue& queue = *m_Queues[(threadId + offset) % numThreads];
+                    lock_guard<mutex> guard(queue.lock);
+                    if (!queue.items.empty()) {
+                        item = queue.items.front();
+                        queue.items.pop_front();
+                        return true;
+                    }
+                }
+
+                // Finished if nothing is outstanding (items can only be added by threads that are processing an item)
+                if (m_Outstanding == 0) {
+                    return false;
+                }
+
+                this_thread::yield();
+            }
+        }
+
+        /// \brief Indicates that an item retrieved with pop() has been completely processed
+        inline void finished() { --m_Outstanding; }
+    };
+
+    /// \brief Transitions discovered by a single thread
+    typedef vector<pair<int, parallel_transitions> > parallel_transition_buffer;
+
+    ///
+    /// \brief Performs the first phase of the parallel subset construction
+    ///
+    class parallel_subset_builder {
+    private:
+        /// \brief Maps symbol sets to the states that would be reached in the NDFA
+        typedef map<int, parallel_state_set> transition_for_symbol;
+
+        /// \brief The NDFA being converted
+        const ndfa& m_Ndfa;
+
+        /// \brief The ID of the epsilon symbol set
+        int m_EpsilonSymbolSet;
+
+        /// \brief The states that have been found so far
+        concurrent_state_map& m_StateMap;
+
+        /// \brief The states waiting to be processed
+        work_stealing_queue& m_Queue;
+
+        /// \brief The transitions found by each thread
+        vector<parallel_transition_buffer>& m_Buffers;
+
+    public:
+        parallel_subset_builder(const ndfa& source, int epsilonSymbolSet, concurrent_state_map& stateMap, work_stealing_queue& queue, vector<parallel_transition_buffer>& buffers)
+        : m_Ndfa(source)
+        , m_EpsilonSymbolSet(epsilonSymbolSet)
+        , m_StateMap(stateMap)
+        , m_Queue(queue)
+        , m_Buffers(buffers) {
+        }
+
+        /// \brief Finds the temporary ID for a set of states, queuing it for processing if it is new
+        int find_or_queue(int threadId, const parallel_state_set& states) {
+            const parallel_state_set*   stored;
+            bool                        isNew;
+            int                         stateId = m_StateMap.find_or_add(states, stored, isNew);
+
+            if (isNew) {
+                m_Queue.push(threadId, parallel_work_item(stateId, stored));
+            }
+
+            return stateId;
+        }
+
+        /// \brief Processes states until there are none left
+        void run(int threadId) {
+            parallel_transition_buffer& buffer = m_Buffers[threadId];
+            parallel_work_item          next;
+
+            while (m_Queue.pop(threadId, next)) {
+                // Find the set of states reached by each symbol set for this transition
+                transition_for_symbol   statesForSymbol;
+                bool                    isEager = false;
+
+                for (parallel_state_set::const_iterator stateIt = next.second->begin(); stateIt != next.second->end(); ++stateIt) {
+                    const state& thisState = m_Ndfa.get_state(*stateIt);
+
+                    for (state::iterator transit = thisState.begin(); transit != thisState.end(); ++transit) {
+                        // Ignore the epsilon set (covered by performing the closure)
+                        if (transit->symbol_set() == m_EpsilonSymbolSet) continue;
+
+                        statesForSymbol[transit->symbol_set()].insert(transit->new_state());
+                    }
+
+                    // Check for eager accepting actions
+                    const ndfa::accept_action_list& actions = m_Ndfa.actions_for_state(*stateIt);
+                    for (ndfa::accept_action_list::const_iterator action = actions.begin(); action != actions.end(); ++action) {
+                        if ((*action)->eager()) {
+                            isEager = true;
+                        }
+                    }
+                }
+
+                // Eager states have no transitions
+                if (!isEager) {
+                    buffer.push_back(pair<int, parallel_transitions>(next.first, parallel_transitions()));
+                    parallel_transitions& transitions = buffer.back().second;
+
+                    for (transition_for_symbol::iterator transit = statesForSymbol.begin(); transit != statesForSymbol.end(); ++transit) {
+                        m_Ndfa.closure(transit->second, m_EpsilonSymbolSet);
+                        transitions.push_back(pair<int, int>(transit->first, find_or_queue(threadId, transit->second)));
+                    }
+                }
+
+                m_Queue.finished();
+            }
+        }
+    };
+
+    /// \brief Entry point for the threads that perform the subset construction
+    static void run_parallel_subset_builder(parallel_subset_builder* builder, int threadId) {
+        builder->run(threadId);
+    }
+}
+
+/// \brief Creates a DFA from this NDFA, using several threads to perform the subset construction
+///
+/// The result is identical to the result of to_dfa(): the states are discovered in parallel, but are numbered in the
+/// same order that the serial algorithm would use. Set numThreads to 0 to use one thread per processor. This will
+/// fall back to to_dfa() if only one thread is requested or the library was built without thread support.
+ndfa* ndfa::to_dfa_parallel(const vector<int>& initialState, int numThreads) const {
+    // Work out how many threads to use
+    if (numThreads <= 0) {
+        numThreads = (int) thread::hardware_concurrency();
+    }
+
+    // Use the serial algorithm if there's nothing to parallelise
+    if (numThreads <= 1 || initialState.size() == 0) {
+        return to_dfa(initialState);
+    }
+
+    // The symbols are copied before looking up the epsilon set, as to_dfa() does, so the result doesn't gain an extra set
+    symbol_map* symbols = new symbol_map(*m_Symbols);
+
+    // Get the epsilon set (we must do this before starting any threads as it can add a new symbol set)
+    int epsilonSymbolSet = m_Symbols->identifier_for_symbols(epsilon());
+
+    // Phase 1: discover all of the states in parallel
+    concurrent_state_map                stateMap;
+    work_stealing_queue                 queue(numThreads);
+    vector<parallel_transition_buffer>  buffers(numThreads);
+    parallel_subset_builder             builder(*this, epsilonSymbolSet, stateMap, queue, buffers);
+    vector<int>                         initialTemporary;
+
+    for (vector<int>::const_iterator initialIt = initialState.begin(); initialIt != initialState.end(); ++initialIt) {
+        parallel_state_set thisStateSet;
+        thisStateSet.insert(*initialIt);
+        closure(thisStateSet, epsilonSymbolSet);
+
+        // Spread the initial states between the threads
+        initialTemporary.push_back(builder.find_or_queue((int) initialTemporary.size() % numThreads, thisStateSet));
+    }
+
+    vector<thread> threads;
+    for (int threadId = 0; threadId < numThreads; ++threadId) {
+        threads.push_back(thread(run_parallel_subset_builder, &builder, threadId));
+    }
+    for (vector<thread>::iterator worker = threads.begin(); worker != threads.end(); ++worker) {
+        worker->join();
+    }
+
+    // Merge the per-thread buffers
+    int                                 numTemporary = stateMap.count();
+    vector<const parallel_state_set*>   setForTemporary;
+    vector<const parallel_transitions*> transitionsForTemporary(numTemporary, (const parallel_transitions*) NULL);
+
+    stateMap.sets_by_id(setForTemporary);
+    for (vector<parallel_transition_buffer>::const_iterator buffer = buffers.begin(); buffer != buffers.end(); ++buffer) {
+        for (parallel_transition_buffer::const_iterator entry = buffer->begin(); entry != buffer->end(); ++entry) {
+            transitionsForTemporary[entry->first] = &entry->second;
+        }
+    }
+
+    // Phase 2: replay the serial algorithm to assign the final state IDs
+    state_list*                 states      = new state_list();
+    accept_action_for_state*    accept      = new accept_action_for_state();
+    vector<int>                 temporaryForState;
+    vector<int>                 stateForTemporary(numTemporary, -1);
+    stack<int>                  remainingStates;
+
+    for (vector<int>::const_iterator initialIt = initialTemporary.begin(); initialIt != initialTemporary.end(); ++initialIt) {
+        int stateId = (int) states->size();
+        states->push_back(new state(stateId));
+        temporaryForState.push_back(*initialIt);
+
+        // The first state with a particular set becomes the 'canonical' one
+        if (stateForTemporary[*initialIt] < 0) {
+            stateForTemporary[*initialIt] = stateId;
+        }
+
+        remainingStates.push(stateId);
+    }
+
+    while (!remainingStates.empty()) {
+        int     stateId     = remainingStates.top();
+        state*  thisState   = (*states)[stateId];
+        int     temporaryId = temporaryForState[stateId];
+        remainingStates.pop();
+
+        // Add the accepting actions for this state
+        const parallel_state_set& stateSet = *setForTemporary[temporaryId];
+        for (parallel_state_set::const_iterator stateIt = stateSet.begin(); stateIt != stateSet.end(); ++stateIt) {
+            accept_action_for_state::const_iterator acceptForState = m_Accept->find(*stateIt);
+            if (acceptForState == m_Accept->end()) continue;
+
+            for (accept_action_list::const_iterator acceptIt = acceptForState->second.begin(); acceptIt != acceptForState->second.end(); ++acceptIt) {
+                (*accept)[stateId].push_back((*acceptIt)->clone());
+            }
+        }
+
+        // Eager states have no transitions
+        const parallel_transitions* transitions = transitionsForTemporary[temporaryId];
+        if (!transitions) continue;
+
+        for (parallel_transitions::const_iterator transit = transitions->begin(); transit != transitions->end(); ++transit) {
+            int targetState = stateForTemporary[transit->second];
+
+            // Create a new state if this is the first time the serial algorithm would have reached this one
+            if (targetState < 0) {
+                targetState = (int) states->size();
+                states->push_back(new state(targetState));
+                temporaryForState.push_back(transit->second);
+                stateForTemporary[transit->second] = targetState;
+
+                remainingStates.push(targetState);
+            }
+
+            thisState->add(transition(transit->first, targetState));
+        }
+    }
+
+    // Create the new NDFA from the result
+    ndfa* result = new ndfa(states, symbols, accept);
+    result->m_IsDeterministic = true;
+
+    return result;
+}
+
+#else
+
+using namespace std;
+using namespace dfa;
+
+/// \brief Creates a DFA from this NDFA, using several threads to perform the subset construction
+///
+/// This compiler doesn't support threads, so this just uses the serial algorithm.
+ndfa* ndfa::to_dfa_parallel(const vector<int>& initialState, int numThreads) const {
+    return to_dfa(initialState);
+}
+
+#endif
@@ -54,7 +54,9 @@ ndfa_regex::ndfa_regex(const ndfa_regex& copyFrom)
 , m_ConstructSurrogates(copyFrom.m_ConstructSurrogates)
 , m_CaseInsensitive(copyFrom.m_CaseInsensitive)
 , m_ExpressionMap(copyFrom.m_ExpressionMap)
-, m_LiteralExpressionMap(copyFrom.m_LiteralExpressionMap) {
+, m_LiteralExpressionMap(copyFrom.m_LiteralExpressionMap)
+, m_Unicode(copyFrom.m_Unicode)
+, m_Fragments(copyFrom.m_Fragments) {
 }
 
 /// \brief Converts a string to a symbol_string
@@ -205,6 +207,9 @@ int ndfa_regex::add_regex(builder& cons, const symbol_string& regex) {
 /// change this behaviour by overriding the compile_expression funciton.
 void ndfa_regex::define_expression(const symbol_string& name, const symbol_string& value) {
     m_ExpressionMap[name] = value;
+    
+    // Any expressions that have already been compiled might refer to the old definition
+    m_Fragments.clear();
 }
 
 
@@ -216,6 +221,9 @@ void ndfa_regex::define_expression(const symbol_string& name, const symbol_strin
 /// Unlike the define_expression call, the value given here is literal rather than a regular expression.
 void ndfa_regex::define_expression_literal(const symbol_string& name, const symbol_string& value) {
     m_LiteralExpressionMap[name] = value;
+    
+    // Any expressions that have already been compiled might refer to the old definition
+    m_Fragments.clear();
 }
 
 ///
@@ -371,7 +379,7 @@ void ndfa_regex::compile(symbol_string::const_iterator& pos, const symbol_string
 
             // Compile this expression
             cons.push();
-            compile_expression(expr, cons);
+            add_expression(expr, cons);
             cons.pop();
             break;
         }
@@ -948,28 +956,102 @@ bool ndfa_regex::compile_expression(const symbol_string& expression, builder& co
     // Get the unicode sequence for this item
     string unicodeCategory = unicode_for_expression(expression);
     if (!unicodeCategory.empty()) {
-        // Find all of the symbols that match this category
-        unicode     someUnicode;
-        symbol_set  ourSymbols;
+        // Add a transition for the symbols in this category
+        cons >> m_Unicode.category(unicodeCategory);
+    }
 
-        // Iterate through all of the unicode block
-        for (unicode::iterator block = someUnicode.begin(); block != someUnicode.end(); ++block) {
-            // Main category must match
-            if (block->type[0] != unicodeCategory[0]) continue;
+    // Fail
+    return false;
+}
 
-            // If the category has two parts, then the rest must match too
-            if (unicodeCategory.size() > 1 && block->type[1] != unicodeCategory[1]) continue;
+/// \brief Maps a state in a compiled expression to the equivalent state in a copy of that expression
+static inline int copied_state(int stateId, int firstState, int initialState, int firstCopy) {
+    if (stateId == firstState) return initialState;
+    return firstCopy + (stateId - firstState - 1);
+}
 
-            // This matches: add the symbols ranges
-            for (const unicode::range* r = block->ranges; r->lower >= 0; ++r) {
-                ourSymbols |= range<int>(r->lower, r->upper);
+/// \brief Compiles the value of a {} expression at the current position of the builder
+///
+/// The first time an expression is used, it's compiled into an unreachable part of this NDFA, and then the
+/// resulting states are copied to wherever it is used. This avoids recompiling the same expression over and over.
+void ndfa_regex::add_expression(const symbol_string& expression, builder& cons) {
+    // The options that affect how the expression is compiled are part of its key
+    int flags = (cons.make_lowercase() ? 1 : 0)
+              | (cons.make_uppercase() ? 2 : 0)
+              | (cons.generate_surrogates() ? 4 : 0)
+              | (m_CaseInsensitive ? 8 : 0)
+              | (m_ConstructSurrogates ? 16 : 0);
+    
+    fragment_key                                            key(expression, flags);
+    map<fragment_key, expression_fragment>::const_iterator  found = m_Fragments.find(key);
+    
+    if (found == m_Fragments.end()) {
+        // Compile the expression starting at a new state that nothing else refers to
+        expression_fragment fragment;
+        fragment.firstState = add_state();
+        
+        builder fragmentCons = get_cons();
+        fragmentCons.set_generate_surrogates(cons.generate_surrogates());
+        fragmentCons.set_case_options(cons.make_lowercase(), cons.make_uppercase());
+        fragmentCons.goto_state(get_state(fragment.firstState));
+        
+        fragmentCons.push();
+        compile_expression(expression, fragmentCons);
+        fragmentCons.pop();
+        
+        fragment.lastState  = count_states();
+        fragment.finalState = fragmentCons.current_state().identifier();
+        
+        // The states can only be copied if they don't refer to anything outside of the expression
+        bool selfContained = fragment.finalState >= fragment.firstState && fragment.finalState < fragment.lastState;
+        
+        for (int stateId = fragment.firstState; stateId < fragment.lastState && selfContained; ++stateId) {
+            if (!actions_for_state(stateId).empty()) {
+                selfContained = false;
+                break;
+            }
+            
+            const state& thisState = get_state(stateId);
+            for (state::iterator transit = thisState.begin(); transit != thisState.end(); ++transit) {
+                if (transit->new_state() < fragment.firstState || transit->new_state() >= fragment.lastState) {
+                    selfContained = false;
+                    break;
+                }
             }
         }
-
-        // Add a transition for this symbol set
-        cons >> ourSymbols;
+        
+        if (!selfContained) {
+            fragment.firstState = -1;
+        }
+        
+        found = m_Fragments.insert(map<fragment_key, expression_fragment>::value_type(key, fragment)).first;
     }
-
-    // Fail
-    return false;
+    
+    // Just compile the expression again if it can't be copied
+    const expression_fragment& fragment = found->second;
+    
+    if (fragment.firstState < 0) {
+        compile_expression(expression, cons);
+        return;
+    }
+    
+    // Copy the states from the compiled expression. The first state of the expression is the current state.
+    int initialState    = cons.current_state().identifier();
+    int firstCopy       = count_states();
+    
+    for (int stateId = fragment.firstState + 1; stateId < fragment.lastState; ++stateId) {
+        add_state();
+    }
+    
+    for (int stateId = fragment.firstState; stateId < fragment.lastState; ++stateId) {
+        int             fromState = copied_state(stateId, fragment.firstState, initialState, firstCopy);
+        const state&    thisState = get_state(stateId);
+        
+        for (state::iterator transit = thisState.begin(); transit != thisState.end(); ++transit) {
+            add_transition_for_set(fromState, transit->symbol_set(), copied_state(transit->new_state(), fragment.firstState, initialState, firstCopy));
+        }
+    }
+    
+    // Move to the end of the expression
+    cons.goto_state(get_state(copied_state(fragment.finalState, fragment.firstState, initialState, firstCopy)));
 }
@@ -34,6 +34,7 @@
 
 #include "TameParse/Dfa/ndfa.h"
 #include "TameParse/Dfa/regex_error.h"
+#include "TameParse/Util/unicode.h"
 
 namespace dfa {
     ///
@@ -60,6 +61,35 @@ namespace dfa {
         /// \brief Maps expressions to literal strings
         std::map<symbol_string, symbol_string> m_LiteralExpressionMap;
         
+        /// \brief Unicode tables (caches the symbol sets for any unicode categories used by this object)
+        util::unicode m_Unicode;
+        
+        ///
+        /// \brief A {} expression that has been compiled into this NDFA
+        ///
+        /// The states from firstState up to (but not including) lastState are unreachable from the rest of the NDFA,
+        /// and are copied to wherever the expression is used. firstState stands for the state where the expression
+        /// starts, and finalState is the state it finishes in. firstState is -1 if the expression can't be copied.
+        ///
+        struct expression_fragment {
+            int firstState;
+            int lastState;
+            int finalState;
+        };
+        
+        /// \brief Identifies a compiled expression: its name, and a set of flags for the options that were used to compile it
+        typedef std::pair<symbol_string, int> fragment_key;
+        
+        /// \brief The expressions that have been compiled into this NDFA
+        std::map<fragment_key, expression_fragment> m_Fragments;
+        
+    private:
+        /// \brief Compiles the value of a {} expression at the current position of the builder
+        ///
+        /// The first time an expression is used, it's compiled into an unreachable part of this NDFA, and then the
+        /// resulting states are copied to wherever it is used. This avoids recompiling the same expression over and over.
+        void add_expression(const symbol_string& expression, builder& cons);
+        
     public:
         /// \brief Constructs an empty NDFA
         ndfa_regex();
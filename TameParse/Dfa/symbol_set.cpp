@@ -193,9 +193,9 @@ void symbol_set::invert() {
 }
 
 /// \brief True if the specified symbol is in this set
-bool symbol_set::operator[](int symbol) {
+bool symbol_set::operator[](int symbol) const {
     // Find the item nearest this symbol
-    symbol_store::iterator nearestValue = m_Symbols.upper_bound(symbol);
+    symbol_store::const_iterator nearestValue = m_Symbols.upper_bound(symbol);
     
     // Doesn't exist if this is at the start
     if (nearestValue == m_Symbols.begin()) return false;
@@ -207,6 +207,20 @@ bool symbol_set::operator[](int symbol) {
     return (*nearestValue)[symbol];
 }
 
+/// \brief True if all of the symbols in the specified range are in this set
+bool symbol_set::contains(const symbol_range& symbols) const {
+    // The empty range is in every set
+    if (symbols.lower() >= symbols.upper()) return true;
+    
+    // Find the range that the first symbol should be in
+    symbol_store::const_iterator nearestValue = m_Symbols.upper_bound(symbols.lower());
+    if (nearestValue == m_Symbols.begin()) return false;
+    nearestValue--;
+    
+    // Ranges in this set never touch, so the whole range must be inside this one
+    return nearestValue->lower() <= symbols.lower() && nearestValue->upper() >= symbols.upper();
+}
+
 /// \brief Determines if this set represents the same as another set
 bool symbol_set::operator==(const symbol_set& compareTo) const {
     if (&compareTo == this) return true;
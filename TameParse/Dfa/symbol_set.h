@@ -172,7 +172,10 @@ namespace dfa {
         }
         
         /// \brief True if the specified symbol is in this set
-        bool operator[](int symbol);
+        bool operator[](int symbol) const;
+        
+        /// \brief True if all of the symbols in the specified range are in this set
+        bool contains(const symbol_range& symbols) const;
         
         /// \brief Determines if this set represents the same as another set
         bool operator==(const symbol_set& compareTo) const;
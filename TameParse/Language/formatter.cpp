@@ -40,6 +40,7 @@
 #include "TameParse/Lr/lalr_machine.h"
 #include "TameParse/Lr/lalr_builder.h"
 #include "TameParse/Lr/conflict.h"
+#include "TameParse/Lr/profiling_parser_trace.h"
 
 using namespace std;
 using namespace util;
@@ -518,6 +519,40 @@ wstring formatter::to_string(const conflict& conf, const grammar& gram, const te
     return res.str();
 }
 
+/// \brief Turns the counters collected by a profiling parser into a report
+std::wstring formatter::to_string(const lr::parser_profile& profile, const contextfree::grammar& gram, const contextfree::terminal_dictionary& dict, int maxEntries) {
+    wstringstream res;
+    
+    // Totals and guards are only identified by number
+    profile.write_summary(res);
+    
+    // Write out the most used rules
+    parser_profile::ranking rules = parser_profile::most_frequent(profile.rule_reductions(), maxEntries);
+    
+    res << endl << L"Reductions by rule:" << endl;
+    for (parser_profile::ranking::const_iterator rule = rules.begin(); rule != rules.end(); ++rule) {
+        res << L"  " << rule->first << L"\t" << to_string(*gram.rule_with_identifier(rule->second), gram, dict) << endl;
+    }
+    
+    // ... and the most used nonterminals
+    parser_profile::ranking nonterminals = parser_profile::most_frequent(profile.nonterminal_reductions(), maxEntries);
+    
+    res << endl << L"Reductions by nonterminal:" << endl;
+    for (parser_profile::ranking::const_iterator nt = nonterminals.begin(); nt != nonterminals.end(); ++nt) {
+        res << L"  " << nt->first << L"\t" << to_string(*gram.item_with_identifier(nt->second), gram, dict) << endl;
+    }
+    
+    // ... and the states that are most often shifted into
+    parser_profile::ranking states = parser_profile::most_frequent(profile.shifts(), maxEntries);
+    
+    res << endl << L"Shifts by state:" << endl;
+    for (parser_profile::ranking::const_iterator state = states.begin(); state != states.end(); ++state) {
+        res << L"  " << state->first << L"\tstate " << state->second << endl;
+    }
+    
+    return res.str();
+}
+
 /// \brief Turns a AST node into a string description
 std::wstring formatter::to_string(const util::astnode& node, const contextfree::grammar& gram, const contextfree::terminal_dictionary& dict) {
     // Begin building the result
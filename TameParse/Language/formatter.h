@@ -54,6 +54,7 @@ namespace lr {
     class lr_action;
     class lalr_builder;
     class conflict;
+    class parser_profile;
 }
 
 namespace language {
@@ -106,6 +107,9 @@ namespace language {
         /// \brief Turns a LALR conflict into a string description
         static std::wstring to_string(const lr::conflict& conflict, const contextfree::grammar& gram, const contextfree::terminal_dictionary& dict);
         
+        /// \brief Turns the counters collected by a profiling parser into a report, showing the maxEntries most used rules and states
+        static std::wstring to_string(const lr::parser_profile& profile, const contextfree::grammar& gram, const contextfree::terminal_dictionary& dict, int maxEntries = 20);
+        
     public:
         /// \brief Turns a AST node into a string description
         static std::wstring to_string(const util::astnode& node, const contextfree::grammar& gram, const contextfree::terminal_dictionary& dict);
@@ -28,7 +28,9 @@
 #ifndef _LR_AST_PARSER_H
 #define _LR_AST_PARSER_H
 
+#include "TameParse/Util/arena.h"
 #include "TameParse/Util/astnode.h"
+#include "TameParse/Util/flat_ast.h"
 #include "TameParse/Dfa/lexer.h"
 #include "TameParse/Lr/parser.h"
 
@@ -93,7 +95,7 @@ namespace lr {
             astnode* newNode = new astnode(nonterminal, rule);
             
             // Add the contents of the reduce list to this node
-            newNode->add_children(reduce.rbegin(), reduce.rend());
+            newNode->add_children(reduce.begin(), reduce.end());
             
             // Create the container for this node
             return astnode_container(newNode, true);
@@ -102,6 +104,142 @@ namespace lr {
     
     /// \brief A parser that produces an AST from the input source file
     typedef ast_parser_actions::ast_parser ast_parser;
+    
+    ///
+    /// \brief Parser actions that describe a parser that produces an AST in an arena
+    ///
+    /// The nodes, their lists of children and references to the lexemes are all allocated in an arena supplied by
+    /// the caller, so the tree can be freed in one step by clearing that arena. The tree remains valid after the
+    /// parser that created it is destroyed, until the arena is cleared.
+    ///
+    class arena_ast_parser_actions {
+    public:
+        /// \brief Type of an AST node
+        typedef util::arena_astnode astnode;
+        
+        /// \brief Type of a lexeme stream
+        typedef dfa::lexeme_stream lexeme_stream;
+        
+        /// \brief Type of a parser that uses these actions
+        typedef parser<const astnode*, arena_ast_parser_actions> ast_parser;
+        
+        /// \brief Type of a list of reduced symbols
+        typedef ast_parser::reduce_list reduce_list;
+        
+    private:
+        /// \brief The stream of lexemes that this actions object will read from
+        lexeme_stream* m_Stream;
+        
+        /// \brief The arena where the AST is built
+        util::arena* m_Arena;
+        
+        arena_ast_parser_actions(const arena_ast_parser_actions& copyFrom);
+        arena_ast_parser_actions& operator=(arena_ast_parser_actions& copyFrom);
+        
+    public:
+        /// \brief Creates a new actions object that will read from the specified stream and build an AST in the specified arena
+        ///
+        /// The stream will be deleted when this object is deleted. The arena must not be destroyed until the AST is no longer
+        /// in use.
+        arena_ast_parser_actions(dfa::lexeme_stream* stream, util::arena& arena)
+        : m_Stream(stream)
+        , m_Arena(&arena) {
+        }
+        
+        /// \brief Destroys an existing actions object
+        ~arena_ast_parser_actions() { delete m_Stream; }
+        
+        /// \brief Reads the next symbol from the stream
+        inline dfa::lexeme* read() {
+            dfa::lexeme* result = NULL;
+            (*m_Stream) >> result;
+            return result;
+        }
+        
+        /// \brief Returns the item resulting from a shift action
+        inline const astnode* shift(const dfa::lexeme_container& lexeme) {
+            // Keep the lexeme alive for as long as the arena
+            const dfa::lexeme_container* arenaLexeme = m_Arena->own(new (m_Arena) dfa::lexeme_container(lexeme));
+            
+            // Create a new node from the lexeme
+            return new (m_Arena) astnode(arenaLexeme->item());
+        }
+        
+        /// \brief Returns the item resulting from a reduce action
+        inline const astnode* reduce(int nonterminal, int rule, const reduce_list& reduce, const dfa::position& lookaheadPosition) {
+            // Copy the reduced items into the arena
+            const astnode** children = m_Arena->allocate_array<const astnode*>(reduce.size());
+            for (size_t x = 0; x < reduce.size(); ++x) {
+                children[x] = reduce[x];
+            }
+            
+            // Create a new nonterminal node
+            return new (m_Arena) astnode(nonterminal, rule, children, reduce.size());
+        }
+    };
+    
+    /// \brief A parser that produces an AST in an arena from the input source file
+    typedef arena_ast_parser_actions::ast_parser arena_ast_parser;
+    
+    ///
+    /// \brief Parser actions that describe a parser that records its AST in a flat_ast object
+    ///
+    /// The items on the parser stack are indexes of nodes in the tree. A flat_ast object should only be used by
+    /// a single parser state at a time.
+    ///
+    class flat_ast_parser_actions {
+    public:
+        /// \brief Type of a lexeme stream
+        typedef dfa::lexeme_stream lexeme_stream;
+        
+        /// \brief Type of a parser that uses these actions
+        typedef parser<int, flat_ast_parser_actions> ast_parser;
+        
+        /// \brief Type of a list of reduced symbols
+        typedef ast_parser::reduce_list reduce_list;
+        
+    private:
+        /// \brief The stream of lexemes that this actions object will read from
+        lexeme_stream* m_Stream;
+        
+        /// \brief The tree that is being built
+        util::flat_ast* m_Ast;
+        
+        flat_ast_parser_actions(const flat_ast_parser_actions& copyFrom);
+        flat_ast_parser_actions& operator=(flat_ast_parser_actions& copyFrom);
+        
+    public:
+        /// \brief Creates a new actions object that will read from the specified stream and add the AST to the specified tree
+        ///
+        /// The stream will be deleted when this object is deleted.
+        flat_ast_parser_actions(dfa::lexeme_stream* stream, util::flat_ast& ast)
+        : m_Stream(stream)
+        , m_Ast(&ast) {
+        }
+        
+        /// \brief Destroys an existing actions object
+        ~flat_ast_parser_actions() { delete m_Stream; }
+        
+        /// \brief Reads the next symbol from the stream
+        inline dfa::lexeme* read() {
+            dfa::lexeme* result = NULL;
+            (*m_Stream) >> result;
+            return result;
+        }
+        
+        /// \brief Returns the item resulting from a shift action
+        inline int shift(const dfa::lexeme_container& lexeme) {
+            return m_Ast->add_terminal(lexeme);
+        }
+        
+        /// \brief Returns the item resulting from a reduce action
+        inline int reduce(int nonterminal, int rule, const reduce_list& reduce, const dfa::position& lookaheadPosition) {
+            return m_Ast->add_nonterminal(nonterminal, rule, reduce.begin(), (int) reduce.size());
+        }
+    };
+    
+    /// \brief A parser that records a flat AST from the input source file
+    typedef flat_ast_parser_actions::ast_parser flat_ast_parser;
 }
 
 #endif
@@ -0,0 +1,262 @@
+//
+//  batch_parser.h
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef _LR_BATCH_PARSER_H
+#define _LR_BATCH_PARSER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#if __cplusplus >= 201103L
+#include <thread>
+#include <atomic>
+#endif
+
+#include "TameParse/Dfa/lexer.h"
+#include "TameParse/Lr/parser.h"
+
+namespace lr {
+    ///
+    /// \brief Parses a set of independent documents, one per worker thread at a time
+    ///
+    /// All of the workers share the same parser (and hence the same tables), which is never modified while parsing.
+    /// Each worker creates a single parser state and restarts it for every document it parses, so the stack and
+    /// lookahead buffers are allocated once per thread rather than once per document.
+    ///
+    /// The handler supplies the actions for each document and receives the results. It must implement these
+    /// methods, which are called from the worker threads (so they can be called concurrently, but never for the
+    /// same document at the same time):
+    ///
+    ///     parser_type::actions_type* begin_document(int document)
+    ///     void end_document(int document, parser_type::state& state, bool accepted)
+    ///     void release_document(int document)
+    ///
+    /// end_document is called once the document has been parsed, while the state still contains its final stack.
+    /// release_document is called after the actions for the document have been destroyed, so it can safely free
+    /// anything that they were reading from.
+    ///
+    template<typename parser_type, typename batch_handler> class batch_parser {
+    public:
+        /// \brief The parser state type
+        typedef typename parser_type::state state;
+        
+        /// \brief The parser actions type
+        typedef typename parser_type::actions_type actions;
+        
+    private:
+        /// \brief The parser shared by all of the workers
+        const parser_type& m_Parser;
+        
+        /// \brief The handler that creates actions and receives the results
+        batch_handler& m_Handler;
+        
+        /// \brief The number of documents to parse
+        int m_NumDocuments;
+        
+        /// \brief The parser state that each document is parsed from
+        int m_InitialState;
+        
+        /// \brief The next document that hasn't been picked up by a worker
+#if __cplusplus >= 201103L
+        std::atomic<int> m_NextDocument;
+#else
+        int m_NextDocument;
+#endif
+        
+    private:
+        batch_parser(const batch_parser& noCopying);
+        batch_parser& operator=(const batch_parser& noCopying);
+        
+    public:
+        /// \brief Creates a batch that will parse the specified number of documents, starting in the specified parser state
+        batch_parser(const parser_type& parser, batch_handler& handler, int numDocuments, int initialState = 0)
+        : m_Parser(parser)
+        , m_Handler(handler)
+        , m_NumDocuments(numDocuments)
+        , m_InitialState(initialState)
+        , m_NextDocument(0) {
+        }
+        
+        ///
+        /// \brief Parses documents until there are none left
+        ///
+        /// This can be called from any number of threads at once: each document is parsed exactly once.
+        ///
+        void run() {
+            state* worker = NULL;
+            
+            for (int document = m_NextDocument++; document < m_NumDocuments; document = m_NextDocument++) {
+                // Start parsing the next document, re-using the state from the last one if there was one
+                actions* documentActions = m_Handler.begin_document(document);
+                
+                if (worker) {
+                    worker->restart(documentActions, m_InitialState);
+                } else {
+                    worker = m_Parser.create_parser(documentActions, m_InitialState);
+                }
+                
+                // Parse it
+                bool accepted = worker->parse();
+                m_Handler.end_document(document, *worker, accepted);
+                
+                // Destroy the actions before letting the handler free the document
+                worker->restart(NULL);
+                m_Handler.release_document(document);
+            }
+            
+            delete worker;
+        }
+    };
+    
+    ///
+    /// \brief Parses a set of documents using several threads
+    ///
+    /// See batch_parser for the methods that the handler must implement. Set numThreads to 0 to use one thread per
+    /// processor. The documents are parsed on the calling thread if only one thread is requested or the library was
+    /// built without thread support. The initial state is the parser state to start in for each document (the index
+    /// of the start symbol for parsers with more than one).
+    ///
+    template<typename parser_type, typename batch_handler> void parse_all(const parser_type& parser, batch_handler& handler, int numDocuments, int numThreads = 0, int initialState = 0) {
+        batch_parser<parser_type, batch_handler> batch(parser, handler, numDocuments, initialState);
+        
+#if __cplusplus >= 201103L
+        // Work out how many threads to use
+        if (numThreads <= 0) {
+            numThreads = (int) std::thread::hardware_concurrency();
+        }
+        if (numThreads > numDocuments) {
+            numThreads = numDocuments;
+        }
+        
+        if (numThreads > 1) {
+            // The calling thread waits for the workers
+            std::vector<std::thread> threads;
+            for (int threadId = 0; threadId < numThreads; ++threadId) {
+                threads.push_back(std::thread(&batch_parser<parser_type, batch_handler>::run, &batch));
+            }
+            for (typename std::vector<std::thread>::iterator worker = threads.begin(); worker != threads.end(); ++worker) {
+                worker->join();
+            }
+            return;
+        }
+#endif
+        
+        batch.run();
+    }
+    
+    ///
+    /// \brief Batch handler that parses a list of files with a shared lexer
+    ///
+    /// The actions class must have a constructor that takes a lexeme stream (which it should destroy). The result
+    /// of parsing each file is recorded; files that can't be opened are parsed as if they were empty.
+    ///
+    template<typename parser_type, typename lexer_type = dfa::lexer> class file_batch {
+    public:
+        /// \brief The parser state type
+        typedef typename parser_type::state state;
+        
+        /// \brief The parser actions type
+        typedef typename parser_type::actions_type actions;
+        
+    private:
+        /// \brief The lexer shared by all of the files
+        const lexer_type& m_Lexer;
+        
+        /// \brief The files to parse
+        std::vector<std::string> m_Files;
+        
+        /// \brief The open streams for the files that are being parsed
+        std::vector<std::ifstream*> m_Streams;
+        
+        /// \brief Non-zero for the files that were accepted (a vector<bool> can't be written by several threads at once)
+        std::vector<char> m_Accepted;
+        
+    private:
+        file_batch(const file_batch& noCopying);
+        file_batch& operator=(const file_batch& noCopying);
+        
+    public:
+        /// \brief Creates a handler for the specified list of files
+        file_batch(const lexer_type& lexer, const std::vector<std::string>& files)
+        : m_Lexer(lexer)
+        , m_Files(files)
+        , m_Streams(files.size(), (std::ifstream*) NULL)
+        , m_Accepted(files.size(), 0) {
+        }
+        
+        /// \brief Closes any files that are still open
+        ~file_batch() {
+            for (typename std::vector<std::ifstream*>::iterator stream = m_Streams.begin(); stream != m_Streams.end(); ++stream) {
+                delete *stream;
+            }
+        }
+        
+        /// \brief The number of files in this batch
+        inline int size() const { return (int) m_Files.size(); }
+        
+        /// \brief True if the specified file was accepted by the parser
+        inline bool accepted(int document) const { return m_Accepted[document] != 0; }
+        
+        /// \brief Opens a file and creates the actions that will parse it
+        actions* begin_document(int document) {
+            std::ifstream* stream   = new std::ifstream(m_Files[document].c_str());
+            m_Streams[document]     = stream;
+            
+            return new actions(m_Lexer.create_stream_from(*stream));
+        }
+        
+        /// \brief Records the result of parsing a file
+        void end_document(int document, state& finalState, bool accepted) {
+            m_Accepted[document] = accepted ? 1 : 0;
+        }
+        
+        /// \brief Closes a file once it has been parsed
+        void release_document(int document) {
+            delete m_Streams[document];
+            m_Streams[document] = NULL;
+        }
+    };
+    
+    ///
+    /// \brief Parses a list of files using several threads, and returns which of them were accepted
+    ///
+    /// The parser and lexer are shared between all of the threads. Set numThreads to 0 to use one thread per processor.
+    ///
+    template<typename parser_type, typename lexer_type> std::vector<bool> parse_all(const parser_type& parser, const lexer_type& lexer, const std::vector<std::string>& files, int numThreads = 0) {
+        file_batch<parser_type, lexer_type> batch(lexer, files);
+        parse_all(parser, batch, batch.size(), numThreads);
+        
+        std::vector<bool> result;
+        for (int document = 0; document < batch.size(); ++document) {
+            result.push_back(batch.accepted(document));
+        }
+        return result;
+    }
+}
+
+#endif
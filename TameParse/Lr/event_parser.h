@@ -0,0 +1,163 @@
+//
+//  event_parser.h
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef _LR_EVENT_PARSER_H
+#define _LR_EVENT_PARSER_H
+
+#include "TameParse/Dfa/lexer.h"
+#include "TameParse/Lr/parser.h"
+
+namespace lr {
+    ///
+    /// \brief The range of lexemes matched by a symbol in an event parser
+    ///
+    /// Lexemes are numbered in the order that they are shifted by the parser, starting at 0.
+    ///
+    struct event_span {
+        /// \brief The index of the first lexeme in this span
+        int firstLexeme;
+        
+        /// \brief The number of lexemes in this span
+        int numLexemes;
+    };
+    
+    ///
+    /// \brief Handler for events generated by an event parser that ignores all of them
+    ///
+    /// Handlers don't need to inherit from this class, but doing so means that only the events that are of
+    /// interest need to be implemented. The methods are not virtual: they're resolved when the parser is
+    /// compiled.
+    ///
+    class parser_event_handler {
+    public:
+        /// \brief Called when the parser shifts a lexeme
+        inline void shift(const dfa::lexeme_container&, const event_span&) { }
+        
+        /// \brief Called when the parser reduces a rule
+        inline void reduce(int, int, const event_span&) { }
+        
+        /// \brief Called when the parser accepts the input (by parse_events())
+        inline void accept(const event_span&) { }
+    };
+    
+    ///
+    /// \brief Parser actions that pass the parser's actions on to a handler as events, instead of building a tree
+    ///
+    /// The parser stack only contains an event_span for each symbol, and lexemes are released as soon as they
+    /// have been shifted, so memory use depends on the depth of the parse rather than the size of the input. This
+    /// is useful for performing a single pass over very large files.
+    ///
+    /// The handler_type class should implement the same methods as parser_event_handler.
+    ///
+    template<typename handler_type> class event_parser_actions {
+    public:
+        /// \brief Type of a parser that uses these actions
+        typedef parser<event_span, event_parser_actions<handler_type> > parser_type;
+        
+        /// \brief Type of a list of reduced symbols
+        typedef typename parser_type::reduce_list reduce_list;
+        
+    private:
+        /// \brief The stream of lexemes that this actions object will read from
+        dfa::lexeme_stream* m_Stream;
+        
+        /// \brief True if m_Stream should be deleted along with this object
+        bool m_OwnStream;
+        
+        /// \brief The object that will receive the events
+        handler_type* m_Handler;
+        
+        /// \brief The number of lexemes that have been shifted so far
+        int m_NumShifted;
+        
+        event_parser_actions(const event_parser_actions& copyFrom);
+        event_parser_actions& operator=(const event_parser_actions& copyFrom);
+        
+    public:
+        /// \brief Creates a new actions object that will read from the specified stream, and send events to the specified handler
+        event_parser_actions(dfa::lexeme_stream* stream, handler_type& handler, bool ownStream = true)
+        : m_Stream(stream)
+        , m_OwnStream(ownStream)
+        , m_Handler(&handler)
+        , m_NumShifted(0) {
+        }
+        
+        /// \brief Destroys an existing actions object
+        ~event_parser_actions() { 
+            if (m_OwnStream) delete m_Stream;
+        }
+        
+        /// \brief Reads the next symbol from the stream
+        inline dfa::lexeme* read() {
+            dfa::lexeme* result = NULL;
+            (*m_Stream) >> result;
+            return result;
+        }
+        
+        /// \brief Sends a shift event, and returns the span for the lexeme
+        inline event_span shift(const dfa::lexeme_container& lexeme) {
+            event_span span;
+            span.firstLexeme    = m_NumShifted++;
+            span.numLexemes     = 1;
+            
+            m_Handler->shift(lexeme, span);
+            return span;
+        }
+        
+        /// \brief Sends a reduce event, and returns the span covered by the reduced symbols
+        inline event_span reduce(int nonterminal, int rule, const reduce_list& reduce, const dfa::position& lookaheadPosition) {
+            event_span span;
+            
+            if (reduce.empty()) {
+                // Empty rules cover no lexemes, and are positioned after the last lexeme to be shifted
+                span.firstLexeme    = m_NumShifted;
+                span.numLexemes     = 0;
+            } else {
+                // The reduced symbols are contiguous
+                const event_span& last = reduce[reduce.size()-1];
+                
+                span.firstLexeme    = reduce[0].firstLexeme;
+                span.numLexemes     = last.firstLexeme + last.numLexemes - span.firstLexeme;
+            }
+            
+            m_Handler->reduce(nonterminal, rule, span);
+            return span;
+        }
+    };
+    
+    ///
+    /// \brief Runs a parser that uses event_parser_actions, and sends an accept event to the handler if it succeeds
+    ///
+    template<typename state_type, typename handler_type> inline bool parse_events(state_type* state, handler_type& handler) {
+        if (!state->parse()) return false;
+        
+        handler.accept(state->get_item());
+        return true;
+    }
+}
+
+#endif
@@ -0,0 +1,495 @@
+//
+//  glr_parser.cpp
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include <map>
+
+#include "TameParse/Lr/glr_parser.h"
+#include "TameParse/Lr/lr_action.h"
+
+using namespace std;
+using namespace dfa;
+using namespace lr;
+
+/// \brief Creates an empty forest
+glr_forest::glr_forest()
+: m_Root(-1) {
+}
+
+/// \brief Removes everything from this forest
+void glr_forest::clear() {
+    m_Nodes.clear();
+    m_Alternatives.clear();
+    m_Children.clear();
+    m_Lexemes.clear();
+    m_Root = -1;
+}
+
+/// \brief Adds a terminal node for the lexeme at the specified position
+int glr_forest::add_terminal(const lexeme_container& lexeme, int position) {
+    node terminal;
+    
+    terminal.itemIdentifier     = -1;
+    terminal.firstLexeme        = position;
+    terminal.endLexeme          = position + 1;
+    terminal.lexeme             = (int) m_Lexemes.size();
+    terminal.firstAlternative   = -1;
+    terminal.numAlternatives    = 0;
+    
+    m_Lexemes.push_back(lexeme);
+    m_Nodes.push_back(terminal);
+    
+    return (int) m_Nodes.size() - 1;
+}
+
+/// \brief Adds a nonterminal node with no alternatives
+int glr_forest::add_nonterminal(int itemIdentifier, int firstLexeme, int endLexeme) {
+    node nonterminal;
+    
+    nonterminal.itemIdentifier      = itemIdentifier;
+    nonterminal.firstLexeme         = firstLexeme;
+    nonterminal.endLexeme           = endLexeme;
+    nonterminal.lexeme              = -1;
+    nonterminal.firstAlternative    = -1;
+    nonterminal.numAlternatives     = 0;
+    
+    m_Nodes.push_back(nonterminal);
+    
+    return (int) m_Nodes.size() - 1;
+}
+
+/// \brief Adds an alternative to a node, unless an identical one already exists. Returns true if the alternative was added.
+bool glr_forest::add_alternative(int nodeIndex, int rule, const int* children, int numChildren) {
+    // Check for an existing alternative
+    for (int altIndex = m_Nodes[nodeIndex].firstAlternative; altIndex >= 0; altIndex = m_Alternatives[altIndex].nextAlternative) {
+        const alternative& existing = m_Alternatives[altIndex];
+        if (existing.rule != rule || existing.numChildren != numChildren) continue;
+        
+        bool same = true;
+        for (int child = 0; child < numChildren; ++child) {
+            if (m_Children[existing.firstChild + child] != children[child]) {
+                same = false;
+                break;
+            }
+        }
+        
+        if (same) return false;
+    }
+    
+    // Create a new alternative
+    alternative newAlternative;
+    
+    newAlternative.rule             = rule;
+    newAlternative.firstChild       = (int) m_Children.size();
+    newAlternative.numChildren      = numChildren;
+    newAlternative.nextAlternative  = m_Nodes[nodeIndex].firstAlternative;
+    
+    m_Children.insert(m_Children.end(), children, children + numChildren);
+    m_Alternatives.push_back(newAlternative);
+    
+    m_Nodes[nodeIndex].firstAlternative = (int) m_Alternatives.size() - 1;
+    ++m_Nodes[nodeIndex].numAlternatives;
+    
+    return true;
+}
+
+/// \brief Counts the nodes in this forest that have more than one alternative
+int glr_forest::count_ambiguities() const {
+    int count = 0;
+    
+    for (vector<node>::const_iterator nextNode = m_Nodes.begin(); nextNode != m_Nodes.end(); ++nextNode) {
+        if (nextNode->numAlternatives > 1) ++count;
+    }
+    
+    return count;
+}
+
+///
+/// \brief The graph-structured stack used while the GLR parser is running
+///
+/// The stack is made up of nodes, each of which represents a parser state reached after a particular number of
+/// lexemes. Links between nodes point towards the bottom of the stack, and are labelled with the forest node
+/// for the symbol that moved the parser between the two states.
+///
+/// Only the nodes for the most recent lexeme (the current 'level') can acquire new links. When a new link is
+/// added to a node that has already been processed, every reduction in the level is performed again (duplicate
+/// results are discarded by the forest), which ensures that reductions through empty rules are not missed.
+///
+class graph_stack {
+private:
+    /// \brief A node in the stack
+    struct stack_node {
+        /// \brief The parser state for this node
+        int state;
+        
+        /// \brief The number of lexemes that had been read when this node was created
+        int position;
+        
+        /// \brief The first link from this node, or -1
+        int firstLink;
+    };
+    
+    /// \brief A link between two nodes
+    struct stack_link {
+        /// \brief The node below this one
+        int target;
+        
+        /// \brief The forest node for the symbol on this link, or -1 if it doesn't have one (after a divert action)
+        int forestNode;
+        
+        /// \brief The next link from the same node, or -1
+        int nextLink;
+    };
+    
+    /// \brief A reduction waiting to be performed
+    struct pending_reduction {
+        /// \brief The node to reduce from
+        int node;
+        
+        /// \brief The action that specifies the reduction
+        const parser_tables::action* act;
+    };
+    
+    /// \brief The tables for the parser
+    const parser_tables* m_Tables;
+    
+    /// \brief The forest that is being built
+    glr_forest* m_Forest;
+    
+    /// \brief The nodes in this stack
+    vector<stack_node> m_Nodes;
+    
+    /// \brief The links in this stack
+    vector<stack_link> m_Links;
+    
+    /// \brief The nodes in the current level
+    vector<int> m_Level;
+    
+    /// \brief Maps states to the node in the current level for that state
+    map<int, int> m_LevelStates;
+    
+    /// \brief Maps (symbol, first lexeme) to the forest node for nonterminals ending at the current position
+    map<pair<int, int>, int> m_LevelSymbols;
+    
+    /// \brief Reductions waiting to be performed
+    vector<pending_reduction> m_Pending;
+    
+    /// \brief The forest nodes on the path currently being reduced (in rule order)
+    vector<int> m_Path;
+    
+    /// \brief The number of lexemes read so far
+    int m_Position;
+    
+    /// \brief The symbol that is currently being looked at
+    int m_Symbol;
+    
+    /// \brief True if m_Symbol is a terminal symbol
+    bool m_IsTerminal;
+    
+    /// \brief The node at the bottom of the stack
+    int m_Bottom;
+    
+private:
+    /// \brief Finds the actions for the current symbol in the specified state
+    inline void find_actions(int state, parser_tables::action_iterator& act, parser_tables::action_iterator& end) const {
+        if (m_IsTerminal) {
+            act = m_Tables->find_terminal(state, m_Symbol);
+            end = m_Tables->last_terminal_action(state);
+        } else {
+            act = m_Tables->find_nonterminal(state, m_Symbol);
+            end = m_Tables->last_nonterminal_action(state);
+        }
+    }
+    
+    /// \brief Creates a new node in the current level
+    int add_node(int state) {
+        stack_node newNode;
+        
+        newNode.state       = state;
+        newNode.position    = m_Position;
+        newNode.firstLink   = -1;
+        
+        int index = (int) m_Nodes.size();
+        m_Nodes.push_back(newNode);
+        m_Level.push_back(index);
+        m_LevelStates[state] = index;
+        
+        return index;
+    }
+    
+    /// \brief Adds a link between two nodes, returning false if it already existed
+    bool add_link(int from, int target, int forestNode) {
+        for (int linkIndex = m_Nodes[from].firstLink; linkIndex >= 0; linkIndex = m_Links[linkIndex].nextLink) {
+            if (m_Links[linkIndex].target == target && m_Links[linkIndex].forestNode == forestNode) {
+                return false;
+            }
+        }
+        
+        stack_link newLink;
+        
+        newLink.target      = target;
+        newLink.forestNode  = forestNode;
+        newLink.nextLink    = m_Nodes[from].firstLink;
+        
+        m_Nodes[from].firstLink = (int) m_Links.size();
+        m_Links.push_back(newLink);
+        
+        return true;
+    }
+    
+    /// \brief Queues the reductions for a node in the current level, and performs any divert actions
+    void schedule(int node, bool onlyNonEmpty) {
+        parser_tables::action_iterator act;
+        parser_tables::action_iterator end;
+        find_actions(m_Nodes[node].state, act, end);
+        
+        for (; act != end && act->symbolId == m_Symbol; ++act) {
+            switch (act->type) {
+                case lr_action::act_reduce:
+                case lr_action::act_weakreduce:
+                case lr_action::act_accept:
+                {
+                    if (onlyNonEmpty && m_Tables->rule(act->nextState).length == 0) break;
+                    
+                    pending_reduction reduction;
+                    reduction.node  = node;
+                    reduction.act   = act;
+                    m_Pending.push_back(reduction);
+                    break;
+                }
+                    
+                case lr_action::act_divert:
+                    // Move to the new state without consuming the lookahead
+                    if (!onlyNonEmpty) {
+                        link_state(act->nextState, node, -1);
+                    }
+                    break;
+                    
+                default:
+                    // Shifts are performed once all of the reductions are finished, and guards are not evaluated
+                    break;
+            }
+        }
+    }
+    
+    /// \brief Links a node in the specified state in the current level to a node below it
+    void link_state(int state, int below, int forestNode) {
+        map<int, int>::const_iterator existing = m_LevelStates.find(state);
+        
+        if (existing == m_LevelStates.end()) {
+            // Create a new node, and process its actions
+            int newNode = add_node(state);
+            add_link(newNode, below, forestNode);
+            schedule(newNode, false);
+        } else if (add_link(existing->second, below, forestNode)) {
+            // The new link creates new paths through the existing node: perform the reductions in this level again
+            for (size_t levelPos = 0; levelPos < m_Level.size(); ++levelPos) {
+                schedule(m_Level[levelPos], true);
+            }
+        }
+    }
+    
+    /// \brief Finishes a reduction along a path that ends at the specified node
+    void finish_reduction(int bottomNode, const parser_tables::action* act) {
+        const parser_tables::reduce_rule& rule = m_Tables->rule(act->nextState);
+        
+        // Find or create the forest node for this symbol
+        int                             firstLexeme = m_Nodes[bottomNode].position;
+        pair<int, int>                  key(rule.identifier, firstLexeme);
+        map<pair<int, int>, int>::iterator found    = m_LevelSymbols.find(key);
+        int                             forestNode;
+        
+        if (found == m_LevelSymbols.end()) {
+            forestNode          = m_Forest->add_nonterminal(rule.identifier, firstLexeme, m_Position);
+            m_LevelSymbols[key] = forestNode;
+        } else {
+            forestNode          = found->second;
+        }
+        
+        // Add this path as an alternative (links without a forest node are left out)
+        vector<int> children;
+        children.reserve(m_Path.size());
+        for (vector<int>::const_iterator child = m_Path.begin(); child != m_Path.end(); ++child) {
+            if (*child >= 0) children.push_back(*child);
+        }
+        
+        m_Forest->add_alternative(forestNode, rule.ruleId, children.empty() ? NULL : &children[0], (int) children.size());
+        
+        // Accepting actions finish the parse if they reach the bottom of the stack
+        if (act->type == lr_action::act_accept) {
+            if (bottomNode == m_Bottom) {
+                m_Forest->set_root(forestNode);
+            }
+            return;
+        }
+        
+        // Move to the goto state
+        int gotoState = m_Tables->find_goto(m_Nodes[bottomNode].state, rule.identifier);
+        if (gotoState >= 0) {
+            link_state(gotoState, bottomNode, forestNode);
+        }
+    }
+    
+    /// \brief Follows every path of the specified length from a node, and finishes the reduction for each one
+    void walk(int node, int remaining, const parser_tables::action* act) {
+        if (remaining == 0) {
+            finish_reduction(node, act);
+            return;
+        }
+        
+        // The links are fetched by index, as finishing a reduction can add new links and nodes
+        for (int linkIndex = m_Nodes[node].firstLink; linkIndex >= 0; linkIndex = m_Links[linkIndex].nextLink) {
+            m_Path[remaining-1] = m_Links[linkIndex].forestNode;
+            walk(m_Links[linkIndex].target, remaining-1, act);
+        }
+    }
+    
+    /// \brief Performs all of the reductions for the current level
+    void reduce_level() {
+        // Queue the reductions for every node in this level
+        m_LevelSymbols.clear();
+        
+        for (size_t levelPos = 0; levelPos < m_Level.size(); ++levelPos) {
+            schedule(m_Level[levelPos], false);
+        }
+        
+        // Perform them
+        while (!m_Pending.empty()) {
+            pending_reduction next = m_Pending.back();
+            m_Pending.pop_back();
+            
+            m_Path.resize(m_Tables->rule(next.act->nextState).length);
+            walk(next.node, (int) m_Path.size(), next.act);
+        }
+    }
+    
+    /// \brief Shifts the specified lexeme, creating a new level. Returns false if there are no stacks left.
+    bool shift(const lexeme_container& lexeme) {
+        vector<int>     oldLevel;
+        int             terminalNode = -1;
+        
+        oldLevel.swap(m_Level);
+        m_LevelStates.clear();
+        ++m_Position;
+        
+        for (vector<int>::const_iterator node = oldLevel.begin(); node != oldLevel.end(); ++node) {
+            parser_tables::action_iterator act;
+            parser_tables::action_iterator end;
+            find_actions(m_Nodes[*node].state, act, end);
+            
+            for (; act != end && act->symbolId == m_Symbol; ++act) {
+                switch (act->type) {
+                    case lr_action::act_shift:
+                    case lr_action::act_shiftstrong:
+                    {
+                        // Every stack shares the same forest node for this lexeme
+                        if (terminalNode < 0) {
+                            terminalNode = m_Forest->add_terminal(lexeme, m_Position-1);
+                        }
+                        
+                        map<int, int>::const_iterator existing = m_LevelStates.find(act->nextState);
+                        int target = existing == m_LevelStates.end() ? add_node(act->nextState) : existing->second;
+                        add_link(target, *node, terminalNode);
+                        break;
+                    }
+                        
+                    case lr_action::act_ignore:
+                    {
+                        // The stack is carried over to the next level unchanged
+                        map<int, int>::const_iterator existing = m_LevelStates.find(m_Nodes[*node].state);
+                        int target = existing == m_LevelStates.end() ? add_node(m_Nodes[*node].state) : existing->second;
+                        
+                        for (int linkIndex = m_Nodes[*node].firstLink; linkIndex >= 0; linkIndex = m_Links[linkIndex].nextLink) {
+                            stack_link oldLink = m_Links[linkIndex];
+                            add_link(target, oldLink.target, oldLink.forestNode);
+                        }
+                        break;
+                    }
+                        
+                    default:
+                        break;
+                }
+            }
+        }
+        
+        return !m_Level.empty();
+    }
+    
+public:
+    /// \brief Creates a new stack, starting in the specified state
+    graph_stack(const parser_tables* tables, glr_forest* forest, int initialState)
+    : m_Tables(tables)
+    , m_Forest(forest)
+    , m_Position(0)
+    , m_Symbol(-1)
+    , m_IsTerminal(false) {
+        m_Bottom = add_node(initialState);
+    }
+    
+    /// \brief Runs the parser over the specified stream
+    bool parse(lexeme_stream& stream) {
+        for (;;) {
+            // Read the next lexeme
+            lexeme* nextLexeme = NULL;
+            stream >> nextLexeme;
+            lexeme_container la(nextLexeme, true);
+            
+            if (la.item() != NULL) {
+                m_Symbol        = la->matched();
+                m_IsTerminal    = true;
+            } else {
+                m_Symbol        = m_Tables->end_of_input();
+                m_IsTerminal    = false;
+            }
+            
+            // Perform the reductions for this symbol
+            reduce_level();
+            
+            // Finished at the end of the input
+            if (la.item() == NULL) {
+                return m_Forest->root() >= 0;
+            }
+            
+            // Reject if no stacks can shift this symbol
+            if (!shift(la)) {
+                return false;
+            }
+        }
+    }
+};
+
+/// \brief Creates a GLR parser that uses the specified tables
+glr_parser::glr_parser(const parser_tables& tables)
+: m_Tables(&tables) {
+}
+
+/// \brief Parses the lexemes in a stream, starting at the specified initial state, and stores the result in a forest
+bool glr_parser::parse(lexeme_stream& stream, glr_forest& forest, int initialState) const {
+    forest.clear();
+    
+    graph_stack stack(m_Tables, &forest, initialState);
+    return stack.parse(stream);
+}
@@ -0,0 +1,180 @@
+//
+//  glr_parser.h
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef _LR_GLR_PARSER_H
+#define _LR_GLR_PARSER_H
+
+#include <vector>
+
+#include "TameParse/Dfa/lexer.h"
+#include "TameParse/Lr/parser_tables.h"
+
+namespace lr {
+    ///
+    /// \brief Shared packed parse forest produced by the GLR parser
+    ///
+    /// Each node in the forest represents a symbol matched over a particular range of lexemes. There is only
+    /// ever one node for a given symbol and range, so subtrees are shared between all of the parses that use
+    /// them. Nonterminal nodes have one or more alternatives, each of which is a rule and the list of nodes that
+    /// it was reduced from: a node with more than one alternative indicates an ambiguity in the input.
+    ///
+    class glr_forest {
+    public:
+        ///
+        /// \brief A node in the forest
+        ///
+        struct node {
+            /// \brief The identifier of the nonterminal item for this node (or -1 for a terminal node)
+            int itemIdentifier;
+            
+            /// \brief The index of the first lexeme covered by this node
+            int firstLexeme;
+            
+            /// \brief The index after the last lexeme covered by this node
+            int endLexeme;
+            
+            /// \brief The lexeme for a terminal node (an index into lexemes()), or -1 for a nonterminal node
+            int lexeme;
+            
+            /// \brief The first alternative for this node (an index into the alternatives list), or -1 if there are none
+            int firstAlternative;
+            
+            /// \brief The number of alternatives for this node
+            int numAlternatives;
+        };
+        
+        ///
+        /// \brief A way of reducing a node
+        ///
+        struct alternative {
+            /// \brief The identifier of the rule that was reduced
+            int rule;
+            
+            /// \brief The first child of this alternative (an index into the children list)
+            int firstChild;
+            
+            /// \brief The number of children in this alternative
+            int numChildren;
+            
+            /// \brief The next alternative for the same node, or -1 if this is the last one
+            int nextAlternative;
+        };
+        
+    private:
+        /// \brief The nodes in this forest
+        std::vector<node> m_Nodes;
+        
+        /// \brief The alternatives for the nodes in this forest
+        std::vector<alternative> m_Alternatives;
+        
+        /// \brief The children of the alternatives in this forest (node indexes)
+        std::vector<int> m_Children;
+        
+        /// \brief The lexemes that were shifted by the parser
+        std::vector<dfa::lexeme_container> m_Lexemes;
+        
+        /// \brief The root node, or -1 if the input was not accepted
+        int m_Root;
+        
+    public:
+        /// \brief Creates an empty forest
+        glr_forest();
+        
+        /// \brief Removes everything from this forest
+        void clear();
+        
+        /// \brief Adds a terminal node for the lexeme at the specified position
+        int add_terminal(const dfa::lexeme_container& lexeme, int position);
+        
+        /// \brief Adds a nonterminal node with no alternatives
+        int add_nonterminal(int itemIdentifier, int firstLexeme, int endLexeme);
+        
+        /// \brief Adds an alternative to a node, unless an identical one already exists. Returns true if the alternative was added.
+        bool add_alternative(int node, int rule, const int* children, int numChildren);
+        
+        /// \brief Sets the root node of this forest
+        inline void set_root(int root) { m_Root = root; }
+        
+        /// \brief The root node of the forest, or -1 if the parser rejected its input
+        inline int root() const { return m_Root; }
+        
+        /// \brief The number of nodes in this forest
+        inline int size() const { return (int) m_Nodes.size(); }
+        
+        /// \brief Retrieves the node with the specified index
+        inline const node& get_node(int index) const { return m_Nodes[index]; }
+        
+        /// \brief Retrieves the alternative with the specified index
+        inline const alternative& get_alternative(int index) const { return m_Alternatives[index]; }
+        
+        /// \brief The children of the specified alternative
+        inline const int* children(const alternative& alt) const { return alt.numChildren > 0 ? &m_Children[alt.firstChild] : NULL; }
+        
+        /// \brief The lexeme associated with a terminal node
+        inline const dfa::lexeme_container& lexeme(const node& terminal) const { return m_Lexemes[terminal.lexeme]; }
+        
+        /// \brief True if the specified node has more than one alternative
+        inline bool is_ambiguous(int index) const { return m_Nodes[index].numAlternatives > 1; }
+        
+        /// \brief Counts the nodes in this forest that have more than one alternative
+        int count_ambiguities() const;
+    };
+    
+    ///
+    /// \brief Generalised LR parser
+    ///
+    /// This parser uses the same tables as lr::parser, but instead of picking a single action when there is a
+    /// conflict, it performs all of them. The parser stacks are represented as a graph-structured stack: stacks
+    /// that reach the same state after the same lexeme are merged, so the amount of work the parser does only
+    /// grows where the grammar is actually ambiguous. The result is a glr_forest containing every parse of the
+    /// input.
+    ///
+    /// Weak reductions are performed like any other reduction (stacks where they don't lead to a shift will
+    /// die off). Guard conditions are not evaluated: a grammar that is to be used with this parser should
+    /// leave the conflicts that guards would resolve in place, and they will instead appear as alternatives
+    /// in the forest.
+    ///
+    class glr_parser {
+    private:
+        /// \brief The tables used by this parser
+        const parser_tables* m_Tables;
+        
+    public:
+        /// \brief Creates a GLR parser that uses the specified tables (which must exist for as long as the parser does)
+        explicit glr_parser(const parser_tables& tables);
+        
+        /// \brief Parses the lexemes in a stream, starting at the specified initial state, and stores the result in a forest
+        ///
+        /// Returns true if the input was accepted.
+        bool parse(dfa::lexeme_stream& stream, glr_forest& forest, int initialState = 0) const;
+        
+        /// \brief The tables used by this parser
+        inline const parser_tables& get_tables() const { return *m_Tables; }
+    };
+}
+
+#endif
@@ -0,0 +1,536 @@
+//
+//  incremental_parser.cpp
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include "TameParse/Lr/incremental_parser.h"
+#include "TameParse/Lr/lr_action.h"
+
+using namespace std;
+using namespace dfa;
+using namespace lr;
+
+/// \brief Creates a terminal node
+incremental_node::incremental_node(const lexeme_container& lexeme, int leftState)
+: m_ItemIdentifier(-1)
+, m_Rule(-1)
+, m_Lexeme(lexeme)
+, m_LeftState(leftState)
+, m_Length(1)
+, m_Examined(1) {
+}
+
+/// \brief Creates a nonterminal node
+incremental_node::incremental_node(int itemIdentifier, int rule, int leftState, int length, int examined)
+: m_ItemIdentifier(itemIdentifier)
+, m_Rule(rule)
+, m_Lexeme((dfa::lexeme*) NULL, false)
+, m_LeftState(leftState)
+, m_Length(length)
+, m_Examined(examined) {
+}
+
+/// \brief Adds a child node, which starts at the specified offset from the start of this node
+void incremental_node::add_child(const incremental_node_container& child, int offset) {
+    m_Children.push_back(child);
+    m_ChildOffsets.push_back(offset);
+}
+
+/// \brief Creates an empty parse result
+incremental_parse::incremental_parse()
+: m_Root((incremental_node*) NULL, false)
+, m_RootStart(0)
+, m_ReusedNodes(0)
+, m_ReusedTokens(0) {
+}
+
+namespace lr {
+    ///
+    /// \brief Walks through the tree from a previous parse, finding the subtrees that can be reused at a given position
+    ///
+    /// Positions only ever move forwards, so each node in the old tree is visited at most once during a reparse.
+    ///
+    class reuse_cursor {
+    private:
+        /// \brief A node on the path from the root to the current node
+        struct frame {
+            /// \brief The node
+            const incremental_node_container* node;
+            
+            /// \brief The position of the first token of the node (in the old list of tokens)
+            int start;
+            
+            /// \brief The child that is being visited (for nodes other than the current node)
+            int child;
+        };
+        
+        /// \brief The root of the old tree (kept here in case the old parse is overwritten by the new one)
+        incremental_node_container m_Root;
+        
+        /// \brief The path from the root to the current node
+        vector<frame> m_Path;
+        
+        /// \brief The edit that was made to the old tokens
+        const incremental_edit* m_Edit;
+        
+    private:
+        /// \brief Moves to the first child of the current node
+        void descend() {
+            frame&                  parent  = m_Path.back();
+            const incremental_node& node    = **parent.node;
+            frame                   child;
+            
+            parent.child    = 0;
+            child.node      = &node.children()[0];
+            child.start     = parent.start + node.child_offset(0);
+            child.child     = -1;
+            
+            m_Path.push_back(child);
+        }
+        
+        /// \brief Moves to the next node that is not a descendant of the current node
+        void next() {
+            m_Path.pop_back();
+            
+            while (!m_Path.empty()) {
+                frame&                  parent  = m_Path.back();
+                const incremental_node& node    = **parent.node;
+                
+                ++parent.child;
+                if (parent.child < (int) node.children().size()) {
+                    frame child;
+                    
+                    child.node  = &node.children()[parent.child];
+                    child.start = parent.start + node.child_offset(parent.child);
+                    child.child = -1;
+                    
+                    m_Path.push_back(child);
+                    return;
+                }
+                
+                m_Path.pop_back();
+            }
+        }
+        
+        /// \brief True if none of the tokens examined while building the node starting at the specified position were edited
+        inline bool unchanged(int start, const incremental_node& node) const {
+            return start >= m_Edit->firstToken + m_Edit->numRemoved || start + node.examined() <= m_Edit->firstToken;
+        }
+        
+    public:
+        /// \brief Creates a cursor for the tree in a previous parse
+        reuse_cursor(const incremental_parse& previous, const incremental_edit& edit)
+        : m_Root(previous.root())
+        , m_Edit(&edit) {
+            if (previous.accepted()) {
+                frame root;
+                
+                root.node   = &m_Root;
+                root.start  = previous.root_start();
+                root.child  = -1;
+                
+                m_Path.push_back(root);
+            }
+        }
+        
+        ///
+        /// \brief Finds the largest unchanged subtree that starts at the specified position in the old tokens and was started in the specified state
+        ///
+        /// Returns NULL if there is no such subtree. The position must not be before the position passed to the last call.
+        ///
+        const incremental_node_container* find(int position, int state) {
+            // Move to the first non-empty node that doesn't start before the position
+            while (!m_Path.empty()) {
+                const frame&            current = m_Path.back();
+                const incremental_node& node    = **current.node;
+                
+                if (node.length() == 0 || current.start + node.length() <= position) {
+                    // Node is before the position
+                    next();
+                } else if (current.start < position) {
+                    // Node contains the position
+                    if (node.children().empty()) {
+                        next();
+                    } else {
+                        descend();
+                    }
+                } else {
+                    break;
+                }
+            }
+            
+            if (m_Path.empty() || m_Path.back().start != position) {
+                return NULL;
+            }
+            
+            // Look for a suitable node on the left edge of the subtree starting here
+            const incremental_node_container* candidate = m_Path.back().node;
+            
+            while (candidate) {
+                const incremental_node& node = **candidate;
+                
+                // Terminals are shifted normally
+                if (node.item_identifier() < 0) break;
+                
+                if (node.left_state() == state && unchanged(position, node)) {
+                    return candidate;
+                }
+                
+                // Try the first child that contains any tokens
+                const incremental_node_container* child = NULL;
+                for (int childIndex = 0; childIndex < (int) node.children().size(); ++childIndex) {
+                    if (node.children()[childIndex]->length() > 0) {
+                        child = &node.children()[childIndex];
+                        break;
+                    }
+                }
+                
+                candidate = child;
+            }
+            
+            return NULL;
+        }
+    };
+    
+    ///
+    /// \brief A single run of the incremental parser
+    ///
+    class incremental_run {
+    private:
+        /// \brief An entry on the parser stack
+        struct entry {
+            /// \brief The parser state
+            int state;
+            
+            /// \brief The node for this entry (empty for entries pushed by divert actions)
+            incremental_node_container node;
+            
+            /// \brief The position of the first token covered by the node
+            int start;
+            
+            entry(int newState, const incremental_node_container& newNode, int newStart)
+            : state(newState)
+            , node(newNode)
+            , start(newStart) {
+            }
+        };
+        
+        /// \brief The parser tables
+        const parser_tables* m_Tables;
+        
+        /// \brief The tokens being parsed
+        const incremental_parse::token_list* m_Tokens;
+        
+        /// \brief The parser stack
+        vector<entry> m_Stack;
+        
+        /// \brief Stack of states used when simulating weak reductions
+        vector<int> m_SimulatedStack;
+        
+        /// \brief The position of the current lookahead token
+        int m_Position;
+        
+    private:
+        /// \brief Finds the actions for the current lookahead symbol in the specified state
+        inline void find_actions(int state, int symbol, bool isTerminal, parser_tables::action_iterator& act, parser_tables::action_iterator& end) const {
+            if (isTerminal) {
+                act = m_Tables->find_terminal(state, symbol);
+                end = m_Tables->last_terminal_action(state);
+            } else {
+                act = m_Tables->find_nonterminal(state, symbol);
+                end = m_Tables->last_nonterminal_action(state);
+            }
+        }
+        
+        /// \brief Returns true if reducing with the specified weak reduce action will eventually lead to the lookahead being shifted
+        bool can_reduce(int symbol, bool isTerminal, const parser_tables::action* weakReduce) {
+            m_SimulatedStack.clear();
+            for (vector<entry>::const_iterator stackEntry = m_Stack.begin(); stackEntry != m_Stack.end(); ++stackEntry) {
+                m_SimulatedStack.push_back(stackEntry->state);
+            }
+            
+            const parser_tables::action* act = weakReduce;
+            
+            for (;;) {
+                // Perform the reduction
+                const parser_tables::reduce_rule& rule = m_Tables->rule(act->nextState);
+                if (rule.length >= (int) m_SimulatedStack.size()) return false;
+                
+                m_SimulatedStack.resize(m_SimulatedStack.size() - rule.length);
+                
+                int gotoState = m_Tables->find_goto(m_SimulatedStack.back(), rule.identifier);
+                if (gotoState < 0) return false;
+                m_SimulatedStack.push_back(gotoState);
+                
+                // Find the next action for the symbol
+                parser_tables::action_iterator next;
+                parser_tables::action_iterator end;
+                find_actions(gotoState, symbol, isTerminal, next, end);
+                
+                act = NULL;
+                for (; next != end && next->symbolId == symbol; ++next) {
+                    if (next->type == lr_action::act_guard) continue;
+                    act = next;
+                    break;
+                }
+                
+                if (!act) return false;
+                
+                switch (act->type) {
+                    case lr_action::act_reduce:
+                    case lr_action::act_weakreduce:
+                        continue;
+                        
+                    default:
+                        return true;
+                }
+            }
+        }
+        
+        /// \brief Performs a reduction, returning false if there is no goto for the reduced nonterminal
+        bool reduce(const parser_tables::reduce_rule& rule) {
+            int firstEntry  = (int) m_Stack.size() - rule.length;
+            int start       = rule.length > 0 ? m_Stack[firstEntry].start : m_Position;
+            int end         = start;
+            int examinedEnd = m_Position + 1;
+            
+            for (int entryIndex = firstEntry; entryIndex < (int) m_Stack.size(); ++entryIndex) {
+                const entry& child = m_Stack[entryIndex];
+                if (child.node.item() == NULL) continue;
+                
+                if (child.start + child.node->length() > end)       end         = child.start + child.node->length();
+                if (child.start + child.node->examined() > examinedEnd)  examinedEnd = child.start + child.node->examined();
+            }
+            
+            int leftState = m_Stack[firstEntry - 1].state;
+            incremental_node_container node(new incremental_node(rule.identifier, rule.ruleId, leftState, end - start, examinedEnd - start), true);
+            
+            for (int entryIndex = firstEntry; entryIndex < (int) m_Stack.size(); ++entryIndex) {
+                const entry& child = m_Stack[entryIndex];
+                if (child.node.item() == NULL) continue;
+                
+                node->add_child(child.node, child.start - start);
+            }
+            
+            m_Stack.erase(m_Stack.begin() + firstEntry, m_Stack.end());
+            
+            int gotoState = m_Tables->find_goto(leftState, rule.identifier);
+            if (gotoState < 0) return false;
+            
+            m_Stack.push_back(entry(gotoState, node, start));
+            return true;
+        }
+        
+    public:
+        /// \brief Prepares to parse a list of tokens
+        incremental_run(const parser_tables* tables, const incremental_parse::token_list* tokens, int initialState)
+        : m_Tables(tables)
+        , m_Tokens(tokens)
+        , m_Position(0) {
+            m_Stack.push_back(entry(initialState, incremental_node_container((incremental_node*) NULL, false), 0));
+        }
+        
+        /// \brief Runs the parser, reusing nodes from the cursor if it's not NULL, and stores the result
+        bool run(reuse_cursor* cursor, const incremental_edit* edit, incremental_parse& result) {
+            int numTokens = (int) m_Tokens->size();
+            
+            for (;;) {
+                // Shift an unchanged subtree from the old tree if there is one that fits
+                if (cursor) {
+                    // Work out where the current token was in the old list of tokens
+                    int oldPosition = -1;
+                    int numInserted = (int) edit->inserted.size();
+                    
+                    if (m_Position < edit->firstToken) {
+                        oldPosition = m_Position;
+                    } else if (m_Position >= edit->firstToken + numInserted) {
+                        oldPosition = m_Position - numInserted + edit->numRemoved;
+                    }
+                    
+                    if (oldPosition >= 0) {
+                        const incremental_node_container* reuse = cursor->find(oldPosition, m_Stack.back().state);
+                        
+                        if (reuse) {
+                            int gotoState = m_Tables->find_goto(m_Stack.back().state, (*reuse)->item_identifier());
+                            
+                            if (gotoState >= 0) {
+                                m_Stack.push_back(entry(gotoState, *reuse, m_Position));
+                                m_Position += (*reuse)->length();
+                                
+                                ++result.m_ReusedNodes;
+                                result.m_ReusedTokens += (*reuse)->length();
+                                continue;
+                            }
+                        }
+                    }
+                }
+                
+                // Find the actions for the current lookahead
+                int                             symbol;
+                bool                            isTerminal = m_Position < numTokens;
+                parser_tables::action_iterator  act;
+                parser_tables::action_iterator  end;
+                
+                if (isTerminal) {
+                    symbol = (*m_Tokens)[m_Position]->matched();
+                } else {
+                    symbol = m_Tables->end_of_input();
+                }
+                
+                find_actions(m_Stack.back().state, symbol, isTerminal, act, end);
+                
+                // Use the first action that applies (guards are not evaluated)
+                const parser_tables::action* chosen = NULL;
+                
+                for (; act != end && act->symbolId == symbol; ++act) {
+                    if (act->type == lr_action::act_guard) continue;
+                    if (act->type == lr_action::act_weakreduce && !can_reduce(symbol, isTerminal, act)) continue;
+                    
+                    chosen = act;
+                    break;
+                }
+                
+                if (!chosen) return false;
+                
+                switch (chosen->type) {
+                    case lr_action::act_accept:
+                        result.m_Root       = m_Stack.back().node;
+                        result.m_RootStart  = m_Stack.back().start;
+                        return true;
+                        
+                    case lr_action::act_ignore:
+                        ++m_Position;
+                        break;
+                        
+                    case lr_action::act_shift:
+                    {
+                        incremental_node_container terminal(new incremental_node((*m_Tokens)[m_Position], m_Stack.back().state), true);
+                        m_Stack.push_back(entry(chosen->nextState, terminal, m_Position));
+                        ++m_Position;
+                        break;
+                    }
+                        
+                    case lr_action::act_shiftstrong:
+                    {
+                        // Shift the strong equivalent of the lookahead
+                        const lexeme_container& weak = (*m_Tokens)[m_Position];
+                        lexeme_container        strong(new lexeme(weak, m_Tables->strong_for_weak(weak->matched())), true);
+                        
+                        incremental_node_container terminal(new incremental_node(strong, m_Stack.back().state), true);
+                        m_Stack.push_back(entry(chosen->nextState, terminal, m_Position));
+                        ++m_Position;
+                        break;
+                    }
+                        
+                    case lr_action::act_divert:
+                        m_Stack.push_back(entry(chosen->nextState, incremental_node_container((incremental_node*) NULL, false), m_Position));
+                        break;
+                        
+                    case lr_action::act_reduce:
+                    case lr_action::act_weakreduce:
+                        if (!reduce(m_Tables->rule(chosen->nextState))) return false;
+                        break;
+                        
+                    default:
+                        return false;
+                }
+            }
+        }
+    };
+}
+
+/// \brief Creates an incremental parser that uses the specified tables, starting in the specified state
+incremental_parser::incremental_parser(const parser_tables& tables, int initialState)
+: m_Tables(&tables)
+, m_InitialState(initialState)
+, m_CanReuse(true) {
+    // Subtrees can't be reused if the tables contain any guards or weak reductions
+    for (int stateId = 0; stateId < tables.count_states() && m_CanReuse; ++stateId) {
+        for (const parser_tables::action* act = tables.terminal_actions()[stateId]; act != tables.last_terminal_action(stateId); ++act) {
+            if (act->type == lr_action::act_guard || act->type == lr_action::act_weakreduce) {
+                m_CanReuse = false;
+                break;
+            }
+        }
+        
+        for (const parser_tables::action* act = tables.nonterminal_actions()[stateId]; act != tables.last_nonterminal_action(stateId); ++act) {
+            if (act->type == lr_action::act_guard || act->type == lr_action::act_weakreduce) {
+                m_CanReuse = false;
+                break;
+            }
+        }
+    }
+}
+
+/// \brief Parses all of the tokens in a stream, and returns true if they were accepted
+bool incremental_parser::parse(lexeme_stream& stream, incremental_parse& result) const {
+    incremental_parse::token_list tokens;
+    
+    for (;;) {
+        lexeme* next = NULL;
+        stream >> next;
+        if (!next) break;
+        
+        tokens.push_back(lexeme_container(next, true));
+    }
+    
+    return parse(tokens, result);
+}
+
+/// \brief Parses a list of tokens, and returns true if they were accepted
+bool incremental_parser::parse(const incremental_parse::token_list& tokens, incremental_parse& result) const {
+    result.m_Tokens         = tokens;
+    result.m_Root           = incremental_node_container((incremental_node*) NULL, false);
+    result.m_RootStart      = 0;
+    result.m_ReusedNodes    = 0;
+    result.m_ReusedTokens   = 0;
+    
+    incremental_run run(m_Tables, &result.m_Tokens, m_InitialState);
+    return run.run(NULL, NULL, result);
+}
+
+/// \brief Applies an edit to the tokens from a previous parse and parses the result, reusing any unchanged parts of the old tree
+bool incremental_parser::reparse(const incremental_parse& previous, const incremental_edit& edit, incremental_parse& result) const {
+    // Apply the edit to the tokens
+    const incremental_parse::token_list& oldTokens = previous.tokens();
+    incremental_parse::token_list        newTokens;
+    
+    newTokens.reserve(oldTokens.size() - edit.numRemoved + edit.inserted.size());
+    newTokens.insert(newTokens.end(), oldTokens.begin(), oldTokens.begin() + edit.firstToken);
+    newTokens.insert(newTokens.end(), edit.inserted.begin(), edit.inserted.end());
+    newTokens.insert(newTokens.end(), oldTokens.begin() + edit.firstToken + edit.numRemoved, oldTokens.end());
+    
+    // Parse them, reusing what we can from the previous tree (which might be the same object as the result)
+    reuse_cursor oldTree(previous, edit);
+    
+    result.m_Tokens.swap(newTokens);
+    result.m_Root           = incremental_node_container((incremental_node*) NULL, false);
+    result.m_RootStart      = 0;
+    result.m_ReusedNodes    = 0;
+    result.m_ReusedTokens   = 0;
+    
+    incremental_run run(m_Tables, &result.m_Tokens, m_InitialState);
+    return run.run(m_CanReuse ? &oldTree : NULL, &edit, result);
+}
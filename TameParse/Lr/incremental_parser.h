@@ -0,0 +1,234 @@
+//
+//  incremental_parser.h
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef _LR_INCREMENTAL_PARSER_H
+#define _LR_INCREMENTAL_PARSER_H
+
+#include <vector>
+
+#include "TameParse/Dfa/lexer.h"
+#include "TameParse/Util/container.h"
+#include "TameParse/Lr/parser_tables.h"
+
+namespace lr {
+    class incremental_node;
+    class incremental_run;
+    
+    /// \brief Reference to a node in an incremental syntax tree (nodes are shared between versions of the tree)
+    typedef util::container<incremental_node> incremental_node_container;
+    
+    ///
+    /// \brief Node in a syntax tree produced by the incremental parser
+    ///
+    /// As well as the usual AST data, each node records what the parser needs to know to decide whether or not it
+    /// can be reused after an edit: the parser state that it was started in, the number of tokens that it covers and
+    /// the number of tokens (counting from its first token) that the parser examined while building it. Positions
+    /// are relative, so a node that is reused can be moved to a new place in the input without changing it.
+    ///
+    class incremental_node {
+    public:
+        /// \brief List of nodes
+        typedef std::vector<incremental_node_container> node_list;
+        
+    private:
+        /// \brief The identifier of the nonterminal for this node (or -1 for a terminal node)
+        int m_ItemIdentifier;
+        
+        /// \brief The identifier of the rule that was matched for this node (or -1 for a terminal node)
+        int m_Rule;
+        
+        /// \brief The lexeme for a terminal node
+        dfa::lexeme_container m_Lexeme;
+        
+        /// \brief The child nodes of a nonterminal node
+        node_list m_Children;
+        
+        /// \brief The position of the first token of each child, relative to the first token of this node
+        std::vector<int> m_ChildOffsets;
+        
+        /// \brief The parser state that this node was started in
+        int m_LeftState;
+        
+        /// \brief The number of tokens covered by this node (including any ignored tokens between its children)
+        int m_Length;
+        
+        /// \brief The number of tokens examined by the parser while building this node, counting from its first token
+        ///
+        /// This is always at least m_Length, as the parser has to look past the end of a nonterminal to decide to reduce it.
+        /// The end of the input counts as a token.
+        int m_Examined;
+        
+    public:
+        /// \brief Creates a terminal node
+        incremental_node(const dfa::lexeme_container& lexeme, int leftState);
+        
+        /// \brief Creates a nonterminal node
+        incremental_node(int itemIdentifier, int rule, int leftState, int length, int examined);
+        
+        /// \brief The identifier of the nonterminal for this node (or -1 for a terminal node)
+        inline int item_identifier() const { return m_ItemIdentifier; }
+        
+        /// \brief The identifier of the rule that was matched for this node (or -1 for a terminal node)
+        inline int rule() const { return m_Rule; }
+        
+        /// \brief The lexeme for a terminal node
+        inline const dfa::lexeme_container& lexeme() const { return m_Lexeme; }
+        
+        /// \brief The child nodes of a nonterminal node
+        inline const node_list& children() const { return m_Children; }
+        
+        /// \brief The position of the first token of the specified child, relative to the first token of this node
+        inline int child_offset(int child) const { return m_ChildOffsets[child]; }
+        
+        /// \brief Adds a child node, which starts at the specified offset from the start of this node
+        void add_child(const incremental_node_container& child, int offset);
+        
+        /// \brief The parser state that this node was started in
+        inline int left_state() const { return m_LeftState; }
+        
+        /// \brief The number of tokens covered by this node
+        inline int length() const { return m_Length; }
+        
+        /// \brief The number of tokens examined by the parser while building this node
+        inline int examined() const { return m_Examined; }
+    };
+    
+    ///
+    /// \brief An edit to a list of tokens
+    ///
+    /// The tokens in the range [firstToken, firstToken + numRemoved) are replaced with the inserted tokens. Callers
+    /// are expected to re-run the lexer over the part of the text that was changed to produce the new tokens.
+    ///
+    struct incremental_edit {
+        /// \brief The index of the first token that was changed
+        int firstToken;
+        
+        /// \brief The number of tokens that were removed
+        int numRemoved;
+        
+        /// \brief The tokens that replace the ones that were removed
+        std::vector<dfa::lexeme_container> inserted;
+    };
+    
+    ///
+    /// \brief The result of parsing a list of tokens with the incremental parser
+    ///
+    class incremental_parse {
+    public:
+        /// \brief List of tokens
+        typedef std::vector<dfa::lexeme_container> token_list;
+        
+    private:
+        friend class incremental_parser;
+        friend class incremental_run;
+        
+        /// \brief The tokens that were parsed (including any ignored tokens)
+        token_list m_Tokens;
+        
+        /// \brief The root of the syntax tree (empty if the tokens were rejected)
+        incremental_node_container m_Root;
+        
+        /// \brief The index of the first token of the root node
+        int m_RootStart;
+        
+        /// \brief The number of subtrees that were reused from the previous parse
+        int m_ReusedNodes;
+        
+        /// \brief The number of tokens covered by the subtrees that were reused from the previous parse
+        int m_ReusedTokens;
+        
+    public:
+        /// \brief Creates an empty parse result
+        incremental_parse();
+        
+        /// \brief The tokens that were parsed
+        inline const token_list& tokens() const { return m_Tokens; }
+        
+        /// \brief The root of the syntax tree (empty if the tokens were rejected)
+        inline const incremental_node_container& root() const { return m_Root; }
+        
+        /// \brief The index of the first token of the root node (tokens before this are ignored tokens)
+        inline int root_start() const { return m_RootStart; }
+        
+        /// \brief True if the tokens were accepted by the parser
+        inline bool accepted() const { return m_Root.item() != NULL; }
+        
+        /// \brief The number of subtrees that were reused from the previous parse
+        inline int reused_nodes() const { return m_ReusedNodes; }
+        
+        /// \brief The number of tokens covered by the subtrees that were reused from the previous parse
+        inline int reused_tokens() const { return m_ReusedTokens; }
+    };
+    
+    ///
+    /// \brief Parser that can update the syntax tree for an input after an edit, reusing the parts that didn't change
+    ///
+    /// This is a deterministic LR parser driven directly by the parser tables. When reparsing, whenever the old tree
+    /// has an unchanged subtree that starts at the current token and was started in the same parser state as the
+    /// current one, the parser shifts the whole subtree as a single nonterminal instead of parsing its tokens again.
+    /// A subtree is unchanged if none of the tokens that the parser examined while building it (including the
+    /// lookahead past its end) were part of the edit.
+    ///
+    /// This works because the actions of an LR parser only depend on the states above the point where a subtree was
+    /// started. Guards and weak reductions can look deeper into the stack and further into the input, so subtrees are
+    /// never reused with tables that contain them. Weak reductions are still handled (by simulating the reduction as
+    /// the standard parser does), but guards are not evaluated.
+    ///
+    class incremental_parser {
+    private:
+        /// \brief The parser tables
+        const parser_tables* m_Tables;
+        
+        /// \brief The initial parser state
+        int m_InitialState;
+        
+        /// \brief True if subtrees can be reused with these tables
+        bool m_CanReuse;
+        
+    public:
+        /// \brief Creates an incremental parser that uses the specified tables, starting in the specified state
+        explicit incremental_parser(const parser_tables& tables, int initialState = 0);
+        
+        /// \brief True if this parser can reuse subtrees (false if the tables contain guards or weak reductions)
+        inline bool can_reuse() const { return m_CanReuse; }
+        
+        /// \brief Parses all of the tokens in a stream, and returns true if they were accepted
+        bool parse(dfa::lexeme_stream& stream, incremental_parse& result) const;
+        
+        /// \brief Parses a list of tokens, and returns true if they were accepted
+        bool parse(const incremental_parse::token_list& tokens, incremental_parse& result) const;
+        
+        ///
+        /// \brief Applies an edit to the tokens from a previous parse and parses the result, reusing any unchanged parts of the old tree
+        ///
+        /// The previous parse does not have to have been accepted, but only subtrees from an accepted parse can be reused.
+        ///
+        bool reparse(const incremental_parse& previous, const incremental_edit& edit, incremental_parse& result) const;
+    };
+}
+
+#endif
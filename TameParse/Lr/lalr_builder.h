@@ -174,6 +174,9 @@ namespace lr {
         /// \brief Returns the number of states in the state machine
         inline int count_states() const { return m_Machine.count_states(); }
         
+        /// \brief Maps the ID of guard rules to their initial state
+        inline const std::map<int, int>& guard_states() const { return m_StatesForGuard; }
+        
         /// \brief After the state machine has been completely built, returns the actions for the specified state
         ///
         /// If there are conflicts, this will return multiple actions for a single symbol.
@@ -29,14 +29,18 @@
 #define _LR_PARSER_H
 
 #include <vector>
+#include <map>
 #include <stack>
+#include <iterator>
 #include <iostream>
+#include <cassert>
 
 #include "TameParse/Dfa/lexeme.h"
 #include "TameParse/Dfa/basic_lexer.h"
 #include "TameParse/Lr/lalr_builder.h"
 #include "TameParse/Lr/parser_tables.h"
 #include "TameParse/Lr/parser_stack.h"
+#include "TameParse/Lr/state_stack.h"
 
 namespace lr {
     
@@ -55,6 +59,54 @@ namespace lr {
         };
     };
     
+    ///
+    /// \brief List of items passed to a reduce action by the parser
+    ///
+    /// This is a view onto a buffer owned by the parser state, with the items in the order that they
+    /// appear in the rule being reduced. It is only valid for the duration of the reduce call: actions
+    /// that want to keep the items must copy them.
+    ///
+    template<typename item_type> class reduce_view {
+    public:
+        typedef const item_type* const_iterator;
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+        
+    private:
+        /// \brief The first item in this list
+        const item_type* m_Items;
+        
+        /// \brief The number of items in this list
+        size_t m_Count;
+        
+    public:
+        /// \brief Creates a view of count items starting at items
+        inline reduce_view(const item_type* items, size_t count)
+        : m_Items(items)
+        , m_Count(count) {
+        }
+        
+        /// \brief The number of items in this list
+        inline size_t size() const { return m_Count; }
+        
+        /// \brief True if this list is empty
+        inline bool empty() const { return m_Count == 0; }
+        
+        /// \brief Retrieves the item at the specified index (0 is the first symbol in the rule)
+        inline const item_type& operator[](size_t index) const { return m_Items[index]; }
+        
+        /// \brief The first item in this list
+        inline const_iterator begin() const { return m_Items; }
+        
+        /// \brief The item after the last item in this list
+        inline const_iterator end() const { return m_Items + m_Count; }
+        
+        /// \brief The last item in this list
+        inline const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        
+        /// \brief The item before the first item in this list
+        inline const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+    };
+    
     ///
     /// \brief Parser trace class that performs no actions
     ///
@@ -72,7 +124,12 @@ namespace lr {
         inline void shift(const lexeme_container& lookahead, int newState)  { }
         inline void reduce(int nonterminalId, int ruleId, int length)       { }
         inline void goto_state(int newState)                                { }
+        inline void begin_guard(int initialState)                           { }
         inline void checked_guard(int initialState, int result)             { }
+        inline void ran_guard(int initialState)                             { }
+        inline void checked_reduce(bool result)                             { }
+        inline void looked_ahead(int offset)                                { }
+        inline void read_lookahead(int bufferedSymbols)                     { }
         inline void reject(const lexeme_container& lookahead)               { }
     };
     
@@ -116,7 +173,12 @@ namespace lr {
     ///
     /// \brief Generic parser implementation.
     ///
-    template<typename item_type, typename parser_actions, typename parser_trace = no_parser_trace> class parser {
+    /// The features parameter is a combination of values from parser_features. Actions that need a feature
+    /// that is not in this set are not checked for when parsing, so it must include everything returned by
+    /// the features() call of the tables that the parser will use. Parsers for grammars that need none of
+    /// these features can use parser_features::none to get a plain LALR(1) parser.
+    ///
+    template<typename item_type, typename parser_actions, typename parser_trace = no_parser_trace, int features = parser_features::all> class parser {
     private:
         /// \brief The parser tables
         const parser_tables* m_ParserTables;
@@ -132,19 +194,38 @@ namespace lr {
         /// \brief Parser action
         typedef parser_tables::action action;
         
+        /// \brief The parser actions class used by this parser
+        typedef parser_actions actions_type;
+        
+        /// \brief The type of the items on the parser stack
+        typedef item_type stack_item;
+        
         /// \brief The parser stack
         typedef parser_stack<item_type> stack;
         
+        /// \brief The stack used when simulating parser actions (when checking guards and weak reductions)
+        typedef state_stack<> fake_stack;
+        
         /// \brief List of items passed to a reduce action
-        typedef std::vector<item_type> reduce_list;
+        typedef reduce_view<item_type> reduce_list;
         
         /// \brief Forward declaration of the state class
         class state;
         
+        /// \brief True if a parser with this set of features can run the specified tables
+        ///
+        /// The constructors check this in debug builds, as a parser that is missing a feature its tables need
+        /// will silently ignore the actions that use it.
+        static bool supports_tables(const parser_tables& tables) {
+            return (tables.features() & ~features) == 0;
+        }
+        
         /// \brief Creates a parser by copying the tables
         explicit parser(const parser_tables& tables) 
         : m_ParserTables(new parser_tables(tables))
-        , m_OwnsTables(true) { }
+        , m_OwnsTables(true) {
+            assert(supports_tables(*m_ParserTables));
+        }
         
         /// \brief Creates a parser with a reference to the tables it should use.
         ///
@@ -152,12 +233,15 @@ namespace lr {
         parser(const parser_tables* tables, bool destroyTables)
         : m_ParserTables(tables)
         , m_OwnsTables(destroyTables) {
+            assert(supports_tables(*m_ParserTables));
         }
 
         /// \brief Creates a parser from the result of the specified builder class
         parser(const lalr_builder& builder, const weak_symbols* weakSymbols) 
         : m_ParserTables(new parser_tables(builder, weakSymbols))
-        , m_OwnsTables(true) { }
+        , m_OwnsTables(true) {
+            assert(supports_tables(*m_ParserTables));
+        }
         
         /// \brief Copy constructor
         parser(const parser& copyFrom) {
@@ -165,7 +249,7 @@ namespace lr {
             // (For hard-coded parsers, the tables often aren't, so there's no need to copy)
             if (copyFrom.m_OwnsTables) {
                 m_OwnsTables    = true;
-                m_ParserTables  = new parser_tables(copyFrom.m_ParserTables);
+                m_ParserTables  = new parser_tables(*copyFrom.m_ParserTables);
             } else {
                 m_OwnsTables    = false;
                 m_ParserTables  = copyFrom.m_ParserTables;
@@ -196,13 +280,40 @@ namespace lr {
             /// \brief Session lookahead
             typedef std::vector<dfa::lexeme_container> lookahead_list;
             
+            /// \brief Results of checking guards, keyed by the absolute lookahead position and the initial state of the guard
+            typedef std::map<std::pair<int, int>, int> guard_results;
+            
+            /// \brief The initial size of the lookahead buffer (must be a power of 2)
+            enum { initial_lookahead_size = 16 };
+            
         private:
-            /// \brief The symbols that are in the parser lookahead
+            ///
+            /// \brief Ring buffer containing the symbols that are in the parser lookahead
+            ///
+            /// The size of this buffer is always a power of 2. The symbol at the absolute position pos (counting from the
+            /// start of the input) is stored at m_Lookahead[pos & (m_Lookahead.size()-1)]. Symbols that have been trimmed
+            /// from the lookahead stay in the buffer until their entry is re-used.
+            ///
             lookahead_list m_Lookahead;
             
+            /// \brief The absolute position of the first symbol in m_Lookahead (the number of symbols trimmed so far)
+            int m_LookaheadBase;
+            
+            /// \brief The absolute position after the last symbol that has been read into m_Lookahead
+            int m_LookaheadEnd;
+            
+            /// \brief The guards that have been checked against the symbols that are still in the lookahead
+            guard_results m_GuardResults;
+            
             /// \brief Set to true if we've reached the end of the file
             bool m_EndOfFile;
             
+            /// \brief Empty lexeme container returned by look() when it is past the end of the file
+            ///
+            /// This is kept in the session rather than in a static variable so that parsers running in different
+            /// threads never share a reference count.
+            dfa::lexeme_container m_EndOfFileLexeme;
+            
             /// \brief The first active state in the parser
             state* m_FirstState;
             
@@ -212,7 +323,11 @@ namespace lr {
         public:
             session(parser_actions* actions)
             : m_Actions(actions)
+            , m_Lookahead(initial_lookahead_size, dfa::lexeme_container((dfa::lexeme*) NULL, false))
+            , m_LookaheadBase(0)
+            , m_LookaheadEnd(0)
             , m_EndOfFile(false)
+            , m_EndOfFileLexeme((dfa::lexeme*) NULL, false)
             , m_FirstState(NULL) {
             }
             
@@ -239,12 +354,48 @@ namespace lr {
             /// \brief The parser stack in this state
             stack m_Stack;
             
+            /// \brief Buffer used to pass items to the reduce action (reused so that reductions don't allocate)
+            std::vector<item_type> m_ReduceItems;
+            
             /// \brief The session that this is a part of
             session* m_Session;
             
-            /// \brief The position in the lookahead of this state
+            /// \brief The absolute position in the lookahead of this state
             int m_LookaheadPos;
             
+            /// \brief The last generation number handed out by this state
+            ///
+            /// Every change to the parser stack, or to the stack of a guard being checked, is assigned a new
+            /// generation number. Two checks made with the same generation number are made against the same stack.
+            unsigned int m_Generation;
+            
+            /// \brief The generation number of m_Stack
+            unsigned int m_StackGeneration;
+            
+            /// \brief Entry in the cache of the results of can_reduce for weak reduce actions
+            struct can_reduce_entry {
+                /// \brief The generation of the stack that the result is for (0 if this entry is unused)
+                unsigned int generation;
+                
+                /// \brief The state on top of the stack
+                int state;
+                
+                /// \brief The symbol that was checked
+                int symbol;
+                
+                /// \brief The action that was checked
+                const action* act;
+                
+                /// \brief The result of the check
+                bool result;
+            };
+            
+            /// \brief The number of entries in the can_reduce cache (must be a power of 2)
+            enum { can_reduce_cache_size = 64 };
+            
+            /// \brief Cache of the results of can_reduce for weak reduce actions
+            can_reduce_entry m_CanReduceCache[can_reduce_cache_size];
+            
             /// \brief The next state in the state list
             state* m_NextState;
             
@@ -270,10 +421,26 @@ namespace lr {
             /// \brief Destructor
             ~state();
             
+            ///
+            /// \brief Resets this state so that it can parse a new input
+            ///
+            /// This must be the only state in its session. The existing actions are destroyed and replaced with the
+            /// new ones (which may be NULL if the state is to be left idle; it must be restarted again before it is
+            /// used). The stack and lookahead buffer keep their memory, so restarting a state is cheaper than creating
+            /// a new one when many inputs are parsed in turn.
+            ///
+            void restart(parser_actions* actions, int initialState = 0);
+            
         private:
             /// \brief Trims the lookahead in the sessions (removes any symbols that won't be visited again)
             inline void trim_lookahead();
             
+            /// \brief Returns a new generation number, for a parser stack that has just changed
+            inline unsigned int next_generation();
+            
+            /// \brief Discards everything in the can_reduce cache
+            inline void clear_can_reduce_cache();
+            
         public:
             ///
             /// \brief Moves on a single symbol (ie, throws away the current lookahead)
@@ -289,6 +456,29 @@ namespace lr {
             
         private:
             
+            /// \brief Finds goto actions using the parser tables
+            class table_goto {
+            private:
+                const parser_tables* m_Tables;
+                
+            public:
+                inline explicit table_goto(const parser_tables* tables) : m_Tables(tables) { }
+                
+                inline int operator()(int state, int nonterminalId) const { return m_Tables->find_goto(state, nonterminalId); }
+            };
+            
+            /// \brief Finds goto actions using the goto_state() function of a direct-coded automaton
+            template<class goto_table> class direct_goto {
+            public:
+                inline int operator()(int state, int nonterminalId) const { return goto_table::goto_state(state, nonterminalId); }
+            };
+            
+            /// \brief Pushes the specified state and the result of shifting a lookahead symbol on to the stack
+            inline void shift_to(const lexeme_container& lookahead, int nextState);
+            
+            /// \brief Reduces a rule, using the specified object to find the state to go to afterwards
+            template<class goto_finder> inline void reduce_to(int nonterminalId, int ruleId, int length, const goto_finder& findGoto);
+            
             friend class standard_actions;
             
             ///
@@ -296,8 +486,14 @@ namespace lr {
             ///
             class standard_actions {
             private:
-                /// \brief The trace for these actions
-                parser_trace m_Trace;
+                /// \brief The trace for these actions (owned by the state that is running them)
+                parser_trace& m_Trace;
+                
+            public:
+                /// \brief Creates the standard actions for the specified state
+                inline explicit standard_actions(state* state)
+                : m_Trace(state->m_Trace) {
+                }
                 
             public:
                 /// \brief Ignore action
@@ -308,61 +504,18 @@ namespace lr {
                 
                 /// \brief Shift action
                 inline void shift(state* state, const action* act, const lexeme_container& lookahead) {
-                    // Push the next state, and the result of the shift action in the actions class
-                    state->m_Stack.push(act->nextState, state->m_Session->m_Actions->shift(lookahead));
-                    
-                    // Tell the trace
-                    m_Trace.shift(lookahead, act->nextState);
+                    state->shift_to(lookahead, act->nextState);
                 }
                 
                 /// \brief Reduce action
                 inline void reduce(state* state, const action* act, const parser_tables::reduce_rule& rule) {
-                    // Tell the trace that this is happening
-                    m_Trace.reduce(rule.identifier, rule.ruleId, rule.length);
-                    
-                    // Pop items from the stack, and create an item for them by calling the actions
-                    reduce_list items;
-                    for (int x=0; x < rule.length; ++x) {
-                        items.push_back(state->m_Stack->item);
-                        state->m_Stack.pop();
-                    }
-                    
-                    // Fetch the state that's now on top of the stack
-                    int gotoState = state->m_Stack->state;
-                    
-                    // Work out the lookahead position
-                    const lexeme_container& la              = state->look();
-                    const dfa::position*    lookaheadPos    = NULL;
-                    
-                    if (state->look().item()) {
-                        // Still following symbols
-                        lookaheadPos = &la->pos();
-                    } else {
-                        // At end: use an invalid position
-                        // (Alternatively: modify the actions so it's possible to retrieve the current position)
-                        static const dfa::position eofPos(-1, -1, -1);
-                        lookaheadPos = &eofPos;
-                    }
-                    
-                    // Get the goto action for this nonterminal
-                    for (parser_tables::action_iterator gotoAct = state->m_Tables->find_nonterminal(gotoState, rule.identifier);
-                         gotoAct != state->m_Tables->last_nonterminal_action(gotoState); 
-                         ++gotoAct) {
-                        if (gotoAct->type == lr_action::act_goto) {
-                            // Found the goto action, perform the reduction
-                            // (Note that this will perform the goto action for the next nonterminal if the nonterminal isn't in this state. This can only happen if the parser is in an invalid state)
-                            state->m_Stack.push(gotoAct->nextState, state->m_Session->m_Actions->reduce(rule.identifier, rule.ruleId, items, *lookaheadPos));
-                            
-                            // Tell the trace about this
-                            m_Trace.goto_state(gotoAct->nextState);
-                            break;
-                        }
-                    }                    
+                    state->reduce_to(rule.identifier, rule.ruleId, rule.length, table_goto(state->m_Tables));
                 }
                 
                 /// \brief Sets the current state of the parser
                 inline void set_state(state* state, int newState) {
                     state->m_Stack->state = newState;
+                    state->m_StackGeneration = state->next_generation();
                     
                     m_Trace.goto_state(newState);
                 }
@@ -382,6 +535,8 @@ namespace lr {
                 
                 /// \brief Returns -1 or the guard symbol matched by the lookahead with the specified initial guard state
                 inline int check_guard(state* state, int initialState) {
+                    m_Trace.begin_guard(initialState);
+                    
                     int result = state->check_guard(initialState, 0);
                     
                     m_Trace.checked_guard(initialState, result);
@@ -401,14 +556,11 @@ namespace lr {
                         return true;
                     }
 
-                    // Fake reduce using the action
-                    std::stack<int> fakeStack;
-                    int             stackPos = 0;
-
-                    state->fake_reduce(act, stackPos, fakeStack, state->m_Stack);
-
-                    // Do a can_reduce on what remains
-                    return state->template can_reduce<terminal_fetcher>(terminal, stackPos, fakeStack, state->m_Stack);
+                    // Check using the real stack
+                    bool result = state->template can_reduce_action<terminal_fetcher>(terminal, act, fake_stack(), state->m_StackGeneration);
+                    m_Trace.checked_reduce(result);
+                    
+                    return result;
                 }
                 
                 /// \brief Returns true if the specified terminal symbol can be reduced
@@ -418,14 +570,11 @@ namespace lr {
                         return true;
                     }
 
-                    // Fake reduce using the action
-                    std::stack<int> fakeStack;
-                    int             stackPos = 0;
-
-                    state->fake_reduce(act, stackPos, fakeStack, state->m_Stack);
-
-                    // Do a can_reduce on what remains
-                    return state->template can_reduce<nonterminal_fetcher>(terminal, stackPos, fakeStack, state->m_Stack);
+                    // Check using the real stack
+                    bool result = state->template can_reduce_action<nonterminal_fetcher>(terminal, act, fake_stack(), state->m_StackGeneration);
+                    m_Trace.checked_reduce(result);
+                    
+                    return result;
                 }
             };
             
@@ -440,12 +589,16 @@ namespace lr {
                 int             m_Offset;
                 
                 /// \brief The current stack for the guard symbol
-                std::stack<int> m_Stack;
+                fake_stack      m_Stack;
+                
+                /// \brief The generation number of m_Stack
+                unsigned int    m_Generation;
                 
             public:
                 /// \brief Creates 
-                guard_actions(int initialState, int initialOffset)
-                : m_Offset(initialOffset) {
+                guard_actions(state* state, int initialState, int initialOffset)
+                : m_Offset(initialOffset)
+                , m_Generation(state->next_generation()) {
                     m_Stack.push(initialState);
                 }
                 
@@ -469,6 +622,7 @@ namespace lr {
                 inline void shift(state* state, const action* act, const lexeme_container& lookahead) {
                     // Push the next state, and the result of the shift action in the actions class
                     m_Stack.push(act->nextState);
+                    m_Generation = state->next_generation();
                 }
                 
                 /// \brief Reduce action
@@ -480,23 +634,19 @@ namespace lr {
                     
                     // Fetch the state that's now on top of the stack
                     int gotoState = m_Stack.top();
+                    m_Generation = state->next_generation();
                     
                     // Get the goto action for this nonterminal
-                    for (parser_tables::action_iterator gotoAct = state->m_Tables->find_nonterminal(gotoState, rule.identifier);
-                         gotoAct != state->m_Tables->last_nonterminal_action(gotoState); 
-                         ++gotoAct) {
-                        if (gotoAct->type == lr_action::act_goto) {
-                            // Found the goto action, perform the reduction
-                            // (Note that this will perform the goto action for the next nonterminal if the nonterminal isn't in this state. This can only happen if the parser is in an invalid state)
-                            m_Stack.push(gotoAct->nextState);
-                            break;
-                        }
-                    }                    
+                    int nextState = state->m_Tables->find_goto(gotoState, rule.identifier);
+                    if (nextState >= 0) {
+                        m_Stack.push(nextState);
+                    }
                 }
                 
                 /// \brief Sets the current state of the parser
                 inline void set_state(state* state, int newState) {
                     m_Stack.top() = newState;
+                    m_Generation = state->next_generation();
                 }
                 
                 /// \brief Returns -1 or the guard symbol matched by the lookahead with the specified initial guard state
@@ -515,14 +665,8 @@ namespace lr {
                         return true;
                     }
 
-                    // Fake reduce using the action
-                    std::stack<int> fakeStack   = m_Stack;
-                    int             stackPos    = 0;
-
-                    state->fake_reduce(act, stackPos, fakeStack, state->m_Stack);
-
-                    // Do a can_reduce on the result
-                    return state->template can_reduce<terminal_fetcher>(terminal, stackPos, fakeStack, state->m_Stack);
+                    // Check using the guard stack
+                    return state->template can_reduce_action<terminal_fetcher>(terminal, act, m_Stack, m_Generation);
                 }
                 
                 /// \brief Returns true if the specified terminal symbol can be reduced
@@ -532,14 +676,8 @@ namespace lr {
                         return true;
                     }
 
-                    // Fake reduce using the action
-                    std::stack<int> fakeStack   = m_Stack;
-                    int             stackPos    = 0;
-
-                    state->fake_reduce(act, stackPos, fakeStack, state->m_Stack);
-
-                    // Do a can_reduce on the result
-                    return state->template can_reduce<nonterminal_fetcher>(nonterminal, stackPos, fakeStack, state->m_Stack);
+                    // Check using the guard stack
+                    return state->template can_reduce_action<nonterminal_fetcher>(nonterminal, act, m_Stack, m_Generation);
                 }
             };
 
@@ -562,8 +700,17 @@ namespace lr {
             /// can produce an accepting state, then this will return the ID of the guard symbol that was accepted.
             /// If no accepting state is reached, this will return a negative value (generally -1)
             ///
+            /// The result of a guard only depends on the lookahead, so results are remembered by the session until
+            /// the symbols they were checked against are trimmed from the lookahead.
+            ///
             int check_guard(int initialState, int initialOffset);
             
+            /// \brief Runs the guard parser for check_guard
+            int match_guard(int initialState, int initialOffset);
+            
+            /// \brief Matches a regular guard for check_guard by stepping its automaton over the lookahead
+            int match_regular_guard(int guardState, int initialState, int initialOffset);
+            
         public:
             ///
             /// \brief Performs the specified action
@@ -573,7 +720,7 @@ namespace lr {
             ///
             inline bool perform(const lexeme_container& lookahead, const action* act) {
                 // Call perform_generic with the standard actions
-                standard_actions standard;
+                standard_actions standard(this);
                 return perform_generic(lookahead, act, standard);
             }
             
@@ -625,10 +772,19 @@ namespace lr {
             };
             
             /// \brief Fakes up a reduce action during can_reduce testing. act must be a reduce action
-            inline void fake_reduce(parser_tables::action_iterator act, int& stackPos, std::stack<int>& pushed, const stack& underlyingStack);
+            inline void fake_reduce(parser_tables::action_iterator act, int& stackPos, fake_stack& pushed, const stack& underlyingStack);
             
             /// \brief Returns true if a reduction of the specified lexeme will result in it being shifted
-            template<class symbol_fetcher> bool can_reduce(int symbol, int stackPos, std::stack<int> pushed, const stack& underlyingStack);
+            template<class symbol_fetcher> bool can_reduce(int symbol, int stackPos, fake_stack pushed, const stack& underlyingStack);
+            
+            ///
+            /// \brief Returns true if performing the specified reduce action will result in the symbol being shifted
+            ///
+            /// The pushed stack is laid on top of the real parser stack, and generation should be the generation number
+            /// of the two stacks combined. Results are cached, so repeated checks of the same action against the same
+            /// stack are answered without re-running the reduction.
+            ///
+            template<class symbol_fetcher> inline bool can_reduce_action(int symbol, parser_tables::action_iterator act, const fake_stack& pushed, unsigned int generation);
             
         public:
             /// \brief Returns true if a reduction of the specified lexeme will result in it being shifted
@@ -637,7 +793,7 @@ namespace lr {
             /// be resolved by a LR(1) parser, this will disambiguate the grammar (making it possible to choose
             /// only the action that allows the parser to continue)
             inline bool can_reduce(const lexeme_container& lexeme) {
-                return can_reduce<terminal_fetcher>(lexeme->matched(), 0, std::stack<int>());
+                return can_reduce<terminal_fetcher>(lexeme->matched(), 0, fake_stack(), m_Stack);
             }
 
             /// \brief Returns true if a reduction of the specified terminal symbol will result in it being shifted
@@ -646,7 +802,7 @@ namespace lr {
             /// be resolved by a LR(1) parser, this will disambiguate the grammar (making it possible to choose
             /// only the action that allows the parser to continue)
             inline bool can_reduce(int terminalId) {
-                return can_reduce<terminal_fetcher>(terminalId, 0, std::stack<int>(), m_Stack);
+                return can_reduce<terminal_fetcher>(terminalId, 0, fake_stack(), m_Stack);
             }
 
             /// \brief Returns true if a reduction of the lookahead will result in it being shifted
@@ -657,7 +813,7 @@ namespace lr {
         private:
             /// \brief As for can_reduce, but with a fake nonterminal lookahead value
             inline bool can_reduce_nonterminal(int nt) {
-                return can_reduce<nonterminal_fetcher>(nt, 0, std::stack<int>(), m_Stack);
+                return can_reduce<nonterminal_fetcher>(nt, 0, fake_stack(), m_Stack);
             }
             
         public:
@@ -690,7 +846,7 @@ namespace lr {
         public:
             /// \brief Performs a single parsing action, and returns the result
             inline result process() {
-                standard_actions actions;
+                standard_actions actions(this);
                 return process_generic(actions);
             }
             
@@ -709,6 +865,50 @@ namespace lr {
                 }
             }
             
+        public:
+            // Direct-coded parsers
+            //
+            // The parser generator can write out the automaton for a language as code instead of as tables. The generated
+            // code works out which action to perform for itself and uses these functions to perform it. It calls process()
+            // to let the table interpreter deal with anything it does not handle (such as guards and weak reductions).
+            
+            /// \brief The state of the automaton that is on top of the parser stack
+            inline int current_state() const {
+                return m_Stack->state;
+            }
+            
+            /// \brief Discards the current lookahead symbol
+            inline void ignore_direct(const lexeme_container& lookahead) {
+                m_Trace.ignore(lookahead);
+                next();
+            }
+            
+            /// \brief Shifts the current lookahead symbol and moves to the specified state
+            inline void shift_direct(const lexeme_container& lookahead, int nextState) {
+                shift_to(lookahead, nextState);
+                next();
+            }
+            
+            /// \brief Reduces the specified rule. The goto_table class supplies the next state with a static goto_state(state, nonterminalId) function
+            template<class goto_table> inline void reduce_direct(int nonterminalId, int ruleId, int length) {
+                reduce_to(nonterminalId, ruleId, length, direct_goto<goto_table>());
+            }
+            
+            ///
+            /// \brief Parses the input with a direct-coded automaton, and returns true if it was accepted
+            ///
+            /// The direct_code class must have a static step(state&) function which performs one or more parser actions
+            /// and returns a parser_result, in the same way as process().
+            ///
+            template<class direct_code> inline bool parse_direct() {
+                for (;;) {
+                    result next = direct_code::step(*this);
+                    
+                    if (next == parser_result::more) continue;
+                    return next == parser_result::accept;
+                }
+            }
+            
             /// \brief Returns the parser stack associated with this state
             inline const stack& get_stack() const {
                 return m_Stack;
@@ -718,6 +918,23 @@ namespace lr {
             inline const item_type& get_item() const {
                 return m_Stack->item;
             }
+            
+            /// \brief The number of guard results that the session is remembering
+            ///
+            /// Results are forgotten once the lookahead they were checked against has been trimmed.
+            inline size_t count_guard_results() const {
+                return m_Session->m_GuardResults.size();
+            }
+            
+            /// \brief Returns the trace object that is recording the actions performed by this state
+            inline parser_trace& get_trace() {
+                return m_Trace;
+            }
+            
+            /// \brief Returns the trace object that is recording the actions performed by this state
+            inline const parser_trace& get_trace() const {
+                return m_Trace;
+            }
         };
         
     public:
@@ -728,7 +945,7 @@ namespace lr {
         }
         
         /// \brief Retrieves the tables for this parser
-        inline const parser_tables& get_tables() const { return m_ParserTables; }
+        inline const parser_tables& get_tables() const { return *m_ParserTables; }
     };
     
     ///
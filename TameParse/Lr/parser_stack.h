@@ -31,7 +31,6 @@
 #include <cstdlib>
 
 #include <vector>
-#include <stack>
 
 namespace lr {
     ///
@@ -46,14 +45,19 @@ namespace lr {
     /// representing what was matched by the parser, and is what makes parsers useful in compiler design.
     ///
     /// Both these designs have a disadvantage: there is no way to rewind the parser to a previous state. This
-    /// stack implementation works around this by using garbage collection: stack items are not removed until
-    /// the stack is full, and a simple mark-and-sweep algorithm is used to remove existing elements.
+    /// stack implementation works around this by being persistent: each entry points at the entry below it,
+    /// so copying a reference to the stack is enough to preserve its entire contents. Stacks that are copied
+    /// in this way share any entries they have in common.
     ///
     /// This allows for parsers that can backtrack to a previous state without the need to replicate the entire
-    /// stack. A mark-and-sweep approach to freeing stack space has much less overhead than a reference counting
-    /// approach (in a garbage collected language, a linked list is all that's required). This also makes it
-    /// possible to implement GLR parsers that evaluate all possible states in parallel, and to perform error
-    /// recovery by running the parser in a speculative manner.
+    /// stack. It also makes it possible to implement GLR parsers that evaluate all possible states in parallel,
+    /// and to perform error recovery by running the parser in a speculative manner.
+    ///
+    /// Entries are reference counted and allocated from chunks owned by the stack, which are recycled through a
+    /// free list. Pushing and popping are both constant time operations, and an entry is returned to the free
+    /// list as soon as the last reference to it goes away, so there is never a need to stop and search for
+    /// unused entries. (When a reference that is the only owner of a large part of the stack is destroyed, the
+    /// entries are freed at that point: this costs no more than the pushes that created them)
     ///
     /// Our default parser implementation is deterministic (neither GLR nor backtracking), so these advantages
     /// are perhaps not immediately obvious: however, for complex languages or cases where good error recovery
@@ -83,15 +87,17 @@ namespace lr {
             friend class parser_stack<item_type, initial_depth>;
             friend class parser_stack<item_type, initial_depth>::internal_stack;
             
-            /// \brief -1 for a 'head' element, -2 for an empty element, or the entry 'below' this one
-            int m_PreviousIndex;
+            /// \brief The entry 'below' this one, NULL for a 'head' element or the next free entry for an unused element
+            entry* m_Previous;
             
-        public:
-            static const int head = -1;
-            static const int empty = -2;
+            /// \brief The number of references and entries that point at this entry (0 for an unused entry)
+            int m_RefCount;
             
+        public:
             inline entry()
-            : m_PreviousIndex(empty) {
+            : m_Previous(NULL)
+            , m_RefCount(0)
+            , state(-1) {
             }
             
             /// \brief The item associated with this entry
@@ -105,17 +111,17 @@ namespace lr {
         class internal_stack {
             friend class parser_stack<item_type, initial_depth>;
             
-            /// \brief The first stack reference known about by this stack
-            parser_stack<item_type, initial_depth>* m_RootReference;
+            /// \brief The number of references to this stack
+            int m_NumReferences;
             
-            /// \brief A vector of entries in this stack
-            std::vector<entry> m_Stack;
+            /// \brief The chunks of entries allocated by this stack
+            std::vector<entry*> m_Chunks;
             
-            /// \brief The first unused stack entry
-            int m_FirstUnused;
+            /// \brief The number of entries to allocate in the next chunk
+            int m_NextChunkSize;
             
-            /// \brief The number of free entries in the stack
-            int m_NumFree;
+            /// \brief The first unused entry (entries in the free list are linked via m_Previous)
+            entry* m_FirstUnused;
             
             internal_stack(const internal_stack& copyFrom);
             
@@ -125,104 +131,69 @@ namespace lr {
         public:
             /// \brief Creates a new stack
             internal_stack()
-            : m_RootReference(NULL) {
-                m_Stack.resize(initial_depth);
-                m_FirstUnused = 0;
-                m_NumFree = (int)m_Stack.size();
+            : m_NumReferences(0)
+            , m_NextChunkSize(initial_depth)
+            , m_FirstUnused(NULL) {
             }
 
-            /// \brief Destroys the stack (and any remaining references)
+            /// \brief Destroys the stack (once there are no remaining references)
             ~internal_stack() {
-                // Delete any remaining references
-                while (m_RootReference != NULL) {
-                    delete m_RootReference;
-                }
-            }
-            
-            /// \brief Garbage collects this stack
-            void collect() {
-                // Create a vector of marked elements
-                std::vector<bool> marks;
-                marks.resize(m_Stack.size(), false);
-                
-                // Mark any entries used by an active reference
-                std::stack<int> waiting;
-                
-                pstack* ref = m_RootReference;
-                while (ref != NULL) {
-                    waiting.push(ref->m_Index);
-                    ref = ref->m_Next;
-                }
-                
-                // Mark any items that are in use
-                while (!waiting.empty()) {
-                    // Get the next item to process
-                    int next = waiting.top();
-                    waiting.pop();
-                    
-                    // Mark this item as being in-use
-                    marks[next] = true;
-                    
-                    // Push the preceeding entry if there is one
-                    entry& waitingEntry = m_Stack[next];
-                    if (waitingEntry.m_PreviousIndex >= 0) {
-                        if (!marks[waitingEntry.m_PreviousIndex]) {
-                            waiting.push(waitingEntry.m_PreviousIndex);
-                        }
-                    }
-                }
-                
-                // Sweep any unused items in the stack
-                m_NumFree = 0;
-                for (size_t x=0; x<m_Stack.size(); ++x) {
-                    if (!marks[x]) {
-                        m_Stack[x].m_PreviousIndex = entry::empty;
-                        ++m_NumFree;
-                    }
+                for (typename std::vector<entry*>::iterator chunk = m_Chunks.begin(); chunk != m_Chunks.end(); ++chunk) {
+                    delete[] *chunk;
                 }
             }
             
         private:
+            /// \brief Allocates a new chunk of entries and adds them to the free list
             void grow_stack() {
-                // Work out how many new items to create
-                int numNew = (int)m_Stack.size();
-                if (numNew > initial_depth * 8) numNew = initial_depth * 8;
+                // Allocate the new chunk
+                int     numNew  = m_NextChunkSize;
+                entry*  chunk   = new entry[numNew];
+                m_Chunks.push_back(chunk);
                 
-                // Resize the stack by this amount
-                m_Stack.resize(m_Stack.size() + numNew);
-                m_NumFree += numNew;
+                // Add the entries to the free list
+                for (int x = numNew-1; x >= 0; --x) {
+                    chunk[x].m_Previous = m_FirstUnused;
+                    m_FirstUnused       = chunk + x;
+                }
+                
+                // Chunks grow with the stack, up to a limit
+                m_NextChunkSize *= 2;
+                if (m_NextChunkSize > initial_depth * 8) m_NextChunkSize = initial_depth * 8;
             }
             
         public:
-            /// \brief Finds the next unused item
-            int get_new() {
-                // Collect if we've run out of free items, and grow the stack if it's still looking empty
-                if (m_NumFree <= 0) {
-                    collect();
-                    if (m_NumFree < initial_depth/2) {
-                        grow_stack();
-                    }
-                }
-                
-                // Find a free entry
-                while (m_Stack[m_FirstUnused].m_PreviousIndex != entry::empty) {
-                    ++m_FirstUnused;
-                    if (m_FirstUnused >= (int) m_Stack.size()) m_FirstUnused = 0;
+            /// \brief Finds the next unused entry, which is returned as a 'head' entry with a single reference
+            inline entry* get_new() {
+                if (m_FirstUnused == NULL) {
+                    grow_stack();
                 }
                 
-                // m_FirstUnused now points to an entry we can use
-                int result = m_FirstUnused;
-                ++m_FirstUnused;
-                if (m_FirstUnused >= (int) m_Stack.size()) m_FirstUnused = 0;
-                
-                // Make this a 'head' entry
-                m_Stack[result].m_PreviousIndex = entry::head;
+                entry* result   = m_FirstUnused;
+                m_FirstUnused   = result->m_Previous;
                 
-                // Number of free entries goes down
-                m_NumFree--;
+                result->m_Previous  = NULL;
+                result->m_RefCount  = 1;
                 
                 return result;
             }
+            
+            /// \brief Returns an unreferenced entry to the free list
+            inline void free_entry(entry* unused) {
+                unused->item        = item_type();
+                unused->m_RefCount  = 0;
+                unused->m_Previous  = m_FirstUnused;
+                m_FirstUnused       = unused;
+            }
+            
+            /// \brief Removes a reference to the specified entry, freeing it and any entries below it that become unused
+            inline void release(entry* oldEntry) {
+                while (oldEntry != NULL && --oldEntry->m_RefCount == 0) {
+                    entry* previous = oldEntry->m_Previous;
+                    free_entry(oldEntry);
+                    oldEntry = previous;
+                }
+            }
         };
         
     private:
@@ -230,129 +201,133 @@ namespace lr {
         /// \brief The stack that owns this reference
         internal_stack* m_Stack;
         
-        /// \brief The index of this reference
-        int m_Index;
-        
-        /// \brief The previous reference in the list of references
-        pstack* m_Last;
-        
-        /// \brief The next reference in the list of references
-        pstack* m_Next;
-        
-    private:
-        parser_stack(pstack* stack, int index)
-        : m_Index(index)
-        , m_Stack(stack) {
-            m_Next = m_Stack->m_RootReference;
-            m_Last = NULL;
-            m_Stack->m_RootReference = this;
-        }
+        /// \brief The entry that this reference points at
+        entry* m_Entry;
         
     public:
         parser_stack() 
-        : m_Stack(new internal_stack())
-        , m_Index(m_Stack->get_new()) {
-            m_Next = m_Stack->m_RootReference;
-            m_Last = NULL;
-            m_Stack->m_RootReference = this;
+        : m_Stack(new internal_stack()) {
+            ++m_Stack->m_NumReferences;
+            m_Entry = m_Stack->get_new();
         }
         
         /// \brief Creates a copy of a particular reference
         inline parser_stack(const parser_stack& copyFrom)
         : m_Stack(copyFrom.m_Stack)
-        , m_Index(copyFrom.m_Index) {
-            m_Next = m_Stack->m_RootReference;
-            m_Last = NULL;
-            m_Stack->m_RootReference = this;
+        , m_Entry(copyFrom.m_Entry) {
+            ++m_Stack->m_NumReferences;
+            ++m_Entry->m_RefCount;
         }
         
         /// \brief Assignment operator
         inline parser_stack& operator=(const parser_stack& copyFrom) {
-            // This will only work for references from the same stack
-            m_Index = copyFrom.m_Index;
+            // Take the new reference first, in case this is a self-assignment
+            internal_stack* newStack = copyFrom.m_Stack;
+            entry*          newEntry = copyFrom.m_Entry;
+            
+            ++newStack->m_NumReferences;
+            ++newEntry->m_RefCount;
+            
+            // Release the old reference
+            release();
+            
+            m_Stack = newStack;
+            m_Entry = newEntry;
             
             return *this;
         }
         
         /// \brief Destructor
         inline ~parser_stack() {
-            // Remove this reference from the list of references
-            if (m_Next) {
-                m_Next->m_Last = m_Last;
-            }
-            if (m_Last) {
-                m_Last->m_Next = m_Next;
-            } else {
-                m_Stack->m_RootReference = m_Next;
-            }
+            release();
+        }
+        
+    private:
+        /// \brief Releases the entry and stack referenced by this object
+        inline void release() {
+            m_Stack->release(m_Entry);
             
-            if (m_Stack->m_RootReference == NULL) {
+            if (--m_Stack->m_NumReferences == 0) {
                 delete m_Stack;
             }
         }
         
+    public:
         inline entry& operator*() {
-            return m_Stack->m_Stack[m_Index];
+            return *m_Entry;
         }
         
         inline entry* operator->() {
-            return &m_Stack->m_Stack[m_Index];
+            return m_Entry;
         }
 
         inline const entry& operator*() const {
-            return m_Stack->m_Stack[m_Index];
+            return *m_Entry;
         }
         
         inline const entry* operator->() const {
-            return &m_Stack->m_Stack[m_Index];
+            return m_Entry;
         }
         
         /// \brief Returns the entry at the specified offset from this entry. 'x' should be a negative value
         ///
         /// IE, reference[-1] gives the entry preceeding this one on the stack
         inline entry& operator[](int x) {
-            int index = m_Index;
+            entry* result = m_Entry;
             for (int pos = x; pos < 0; ++pos) {
-                int nextIndex = m_Stack->m_Stack[index].m_PreviousIndex;
-                if (nextIndex >= 0) index = nextIndex;
+                if (result->m_Previous != NULL) result = result->m_Previous;
             }
-            return m_Stack->m_Stack[index];
+            return *result;
         }
         
         /// \brief Returns the entry at the specified offset from this entry. 'x' should be a negative value
         ///
         /// IE, reference[-1] gives the entry preceeding this one on the stack
         inline const entry& operator[](int x) const {
-            int index = m_Index;
+            const entry* result = m_Entry;
             for (int pos = x; pos < 0; ++pos) {
-                int nextIndex = m_Stack->m_Stack[index].m_PreviousIndex;
-                if (nextIndex >= 0) index = nextIndex;
+                if (result->m_Previous != NULL) result = result->m_Previous;
             }
-            return m_Stack->m_Stack[index];
+            return *result;
         }
 
         /// \brief Pushes a new item onto the stack, and updates this to point at it
         inline void push(int state, const item_type& newItem) {
-            int newIndex = m_Stack->get_new();
+            entry* newEntry = m_Stack->get_new();
             
-            entry& newEntry = m_Stack->m_Stack[newIndex];
+            newEntry->state         = state;
+            newEntry->item          = newItem;
+            newEntry->m_Previous    = m_Entry;          // The new entry takes over our reference to the old one
             
-            newEntry.state              = state;
-            newEntry.item               = newItem;
-            newEntry.m_PreviousIndex    = m_Index;
-            
-            m_Index = newIndex;
+            m_Entry = newEntry;
         }
         
         /// \brief Pops an item from the stack (returns false if this is currently pointing at a head item)
         ///
         /// This reference is adjusted to point at the new head of the stack
         inline bool pop() {
-            entry& ourEntry = operator*();
-            if (ourEntry.m_PreviousIndex == -1) return false;
-            m_Index = ourEntry.m_PreviousIndex;
+            entry* previous = m_Entry->m_Previous;
+            if (previous == NULL) return false;
+            
+            if (m_Entry->m_RefCount == 1) {
+                // Nothing else is using this entry: free it, and take over its reference to the previous entry
+                m_Stack->free_entry(m_Entry);
+            } else {
+                // The entry is shared with another stack
+                --m_Entry->m_RefCount;
+                ++previous->m_RefCount;
+            }
+            
+            m_Entry = previous;
             return true;
         }
+        
+        /// \brief The number of chunks of entries that have been allocated for this stack (and any stacks forked from it)
+        ///
+        /// This only grows when there are no free entries left to re-use.
+        inline size_t count_chunks() const {
+            return m_Stack->m_Chunks.size();
+        }
     };
 }
 
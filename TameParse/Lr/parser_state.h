@@ -34,12 +34,17 @@ namespace lr {
     ///
     /// \brief Constructs a new state, used by the parser
     ///
-    template<typename I, typename A, typename T> parser<I, A, T>::state::state(const parser_tables* tables, int initialState, session* session) 
+    template<typename I, typename A, typename T, int F> parser<I, A, T, F>::state::state(const parser_tables* tables, int initialState, session* session) 
     : m_Tables(tables)
     , m_Session(session)
-    , m_LookaheadPos(0) {
+    , m_LookaheadPos(0)
+    , m_Generation(1)
+    , m_StackGeneration(1) {
         // Push the initial state
         m_Stack->state          = initialState;
+        
+        // Nothing is cached yet
+        clear_can_reduce_cache();
         m_NextState             = m_Session->m_FirstState;
         m_LastState             = NULL;
         m_Session->m_FirstState = this;
@@ -50,11 +55,16 @@ namespace lr {
     ///
     /// \brief Creates a new parser state by copying an old one. Parser states can be run independently.
     ///
-    template<typename I, typename A, typename T> parser<I, A, T>::state::state(const state& copyFrom)
+    template<typename I, typename A, typename T, int F> parser<I, A, T, F>::state::state(const state& copyFrom)
     : m_Tables(copyFrom.m_Tables)
     , m_Session(copyFrom.m_Session)
     , m_Stack(copyFrom.m_Stack)
-    , m_LookaheadPos(copyFrom.m_LookaheadPos) {
+    , m_LookaheadPos(copyFrom.m_LookaheadPos)
+    , m_Generation(copyFrom.m_Generation)
+    , m_StackGeneration(copyFrom.m_StackGeneration) {
+        // Stacks in this state will diverge from the original, so don't share its cache
+        clear_can_reduce_cache();
+        
         m_NextState             = m_Session->m_FirstState;
         m_LastState             = NULL;
         m_Session->m_FirstState = this;
@@ -65,7 +75,7 @@ namespace lr {
     ///
     /// \brief Destructor
     ///
-    template<typename I, typename A, typename T> parser<I, A, T>::state::~state() {
+    template<typename I, typename A, typename T, int F> parser<I, A, T, F>::state::~state() {
         // Remove this state from the session
         if (m_LastState) {
             m_LastState->m_NextState = m_NextState;
@@ -82,10 +92,42 @@ namespace lr {
         }
     }
 
+    ///
+    /// \brief Resets this state so that it can parse a new input
+    ///
+    template<typename I, typename A, typename T, int F> void parser<I, A, T, F>::state::restart(A* actions, int initialState) {
+        // Replace the actions
+        if (m_Session->m_Actions != actions) {
+            delete m_Session->m_Actions;
+            m_Session->m_Actions = actions;
+        }
+        
+        // Clear out the lookahead (including any trimmed symbols that are still in the buffer), keeping the buffer
+        typename session::lookahead_list& lookahead = m_Session->m_Lookahead;
+        for (typename session::lookahead_list::iterator symbol = lookahead.begin(); symbol != lookahead.end(); ++symbol) {
+            *symbol = m_Session->m_EndOfFileLexeme;
+        }
+        
+        m_Session->m_LookaheadBase  = 0;
+        m_Session->m_LookaheadEnd   = 0;
+        m_Session->m_EndOfFile      = false;
+        m_Session->m_GuardResults.clear();
+        m_LookaheadPos              = 0;
+        
+        // Return the stack to its initial state (the popped entries go back to the stack's free list)
+        while (m_Stack.pop()) { }
+        
+        m_Stack->state  = initialState;
+        m_Stack->item   = I();
+        
+        // Nothing in the cache applies any more
+        clear_can_reduce_cache();
+    }
+
     ///
     /// \brief Trims the lookahead in the sessions (removes any symbols that won't be visited again)
     ///
-    template<typename I, typename A, typename T> inline void parser<I, A, T>::state::trim_lookahead() {
+    template<typename I, typename A, typename T, int F> inline void parser<I, A, T, F>::state::trim_lookahead() {
         // Find the minimum lookahead position in all of the states
         int minPos = m_LookaheadPos;
         for (state* whichState = m_Session->m_FirstState; whichState != NULL; whichState = whichState->m_NextState) {
@@ -93,14 +135,39 @@ namespace lr {
                 }
         
         // Give up if there's no work to do
-        if (minPos == 0) return;
+        if (minPos <= m_Session->m_LookaheadBase) return;
         
-        // Remove the symbols from the session
-        m_Session->m_Lookahead.erase(m_Session->m_Lookahead.begin(), m_Session->m_Lookahead.begin() + minPos);
+        // Remove the symbols from the session (positions are absolute, so the states don't need updating)
+        m_Session->m_LookaheadBase = minPos;
         
-        // Update the state lookahead positions
-        for (state* whichState = m_Session->m_FirstState; whichState != NULL; whichState = whichState->m_NextState) {
-            whichState->m_LookaheadPos -= minPos;
+        // Forget about any guards that were checked against these symbols
+        if (!m_Session->m_GuardResults.empty()) {
+            typename session::guard_results& guardResults = m_Session->m_GuardResults;
+            guardResults.erase(guardResults.begin(), guardResults.lower_bound(std::pair<int, int>(minPos, -1)));
+        }
+    }
+
+    ///
+    /// \brief Returns a new generation number, for a parser stack that has just changed
+    ///
+    template<typename I, typename A, typename T, int F> inline unsigned int parser<I, A, T, F>::state::next_generation() {
+        ++m_Generation;
+        
+        // Generation 0 marks an unused cache entry, and old entries could be matched again once the counter wraps
+        if (m_Generation == 0) {
+            clear_can_reduce_cache();
+            m_Generation = 1;
+        }
+        
+        return m_Generation;
+    }
+    
+    ///
+    /// \brief Discards everything in the can_reduce cache
+    ///
+    template<typename I, typename A, typename T, int F> inline void parser<I, A, T, F>::state::clear_can_reduce_cache() {
+        for (int entry = 0; entry < can_reduce_cache_size; ++entry) {
+            m_CanReduceCache[entry].generation = 0;
         }
     }
 
@@ -109,7 +176,7 @@ namespace lr {
     ///
     /// It is an error to call this without calling lookahead() at least once since the last call.
     ///
-    template<typename I, typename A, typename T> inline void parser<I, A, T>::state::next() {
+    template<typename I, typename A, typename T, int F> inline void parser<I, A, T, F>::state::next() {
         ++m_LookaheadPos;
         trim_lookahead();
     }
@@ -117,14 +184,14 @@ namespace lr {
     ///
     /// \brief Retrieves the current lookahead character
     ///
-    template<typename I, typename A, typename T> inline const typename parser<I, A, T>::lexeme_container& parser<I, A, T>::state::look(int offset) {
-        // Static lexeme container representing the end of the file
-        static lexeme_container endOfFile((lexeme*)NULL);
-        
+    template<typename I, typename A, typename T, int F> inline const typename parser<I, A, T, F>::lexeme_container& parser<I, A, T, F>::state::look(int offset) {
         // Read a new symbol if necessary
-        size_t pos = m_LookaheadPos + offset;
+        int                         pos         = m_LookaheadPos + offset;
+        typename session::lookahead_list&  lookahead   = m_Session->m_Lookahead;
+        
+        m_Trace.looked_ahead(offset);
         
-        while (pos >= m_Session->m_Lookahead.size()) {
+        while (pos >= m_Session->m_LookaheadEnd) {
             if (!m_Session->m_EndOfFile) {
                 // Read the next symbol using the parser actions
                 dfa::lexeme_container nextLexeme(m_Session->m_Actions->read(), true);
@@ -132,21 +199,100 @@ namespace lr {
                 // Flag up an end of file condition
                 if (nextLexeme.item() == NULL) {
                     m_Session->m_EndOfFile = true;
-                    return endOfFile;
+                    return m_Session->m_EndOfFileLexeme;
+                }
+                
+                // Make space for the symbol if the ring buffer is full
+                int size = (int) lookahead.size();
+                
+                if (m_Session->m_LookaheadEnd - m_Session->m_LookaheadBase >= size) {
+                    typename session::lookahead_list larger(size * 2, m_Session->m_EndOfFileLexeme);
+                    
+                    for (int oldPos = m_Session->m_LookaheadBase; oldPos < m_Session->m_LookaheadEnd; ++oldPos) {
+                        larger[oldPos & (size*2 - 1)] = lookahead[oldPos & (size - 1)];
+                    }
+                    
+                    lookahead.swap(larger);
                 }
                 
                 // Store in the lookahead
-                m_Session->m_Lookahead.push_back(nextLexeme);
+                lookahead[m_Session->m_LookaheadEnd & (lookahead.size() - 1)] = nextLexeme;
+                ++m_Session->m_LookaheadEnd;
+                
+                m_Trace.read_lookahead(m_Session->m_LookaheadEnd - m_Session->m_LookaheadBase);
             } else {
                 // EOF
-                return endOfFile;
+                return m_Session->m_EndOfFileLexeme;
             }
         }
         
         // Return the current symbol
-        return m_Session->m_Lookahead[pos];
+        return lookahead[pos & (lookahead.size() - 1)];
     }
 
+    /// \brief Pushes the specified state and the result of shifting a lookahead symbol on to the stack
+    template<typename I, typename A, typename T, int F> inline void parser<I, A, T, F>::state::shift_to(const lexeme_container& lookahead, int nextState) {
+        // Push the next state, and the result of the shift action in the actions class
+        m_Stack.push(nextState, m_Session->m_Actions->shift(lookahead));
+        m_StackGeneration = next_generation();
+        
+        // Tell the trace
+        m_Trace.shift(lookahead, nextState);
+    }
+    
+    /// \brief Reduces a rule, using the specified object to find the state to go to afterwards
+    template<typename I, typename A, typename T, int F> template<class goto_finder> inline void parser<I, A, T, F>::state::reduce_to(int nonterminalId, int ruleId, int length, const goto_finder& findGoto) {
+        // Tell the trace that this is happening
+        m_Trace.reduce(nonterminalId, ruleId, length);
+        
+        // Pop items from the stack into the reduce buffer, in rule order
+        std::vector<I>& buffer = m_ReduceItems;
+        if (buffer.size() < (size_t) length) {
+            buffer.resize(length);
+        }
+        
+        for (int x = length-1; x >= 0; --x) {
+            buffer[x] = m_Stack->item;
+            m_Stack.pop();
+        }
+        
+        reduce_list items(length > 0 ? &buffer[0] : NULL, length);
+        
+        // Fetch the state that's now on top of the stack
+        int gotoState = m_Stack->state;
+        m_StackGeneration = next_generation();
+        
+        // Work out the lookahead position
+        const lexeme_container& la              = look();
+        const dfa::position*    lookaheadPos    = NULL;
+        const dfa::position     eofPos(-1, -1, -1);
+        
+        if (la.item()) {
+            // Still following symbols
+            lookaheadPos = &la->pos();
+        } else {
+            // At end: use an invalid position
+            // (Alternatively: modify the actions so it's possible to retrieve the current position)
+            lookaheadPos = &eofPos;
+        }
+        
+        // Get the goto action for this nonterminal
+        int nextState = findGoto(gotoState, nonterminalId);
+        if (nextState >= 0) {
+            // Found the goto action, perform the reduction
+            // (There is always a goto action unless the parser is in an invalid state)
+            m_Stack.push(nextState, m_Session->m_Actions->reduce(nonterminalId, ruleId, items, *lookaheadPos));
+            
+            // Tell the trace about this
+            m_Trace.goto_state(nextState);
+        }
+        
+        // Release the items in the buffer
+        for (int x = 0; x < length; ++x) {
+            buffer[x] = I();
+        }
+    }
+    
     ///
     /// \brief Performs the specified action
     ///
@@ -157,7 +303,7 @@ namespace lr {
     /// generated. This is to support guard actions (where we are only interested in storing the state) as
     /// well as standard actions (where we want to call the actions object to actually perform the action)
     ///
-    template<class I, class A, class T> template<class actions> inline bool parser<I, A, T>::state::perform_generic(const lexeme_container& lookahead, const action* act, actions& actDelegate) {
+    template<class I, class A, class T, int F> template<class actions> inline bool parser<I, A, T, F>::state::perform_generic(const lexeme_container& lookahead, const action* act, actions& actDelegate) {
         switch (act->type) {
             case lr_action::act_ignore:
                 // Discard the current lookahead
@@ -174,8 +320,8 @@ namespace lr {
                 // Fetch the strong equivalent of this symbol
                 int strongEquiv = m_Tables->strong_for_weak(lookahead->matched());
                 
-                // Push a new lexeme with a different symbol onto the stack
-                actDelegate.shift(this, act, lexeme_container(new dfa::lexeme(lookahead->content(), lookahead->pos(), strongEquiv), true));
+                // Push a new lexeme with a different symbol onto the stack (it shares its content with the lookahead)
+                actDelegate.shift(this, act, lexeme_container(new dfa::lexeme(lookahead, strongEquiv), true));
                 return true;
             }
                 
@@ -224,9 +370,73 @@ namespace lr {
     /// can produce an accepting state, then this will return the ID of the guard symbol that was accepted.
     /// If no accepting state is reached, this will return a negative value (generally -1)
     ///
-    template<typename I, typename A, typename T> int parser<I, A, T>::state::check_guard(int initialState, int initialOffset) {
+    template<typename I, typename A, typename T, int F> int parser<I, A, T, F>::state::check_guard(int initialState, int initialOffset) {
+        // Guards always have the same result at the same position in the lookahead, so re-use any earlier result
+        std::pair<int, int> key(m_LookaheadPos + initialOffset, initialState);
+        
+        typename session::guard_results::const_iterator found = m_Session->m_GuardResults.find(key);
+        if (found != m_Session->m_GuardResults.end()) {
+            return found->second;
+        }
+        
+        // Match the guard and remember the result (regular guards can be matched without running the parser)
+        m_Trace.ran_guard(initialState);
+        
+        int result;
+        int guardState = m_Tables->regular_guard(initialState);
+        
+        if (guardState >= 0) {
+            result = match_regular_guard(guardState, initialState, initialOffset);
+        } else {
+            result = match_guard(initialState, initialOffset);
+        }
+        
+        m_Session->m_GuardResults[key] = result;
+        
+        return result;
+    }
+    
+    ///
+    /// \brief Matches a regular guard for check_guard by stepping its automaton over the lookahead
+    ///
+    template<typename I, typename A, typename T, int F> int parser<I, A, T, F>::state::match_regular_guard(int guardState, int initialState, int initialOffset) {
+        for (int offset = initialOffset; ; ++offset) {
+            // Guards match the shortest input that they can accept
+            int guardSymbol = m_Tables->guard_accepts(guardState);
+            if (guardSymbol >= 0) {
+                return guardSymbol;
+            }
+            
+            // The guard is rejected if the input ends first
+            const lexeme_container& la = look(offset);
+            if (la.item() == NULL) {
+                return -1;
+            }
+            
+            // Move to the next state
+            int terminal    = la->matched();
+            int nextState   = m_Tables->next_guard_state(guardState, terminal);
+            
+            if (nextState < 0) {
+                // Symbols that the parser ignores are skipped, anything else rejects the guard
+                parser_tables::action_iterator act = m_Tables->find_terminal(initialState, terminal);
+                if (act != m_Tables->last_terminal_action(initialState) && act->symbolId == terminal && act->type == lr_action::act_ignore) {
+                    continue;
+                }
+                
+                return -1;
+            }
+            
+            guardState = nextState;
+        }
+    }
+    
+    ///
+    /// \brief Runs the guard parser for check_guard
+    ///
+    template<typename I, typename A, typename T, int F> int parser<I, A, T, F>::state::match_guard(int initialState, int initialOffset) {
         // Create the guard actions object
-        guard_actions guardActions(initialState, initialOffset);
+        guard_actions guardActions(this, initialState, initialOffset);
         
         // Set to true once the EOG symbol can be reduced
         bool canReduceEog = false;
@@ -283,9 +493,6 @@ namespace lr {
                 
                 // If this is a weak reduce action, then check if the action is successful
                 if (act->type == lr_action::act_weakreduce) {
-                    // TODO: if we've previously tested this symbol to see if it will reduce and the parser state hasn't changed
-                    // then we can just re-use the existing information.
-                    // TODO: see if this produces a meaningful speedup before complicating the code
                     if (la.item() != NULL) {
                         // Standard symbol: use the usual form of can_reduce
                         if (!guardActions.can_reduce(la->matched(), act, this)) {
@@ -351,7 +558,7 @@ namespace lr {
     }
     
     /// \brief Fakes up a reduce action during can_reduce testing. act must be a reduce action
-    template<typename I, typename A, typename T> inline void parser<I, A, T>::state::fake_reduce(parser_tables::action_iterator act, int& stackPos, std::stack<int>& pushed, const stack& underlyingStack) {
+    template<typename I, typename A, typename T, int F> inline void parser<I, A, T, F>::state::fake_reduce(parser_tables::action_iterator act, int& stackPos, fake_stack& pushed, const stack& underlyingStack) {
         // Verify the action type
         switch (act->type) {
             // Reduce actions are fairly easy
@@ -382,13 +589,10 @@ namespace lr {
                 }
                 
                 // Work out the goto action
-                parser_tables::action_iterator gotoAct = m_Tables->find_nonterminal(state, rule.identifier);
-                for (; gotoAct != m_Tables->last_nonterminal_action(state); ++gotoAct) {
-                    if (gotoAct->type == lr_action::act_goto) {
-                        // Push this goto
-                        pushed.push(gotoAct->nextState);
-                        break;
-                    }
+                int gotoState = m_Tables->find_goto(state, rule.identifier);
+                if (gotoState >= 0) {
+                    // Push this goto
+                    pushed.push(gotoState);
                 }
                 break;
             }
@@ -413,7 +617,7 @@ namespace lr {
     }
     
     /// \brief Returns true if a reduction of the specified lexeme will result in it being shifted
-    template<typename I, typename A, typename T> template<class symbol_fetcher> bool parser<I, A, T>::state::can_reduce(int symbol, int stackPos, std::stack<int> pushed, const stack& underlyingStack) {
+    template<typename I, typename A, typename T, int F> template<class symbol_fetcher> bool parser<I, A, T, F>::state::can_reduce(int symbol, int stackPos, fake_stack pushed, const stack& underlyingStack) {
         // Get the new state
         int state;
         if (!pushed.empty()) {
@@ -459,8 +663,8 @@ namespace lr {
                 {
                     // To deal with weak reduce actions, we need to fake up the reduction and try again
                     // Use a separate stack so we can carry on after the action
-                    int             weakPos = stackPos;
-                    std::stack<int> weakStack(pushed);
+                    int         weakPos = stackPos;
+                    fake_stack  weakStack(pushed);
                     
                     // If we can reduce via this item, then the result is true
                     fake_reduce(act, weakPos, weakStack, underlyingStack);
@@ -504,11 +708,43 @@ namespace lr {
         return false;
     }
 
+    /// \brief Returns true if performing the specified reduce action will result in the symbol being shifted
+    template<typename I, typename A, typename T, int F> template<class symbol_fetcher> inline bool parser<I, A, T, F>::state::can_reduce_action(int symbol, parser_tables::action_iterator act, const fake_stack& pushed, unsigned int generation) {
+        // Work out the state on top of the stack
+        int topState = pushed.empty() ? m_Stack->state : pushed.top();
+        
+        // Look for a cached result
+        size_t              hash    = (size_t) generation * 31 + (size_t) topState * 7 + (size_t) symbol + ((size_t) act / sizeof(action));
+        can_reduce_entry&   entry   = m_CanReduceCache[hash & (can_reduce_cache_size-1)];
+        
+        if (entry.generation == generation && entry.state == topState && entry.symbol == symbol && entry.act == act) {
+            return entry.result;
+        }
+        
+        // Fake reduce using the action
+        fake_stack  fakeStack(pushed);
+        int         stackPos = 0;
+        
+        fake_reduce(act, stackPos, fakeStack, m_Stack);
+        
+        // Do a can_reduce on what remains
+        bool result = can_reduce<symbol_fetcher>(symbol, stackPos, fakeStack, m_Stack);
+        
+        // Cache the result
+        entry.generation    = generation;
+        entry.state         = topState;
+        entry.symbol        = symbol;
+        entry.act           = act;
+        entry.result        = result;
+        
+        return result;
+    }
+
     /// \brief Performs a single parsing action, and returns the result
     ///
     /// This version takes several parameters: the current lookahead token, the ID of the symbol and whether or not it's
     /// a terminal symbol, and the range of actions that might apply to this particular symbol.
-    template<typename I, typename A, typename T> template<class actions> inline parser_result::result parser<I,A,T>::state::process_generic(
+    template<typename I, typename A, typename T, int F> template<class actions> inline parser_result::result parser<I,A,T,F>::state::process_generic(
                                                           actions& actDelegate, 
                                                           const lexeme_container& la, 
                                                           int symbol, bool isTerminal,
@@ -520,7 +756,8 @@ namespace lr {
             if (act->symbolId != symbol) break;
             
             // If this is a weak reduce action, then check if the action is successful
-            if (act->type == lr_action::act_weakreduce) {
+            // (The checks against F are constant, so parsers that don't support a feature don't test for it)
+            if ((F & parser_features::weak_symbols) && act->type == lr_action::act_weakreduce) {
                 if (isTerminal) {
                     // Run a fake reduce
                     if (!actDelegate.can_reduce(symbol, act, this)) {
@@ -534,7 +771,7 @@ namespace lr {
             }
             
             // Guard actions are not performed by the 'perform' method, but are handled separately
-            else if (act->type == lr_action::act_guard) {
+            else if ((F & parser_features::guards) && act->type == lr_action::act_guard) {
                 // Check if this guard generates a guard symbol
                 int guardSym = actDelegate.check_guard(this, act->nextState);
                 
@@ -573,7 +810,7 @@ namespace lr {
     
     
     /// \brief Performs a single parsing action, and returns the result
-    template<typename I, typename A, typename T> template<class actions> inline parser_result::result parser<I,A,T>::state::process_generic(actions& actDelegate) {
+    template<typename I, typename A, typename T, int F> template<class actions> inline parser_result::result parser<I,A,T,F>::state::process_generic(actions& actDelegate) {
         // Fetch the lookahead
         lexeme_container la = actDelegate.look(this);
         
@@ -612,7 +849,7 @@ namespace lr {
     /// Practical experience indicates that guards are often used in situations that are not quite LALR(1); checking
     /// whether or not reductions will be successful makes them easier to use as they will not cause spurious reductions
     /// in situations where it's not appropriate.
-    template<typename I, typename A, typename T> template<class actions> bool parser<I, A, T>::state::process_guard(actions& actDelegate, 
+    template<typename I, typename A, typename T, int F> template<class actions> bool parser<I, A, T, F>::state::process_guard(actions& actDelegate, 
                                                                                                const lexeme_container& la, 
                                                                                                int guardSymbol) {
         typedef parser_tables::action_iterator action_iterator;
@@ -28,6 +28,7 @@
 #include <algorithm>
 
 #include "TameParse/Lr/parser_tables.h"
+#include "TameParse/Lr/regular_guard_builder.h"
 
 using namespace std;
 using namespace contextfree;
@@ -235,10 +236,26 @@ parser_tables::parser_tables(const lalr_builder& builder, const weak_symbols* we
         // Sort the items
         sort(m_WeakToStrong, m_WeakToStrong + m_NumWeakToStrong);
     }
+    
+    // Build the table used to look up strong symbols
+    build_strong_for_weak();
+    
+    // Build the tables used to look up actions
+    build_combs();
+    
+    // Compile any guards that are regular into automata
+    regular_guard_builder guards(gram);
+    
+    for (map<int, int>::const_iterator guardState = builder.guard_states().begin(); guardState != builder.guard_states().end(); ++guardState) {
+        const rule_container& guardRule = gram.rule_with_identifier(guardState->first);
+        guards.add_guard(*guardRule, gram.identifier_for_item(guardRule->nonterminal()), guardState->second);
+    }
+    
+    m_Guards = guards.build(m_NumStates);
 }
 
 /// \brief Creates a parser from a set of tables. Tables passed into this constructor will not be deleted by the destructor
-parser_tables::parser_tables(int numStates, int endOfInputSymbol, int endOfGuardSymbol, action** terminalActions, action** nonterminalActions, action_count* actionCounts, int* endGuardStates, int numEndGuards, int numRules, reduce_rule* reduceRules, int numWeakToStrong, symbol_equivalent* weakToStrong)
+parser_tables::parser_tables(int numStates, int endOfInputSymbol, int endOfGuardSymbol, action** terminalActions, action** nonterminalActions, action_count* actionCounts, int* endGuardStates, int numEndGuards, int numRules, reduce_rule* reduceRules, int numWeakToStrong, symbol_equivalent* weakToStrong, comb_table* terminalComb, comb_table* nonterminalComb, int* gotos, guard_table* guards)
 : m_NumStates(numStates)
 , m_EndOfInput(endOfInputSymbol)
 , m_EndOfGuard(endOfGuardSymbol)
@@ -251,17 +268,111 @@ parser_tables::parser_tables(int numStates, int endOfInputSymbol, int endOfGuard
 , m_Rules(reduceRules)
 , m_NumWeakToStrong(numWeakToStrong)
 , m_WeakToStrong(weakToStrong)
+, m_TerminalComb(terminalComb)
+, m_NonterminalComb(nonterminalComb)
+, m_Gotos(nonterminalComb?gotos:NULL)
+, m_Guards(guards)
 , m_DeleteTables(false) {
+    build_strong_for_weak();
 }
 
 /// \brief Copy constructor
-parser_tables::parser_tables(const parser_tables& copyFrom) 
-: m_NumStates(copyFrom.m_NumStates)
-, m_NumRules(copyFrom.m_NumRules)
-, m_EndOfInput(copyFrom.m_EndOfInput)
-, m_EndOfGuard(copyFrom.m_EndOfGuard)
-, m_DeleteTables(copyFrom.m_DeleteTables)
-, m_NumWeakToStrong(copyFrom.m_NumWeakToStrong) {
+parser_tables::parser_tables(const parser_tables& copyFrom) {
+    copy_tables(copyFrom);
+}
+
+/// \brief Assignment
+parser_tables& parser_tables::operator=(const parser_tables& copyFrom) {
+    // Can't self-assign
+    if (&copyFrom == this) return *this;
+    
+    // Destroy the data in this object
+    free_tables();
+
+    // Copy the data from the target object
+    copy_tables(copyFrom);
+
+    return *this;
+}
+
+/// \brief Destructor
+parser_tables::~parser_tables() {
+    free_tables();
+}
+
+/// \brief Copies a comb table (returns NULL if the table is NULL)
+static parser_tables::comb_table* copy_comb(const parser_tables::comb_table* copyFrom, int numStates) {
+    if (!copyFrom) return NULL;
+    
+    parser_tables::comb_table* result = new parser_tables::comb_table;
+    
+    result->size            = copyFrom->size;
+    result->displacement    = new int[numStates];
+    result->check           = new int[result->size];
+    result->index           = new int[result->size];
+    
+    copy(copyFrom->displacement, copyFrom->displacement + numStates, result->displacement);
+    copy(copyFrom->check, copyFrom->check + result->size, result->check);
+    copy(copyFrom->index, copyFrom->index + result->size, result->index);
+    
+    return result;
+}
+
+/// \brief Frees a comb table created by this class
+static void delete_comb(parser_tables::comb_table* comb) {
+    if (!comb) return;
+    
+    delete[] comb->displacement;
+    delete[] comb->check;
+    delete[] comb->index;
+    delete comb;
+}
+
+/// \brief Copies a guard table (returns NULL if the table is NULL)
+static parser_tables::guard_table* copy_guards(const parser_tables::guard_table* copyFrom, int numStates) {
+    if (!copyFrom) return NULL;
+    
+    parser_tables::guard_table* result = new parser_tables::guard_table;
+    int                         numTransitions = copyFrom->firstTransition[copyFrom->numStates];
+    
+    result->numStates       = copyFrom->numStates;
+    result->initialState    = new int[numStates];
+    result->accept          = new int[result->numStates];
+    result->firstTransition = new int[result->numStates+1];
+    result->symbol          = new int[numTransitions];
+    result->nextState       = new int[numTransitions];
+    
+    copy(copyFrom->initialState, copyFrom->initialState + numStates, result->initialState);
+    copy(copyFrom->accept, copyFrom->accept + result->numStates, result->accept);
+    copy(copyFrom->firstTransition, copyFrom->firstTransition + result->numStates+1, result->firstTransition);
+    copy(copyFrom->symbol, copyFrom->symbol + numTransitions, result->symbol);
+    copy(copyFrom->nextState, copyFrom->nextState + numTransitions, result->nextState);
+    
+    return result;
+}
+
+/// \brief Frees a guard table created by this class
+static void delete_guards(parser_tables::guard_table* guards) {
+    if (!guards) return;
+    
+    delete[] guards->initialState;
+    delete[] guards->accept;
+    delete[] guards->firstTransition;
+    delete[] guards->symbol;
+    delete[] guards->nextState;
+    delete guards;
+}
+
+/// \brief Copies the tables from another object into this one
+void parser_tables::copy_tables(const parser_tables& copyFrom) {
+    // Copy the data from the target object (this object always owns its copy of the tables)
+    m_NumStates         = copyFrom.m_NumStates;
+    m_NumRules          = copyFrom.m_NumRules;
+    m_EndOfInput        = copyFrom.m_EndOfInput;
+    m_EndOfGuard        = copyFrom.m_EndOfGuard;
+    m_DeleteTables      = true;
+    m_NumWeakToStrong   = copyFrom.m_NumWeakToStrong;
+
     // Allocate the action tables
     m_TerminalActions       = new action*[m_NumStates];
     m_NonterminalActions    = new action*[m_NumStates];
@@ -310,14 +421,25 @@ parser_tables::parser_tables(const parser_tables& copyFrom)
     } else {
         m_WeakToStrong = NULL;
     }
+    build_strong_for_weak();
+    
+    // Copy the comb tables
+    m_TerminalComb      = copy_comb(copyFrom.m_TerminalComb, m_NumStates);
+    m_NonterminalComb   = copy_comb(copyFrom.m_NonterminalComb, m_NumStates);
+    
+    if (copyFrom.m_Gotos) {
+        m_Gotos = new int[m_NonterminalComb->size];
+        copy(copyFrom.m_Gotos, copyFrom.m_Gotos + m_NonterminalComb->size, m_Gotos);
+    } else {
+        m_Gotos = NULL;
+    }
+    
+    // Copy the guard automata
+    m_Guards = copy_guards(copyFrom.m_Guards, m_NumStates);
 }
 
-/// \brief Assignment
-parser_tables& parser_tables::operator=(const parser_tables& copyFrom) {
-    // Can't self-assign
-    if (&copyFrom == this) return *this;
-    
-    // Destroy the data in this object
+/// \brief Frees the tables owned by this object
+void parser_tables::free_tables() {
     if (m_DeleteTables) {
         // Destroy each entry in the parser table
         for (int x=0; x<m_NumStates; ++x) {
@@ -332,85 +454,205 @@ parser_tables& parser_tables::operator=(const parser_tables& copyFrom) {
         delete[] m_Counts;
         delete[] m_EndGuardStates;
         if (m_WeakToStrong) delete[] m_WeakToStrong;
+        
+        delete_comb(m_TerminalComb);
+        delete_comb(m_NonterminalComb);
+        if (m_Gotos) delete[] m_Gotos;
+        delete_guards(m_Guards);
     }
+    
+    // The strong for weak table is always owned by this object
+    if (m_StrongForWeak) delete[] m_StrongForWeak;
+}
 
-    // Copy the data from the target object
-    m_NumStates         = copyFrom.m_NumStates;
-    m_NumRules          = copyFrom.m_NumRules;
-    m_EndOfInput        = copyFrom.m_EndOfInput;
-    m_EndOfGuard        = copyFrom.m_EndOfGuard;
-    m_DeleteTables      = copyFrom.m_DeleteTables;
-    m_NumWeakToStrong   = copyFrom.m_NumWeakToStrong;
-
-    // Allocate the action tables
-    m_TerminalActions       = new action*[m_NumStates];
-    m_NonterminalActions    = new action*[m_NumStates];
-    m_Counts                = new action_count[m_NumStates];
+/// \brief Builds a comb table for the specified action tables
+///
+/// Rows are placed largest first, each at the first displacement where none of its entries collide with
+/// an entry that has already been placed.
+static parser_tables::comb_table* build_comb(parser_tables::action* const* actions, const vector<int>& counts) {
+    typedef pair<int, int> entry;                           // Symbol ID, index of the first action
     
-    // Copy the states
-    for (int stateId=0; stateId<m_NumStates; ++stateId) {
-        // Copy the counts
-        m_Counts[stateId] = copyFrom.m_Counts[stateId];
+    int                     numStates = (int) counts.size();
+    vector<vector<entry> >  rows(numStates);
+    vector<pair<int, int> > order;                          // -(Row size), state ID
+    
+    for (int stateId = 0; stateId < numStates; ++stateId) {
+        // Find the first action for each symbol (actions are sorted by symbol ID)
+        for (int actionId = 0; actionId < counts[stateId]; ++actionId) {
+            int symbolId = actions[stateId][actionId].symbolId;
+            
+            if (rows[stateId].empty() || rows[stateId].back().first != symbolId) {
+                rows[stateId].push_back(entry(symbolId, actionId));
+            }
+        }
         
-        // Allocate the array for this state
-        m_TerminalActions[stateId]      = new action[m_Counts[stateId].numTerminals];
-        m_NonterminalActions[stateId]   = new action[m_Counts[stateId].numNonterminals];
+        order.push_back(pair<int, int>(-(int)rows[stateId].size(), stateId));
+    }
+    
+    sort(order.begin(), order.end());
+    
+    // Place each row in turn
+    vector<int>     check;
+    vector<int>     index;
+    vector<int>     displacement(numStates, 0);
+    int             firstFree = 0;                          // Entries before this one are all in use
+    
+    for (vector<pair<int, int> >::const_iterator nextRow = order.begin(); nextRow != order.end(); ++nextRow) {
+        int                     stateId = nextRow->second;
+        const vector<entry>&    row     = rows[stateId];
         
-        // Copy the terminals and nonterminals
-        for (int x=0; x<m_Counts[stateId].numTerminals; ++x) {
-            m_TerminalActions[stateId][x] = copyFrom.m_TerminalActions[stateId][x];
+        if (row.empty()) continue;
+        
+        // Find a displacement where this row fits (the first symbol can't go anywhere before the first free entry)
+        int displace = firstFree - row.front().first;
+        if (displace < 0) displace = 0;
+        
+        for (;; ++displace) {
+            bool fits = true;
+            
+            for (vector<entry>::const_iterator item = row.begin(); item != row.end(); ++item) {
+                int pos = displace + item->first;
+                if (pos < (int) check.size() && check[pos] >= 0) {
+                    fits = false;
+                    break;
+                }
+            }
+            
+            if (fits) break;
         }
-        for (int x=0; x<m_Counts[stateId].numNonterminals; ++x) {
-            m_NonterminalActions[stateId][x] = copyFrom.m_NonterminalActions[stateId][x];
+        
+        // Store the row
+        displacement[stateId] = displace;
+        
+        int rowEnd = displace + row.back().first + 1;
+        if (rowEnd > (int) check.size()) {
+            check.resize(rowEnd, -1);
+            index.resize(rowEnd, 0);
+        }
+        
+        for (vector<entry>::const_iterator item = row.begin(); item != row.end(); ++item) {
+            check[displace + item->first] = stateId;
+            index[displace + item->first] = item->second;
+        }
+        
+        while (firstFree < (int) check.size() && check[firstFree] >= 0) {
+            ++firstFree;
         }
     }
     
-    // Allocate the rule table
-    m_Rules = new reduce_rule[m_NumRules];
-    for (int ruleId=0; ruleId<m_NumRules; ++ruleId) {
-        m_Rules[ruleId] = copyFrom.m_Rules[ruleId];
+    // Generate the final table
+    parser_tables::comb_table* result = new parser_tables::comb_table;
+    
+    result->size            = (int) check.size();
+    result->displacement    = new int[numStates];
+    result->check           = new int[result->size];
+    result->index           = new int[result->size];
+    
+    copy(displacement.begin(), displacement.end(), result->displacement);
+    copy(check.begin(), check.end(), result->check);
+    copy(index.begin(), index.end(), result->index);
+    
+    return result;
+}
+
+/// \brief Builds the comb tables and the goto table from the action tables
+void parser_tables::build_combs() {
+    vector<int> terminalCounts;
+    vector<int> nonterminalCounts;
+    
+    for (int stateId = 0; stateId < m_NumStates; ++stateId) {
+        terminalCounts.push_back(m_Counts[stateId].numTerminals);
+        nonterminalCounts.push_back(m_Counts[stateId].numNonterminals);
     }
     
-    // Allocate the end of guard state table
-    m_NumEndOfGuards    = copyFrom.m_NumEndOfGuards;
-    m_EndGuardStates    = new int[m_NumEndOfGuards];
+    m_TerminalComb      = build_comb(m_TerminalActions, terminalCounts);
+    m_NonterminalComb   = build_comb(m_NonterminalActions, nonterminalCounts);
     
-    // Copy the states
-    for (int x=0; x<m_NumEndOfGuards; ++x) {
-        m_EndGuardStates[x] = copyFrom.m_EndGuardStates[x];
+    // Fill in the goto for each nonterminal entry
+    m_Gotos = new int[m_NonterminalComb->size];
+    
+    for (int pos = 0; pos < m_NonterminalComb->size; ++pos) {
+        m_Gotos[pos] = -1;
+        
+        int stateId = m_NonterminalComb->check[pos];
+        if (stateId < 0) continue;
+        
+        int symbolId = pos - m_NonterminalComb->displacement[stateId];
+        
+        for (int actionId = m_NonterminalComb->index[pos]; actionId < m_Counts[stateId].numNonterminals; ++actionId) {
+            const action& act = m_NonterminalActions[stateId][actionId];
+            if (act.symbolId != symbolId) break;
+            
+            if (act.type == lr_action::act_goto) {
+                m_Gotos[pos] = act.nextState;
+                break;
+            }
+        }
     }
+}
 
-    // Copy the weak to strong table
-    if (copyFrom.m_WeakToStrong) {
-        m_WeakToStrong = new symbol_equivalent[m_NumWeakToStrong];
-
-        for (int x=0; x<m_NumWeakToStrong; ++x) {
-            m_WeakToStrong[x] = copyFrom.m_WeakToStrong[x];
+/// \brief Builds the strong for weak table from the weak to strong table
+///
+/// This is a table indexed by terminal symbol ID, so strong_for_weak() doesn't have to search for the symbol.
+void parser_tables::build_strong_for_weak() {
+    m_NumStrongForWeak  = 0;
+    m_StrongForWeak     = NULL;
+    
+    // Find the highest weak symbol ID
+    for (int x=0; x<m_NumWeakToStrong; ++x) {
+        if (m_WeakToStrong[x].m_OriginalSymbol >= m_NumStrongForWeak) {
+            m_NumStrongForWeak = m_WeakToStrong[x].m_OriginalSymbol + 1;
         }
-    } else {
-        m_WeakToStrong = NULL;
     }
-
-    return *this;
+    
+    // Nothing to do if there are no weak symbols
+    if (m_NumStrongForWeak == 0) return;
+    
+    // Every symbol maps to itself unless it's weak
+    m_StrongForWeak = new int[m_NumStrongForWeak];
+    for (int symbolId=0; symbolId<m_NumStrongForWeak; ++symbolId) {
+        m_StrongForWeak[symbolId] = symbolId;
+    }
+    
+    for (int x=0; x<m_NumWeakToStrong; ++x) {
+        if (m_WeakToStrong[x].m_OriginalSymbol < 0) continue;
+        m_StrongForWeak[m_WeakToStrong[x].m_OriginalSymbol] = m_WeakToStrong[x].m_MappedTo;
+    }
 }
 
-/// \brief Destructor
-parser_tables::~parser_tables() {
-    if (m_DeleteTables) {
-        // Destroy each entry in the parser table
-        for (int x=0; x<m_NumStates; ++x) {
-            delete[] m_NonterminalActions[x];
-            delete[] m_TerminalActions[x];
+/// \brief Works out which of the values in parser_features are used by the actions in these tables
+int parser_tables::features() const {
+    int result = parser_features::none;
+    
+    for (int stateId = 0; stateId < m_NumStates; ++stateId) {
+        // Guard symbols, the end of guard symbol and the end of input symbol are all nonterminals, so both sets of actions need checking
+        for (int tableId = 0; tableId < 2; ++tableId) {
+            const action*   actions = tableId == 0 ? m_TerminalActions[stateId] : m_NonterminalActions[stateId];
+            int             count   = tableId == 0 ? m_Counts[stateId].numTerminals : m_Counts[stateId].numNonterminals;
+            
+            for (int actionId = 0; actionId < count; ++actionId) {
+                switch (actions[actionId].type) {
+                    case lr_action::act_guard:
+                        result |= parser_features::guards;
+                        break;
+                        
+                    case lr_action::act_weakreduce:
+                    case lr_action::act_shiftstrong:
+                        result |= parser_features::weak_symbols;
+                        break;
+                        
+                    case lr_action::act_divert:
+                        result |= parser_features::diverts;
+                        break;
+                        
+                    default:
+                        break;
+                }
+            }
         }
-        
-        // Destroy the tables themselves
-        delete[] m_NonterminalActions;
-        delete[] m_TerminalActions;
-        delete[] m_Rules;
-        delete[] m_Counts;
-        delete[] m_EndGuardStates;
-        if (m_WeakToStrong) delete[] m_WeakToStrong;
     }
+    
+    return result;
 }
 
 /// \brief Calculates the size in bytes of these parser tables
@@ -429,6 +671,23 @@ size_t parser_tables::size() const {
         total += sizeof(action) * m_Counts[stateId].numNonterminals;
     }
     
+    // Add the comb tables
+    if (m_TerminalComb) {
+        total += sizeof(comb_table) + sizeof(int) * (m_NumStates + 2 * m_TerminalComb->size);
+    }
+    if (m_NonterminalComb) {
+        total += sizeof(comb_table) + sizeof(int) * (m_NumStates + 2 * m_NonterminalComb->size);
+    }
+    if (m_Gotos) {
+        total += sizeof(int) * m_NonterminalComb->size;
+    }
+    if (m_StrongForWeak) {
+        total += sizeof(int) * m_NumStrongForWeak;
+    }
+    if (m_Guards) {
+        total += sizeof(guard_table) + sizeof(int) * (m_NumStates + 2 * m_Guards->numStates + 1 + 2 * m_Guards->firstTransition[m_Guards->numStates]);
+    }
+    
     // This is the result
     return total;
 }
@@ -35,6 +35,32 @@
 #include "TameParse/Dfa/lexer.h"
 
 namespace lr {
+    ///
+    /// \brief Flags describing which parser features are used by a set of parser tables
+    ///
+    /// Tables for grammars that are plain LALR(1) use none of these, so a parser instantiated with only the
+    /// features a set of tables needs (see lr::parser) can skip the checks for the others.
+    ///
+    class parser_features {
+    public:
+        enum feature {
+            /// \brief The tables use no features that aren't part of a plain LALR(1) parser
+            none            = 0x0,
+            
+            /// \brief The tables contain guard actions (and may contain end of guard actions)
+            guards          = 0x1,
+            
+            /// \brief The tables contain weak reduce or strong shift actions
+            weak_symbols    = 0x2,
+            
+            /// \brief The tables contain divert actions
+            diverts         = 0x4,
+            
+            /// \brief Every feature
+            all             = 0x7
+        };
+    };
+    
     ///
     /// \brief The tables for a LR(1) parser
     ///
@@ -80,6 +106,54 @@ namespace lr {
             int numNonterminals;
         };
         
+        ///
+        /// \brief Row displacement ('comb') table that finds the actions for a state and a symbol with a single lookup
+        ///
+        /// The entry for a particular state and symbol is at displacement[state] + symbol. This entry only belongs to
+        /// the state if check contains the state ID; if it does, then index is the offset into the action list for that
+        /// state of the first action for the symbol.
+        ///
+        struct comb_table {
+            /// \brief The number of entries in the check and index arrays
+            int size;
+            
+            /// \brief The displacement of the row for each state
+            int* displacement;
+            
+            /// \brief The state that each entry belongs to (-1 if the entry is not used)
+            int* check;
+            
+            /// \brief The offset of the first action for the symbol within the action list for the state
+            int* index;
+        };
+        
+        ///
+        /// \brief Deterministic automata that check the guards whose language is regular over the terminal symbols
+        ///
+        /// A guard is matched as soon as its automaton reaches an accepting state, and rejected if there is no
+        /// transition for the next symbol in the lookahead. Guards that are not regular are matched by running the
+        /// parser from the guard's initial state instead.
+        ///
+        struct guard_table {
+            /// \brief The number of automaton states
+            int numStates;
+            
+            /// \brief For each parser state, the automaton state that checks the guard starting there (or -1 if there isn't one)
+            int* initialState;
+            
+            /// \brief For each automaton state, the guard symbol that is matched when it is reached (or -1 if it does not accept)
+            int* accept;
+            
+            /// \brief For each automaton state, the index of its first transition (numStates+1 entries)
+            int* firstTransition;
+            
+            /// \brief The terminal symbol for each transition (sorted for each automaton state)
+            int* symbol;
+            
+            /// \brief The automaton state that each transition moves to
+            int* nextState;
+        };
+        
         /// \brief Structure that maps a weak symbol to its strong equivalent
         struct symbol_equivalent {
             int m_OriginalSymbol;
@@ -132,6 +206,29 @@ namespace lr {
         
         /// \brief Ordered list of weak symbols and their strong equivalent
         symbol_equivalent* m_WeakToStrong;
+        
+        /// \brief The number of entries in the strong for weak table (one more than the highest weak symbol ID)
+        int m_NumStrongForWeak;
+        
+        /// \brief The strong symbol for each terminal symbol, indexed by symbol ID (or NULL if there are no weak symbols)
+        ///
+        /// Terminals that are not weak map to themselves. This table is always owned by this object, as it is built
+        /// from the weak to strong table when it is created.
+        int* m_StrongForWeak;
+        
+        /// \brief Comb table for the terminal actions (or NULL if the actions should be found with a binary search)
+        comb_table* m_TerminalComb;
+        
+        /// \brief Comb table for the nonterminal actions (or NULL if the actions should be found with a binary search)
+        comb_table* m_NonterminalComb;
+        
+        /// \brief The goto state for each entry in the nonterminal comb table (or -1 for entries with no goto action)
+        ///
+        /// This is NULL if there is no nonterminal comb table.
+        int* m_Gotos;
+        
+        /// \brief The automata for the regular guards (or NULL if every guard is matched by running the parser)
+        guard_table* m_Guards;
 
         /// \brief True if this object owns the tables
         bool m_DeleteTables;
@@ -141,7 +238,10 @@ namespace lr {
         parser_tables(const lalr_builder& builder, const weak_symbols* weakSyms);
 
         /// \brief Creates a parser from a set of tables. Tables passed into this constructor will not be deleted by the destructor
-        parser_tables(int numStates, int endOfInputSymbol, int endOfGuardSymbol, action** terminalActions, action** nonterminalActions, action_count* actionCounts, int* endGuardStates, int numEndGuards, int numRules, reduce_rule* reduceRules, int numWeakToStrong, symbol_equivalent* weakToStrong);
+        ///
+        /// The comb tables and the goto table are optional: if they are not supplied, actions are found by searching the
+        /// action tables instead. Likewise, if there is no guard table then all guards are matched by the parser.
+        parser_tables(int numStates, int endOfInputSymbol, int endOfGuardSymbol, action** terminalActions, action** nonterminalActions, action_count* actionCounts, int* endGuardStates, int numEndGuards, int numRules, reduce_rule* reduceRules, int numWeakToStrong, symbol_equivalent* weakToStrong, comb_table* terminalComb = NULL, comb_table* nonterminalComb = NULL, int* gotos = NULL, guard_table* guards = NULL);
 
         /// \brief Copy constructor
         parser_tables(const parser_tables& copyFrom);
@@ -155,6 +255,22 @@ namespace lr {
         /// \brief Calculates the size in bytes of these parser tables
         virtual size_t size() const;
         
+        /// \brief Works out which of the values in parser_features are used by the actions in these tables
+        int features() const;
+        
+    private:
+        /// \brief Copies the tables from another object into this one
+        void copy_tables(const parser_tables& copyFrom);
+        
+        /// \brief Frees the tables owned by this object
+        void free_tables();
+        
+        /// \brief Builds the comb tables and the goto table from the action tables
+        void build_combs();
+        
+        /// \brief Builds the strong for weak table from the weak to strong table
+        void build_strong_for_weak();
+        
     private:
         /// \brief Compares a symbol to an action
         inline static bool compare_symbols(const action& a, const action& compareTo) {
@@ -169,6 +285,24 @@ namespace lr {
             return std::lower_bound(actionList, actionList + count, compareAction, compare_symbols);
         }
         
+        /// \brief Finds the position of the entry for a symbol in a comb table, or -1 if there isn't one
+        inline static int find_comb_entry(const comb_table& comb, int stateId, int symbol) {
+            if (symbol < 0) return -1;
+            
+            int pos = comb.displacement[stateId] + symbol;
+            if (pos >= comb.size || comb.check[pos] != stateId) return -1;
+            
+            return pos;
+        }
+        
+        /// \brief Finds an action using a comb table
+        inline static action_iterator find_comb_action(const comb_table& comb, int stateId, int symbol, action* actionList, int count) {
+            int pos = find_comb_entry(comb, stateId, symbol);
+            if (pos < 0) return actionList + count;
+            
+            return actionList + comb.index[pos];
+        }
+        
     public:
         /// \brief Returns the reduce rule with the specified ID
         inline const reduce_rule& rule(int ruleId) const { return m_Rules[ruleId]; }
@@ -186,21 +320,79 @@ namespace lr {
         /// \brief Finds the first action that refers to a terminal with an ID equal or greater to that supplied 
         /// to this function
         inline action_iterator find_terminal(int stateId, int terminal) const {
+            if (m_TerminalComb) {
+                return find_comb_action(*m_TerminalComb, stateId, terminal, m_TerminalActions[stateId], m_Counts[stateId].numTerminals);
+            }
             return find_action(terminal, m_TerminalActions[stateId], m_Counts[stateId].numTerminals);
         }
         
         /// \brief Finds the first action that refers to a nonterminal with an ID equal or greater to that supplied
         /// to this function
         inline action_iterator find_nonterminal(int stateId, int nonterminal) const {
+            if (m_NonterminalComb) {
+                return find_comb_action(*m_NonterminalComb, stateId, nonterminal, m_NonterminalActions[stateId], m_Counts[stateId].numNonterminals);
+            }
             return find_action(nonterminal, m_NonterminalActions[stateId], m_Counts[stateId].numNonterminals);
         }
         
+        /// \brief Finds the state to move to after reducing the specified nonterminal in the specified state
+        ///
+        /// Returns -1 if there is no goto action for the nonterminal
+        inline int find_goto(int stateId, int nonterminal) const {
+            if (m_Gotos) {
+                int pos = find_comb_entry(*m_NonterminalComb, stateId, nonterminal);
+                if (pos < 0) return -1;
+                
+                return m_Gotos[pos];
+            }
+            
+            // Search for the goto action
+            action_iterator last = last_nonterminal_action(stateId);
+            for (action_iterator gotoAct = find_nonterminal(stateId, nonterminal); gotoAct != last && gotoAct->symbolId == nonterminal; ++gotoAct) {
+                if (gotoAct->type == lr_action::act_goto) {
+                    return gotoAct->nextState;
+                }
+            }
+            
+            return -1;
+        }
+        
         /// \brief Returns the nonterminal identifier representing the end of input symbol
         inline int end_of_input() const { return m_EndOfInput; }
         
         /// \brief Returns the nonterminal identifier representing the end of guard symbol
         inline int end_of_guard() const { return m_EndOfGuard; }
         
+        /// \brief Returns the automaton state that checks the guard starting at the specified parser state, or -1 if the guard is not regular
+        inline int regular_guard(int stateId) const {
+            if (!m_Guards) return -1;
+            return m_Guards->initialState[stateId];
+        }
+        
+        /// \brief Returns the guard symbol matched when the specified guard automaton state is reached, or -1 if it does not accept
+        inline int guard_accepts(int guardState) const {
+            return m_Guards->accept[guardState];
+        }
+        
+        /// \brief Returns the guard automaton state to move to when the specified terminal is matched, or -1 if there is no transition
+        ///
+        /// Weak terminals that have no transition of their own move as their strong equivalent.
+        inline int next_guard_state(int guardState, int terminal) const {
+            const int* first    = m_Guards->symbol + m_Guards->firstTransition[guardState];
+            const int* last     = m_Guards->symbol + m_Guards->firstTransition[guardState+1];
+            const int* found    = std::lower_bound(first, last, terminal);
+            
+            if (found == last || *found != terminal) {
+                int strong = strong_for_weak(terminal);
+                if (strong == terminal) return -1;
+                
+                found = std::lower_bound(first, last, strong);
+                if (found == last || *found != strong) return -1;
+            }
+            
+            return m_Guards->nextState[found - m_Guards->symbol];
+        }
+        
         /// \brief Returns true if the specified state has an end of guard symbol
         inline bool has_end_of_guard(int stateId) const {
             return std::binary_search(m_EndGuardStates, m_EndGuardStates + m_NumEndOfGuards, stateId);
@@ -208,18 +400,10 @@ namespace lr {
         
         /// \brief Finds the strong symbol that is equivalent to a given weak terminal symbol
         inline int strong_for_weak(int weakTerminal) const {
-            // If there are no symbols in the map, then just return the terminal symbol
-            if (m_NumWeakToStrong == 0) return weakTerminal;
-            
-            // Look up the symbol in the map
-            const symbol_equivalent     search  = { weakTerminal, 0 };
-            const symbol_equivalent*    found   = std::find(m_WeakToStrong, m_WeakToStrong + m_NumWeakToStrong, search);
-            if (found != m_WeakToStrong + m_NumWeakToStrong) {
-                return found->m_MappedTo;
-            }
+            // Symbols outside of the table are not weak (this includes every symbol if there are no weak symbols)
+            if (weakTerminal < 0 || weakTerminal >= m_NumStrongForWeak) return weakTerminal;
             
-            // Nothing was found
-            return weakTerminal;
+            return m_StrongForWeak[weakTerminal];
         }
 
     public:
@@ -268,6 +452,18 @@ namespace lr {
 
         /// \brief The weak-to-strong equivalence table (ordered, count_weak_to_strong entries)
         inline const symbol_equivalent* weak_to_strong() const { return m_WeakToStrong; }
+        
+        /// \brief The comb table for the terminal actions (NULL if there isn't one)
+        inline const comb_table* terminal_comb() const { return m_TerminalComb; }
+        
+        /// \brief The comb table for the nonterminal actions (NULL if there isn't one)
+        inline const comb_table* nonterminal_comb() const { return m_NonterminalComb; }
+        
+        /// \brief The goto state for each entry in the nonterminal comb table, or -1 if the entry has no goto (NULL if there is no nonterminal comb table)
+        inline const int* gotos() const { return m_Gotos; }
+        
+        /// \brief The automata for the regular guards (NULL if there aren't any)
+        inline const guard_table* guards() const { return m_Guards; }
     };
 }
 
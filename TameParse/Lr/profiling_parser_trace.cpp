@@ -0,0 +1,272 @@
+//
+//  profiling_parser_trace.cpp
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include <algorithm>
+#include <ctime>
+
+#include "TameParse/Lr/profiling_parser_trace.h"
+
+#if __cplusplus >= 201103L
+#include <chrono>
+#endif
+
+using namespace std;
+using namespace lr;
+
+/// \brief Creates an empty set of counters
+parser_profile::guard_counters::guard_counters()
+: checks(0)
+, runs(0)
+, matches(0)
+, totalLookahead(0)
+, maxLookahead(0)
+, seconds(0) {
+}
+
+/// \brief Creates an empty profile
+parser_profile::parser_profile()
+: m_Ignored(0)
+, m_Rejected(0)
+, m_CanReduceChecks(0)
+, m_CanReduceSucceeded(0)
+, m_MaxBufferedLookahead(0) {
+}
+
+/// \brief Discards all of the counters in this profile
+void parser_profile::clear() {
+    m_Shifts.clear();
+    m_RuleReductions.clear();
+    m_NonterminalReductions.clear();
+    m_Guards.clear();
+    
+    m_Ignored               = 0;
+    m_Rejected              = 0;
+    m_CanReduceChecks       = 0;
+    m_CanReduceSucceeded    = 0;
+    m_MaxBufferedLookahead  = 0;
+}
+
+/// \brief Increases the counter at the specified index, making space for it if necessary
+static inline void increment(parser_profile::counter_list& counters, int index, long amount) {
+    if (index < 0) return;
+    if (index >= (int) counters.size()) {
+        counters.resize(index + 1, 0);
+    }
+    counters[index] += amount;
+}
+
+/// \brief Adds one list of counters to another
+static void add_counters(parser_profile::counter_list& target, const parser_profile::counter_list& source) {
+    for (int index = 0; index < (int) source.size(); ++index) {
+        if (source[index] != 0) {
+            increment(target, index, source[index]);
+        }
+    }
+}
+
+/// \brief Adds the counters from another profile to this one
+void parser_profile::merge(const parser_profile& profile) {
+    add_counters(m_Shifts, profile.m_Shifts);
+    add_counters(m_RuleReductions, profile.m_RuleReductions);
+    add_counters(m_NonterminalReductions, profile.m_NonterminalReductions);
+    
+    for (guard_map::const_iterator guard = profile.m_Guards.begin(); guard != profile.m_Guards.end(); ++guard) {
+        guard_counters& target = m_Guards[guard->first];
+        
+        target.checks           += guard->second.checks;
+        target.runs             += guard->second.runs;
+        target.matches          += guard->second.matches;
+        target.totalLookahead   += guard->second.totalLookahead;
+        target.seconds          += guard->second.seconds;
+        target.maxLookahead     = max(target.maxLookahead, guard->second.maxLookahead);
+    }
+    
+    m_Ignored               += profile.m_Ignored;
+    m_Rejected              += profile.m_Rejected;
+    m_CanReduceChecks       += profile.m_CanReduceChecks;
+    m_CanReduceSucceeded    += profile.m_CanReduceSucceeded;
+    m_MaxBufferedLookahead  = max(m_MaxBufferedLookahead, profile.m_MaxBufferedLookahead);
+}
+
+/// \brief Records a shift into the specified state
+void parser_profile::record_shift(int newState) {
+    increment(m_Shifts, newState, 1);
+}
+
+/// \brief Records a reduction of the specified rule
+void parser_profile::record_reduce(int nonterminalId, int ruleId) {
+    increment(m_RuleReductions, ruleId, 1);
+    increment(m_NonterminalReductions, nonterminalId, 1);
+}
+
+/// \brief Records a check of a guard
+void parser_profile::record_guard(int initialState, bool matched, int lookahead, double seconds) {
+    guard_counters& guard = m_Guards[initialState];
+    
+    ++guard.checks;
+    if (matched) ++guard.matches;
+    guard.totalLookahead    += lookahead;
+    guard.maxLookahead      = max(guard.maxLookahead, lookahead);
+    guard.seconds           += seconds;
+}
+
+/// \brief Records that a guard was run, rather than using the result of an earlier check
+void parser_profile::record_guard_run(int initialState) {
+    ++m_Guards[initialState].runs;
+}
+
+/// \brief Records a can_reduce check
+void parser_profile::record_can_reduce(bool result) {
+    ++m_CanReduceChecks;
+    if (result) ++m_CanReduceSucceeded;
+}
+
+/// \brief Records the number of symbols in the lookahead buffer
+void parser_profile::record_buffered_lookahead(int bufferedSymbols) {
+    if (bufferedSymbols > m_MaxBufferedLookahead) {
+        m_MaxBufferedLookahead = bufferedSymbols;
+    }
+}
+
+/// \brief Adds up a list of counters
+static long total(const parser_profile::counter_list& counters) {
+    long result = 0;
+    for (parser_profile::counter_list::const_iterator count = counters.begin(); count != counters.end(); ++count) {
+        result += *count;
+    }
+    return result;
+}
+
+/// \brief The total number of shift actions
+long parser_profile::total_shifts() const {
+    return total(m_Shifts);
+}
+
+/// \brief The total number of reduce actions
+long parser_profile::total_reductions() const {
+    return total(m_RuleReductions);
+}
+
+/// \brief Orders (count, identifier) pairs so that the largest count comes first
+static bool most_frequent_first(const pair<long, int>& a, const pair<long, int>& b) {
+    if (a.first > b.first) return true;
+    if (a.first < b.first) return false;
+    return a.second < b.second;
+}
+
+/// \brief The most frequently used entries in a list of counters
+parser_profile::ranking parser_profile::most_frequent(const counter_list& counters, int maxEntries) {
+    // Sort the entries that were used
+    ranking used;
+    for (int index = 0; index < (int) counters.size(); ++index) {
+        if (counters[index] != 0) {
+            used.push_back(pair<long, int>(counters[index], index));
+        }
+    }
+    sort(used.begin(), used.end(), most_frequent_first);
+    
+    if (maxEntries > 0 && (int) used.size() > maxEntries) {
+        used.resize(maxEntries);
+    }
+    
+    return used;
+}
+
+/// \brief Writes out the most frequently used entries in a list of counters
+static void write_counters(wostream& out, const wchar_t* title, const wchar_t* name, const parser_profile::counter_list& counters, int maxEntries) {
+    parser_profile::ranking used = parser_profile::most_frequent(counters, maxEntries);
+    
+    out << title << endl;
+    for (parser_profile::ranking::const_iterator entry = used.begin(); entry != used.end(); ++entry) {
+        out << L"  " << entry->first << L"\t" << name << L" " << entry->second << endl;
+    }
+}
+
+/// \brief Writes the totals and the guard counters in this profile to the specified stream
+void parser_profile::write_summary(wostream& out) const {
+    out << L"Shifts: " << total_shifts() << endl;
+    out << L"Reductions: " << total_reductions() << endl;
+    out << L"Ignored symbols: " << m_Ignored << endl;
+    out << L"Rejected symbols: " << m_Rejected << endl;
+    out << L"can_reduce checks: " << m_CanReduceChecks << L" (" << m_CanReduceSucceeded << L" succeeded)" << endl;
+    out << L"Lookahead buffer high-water mark: " << m_MaxBufferedLookahead << endl;
+    
+    if (!m_Guards.empty()) {
+        out << endl << L"Guards:" << endl;
+        for (guard_map::const_iterator guard = m_Guards.begin(); guard != m_Guards.end(); ++guard) {
+            out << L"  state " << guard->first
+                << L": " << guard->second.checks << L" checks, "
+                << guard->second.runs << L" runs, "
+                << guard->second.matches << L" matched, "
+                << guard->second.seconds * 1000.0 << L"ms, "
+                << L"lookahead max " << guard->second.maxLookahead
+                << L" total " << guard->second.totalLookahead << endl;
+        }
+    }
+}
+
+/// \brief Writes a summary of this profile to the specified stream
+void parser_profile::write_report(wostream& out, int maxEntries) const {
+    write_summary(out);
+    
+    out << endl;
+    write_counters(out, L"Shifts by state:", L"state", m_Shifts, maxEntries);
+    
+    out << endl;
+    write_counters(out, L"Reductions by rule:", L"rule", m_RuleReductions, maxEntries);
+}
+
+/// \brief Returns the current time in seconds, as accurately as possible
+static double current_time() {
+#if __cplusplus >= 201103L
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/// \brief Creates a new profiling trace
+profiling_parser_trace::profiling_parser_trace()
+: m_GuardState(-1)
+, m_GuardLookahead(0)
+, m_GuardStartTime(0) {
+}
+
+/// \brief A guard is about to be checked
+void profiling_parser_trace::begin_guard(int initialState) {
+    m_GuardState        = initialState;
+    m_GuardLookahead    = 0;
+    m_GuardStartTime    = current_time();
+}
+
+/// \brief A guard has been checked
+void profiling_parser_trace::checked_guard(int initialState, int result) {
+    double elapsed = current_time() - m_GuardStartTime;
+    
+    m_Profile.record_guard(initialState, result >= 0, m_GuardLookahead, elapsed);
+    m_GuardState = -1;
+}
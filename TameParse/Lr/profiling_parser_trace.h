@@ -0,0 +1,258 @@
+//
+//  profiling_parser_trace.h
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef _LR_PROFILING_PARSER_TRACE_H
+#define _LR_PROFILING_PARSER_TRACE_H
+
+#include <map>
+#include <vector>
+#include <utility>
+#include <iostream>
+
+#include "TameParse/Lr/parser.h"
+
+namespace lr {
+    ///
+    /// \brief Counters collected while a parser is running
+    ///
+    /// States, rules and nonterminals are identified by the identifiers used in the parser tables (for nonterminals,
+    /// this is the identifier of their item in the grammar). Use
+    /// language::formatter to produce a report with the names of the rules and nonterminals instead.
+    ///
+    class parser_profile {
+    public:
+        /// \brief Counters for a single guard (identified by the initial state of its parser)
+        struct guard_counters {
+            /// \brief Creates an empty set of counters
+            guard_counters();
+            
+            /// \brief The number of times this guard was checked
+            long checks;
+            
+            /// \brief The number of times the guard had to be run (the other checks re-used an earlier result)
+            ///
+            /// This also counts guards that were run while checking another guard.
+            long runs;
+            
+            /// \brief The number of checks where the guard matched
+            long matches;
+            
+            /// \brief The total number of symbols of lookahead examined by all of the checks
+            long totalLookahead;
+            
+            /// \brief The most symbols of lookahead examined by a single check
+            int maxLookahead;
+            
+            /// \brief The total time spent checking this guard, in seconds
+            double seconds;
+        };
+        
+        /// \brief List of counters, indexed by a state, rule or nonterminal identifier
+        typedef std::vector<long> counter_list;
+        
+        /// \brief Maps the initial state of a guard to its counters
+        typedef std::map<int, guard_counters> guard_map;
+        
+        /// \brief List of (count, identifier) pairs, most frequent first
+        typedef std::vector<std::pair<long, int> > ranking;
+        
+    private:
+        /// \brief The number of shift actions that moved into each state
+        counter_list m_Shifts;
+        
+        /// \brief The number of times each rule was reduced
+        counter_list m_RuleReductions;
+        
+        /// \brief The number of times each nonterminal was reduced, indexed by item identifier
+        counter_list m_NonterminalReductions;
+        
+        /// \brief The counters for each guard
+        guard_map m_Guards;
+        
+        /// \brief The number of symbols that were ignored
+        long m_Ignored;
+        
+        /// \brief The number of symbols that were rejected
+        long m_Rejected;
+        
+        /// \brief The number of times can_reduce was used to check a weak reduction or a guard
+        long m_CanReduceChecks;
+        
+        /// \brief The number of can_reduce checks that succeeded
+        long m_CanReduceSucceeded;
+        
+        /// \brief The most symbols that were held in the lookahead buffer at once
+        int m_MaxBufferedLookahead;
+        
+    public:
+        /// \brief Creates an empty profile
+        parser_profile();
+        
+        /// \brief Discards all of the counters in this profile
+        void clear();
+        
+        /// \brief Adds the counters from another profile to this one
+        void merge(const parser_profile& profile);
+        
+    public:
+        /// \brief Records a shift into the specified state
+        void record_shift(int newState);
+        
+        /// \brief Records a reduction of the specified rule
+        void record_reduce(int nonterminalId, int ruleId);
+        
+        /// \brief Records a check of a guard
+        void record_guard(int initialState, bool matched, int lookahead, double seconds);
+        
+        /// \brief Records that a guard was run, rather than using the result of an earlier check
+        void record_guard_run(int initialState);
+        
+        /// \brief Records a can_reduce check
+        void record_can_reduce(bool result);
+        
+        /// \brief Records the number of symbols in the lookahead buffer
+        void record_buffered_lookahead(int bufferedSymbols);
+        
+        /// \brief Records an ignored symbol
+        inline void record_ignore() { ++m_Ignored; }
+        
+        /// \brief Records a rejected symbol
+        inline void record_reject() { ++m_Rejected; }
+        
+    public:
+        /// \brief The number of shifts into each state
+        inline const counter_list& shifts() const { return m_Shifts; }
+        
+        /// \brief The number of reductions of each rule
+        inline const counter_list& rule_reductions() const { return m_RuleReductions; }
+        
+        /// \brief The number of reductions of each nonterminal
+        inline const counter_list& nonterminal_reductions() const { return m_NonterminalReductions; }
+        
+        /// \brief The counters for each guard that was checked
+        inline const guard_map& guards() const { return m_Guards; }
+        
+        /// \brief The number of shifts into the specified state
+        inline long shifts(int state) const { return state >= 0 && state < (int) m_Shifts.size() ? m_Shifts[state] : 0; }
+        
+        /// \brief The number of reductions of the specified rule
+        inline long rule_reductions(int ruleId) const { return ruleId >= 0 && ruleId < (int) m_RuleReductions.size() ? m_RuleReductions[ruleId] : 0; }
+        
+        /// \brief The number of reductions of the nonterminal with the specified item identifier
+        inline long nonterminal_reductions(int nonterminalId) const { return nonterminalId >= 0 && nonterminalId < (int) m_NonterminalReductions.size() ? m_NonterminalReductions[nonterminalId] : 0; }
+        
+        /// \brief The total number of shift actions
+        long total_shifts() const;
+        
+        /// \brief The total number of reduce actions
+        long total_reductions() const;
+        
+        /// \brief The number of symbols that were ignored
+        inline long ignored() const { return m_Ignored; }
+        
+        /// \brief The number of symbols that were rejected
+        inline long rejected() const { return m_Rejected; }
+        
+        /// \brief The number of times can_reduce was used to check a weak reduction or a guard
+        inline long can_reduce_checks() const { return m_CanReduceChecks; }
+        
+        /// \brief The number of can_reduce checks that succeeded
+        inline long can_reduce_succeeded() const { return m_CanReduceSucceeded; }
+        
+        /// \brief The most symbols that were held in the lookahead buffer at once
+        inline int max_buffered_lookahead() const { return m_MaxBufferedLookahead; }
+        
+    public:
+        /// \brief Returns the maxEntries most frequently used entries in a list of counters (or all of them if maxEntries is 0)
+        static ranking most_frequent(const counter_list& counters, int maxEntries);
+        
+        /// \brief Writes the totals and the guard counters in this profile to the specified stream
+        void write_summary(std::wostream& out) const;
+        
+        ///
+        /// \brief Writes a summary of this profile to the specified stream
+        ///
+        /// States, rules and nonterminals are written as numbers. Only the maxEntries most frequently used rules and
+        /// states are listed (or all of them if maxEntries is 0).
+        ///
+        void write_report(std::wostream& out, int maxEntries = 20) const;
+    };
+    
+    ///
+    /// \brief Parser trace class that counts the actions performed by the parser
+    ///
+    /// Use this as the parser_trace type of a parser, then fetch the counters with state::get_trace().profile()
+    /// once parsing has finished. Guard checks are timed, so this trace makes the parser noticeably slower: the
+    /// counts are more useful than the absolute timings.
+    ///
+    class profiling_parser_trace : public no_parser_trace {
+    private:
+        /// \brief The counters collected so far
+        parser_profile m_Profile;
+        
+        /// \brief The guard that is currently being checked, or -1
+        int m_GuardState;
+        
+        /// \brief The furthest offset into the lookahead reached by the current guard
+        int m_GuardLookahead;
+        
+        /// \brief The time the current guard check started
+        double m_GuardStartTime;
+        
+    public:
+        /// \brief Creates a new profiling trace
+        profiling_parser_trace();
+        
+    public:
+        /// \brief The counters collected so far
+        inline const parser_profile& profile() const { return m_Profile; }
+        
+        /// \brief The counters collected so far
+        inline parser_profile& profile() { return m_Profile; }
+        
+    public:
+        inline void ignore(const lexeme_container& lookahead)               { m_Profile.record_ignore(); }
+        inline void shift(const lexeme_container& lookahead, int newState)  { m_Profile.record_shift(newState); }
+        inline void reduce(int nonterminalId, int ruleId, int length)       { m_Profile.record_reduce(nonterminalId, ruleId); }
+        inline void checked_reduce(bool result)                             { m_Profile.record_can_reduce(result); }
+        inline void read_lookahead(int bufferedSymbols)                     { m_Profile.record_buffered_lookahead(bufferedSymbols); }
+        inline void reject(const lexeme_container& lookahead)               { m_Profile.record_reject(); }
+        
+        inline void looked_ahead(int offset) {
+            if (m_GuardState >= 0 && offset + 1 > m_GuardLookahead) {
+                m_GuardLookahead = offset + 1;
+            }
+        }
+        
+        void begin_guard(int initialState);
+        void checked_guard(int initialState, int result);
+        
+        inline void ran_guard(int initialState)                             { m_Profile.record_guard_run(initialState); }
+    };
+}
+
+#endif
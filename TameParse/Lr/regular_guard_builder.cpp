@@ -0,0 +1,252 @@
+//
+//  regular_guard_builder.cpp
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include <map>
+#include <algorithm>
+
+#include "TameParse/Lr/regular_guard_builder.h"
+#include "TameParse/ContextFree/ebnf_items.h"
+#include "TameParse/Dfa/epsilon.h"
+
+using namespace std;
+using namespace dfa;
+using namespace contextfree;
+using namespace lr;
+
+/// \brief The largest number of NDFA states that a single guard can compile to
+///
+/// Nonterminals are expanded inline, so a guard that uses them heavily can become very large. These are left to the
+/// parser.
+static const int s_MaxStatesPerGuard = 1024;
+
+/// \brief Creates a builder for the guards in the specified grammar
+regular_guard_builder::regular_guard_builder(const grammar& gram)
+: m_Grammar(gram)
+, m_MaxState(0) {
+}
+
+/// \brief Adds a new NDFA state, or returns -1 if the guard being compiled has become too large
+int regular_guard_builder::add_state() {
+    if (m_Ndfa.count_states() >= m_MaxState) return -1;
+    return m_Ndfa.add_state();
+}
+
+/// \brief Adds the guard with the specified rule, returning false if it is not regular
+bool regular_guard_builder::add_guard(const rule& guardRule, int guardSymbol, int parserState) {
+    // Create the states for this guard (if the guard isn't regular, these are left unreachable)
+    m_MaxState = m_Ndfa.count_states() + s_MaxStatesPerGuard;
+    
+    int initialState    = add_state();
+    int finalState      = add_state();
+    
+    // Compile the rule
+    vector<int> expanding;
+    if (!compile_rule(guardRule, initialState, finalState, expanding)) {
+        return false;
+    }
+    
+    // The final state accepts the guard symbol
+    m_Ndfa.accept(finalState, accept_action(guardSymbol));
+    
+    m_InitialStates.push_back(initialState);
+    m_ParserStates.push_back(parserState);
+    return true;
+}
+
+/// \brief Compiles a rule so that it moves from one NDFA state to another
+bool regular_guard_builder::compile_rule(const rule& thisRule, int from, int to, vector<int>& expanding) {
+    // Empty rules are just an epsilon transition
+    if (thisRule.items().empty()) {
+        m_Ndfa.add_transition(from, epsilon(), to);
+        return true;
+    }
+    
+    // Compile each item in turn
+    int current = from;
+    for (rule::iterator nextItem = thisRule.begin(); nextItem != thisRule.end(); ++nextItem) {
+        // The last item moves to the final state
+        int next = to;
+        if (nextItem + 1 != thisRule.end()) {
+            next = add_state();
+            if (next < 0) return false;
+        }
+        
+        if (!compile_item(*nextItem, current, next, expanding)) {
+            return false;
+        }
+        
+        current = next;
+    }
+    
+    return true;
+}
+
+/// \brief Compiles an item so that it moves from one NDFA state to another
+bool regular_guard_builder::compile_item(const item_container& item, int from, int to, vector<int>& expanding) {
+    switch (item->type()) {
+        case item::terminal:
+            m_Ndfa.add_transition(from, symbol_set(range<int>(item->symbol(), item->symbol()+1)), to);
+            return true;
+            
+        case item::empty:
+            m_Ndfa.add_transition(from, epsilon(), to);
+            return true;
+            
+        case item::nonterminal:
+        {
+            // Recursive nonterminals may not be regular
+            int nonterminal = item->symbol();
+            if (find(expanding.begin(), expanding.end(), nonterminal) != expanding.end()) {
+                return false;
+            }
+            
+            // Compile each of the rules for this nonterminal
+            const rule_list& rules = m_Grammar.rules_for_nonterminal(nonterminal);
+            
+            expanding.push_back(nonterminal);
+            for (rule_list::const_iterator nextRule = rules.begin(); nextRule != rules.end(); ++nextRule) {
+                if (!compile_rule(**nextRule, from, to, expanding)) {
+                    return false;
+                }
+            }
+            expanding.pop_back();
+            
+            return true;
+        }
+            
+        case item::optional:
+        case item::alternative:
+        {
+            // Optional items can also be skipped
+            if (item->type() == item::optional) {
+                m_Ndfa.add_transition(from, epsilon(), to);
+            }
+            
+            // Compile each of the alternatives
+            const ebnf* ebnfItem = item->cast_ebnf();
+            for (ebnf::rule_iterator nextRule = ebnfItem->first_rule(); nextRule != ebnfItem->last_rule(); ++nextRule) {
+                if (!compile_rule(**nextRule, from, to, expanding)) {
+                    return false;
+                }
+            }
+            
+            return true;
+        }
+            
+        case item::repeat:
+        case item::repeat_zero_or_one:
+        {
+            // Use separate states for the loop, so it can't be entered by moving backwards
+            int loopStart   = add_state();
+            int loopEnd     = add_state();
+            if (loopStart < 0 || loopEnd < 0) return false;
+            
+            m_Ndfa.add_transition(from, epsilon(), loopStart);
+            if (!compile_rule(*item->cast_ebnf()->get_rule(), loopStart, loopEnd, expanding)) {
+                return false;
+            }
+            m_Ndfa.add_transition(loopEnd, epsilon(), loopStart);
+            m_Ndfa.add_transition(loopEnd, epsilon(), to);
+            
+            // Zero repetitions are allowed for the '*' closure
+            if (item->type() == item::repeat_zero_or_one) {
+                m_Ndfa.add_transition(from, epsilon(), to);
+            }
+            
+            return true;
+        }
+            
+        default:
+            // Other items (such as guards within guards) are left to the parser
+            return false;
+    }
+}
+
+/// \brief Creates a guard table for a parser with the specified number of states (NULL if no guards were added)
+parser_tables::guard_table* regular_guard_builder::build(int numStates) const {
+    if (m_InitialStates.empty()) return NULL;
+    
+    // Convert to a DFA (initial state n of the DFA corresponds to guard n)
+    ndfa* unique    = m_Ndfa.to_ndfa_with_unique_symbols();
+    ndfa* guardDfa  = unique->to_dfa(m_InitialStates);
+    delete unique;
+    
+    // Create the table
+    parser_tables::guard_table* result = new parser_tables::guard_table;
+    
+    result->numStates       = guardDfa->count_states();
+    result->initialState    = new int[numStates];
+    result->accept          = new int[result->numStates];
+    result->firstTransition = new int[result->numStates+1];
+    
+    for (int stateId = 0; stateId < numStates; ++stateId) {
+        result->initialState[stateId] = -1;
+    }
+    for (int guardId = 0; guardId < (int) m_ParserStates.size(); ++guardId) {
+        result->initialState[m_ParserStates[guardId]] = guardId;
+    }
+    
+    // Fill in the accepting symbol and transitions for each state
+    vector<int> symbols;
+    vector<int> nextStates;
+    
+    for (int stateId = 0; stateId < result->numStates; ++stateId) {
+        // Accepting states (every action for a DFA state is for the same guard)
+        const ndfa::accept_action_list& actions = guardDfa->actions_for_state(stateId);
+        result->accept[stateId] = actions.empty() ? -1 : actions[0]->symbol();
+        
+        // Transitions, ordered by terminal
+        map<int, int>   transitions;
+        const state&    thisState = guardDfa->get_state(stateId);
+        
+        for (state::iterator trans = thisState.begin(); trans != thisState.end(); ++trans) {
+            const symbol_set& terminals = guardDfa->symbols()[trans->symbol_set()];
+            
+            for (symbol_set::iterator terminalRange = terminals.begin(); terminalRange != terminals.end(); ++terminalRange) {
+                for (int terminal = terminalRange->lower(); terminal < terminalRange->upper(); ++terminal) {
+                    transitions[terminal] = trans->new_state();
+                }
+            }
+        }
+        
+        result->firstTransition[stateId] = (int) symbols.size();
+        for (map<int, int>::iterator trans = transitions.begin(); trans != transitions.end(); ++trans) {
+            symbols.push_back(trans->first);
+            nextStates.push_back(trans->second);
+        }
+    }
+    
+    result->firstTransition[result->numStates] = (int) symbols.size();
+    
+    result->symbol      = new int[symbols.size()];
+    result->nextState   = new int[nextStates.size()];
+    copy(symbols.begin(), symbols.end(), result->symbol);
+    copy(nextStates.begin(), nextStates.end(), result->nextState);
+    
+    delete guardDfa;
+    return result;
+}
@@ -0,0 +1,99 @@
+//
+//  regular_guard_builder.h
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef _LR_REGULAR_GUARD_BUILDER_H
+#define _LR_REGULAR_GUARD_BUILDER_H
+
+#include <vector>
+
+#include "TameParse/ContextFree/grammar.h"
+#include "TameParse/Dfa/ndfa.h"
+#include "TameParse/Lr/parser_tables.h"
+
+namespace lr {
+    ///
+    /// \brief Class that compiles guards whose language is regular over the terminal symbols into a DFA
+    ///
+    /// Guards are normally matched by running the parser from the guard's initial state. Many guards are much simpler
+    /// than this requires: they match a fixed sequence of terminals, or a repetition of one. These guards can be
+    /// matched by stepping a DFA over the lookahead instead.
+    ///
+    /// A guard is compiled if its rule only contains terminals, EBNF items and nonterminals that are not recursive.
+    ///
+    class regular_guard_builder {
+    private:
+        /// \brief The grammar that the guards are from
+        const contextfree::grammar& m_Grammar;
+        
+        /// \brief The NDFA that the guards are compiled into
+        dfa::ndfa m_Ndfa;
+        
+        /// \brief The initial NDFA state for each guard that has been added
+        std::vector<int> m_InitialStates;
+        
+        /// \brief The parser state that each guard starts at
+        std::vector<int> m_ParserStates;
+        
+        /// \brief The last NDFA state that belongs to the guard currently being compiled
+        int m_MaxState;
+        
+    private:
+        regular_guard_builder(const regular_guard_builder& noCopying);
+        regular_guard_builder& operator=(const regular_guard_builder& noCopying);
+        
+        /// \brief Compiles a rule so that it moves from one NDFA state to another
+        ///
+        /// expanding is the list of nonterminals that are currently being compiled. Returns false if the rule is not regular.
+        bool compile_rule(const contextfree::rule& thisRule, int from, int to, std::vector<int>& expanding);
+        
+        /// \brief Compiles an item so that it moves from one NDFA state to another
+        bool compile_item(const contextfree::item_container& item, int from, int to, std::vector<int>& expanding);
+        
+        /// \brief Adds a new NDFA state, or returns -1 if the guard being compiled has become too large
+        int add_state();
+        
+    public:
+        /// \brief Creates a builder for the guards in the specified grammar
+        explicit regular_guard_builder(const contextfree::grammar& gram);
+        
+        /// \brief Adds the guard with the specified rule, returning false if it is not regular
+        ///
+        /// guardSymbol is the symbol reported when the guard is matched, and parserState is the initial state of the
+        /// guard in the parser.
+        bool add_guard(const contextfree::rule& guardRule, int guardSymbol, int parserState);
+        
+        /// \brief The number of guards that have been added to this object
+        inline int count_guards() const { return (int) m_InitialStates.size(); }
+        
+        /// \brief Creates a guard table for a parser with the specified number of states (NULL if no guards were added)
+        ///
+        /// The table and its arrays are allocated with new and should be freed by the caller.
+        parser_tables::guard_table* build(int numStates) const;
+    };
+}
+
+#endif
@@ -0,0 +1,56 @@
+//
+//  segmented_parser.cpp
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include "TameParse/Lr/segmented_parser.h"
+
+using namespace dfa;
+using namespace lr;
+
+/// \brief Creates a stream that returns the lexemes in the range [first, end) (and takes ownership of them)
+lexeme_segment_stream::lexeme_segment_stream(lexeme* const* first, lexeme* const* end)
+: m_Lexemes(first, end)
+, m_Next(0) {
+}
+
+/// \brief Deletes any lexemes that were not read
+lexeme_segment_stream::~lexeme_segment_stream() {
+    for (size_t lexemeId = m_Next; lexemeId < m_Lexemes.size(); ++lexemeId) {
+        delete m_Lexemes[lexemeId];
+    }
+}
+
+/// \brief Fills in the contents of the specified pointer with the next lexeme (or NULL if the end of the segment has been reached)
+lexeme_stream& lexeme_segment_stream::operator>>(lexeme*& result) {
+    if (m_Next < m_Lexemes.size()) {
+        // The reader becomes responsible for deleting the lexeme
+        result = m_Lexemes[m_Next++];
+    } else {
+        result = NULL;
+    }
+    
+    return *this;
+}
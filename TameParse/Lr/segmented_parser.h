@@ -0,0 +1,257 @@
+//
+//  segmented_parser.h
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef _LR_SEGMENTED_PARSER_H
+#define _LR_SEGMENTED_PARSER_H
+
+#include <vector>
+
+#include "TameParse/Dfa/lexer.h"
+#include "TameParse/Lr/lr_action.h"
+#include "TameParse/Lr/parser.h"
+#include "TameParse/Lr/batch_parser.h"
+
+namespace lr {
+    ///
+    /// \brief Lexeme stream that returns the lexemes from one segment of a larger input
+    ///
+    /// The stream owns the lexemes in its range: each one is handed over to the reader as it is read, and any that
+    /// are never read are deleted along with the stream.
+    ///
+    class lexeme_segment_stream : public dfa::lexeme_stream {
+    private:
+        /// \brief The lexemes in this segment
+        std::vector<dfa::lexeme*> m_Lexemes;
+        
+        /// \brief The index of the next lexeme to return
+        size_t m_Next;
+        
+    public:
+        /// \brief Creates a stream that returns the lexemes in the range [first, end) (and takes ownership of them)
+        lexeme_segment_stream(dfa::lexeme* const* first, dfa::lexeme* const* end);
+        
+        /// \brief Deletes any lexemes that were not read
+        virtual ~lexeme_segment_stream();
+        
+        /// \brief Fills in the contents of the specified pointer with the next lexeme (or NULL if the end of the segment has been reached)
+        virtual dfa::lexeme_stream& operator>>(dfa::lexeme*& result);
+    };
+    
+    ///
+    /// \brief Creates actions that take ownership of the stream that they read from
+    ///
+    /// This is the default way segmented_parse creates actions, and works with any actions class with a
+    /// constructor that takes a lexeme stream that it will delete.
+    ///
+    template<typename actions> actions* create_owning_actions(dfa::lexeme_stream* stream) {
+        return new actions(stream);
+    }
+    
+    ///
+    /// \brief Batch handler that parses the segments of a single input that are separated by a synchronising terminal
+    ///
+    /// This is useful for inputs that are a long series of independent items (statements in a script, records in a
+    /// file of JSON lines and so on). The whole input is read from the lexer, and split into segments wherever the
+    /// synchronising terminal appears. The segments can then be parsed independently (and concurrently) by a parser
+    /// that starts in the state for a start symbol that matches a single item. Segments that are empty, or that only
+    /// contain symbols that the parser ignores, are skipped.
+    ///
+    /// The synchronising terminal is either dropped (when it separates items) or kept as the last lexeme of the
+    /// segment it ends (when it terminates items, as a semicolon does at the end of a statement).
+    ///
+    /// Only terminals can be used to synchronise. Working out where a nonterminal begins means parsing everything
+    /// before it, which would leave nothing to do concurrently. For a language whose items are nonterminals, use
+    /// a terminal that ends each item and can't appear anywhere inside one.
+    ///
+    template<typename parser_type> class segmented_parse {
+    public:
+        /// \brief The parser state type
+        typedef typename parser_type::state state;
+        
+        /// \brief The parser actions type
+        typedef typename parser_type::actions_type actions;
+        
+        /// \brief The type of the item produced for each segment
+        typedef typename parser_type::stack_item item;
+        
+        /// \brief Function that creates the actions for a segment (the actions should delete the stream)
+        typedef actions* (*actions_factory)(dfa::lexeme_stream* segment);
+        
+    private:
+        /// \brief The lexemes from the input, which are owned by this object until the segment they're in is parsed
+        std::vector<dfa::lexeme*> m_Lexemes;
+        
+        /// \brief The index in m_Lexemes of the start of each segment, followed by the end of the last segment
+        std::vector<int> m_SegmentStart;
+        
+        /// \brief Creates the actions for each segment
+        actions_factory m_CreateActions;
+        
+        /// \brief The item produced for each segment
+        std::vector<item> m_Items;
+        
+        /// \brief Non-zero for the segments that were accepted
+        std::vector<char> m_Accepted;
+        
+    private:
+        segmented_parse(const segmented_parse& noCopying);
+        segmented_parse& operator=(const segmented_parse& noCopying);
+        
+    public:
+        /// \brief Reads an input stream and splits it up into segments that will be parsed from the specified initial state
+        segmented_parse(const parser_tables& tables, int initialState, dfa::lexeme_stream& input, int syncTerminal, bool syncEndsSegment = false, actions_factory createActions = create_owning_actions<actions>)
+        : m_CreateActions(createActions) {
+            dfa::lexeme*    next        = NULL;
+            bool            hasContent  = false;
+            
+            m_SegmentStart.push_back(0);
+            for (input >> next; next != NULL; input >> next) {
+                int terminal = next->matched();
+                
+                if (terminal != syncTerminal) {
+                    m_Lexemes.push_back(next);
+                    
+                    // Segments only containing ignored symbols are treated as empty
+                    if (!hasContent) {
+                        parser_tables::action_iterator act = tables.find_terminal(initialState, terminal);
+                        if (act == tables.last_terminal_action(initialState) || act->symbolId != terminal || act->type != lr_action::act_ignore) {
+                            hasContent = true;
+                        }
+                    }
+                    continue;
+                }
+                
+                // Reached the end of a segment
+                if (syncEndsSegment) {
+                    m_Lexemes.push_back(next);
+                    hasContent = true;
+                } else {
+                    delete next;
+                }
+                
+                end_segment(hasContent);
+                hasContent = false;
+            }
+            
+            // Finish the last segment
+            end_segment(hasContent);
+            
+            m_Items.resize(size());
+            m_Accepted.resize(size(), 0);
+        }
+        
+    private:
+        /// \brief Finishes the segment that's being read, discarding it if it has no content
+        void end_segment(bool hasContent) {
+            int start = m_SegmentStart.back();
+            
+            if (hasContent) {
+                m_SegmentStart.push_back((int) m_Lexemes.size());
+            } else {
+                for (int lexemeId = start; lexemeId < (int) m_Lexemes.size(); ++lexemeId) {
+                    delete m_Lexemes[lexemeId];
+                }
+                m_Lexemes.resize(start);
+            }
+        }
+        
+    public:
+        /// \brief Deletes any lexemes that haven't been parsed
+        ~segmented_parse() {
+            // Segments that were parsed have already been cleared
+            for (std::vector<dfa::lexeme*>::iterator lexeme = m_Lexemes.begin(); lexeme != m_Lexemes.end(); ++lexeme) {
+                delete *lexeme;
+            }
+        }
+        
+        /// \brief The number of segments in the input
+        inline int size() const { return (int) m_SegmentStart.size() - 1; }
+        
+        /// \brief The number of lexemes in the specified segment
+        inline int segment_length(int segment) const { return m_SegmentStart[segment+1] - m_SegmentStart[segment]; }
+        
+        /// \brief True if the specified segment was accepted by the parser
+        inline bool accepted(int segment) const { return m_Accepted[segment] != 0; }
+        
+        /// \brief The item produced by the parser for the specified segment
+        inline const item& get_item(int segment) const { return m_Items[segment]; }
+        
+        /// \brief Creates the actions that will parse a segment
+        ///
+        /// The lexemes in the segment are handed over to its stream.
+        actions* begin_document(int segment) {
+            dfa::lexeme** first = &m_Lexemes[m_SegmentStart[segment]];
+            dfa::lexeme** end   = first + segment_length(segment);
+            
+            lexeme_segment_stream* stream = new lexeme_segment_stream(first, end);
+            
+            // The lexemes now belong to the stream
+            for (dfa::lexeme** lexeme = first; lexeme != end; ++lexeme) {
+                *lexeme = NULL;
+            }
+            
+            return m_CreateActions(stream);
+        }
+        
+        /// \brief Records the result of parsing a segment
+        void end_document(int segment, state& finalState, bool accepted) {
+            m_Accepted[segment] = accepted ? 1 : 0;
+            if (accepted) m_Items[segment] = finalState.get_item();
+        }
+        
+        /// \brief Called once the actions for a segment have been destroyed (they are responsible for the stream)
+        void release_document(int segment) { }
+    };
+    
+    ///
+    /// \brief Parses an input that is made up of a series of items separated by a synchronising terminal
+    ///
+    /// The segments between the synchronising terminals are parsed concurrently, starting in the specified parser
+    /// state (which should be the state for a start symbol that matches a single item). The items produced for each
+    /// segment are appended to the items list in the order they appear in the input. Returns true if every segment
+    /// was accepted. Set numThreads to 0 to use one thread per processor.
+    ///
+    /// The synchronising symbol must be a terminal: see segmented_parse.
+    ///
+    template<typename parser_type> bool parse_segments(const parser_type& parser, dfa::lexeme_stream& input, int syncTerminal, int initialState, std::vector<typename parser_type::stack_item>& items, int numThreads = 0, bool syncEndsSegment = false, typename segmented_parse<parser_type>::actions_factory createActions = create_owning_actions<typename parser_type::actions_type>) {
+        segmented_parse<parser_type> segments(parser.get_tables(), initialState, input, syncTerminal, syncEndsSegment, createActions);
+        parse_all(parser, segments, segments.size(), numThreads, initialState);
+        
+        bool result = true;
+        for (int segment = 0; segment < segments.size(); ++segment) {
+            if (!segments.accepted(segment)) {
+                result = false;
+            } else {
+                items.push_back(segments.get_item(segment));
+            }
+        }
+        
+        return result;
+    }
+}
+
+#endif
@@ -0,0 +1,143 @@
+//
+//  state_stack.h
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef _LR_STATE_STACK_H
+#define _LR_STATE_STACK_H
+
+#include <cstdlib>
+#include <cstring>
+
+namespace lr {
+    ///
+    /// \brief A stack of parser state IDs with a fixed amount of inline storage
+    ///
+    /// This is used when the parser needs to simulate its actions without affecting the real parser stack: for
+    /// example when deciding whether or not a weak reduction can succeed, or when matching a guard. These stacks
+    /// are created and copied very frequently and are usually only a few states deep, so the states are stored
+    /// in the object itself. The stack only allocates memory if it grows beyond inline_capacity states.
+    ///
+    template<int inline_capacity = 16> class state_stack {
+    private:
+        /// \brief The inline storage for this stack
+        int m_Inline[inline_capacity];
+        
+        /// \brief The states in this stack (either m_Inline or a heap allocated array)
+        int* m_States;
+        
+        /// \brief The number of states on this stack
+        int m_Count;
+        
+        /// \brief The number of states that can be stored in m_States
+        int m_Capacity;
+        
+    private:
+        /// \brief Copies the states from the specified stack into this one
+        inline void copy_from(const state_stack& copyFrom) {
+            m_Count     = copyFrom.m_Count;
+            m_Capacity  = inline_capacity;
+            m_States    = m_Inline;
+            
+            if (m_Count > inline_capacity) {
+                m_Capacity  = copyFrom.m_Capacity;
+                m_States    = (int*) malloc(sizeof(int) * m_Capacity);
+            }
+            
+            memcpy(m_States, copyFrom.m_States, sizeof(int) * m_Count);
+        }
+        
+        /// \brief Frees any heap storage used by this stack
+        inline void free_states() {
+            if (m_States != m_Inline) {
+                free(m_States);
+                m_States = m_Inline;
+            }
+        }
+        
+    public:
+        /// \brief Creates an empty stack
+        inline state_stack()
+        : m_States(m_Inline)
+        , m_Count(0)
+        , m_Capacity(inline_capacity) {
+        }
+        
+        /// \brief Copies a stack
+        inline state_stack(const state_stack& copyFrom) {
+            copy_from(copyFrom);
+        }
+        
+        /// \brief Assigns this stack
+        inline state_stack& operator=(const state_stack& copyFrom) {
+            if (&copyFrom == this) return *this;
+            
+            free_states();
+            copy_from(copyFrom);
+            return *this;
+        }
+        
+        /// \brief Destructor
+        inline ~state_stack() {
+            free_states();
+        }
+        
+        /// \brief True if this stack is empty
+        inline bool empty() const { return m_Count == 0; }
+        
+        /// \brief The number of states on this stack
+        inline int size() const { return m_Count; }
+        
+        /// \brief The state on top of the stack
+        inline int& top() { return m_States[m_Count-1]; }
+        
+        /// \brief The state on top of the stack
+        inline const int& top() const { return m_States[m_Count-1]; }
+        
+        /// \brief Removes the state on top of the stack
+        inline void pop() { --m_Count; }
+        
+        /// \brief Pushes a new state onto the stack
+        inline void push(int state) {
+            if (m_Count >= m_Capacity) {
+                // Move to (or grow) the heap storage
+                int newCapacity = m_Capacity * 2;
+                
+                if (m_States == m_Inline) {
+                    m_States = (int*) malloc(sizeof(int) * newCapacity);
+                    memcpy(m_States, m_Inline, sizeof(int) * m_Count);
+                } else {
+                    m_States = (int*) realloc(m_States, sizeof(int) * newCapacity);
+                }
+                
+                m_Capacity = newCapacity;
+            }
+            
+            m_States[m_Count++] = state;
+        }
+    };
+}
+
+#endif
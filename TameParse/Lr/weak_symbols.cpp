@@ -169,6 +169,11 @@ void weak_symbols::add_symbols(ndfa& dfa, const item_set& weak, terminal_diction
     m_WeakSymbols.merge(weak);
 }
 
+/// \brief Marks the specified symbols as weak, without mapping them to any strong symbols
+void weak_symbols::add_weak_symbols(const item_set& weak) {
+    m_WeakSymbols.merge(weak);
+}
+
 /// \brief Modifies the specified set of actions according to the rules in this rewriter
 ///
 /// To deal with weak symbols, several rewrites are performed.
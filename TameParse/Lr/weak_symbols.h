@@ -97,6 +97,11 @@ namespace lr {
         /// The terminal dictionary may be modified if any symbols need to be split in order to generate a set
         /// of unique symbols.
         void add_symbols(dfa::ndfa& dfa, const contextfree::item_set& weak, contextfree::terminal_dictionary& terminals);
+        
+        /// \brief Marks the specified symbols as weak, without mapping them to any strong symbols
+        ///
+        /// This is used when restoring a set of weak symbols that was previously generated from a DFA
+        void add_weak_symbols(const contextfree::item_set& weak);
 
         /// \brief Modifies the specified set of actions according to the rules in this rewriter
         virtual void rewrite_actions(int state, lr_action_set& actions, const lalr_builder& builder) const;
@@ -30,8 +30,10 @@
 
 #include "TameParse/version.h"
 
+#include "TameParse/Util/arena.h"
 #include "TameParse/Util/astnode.h"
 #include "TameParse/Util/container.h"
+#include "TameParse/Util/flat_ast.h"
 #include "TameParse/Util/stringreader.h"
 #include "TameParse/Util/syntax_ptr.h"
 #include "TameParse/Util/unicode.h"
@@ -67,8 +69,12 @@
 
 #include "TameParse/Lr/action_rewriter.h"
 #include "TameParse/Lr/ast_parser.h"
+#include "TameParse/Lr/batch_parser.h"
 #include "TameParse/Lr/conflict.h"
+#include "TameParse/Lr/event_parser.h"
+#include "TameParse/Lr/glr_parser.h"
 #include "TameParse/Lr/ignored_symbols.h"
+#include "TameParse/Lr/incremental_parser.h"
 #include "TameParse/Lr/lalr_builder.h"
 #include "TameParse/Lr/lalr_machine.h"
 #include "TameParse/Lr/lalr_state.h"
@@ -80,6 +86,8 @@
 #include "TameParse/Lr/parser_stack.h"
 #include "TameParse/Lr/parser_state.h"
 #include "TameParse/Lr/parser_tables.h"
+#include "TameParse/Lr/profiling_parser_trace.h"
+#include "TameParse/Lr/segmented_parser.h"
 #include "TameParse/Lr/weak_symbols.h"
 
 #include "TameParse/Language/block.h"
@@ -84,6 +84,36 @@ while ($_ = <>) {
 	}
 }
 
+# Merges single characters that map with the same offset and are two characters apart
+# (eg, the alternating upper and lowercase letters in Latin Extended-A) into a single entry
+# with a stride of 2. Entries are [ first, last + 1, maps to, stride ].
+sub compress_map {
+	my ($map) = @_;
+	my $result = [ ];
+
+	foreach my $range (@$map) {
+		my $last = $result->[-1];
+
+		if (defined($last) 
+			&& $range->[1] - $range->[0] == 1 
+			&& $range->[2] - $range->[0] == $last->[2] - $last->[0]
+			&& (($last->[3] == 2 && $range->[0] == $last->[1] + 1) 
+				|| ($last->[3] == 1 && $last->[1] - $last->[0] == 1 && $range->[0] == $last->[0] + 2))) {
+			# Extend the previous entry
+			$last->[1] = $range->[1];
+			$last->[3] = 2;
+		} else {
+			# Start a new entry
+			push(@$result, [ $range->[0], $range->[1], $range->[2], 1 ]);
+		}
+	}
+
+	return $result;
+}
+
+$uppercase = compress_map($uppercase);
+$lowercase = compress_map($lowercase);
+
 print "/* Unicode character type table generated by unicode.pl */\n\n";
 
 # Generate variables for each character type
@@ -120,7 +150,7 @@ foreach my $range (@$uppercase) {
 	if ($first == 0) {
 		print ", ";
 	}
-	print "{ ", $range->[0], ", ", $range->[1], ", ", $range->[2], " }";
+	print "{ ", $range->[0], ", ", $range->[1], ", ", $range->[2], ", ", $range->[3], " }";
 	$first = 0;
 }
 print " };\n";
@@ -132,7 +162,7 @@ foreach my $range (@$lowercase) {
 	if ($first == 0) {
 		print ", ";
 	}
-	print "{ ", $range->[0], ", ", $range->[1], ", ", $range->[2], " }";
+	print "{ ", $range->[0], ", ", $range->[1], ", ", $range->[2], ", ", $range->[3], " }";
 	$first = 0;
 }
 print " };\n";
@@ -0,0 +1,99 @@
+//
+//  arena.cpp
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include "TameParse/Util/arena.h"
+
+using namespace util;
+
+/// \brief Creates a new arena which will allocate memory in blocks of the specified size
+arena::arena(size_t blockSize)
+: m_Blocks(NULL)
+, m_Next(NULL)
+, m_End(NULL)
+, m_Destructors(NULL)
+, m_BlockSize(blockSize)
+, m_BytesAllocated(0) {
+}
+
+/// \brief Destroys this arena, along with everything allocated in it
+arena::~arena() {
+    clear();
+}
+
+/// \brief Destroys all of the objects in this arena and frees their memory
+void arena::clear() {
+    // Destroy the objects that need it (before any memory is freed, as these may refer to other objects in the arena)
+    for (destructor* toDestroy = m_Destructors; toDestroy != NULL; toDestroy = toDestroy->next) {
+        toDestroy->destroy(toDestroy->object);
+    }
+    m_Destructors = NULL;
+    
+    // Free the blocks
+    block* nextBlock = m_Blocks;
+    while (nextBlock != NULL) {
+        block* toFree   = nextBlock;
+        nextBlock       = nextBlock->next;
+        free(toFree);
+    }
+    
+    m_Blocks            = NULL;
+    m_Next              = NULL;
+    m_End               = NULL;
+    m_BytesAllocated    = 0;
+}
+
+/// \brief Allocates memory from a new block
+void* arena::allocate_block(size_t size) {
+    // The header is padded so that the memory after it remains aligned
+    size_t headerSize = (sizeof(block) + alignment - 1) & ~(size_t)(alignment - 1);
+    
+    // Allocations that are larger than a block get a block of their own
+    size_t blockSize = m_BlockSize;
+    if (blockSize < size) blockSize = size;
+    
+    block* newBlock = (block*) malloc(headerSize + blockSize);
+    if (newBlock == NULL) throw std::bad_alloc();
+    
+    newBlock->size  = blockSize;
+    
+    char* memory    = ((char*) newBlock) + headerSize;
+    m_BytesAllocated += size;
+    
+    if (blockSize == size && m_Blocks != NULL) {
+        // Keep using the current block if this allocation used up all of the new one
+        newBlock->next  = m_Blocks->next;
+        m_Blocks->next  = newBlock;
+    } else {
+        // Allocate from the new block from now on
+        newBlock->next  = m_Blocks;
+        m_Blocks        = newBlock;
+        m_Next          = memory + size;
+        m_End           = memory + blockSize;
+    }
+    
+    return memory;
+}
@@ -0,0 +1,176 @@
+//
+//  arena.h
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef _UTIL_ARENA_H
+#define _UTIL_ARENA_H
+
+#include <cstdlib>
+#include <new>
+
+namespace util {
+    ///
+    /// \brief Memory region that allocates objects which are all freed together
+    ///
+    /// An arena allocates memory by advancing a pointer through large blocks, which makes allocation very cheap.
+    /// Individual allocations are never freed: instead, all of the memory in the arena is released in one step
+    /// when it is cleared or destroyed. This is used when building abstract syntax trees, where a large number of
+    /// small nodes are created during a parse and are all finished with at the same time.
+    ///
+    /// Objects that need their destructor to be called can be registered with the own() call: these are
+    /// destroyed in the reverse order that they were registered in when the arena is cleared.
+    ///
+    /// Objects can be created in an arena using the placement form of new: new (arena) type(...). Passing a NULL
+    /// arena allocates the object on the heap in the usual way.
+    ///
+    class arena {
+    private:
+        /// \brief Header for a block of memory owned by this arena (the memory follows the header)
+        struct block {
+            /// \brief The block allocated before this one
+            block* next;
+            
+            /// \brief The number of bytes available in this block
+            size_t size;
+        };
+        
+        /// \brief Entry in the list of objects that must be destroyed when this arena is cleared
+        struct destructor {
+            /// \brief The destructor registered before this one
+            destructor* next;
+            
+            /// \brief Function that destroys the object
+            void (*destroy)(void* object);
+            
+            /// \brief The object to destroy
+            void* object;
+        };
+        
+        /// \brief Alignment used for all allocations in this arena
+        enum { alignment = 16 };
+        
+        /// \brief The most recently allocated block
+        block* m_Blocks;
+        
+        /// \brief The next free byte in the current block
+        char* m_Next;
+        
+        /// \brief The end of the current block
+        char* m_End;
+        
+        /// \brief The most recently registered destructor
+        destructor* m_Destructors;
+        
+        /// \brief The size of the blocks that this arena allocates
+        size_t m_BlockSize;
+        
+        /// \brief The total number of bytes allocated from this arena
+        size_t m_BytesAllocated;
+        
+        /// \brief Disabled copy constructor
+        arena(const arena& copyFrom);
+        
+        /// \brief Disabled assignment
+        arena& operator=(const arena& assignFrom);
+        
+        /// \brief Allocates memory from a new block
+        void* allocate_block(size_t size);
+        
+        /// \brief Calls the destructor for an object of the specified type
+        template<typename object_type> static void destroy(void* object) {
+            ((object_type*) object)->~object_type();
+        }
+        
+    public:
+        /// \brief Creates a new arena which will allocate memory in blocks of the specified size
+        explicit arena(size_t blockSize = 16384);
+        
+        /// \brief Destroys this arena, along with everything allocated in it
+        ~arena();
+        
+        /// \brief Destroys all of the objects in this arena and frees their memory
+        ///
+        /// Memory previously returned by this arena must not be used after this call.
+        void clear();
+        
+        /// \brief Allocates the specified number of bytes
+        inline void* allocate(size_t size) {
+            // Round up to the alignment
+            size = (size + alignment - 1) & ~(size_t)(alignment - 1);
+            
+            // Allocate a new block if there isn't enough space in this one
+            if ((size_t)(m_End - m_Next) < size) {
+                return allocate_block(size);
+            }
+            
+            // Move on through the current block
+            void* result     = m_Next;
+            m_Next          += size;
+            m_BytesAllocated+= size;
+            
+            return result;
+        }
+        
+        /// \brief Allocates space for an array of items (which are left uninitialised)
+        template<typename item_type> inline item_type* allocate_array(size_t count) {
+            if (count == 0) return NULL;
+            return (item_type*) allocate(sizeof(item_type) * count);
+        }
+        
+        /// \brief Registers an object allocated in this arena so that its destructor is called when the arena is cleared
+        ///
+        /// The destructor for object_type is called directly, so this should be the actual type of the object, or the
+        /// object should have a virtual destructor.
+        template<typename object_type> inline object_type* own(object_type* object) {
+            if (object == NULL) return NULL;
+            
+            destructor* newDestructor   = (destructor*) allocate(sizeof(destructor));
+            newDestructor->next         = m_Destructors;
+            newDestructor->destroy      = &destroy<object_type>;
+            newDestructor->object       = object;
+            m_Destructors               = newDestructor;
+            
+            return object;
+        }
+        
+        /// \brief The number of bytes that have been allocated from this arena since it was created or last cleared
+        inline size_t bytes_allocated() const { return m_BytesAllocated; }
+    };
+}
+
+/// \brief Allocates an object in an arena, or on the heap if the arena is NULL
+inline void* operator new(size_t size, util::arena* arena) {
+    if (arena) return arena->allocate(size);
+    return ::operator new(size);
+}
+
+/// \brief Frees an object allocated in an arena if its constructor throws an exception
+inline void operator delete(void* mem, util::arena* arena) {
+    // Memory in an arena is only freed when the arena is cleared
+    if (!arena) ::operator delete(mem);
+}
+
+#endif
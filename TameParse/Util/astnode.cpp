@@ -77,3 +77,21 @@ bool astnode::operator<(const astnode& compareTo) const {
     
     return false;
 }
+
+/// \brief Creates an arena AST node with a nonterminal ID
+arena_astnode::arena_astnode(int itemIdentifier, int rule, const arena_astnode* const* children, size_t numChildren)
+: m_ItemIdentifier(itemIdentifier)
+, m_Rule(rule)
+, m_Lexeme(NULL)
+, m_Children(children)
+, m_NumChildren(numChildren) {
+}
+
+/// \brief Creates an arena AST node from a lexeme
+arena_astnode::arena_astnode(const dfa::lexeme* terminal)
+: m_ItemIdentifier(-1)
+, m_Rule(-1)
+, m_Lexeme(terminal)
+, m_Children(NULL)
+, m_NumChildren(0) {
+}
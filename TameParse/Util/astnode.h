@@ -108,6 +108,65 @@ namespace util {
             return *a < *b;
         }
     };
+    
+    ///
+    /// \brief Class representing an abstract syntax tree that is allocated in an arena
+    ///
+    /// These nodes have the same structure as astnode, but they don't do any reference counting and store their
+    /// children in a fixed array. They are built by the arena_ast_parser, and are all freed at once when the
+    /// arena used by that parser is cleared.
+    ///
+    class arena_astnode {
+    public:
+        /// \brief Iterator for the children of this node
+        typedef const arena_astnode* const* iterator;
+        
+    private:
+        /// \brief The identifier of the grammar item associated with this node (or -1 for a terminal node)
+        int m_ItemIdentifier;
+        
+        /// \brief The identifier of the rule that was matched for this node (or -1 for a terminal node)
+        int m_Rule;
+        
+        /// \brief The lexeme associated with this node (will be NULL if this node doesn't contain a lexeme)
+        const dfa::lexeme* m_Lexeme;
+        
+        /// \brief The child nodes of this node
+        const arena_astnode* const* m_Children;
+        
+        /// \brief The number of child nodes
+        size_t m_NumChildren;
+        
+    public:
+        /// \brief Creates an AST node with the specified rule and item identifier and children
+        ///
+        /// The array of children is not copied, so it should be allocated in the same arena as this node.
+        arena_astnode(int itemIdentifier, int rule, const arena_astnode* const* children, size_t numChildren);
+        
+        /// \brief Creates an AST node from a lexeme (which should live at least as long as this node)
+        arena_astnode(const dfa::lexeme* terminal);
+        
+        /// \brief The ID of the rule for this node
+        inline int rule() const { return m_Rule; }
+        
+        /// \brief The identifier of the item representing the nonterminal for this node
+        inline int item_identifier() const { return m_ItemIdentifier; }
+        
+        /// \brief The lexeme associated with this node (will be NULL if this node doesn't contain a lexeme)
+        inline const dfa::lexeme* lexeme() const { return m_Lexeme; }
+        
+        /// \brief The number of child nodes of this node
+        inline size_t size() const { return m_NumChildren; }
+        
+        /// \brief The first child of this node
+        inline iterator begin() const { return m_Children; }
+        
+        /// \brief The child after the last child of this node
+        inline iterator end() const { return m_Children + m_NumChildren; }
+        
+        /// \brief Returns the child at the specified index
+        inline const arena_astnode* operator[](int x) const { return m_Children[x]; }
+    };
 }
 
 #endif
@@ -26,3 +26,13 @@
 //
 
 #include "TameParse/Util/container.h"
+
+using namespace util;
+
+/// \brief The reference used by all containers that refer to NULL
+container_reference container_reference::s_Null = { NULL, 0, false };
+
+/// \brief Frees a reference allocated by a container
+void container_reference::free_reference(container_reference* ref) {
+    delete ref;
+}
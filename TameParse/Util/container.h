@@ -47,6 +47,74 @@ namespace util {
         }
     };
     
+    ///
+    /// \brief Reference count shared by the containers that refer to the same item
+    ///
+    /// This is an internal structure used by the container class. A single shared reference is used for all of the
+    /// containers that refer to NULL: it is never counted, so it can be used by many threads at once.
+    ///
+    struct container_reference {
+        /// \brief The item that is being referred to
+        void* item;
+        
+        /// \brief The number of containers that refer to this reference
+        mutable int refCount;
+        
+        /// \brief True if the item should be destroyed when the reference count reaches 0
+        bool willDelete;
+        
+        /// \brief The reference used by all containers that refer to NULL
+        static container_reference s_Null;
+        
+        /// \brief Frees a reference allocated by a container
+        ///
+        /// This isn't inline: compilers can't always tell that an embedded reference will never be passed to this, and will
+        /// warn about freeing a pointer that is not on the heap if they can see the delete.
+        static void free_reference(container_reference* ref);
+    };
+    
+    ///
+    /// \brief Base class for items that hold their own container reference count
+    ///
+    /// A container that owns an item derived from this class keeps its reference count in the item rather than
+    /// allocating a separate reference for it. Containers that do not own the item still allocate a reference.
+    ///
+    class container_item {
+    private:
+        /// \brief The reference used by the containers that own this item
+        container_reference m_ContainerReference;
+        
+        /// \brief Returns the reference embedded in the specified item
+        friend inline container_reference* embedded_container_reference(const container_item* item) {
+            return const_cast<container_reference*>(&item->m_ContainerReference);
+        }
+        
+    public:
+        /// \brief Creates an item that is not yet in a container
+        inline container_item() {
+            m_ContainerReference.item       = NULL;
+            m_ContainerReference.refCount   = 0;
+            m_ContainerReference.willDelete = false;
+        }
+        
+        /// \brief Copying an item does not copy its reference count
+        inline container_item(const container_item&) {
+            m_ContainerReference.item       = NULL;
+            m_ContainerReference.refCount   = 0;
+            m_ContainerReference.willDelete = false;
+        }
+        
+        /// \brief Assigning an item does not change its reference count
+        inline container_item& operator=(const container_item&) {
+            return *this;
+        }
+    };
+    
+    /// \brief Items that are not derived from container_item do not have an embedded reference
+    inline container_reference* embedded_container_reference(const void*) {
+        return NULL;
+    }
+    
     ///
     /// \brief Class used as a container for other classes
     ///
@@ -56,94 +124,111 @@ namespace util {
     /// ItemType must implement a clone() method to create a copy of the class, and a static compare(ItemType*, ItemType*)
     /// method to order them (it should return true if the first item is less than the second).
     ///
+    /// Containers that refer to NULL do not allocate anything, and if ItemType is derived from container_item then a
+    /// container that owns its item does not allocate anything either.
+    ///
     template<typename ItemType, typename ItemAllocator = simple_constructor<ItemType> > class container {
     private:
-        /// \brief Structure used to represent a reference to an item
-        struct reference {
-            ItemType*       item;
+        /// \brief Reference to the item in this container
+        container_reference* m_Ref;
+        
+    private:
+        /// \brief Creates a reference to an item, with a reference count of 1. The item will be destroyed when the reference count reaches 0 if willDelete is true
+        inline static container_reference* create_reference(ItemType* it, bool willDelete) {
+            // All NULL items share the same reference
+            if (!it) {
+                return &container_reference::s_Null;
+            }
             
-        private:
-            const bool m_WillDelete;
-            mutable int m_RefCount;
+            // Use the item's own reference if it has one and this is the container that owns it
+            container_reference* ref = willDelete ? embedded_container_reference(it) : NULL;
+            if (!ref) {
+                ref = new container_reference;
+            }
             
-            reference(const reference& noCopying) { }
-            reference& operator=(const reference& noCopying) { }
+            ref->item       = it;
+            ref->refCount   = 1;
+            ref->willDelete = willDelete;
             
-        public:
-            /// \brief Creates a reference to an item, with a reference count of 1. The item will be deleted if the reference count reached 0 and willDelete is true
-            inline reference(ItemType* it, bool willDelete)
-            : item(it)
-            , m_RefCount(1)
-            , m_WillDelete(willDelete) {
+            return ref;
+        }
+        
+        /// \brief Increases the reference count
+        inline static void retain(container_reference* ref) {
+            if (ref != &container_reference::s_Null) {
+                ++ref->refCount;
             }
+        }
+        
+        /// \brief Decreases the reference count, and destroys the reference and the item if it reaches 0
+        inline static void release(container_reference* ref) {
+            if (ref == &container_reference::s_Null) return;
             
-            inline ~reference() {
-                if (m_WillDelete && item) {
-                    ItemAllocator::destruct(item);
-                    item = NULL;
-                }
+            if (ref->refCount > 1) {
+                --ref->refCount;
+                return;
             }
             
-            /// \brief Decreases the reference count and deletes this reference if it reaches 0
-            inline void release() const {
-                if (m_RefCount <= 1) {
-                    delete this;
-                } else {
-                    m_RefCount--;
-                }
-            }
+            // An embedded reference is destroyed along with its item (embedded references are only used by owning containers)
+            ItemType* item = static_cast<ItemType*>(ref->item);
             
-            /// \brief Increases the reference count
-            inline void retain() const {
-                ++m_RefCount;
+            if (ref != embedded_container_reference(item)) {
+                bool willDelete = ref->willDelete;
+                container_reference::free_reference(ref);
+                
+                if (willDelete) {
+                    ItemAllocator::destruct(item);
+                }
+            } else {
+                ItemAllocator::destruct(item);
             }
-        };
-        
-        /// \brief Reference to the item in this container
-        reference* m_Ref;
+        }
         
-    private:
+        /// \brief The item referred to by this container
+        inline ItemType* get() const {
+            return static_cast<ItemType*>(m_Ref->item);
+        }
         
     public:
         /// \brief Dereferences the content of this container
-        inline ItemType* item() { return m_Ref->item; }
+        inline ItemType* item() { return get(); }
 
         /// \brief Dereferences the content of this container
-        inline const ItemType* item() const { return m_Ref->item; }
+        inline const ItemType* item() const { return get(); }
         
         /// \brief Dereferences the content of this container
         inline ItemType* operator->() {
-            return m_Ref->item;
+            return get();
         }
         
         /// \brief Dereferences the content of this container
         inline const ItemType* operator->() const {
-            return m_Ref->item;
+            return get();
         }
         
         /// \brief Dereferences the content of this container
         inline ItemType& operator*() {
-            return *m_Ref->item;
+            return *get();
         }
         
         /// \brief Dereferences the content of this container
         inline const ItemType& operator*() const {
-            return *m_Ref->item;
+            return *get();
         }
         
         /// \brief Dereferences the content of this container
         inline operator ItemType*() {
-            return m_Ref->item;
+            return get();
         }
         
         /// \brief Dereferences the content of this container
         inline operator const ItemType*() const {
-            return m_Ref->item;
+            return get();
         }
         
         /// \brief Ordering operator
         inline bool operator<(const container& compareTo) const {
-            return ItemType::compare(m_Ref->item, compareTo.m_Ref->item);
+            return ItemType::compare(get(), compareTo.get());
         }
         
         /// \brief Ordering operator
@@ -163,10 +248,10 @@ namespace util {
         
         /// \brief Comparison operator
         inline bool operator==(const container& compareTo) const {
-            if (m_Ref->item == compareTo.m_Ref->item)                   return true;
-            if (m_Ref->item == NULL || compareTo.m_Ref->item == NULL)   return false;
+            if (get() == compareTo.get())                   return true;
+            if (get() == NULL || compareTo.get() == NULL)   return false;
             
-            return (*m_Ref->item) == *compareTo;
+            return (*get()) == *compareTo;
         }
         
         /// \brief Comparison operator
@@ -191,54 +276,69 @@ namespace util {
         
     public:
         /// \brief Default constructor (creates a reference to a new item)
-        inline container() {
-            m_Ref = new reference(ItemAllocator::construct(), true);
+        inline container()
+        : m_Ref(create_reference(ItemAllocator::construct(), true)) {
         }
         
         /// \brief Creates a new container (clones the item)
-        inline container(const ItemType& it) {
-            m_Ref = new reference(it.clone(), true);
+        inline container(const ItemType& it)
+        : m_Ref(create_reference(it.clone(), true)) {
         }
         
         /// \brief Creates a new container (direct reference to an existing item)
-        inline container(ItemType* it) {
-            m_Ref = new reference(it, false);
+        inline container(ItemType* it)
+        : m_Ref(create_reference(it, false)) {
         }
         
         /// \brief Creates a new container (set whether or not the item should get deleted when the container is finished with)
-        inline container(ItemType* it, bool shouldDelete) {
-            m_Ref = new reference(it, shouldDelete);
+        inline container(ItemType* it, bool shouldDelete)
+        : m_Ref(create_reference(it, shouldDelete)) {
         }
         
         /// \brief Creates a new container (clones the item)
-        inline container(const ItemType* it) {
-            if (it) {
-                m_Ref = new reference(it->clone(), true);
-            } else {
-                m_Ref = new reference(NULL, false);
-            }
+        inline container(const ItemType* it)
+        : m_Ref(create_reference(it ? it->clone() : NULL, true)) {
         }
         
         /// \brief Creates a new container
-        inline container(const container<ItemType, ItemAllocator>& copyFrom) {
-            m_Ref = copyFrom.m_Ref;
-            m_Ref->retain();
+        inline container(const container<ItemType, ItemAllocator>& copyFrom)
+        : m_Ref(copyFrom.m_Ref) {
+            retain(m_Ref);
         }
         
         /// \brief Assigns the content of this container
         inline container<ItemType, ItemAllocator>& operator=(const container<ItemType, ItemAllocator>& assignFrom) {
-            if (&assignFrom == this) return *this;
+            if (assignFrom.m_Ref == m_Ref) return *this;
             
-            assignFrom.m_Ref->retain();
-            m_Ref->release();
+            retain(assignFrom.m_Ref);
+            release(m_Ref);
             m_Ref = assignFrom.m_Ref;
 
             return *this;
         }
         
+#if __cplusplus >= 201103L
+        /// \brief Creates a new container, taking the reference from another one (which is left referring to NULL)
+        inline container(container<ItemType, ItemAllocator>&& moveFrom)
+        : m_Ref(moveFrom.m_Ref) {
+            moveFrom.m_Ref = &container_reference::s_Null;
+        }
+        
+        /// \brief Assigns the content of this container, taking the reference from another one
+        inline container<ItemType, ItemAllocator>& operator=(container<ItemType, ItemAllocator>&& moveFrom) {
+            container_reference* oldRef = m_Ref;
+            
+            m_Ref           = moveFrom.m_Ref;
+            moveFrom.m_Ref  = &container_reference::s_Null;
+            release(oldRef);
+            
+            return *this;
+        }
+#endif
+        
         /// \brief Deletes the item in this container
         inline ~container() {
-            m_Ref->release();
+            release(m_Ref);
             m_Ref = NULL;
         }        
     };
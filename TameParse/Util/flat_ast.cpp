@@ -0,0 +1,90 @@
+//
+//  flat_ast.cpp
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include "TameParse/Util/flat_ast.h"
+
+using namespace dfa;
+using namespace util;
+
+/// \brief Creates an empty tree
+flat_ast::flat_ast() {
+}
+
+/// \brief Removes all of the nodes and lexemes from this tree
+void flat_ast::clear() {
+    m_Nodes.clear();
+    m_Lexemes.clear();
+}
+
+/// \brief Adds a terminal node for the specified lexeme, and returns its index
+int flat_ast::add_terminal(const lexeme_container& lexeme) {
+    node terminal;
+    
+    terminal.itemIdentifier = -1;
+    terminal.rule           = -1;
+    terminal.numChildren    = 0;
+    terminal.firstLexeme    = (int) m_Lexemes.size();
+    terminal.numLexemes     = 1;
+    terminal.parent         = -1;
+    terminal.firstChild     = -1;
+    terminal.nextSibling    = -1;
+    
+    m_Lexemes.push_back(lexeme);
+    m_Nodes.push_back(terminal);
+    
+    return (int) m_Nodes.size() - 1;
+}
+
+/// \brief Adds a nonterminal node with the specified children, and returns its index
+int flat_ast::add_nonterminal(int itemIdentifier, int rule, const int* children, int numChildren) {
+    int index = (int) m_Nodes.size();
+    
+    node nonterminal;
+    
+    nonterminal.itemIdentifier  = itemIdentifier;
+    nonterminal.rule            = rule;
+    nonterminal.numChildren     = numChildren;
+    nonterminal.parent          = -1;
+    nonterminal.firstChild      = numChildren > 0 ? children[0] : -1;
+    nonterminal.nextSibling     = -1;
+    
+    // Empty nodes cover no lexemes, and are positioned after the lexemes that have been matched so far
+    nonterminal.firstLexeme     = numChildren > 0 ? m_Nodes[children[0]].firstLexeme : (int) m_Lexemes.size();
+    nonterminal.numLexemes      = 0;
+    
+    // Link the children to this node
+    for (int x = 0; x < numChildren; ++x) {
+        node& child = m_Nodes[children[x]];
+        
+        child.parent            = index;
+        child.nextSibling       = x+1 < numChildren ? children[x+1] : -1;
+        nonterminal.numLexemes += child.numLexemes;
+    }
+    
+    m_Nodes.push_back(nonterminal);
+    return index;
+}
@@ -0,0 +1,237 @@
+//
+//  flat_ast.h
+//  TameParse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef _UTIL_FLAT_AST_H
+#define _UTIL_FLAT_AST_H
+
+#include <vector>
+
+#include "TameParse/Dfa/lexeme.h"
+
+namespace util {
+    ///
+    /// \brief Abstract syntax tree stored as a flat array of nodes
+    ///
+    /// This is an alternative to the astnode class for cases where the tree only needs to be read. The nodes are
+    /// stored in a single array in the order that the parser produced them, which for an LR parser is post-order
+    /// (every node follows its children, and the root is the last node). Nodes refer to each other by index,
+    /// and the lexemes matched by the parser are stored in a separate array: each node records the range of
+    /// lexemes that it covers.
+    ///
+    /// This representation is cheap to build (there is one allocation for the whole tree rather than one per node),
+    /// is cache friendly to traverse, and the node array can be written out directly as it contains no pointers.
+    ///
+    /// Use a cursor to navigate the tree, or the visit functions to traverse all of it.
+    ///
+    class flat_ast {
+    public:
+        ///
+        /// \brief A node in a flat AST
+        ///
+        struct node {
+            /// \brief The identifier of the grammar item associated with this node (or -1 for a terminal node)
+            int itemIdentifier;
+            
+            /// \brief The identifier of the rule that was matched for this node (or -1 for a terminal node)
+            int rule;
+            
+            /// \brief The number of children of this node
+            int numChildren;
+            
+            /// \brief The index of the first lexeme covered by this node
+            int firstLexeme;
+            
+            /// \brief The number of lexemes covered by this node
+            int numLexemes;
+            
+            /// \brief The index of the parent of this node (or -1 if it has not been reduced)
+            int parent;
+            
+            /// \brief The index of the first child of this node (or -1 if it has no children)
+            int firstChild;
+            
+            /// \brief The index of the next sibling of this node (or -1 if it is the last child)
+            int nextSibling;
+        };
+        
+        /// \brief List of nodes
+        typedef std::vector<node> node_list;
+        
+        /// \brief List of lexemes
+        typedef std::vector<dfa::lexeme_container> lexeme_list;
+        
+        ///
+        /// \brief Position of a node within a flat AST
+        ///
+        class cursor {
+        private:
+            /// \brief The tree that this cursor is in
+            const flat_ast* m_Ast;
+            
+            /// \brief The index of the node that this cursor refers to (-1 for a cursor that has moved off the tree)
+            int m_Index;
+            
+        public:
+            /// \brief Creates a cursor referring to the specified node
+            inline cursor(const flat_ast* ast, int index)
+            : m_Ast(ast)
+            , m_Index(index) {
+            }
+            
+            /// \brief True if this cursor refers to a node
+            inline bool valid() const { return m_Index >= 0; }
+            
+            /// \brief The index of the node that this cursor refers to
+            inline int index() const { return m_Index; }
+            
+            /// \brief The node that this cursor refers to
+            inline const node& get() const { return m_Ast->m_Nodes[m_Index]; }
+            
+            /// \brief The identifier of the grammar item associated with this node (or -1 for a terminal node)
+            inline int item_identifier() const { return get().itemIdentifier; }
+            
+            /// \brief The identifier of the rule that was matched for this node (or -1 for a terminal node)
+            inline int rule() const { return get().rule; }
+            
+            /// \brief True if this is a terminal node
+            inline bool is_terminal() const { return get().itemIdentifier < 0; }
+            
+            /// \brief The number of children of this node
+            inline int num_children() const { return get().numChildren; }
+            
+            /// \brief The lexeme for a terminal node (NULL for a nonterminal node)
+            inline const dfa::lexeme* lexeme() const { return is_terminal() ? m_Ast->m_Lexemes[get().firstLexeme].item() : NULL; }
+            
+            /// \brief A cursor referring to the parent of this node
+            inline cursor parent() const { return cursor(m_Ast, get().parent); }
+            
+            /// \brief A cursor referring to the first child of this node
+            inline cursor first_child() const { return cursor(m_Ast, get().firstChild); }
+            
+            /// \brief A cursor referring to the next sibling of this node
+            inline cursor next_sibling() const { return cursor(m_Ast, get().nextSibling); }
+            
+            /// \brief Moves this cursor to its parent
+            inline void to_parent() { m_Index = get().parent; }
+            
+            /// \brief Moves this cursor to its first child
+            inline void to_first_child() { m_Index = get().firstChild; }
+            
+            /// \brief Moves this cursor to its next sibling
+            inline void to_next_sibling() { m_Index = get().nextSibling; }
+            
+            /// \brief True if this cursor refers to the same node as another
+            inline bool operator==(const cursor& compareTo) const { return m_Ast == compareTo.m_Ast && m_Index == compareTo.m_Index; }
+            
+            /// \brief True if this cursor refers to a different node from another
+            inline bool operator!=(const cursor& compareTo) const { return !operator==(compareTo); }
+        };
+        
+    private:
+        friend class cursor;
+        
+        /// \brief The nodes in this tree, in post-order
+        node_list m_Nodes;
+        
+        /// \brief The lexemes covered by this tree
+        lexeme_list m_Lexemes;
+        
+    public:
+        /// \brief Creates an empty tree
+        flat_ast();
+        
+        /// \brief Removes all of the nodes and lexemes from this tree
+        void clear();
+        
+        /// \brief Adds a terminal node for the specified lexeme, and returns its index
+        int add_terminal(const dfa::lexeme_container& lexeme);
+        
+        /// \brief Adds a nonterminal node with the specified children, and returns its index
+        ///
+        /// The children should be listed in order, and should not already have a parent.
+        int add_nonterminal(int itemIdentifier, int rule, const int* children, int numChildren);
+        
+        /// \brief The number of nodes in this tree
+        inline int size() const { return (int) m_Nodes.size(); }
+        
+        /// \brief The nodes in this tree, in post-order
+        inline const node_list& nodes() const { return m_Nodes; }
+        
+        /// \brief The lexemes in this tree, in the order that they were matched
+        inline const lexeme_list& lexemes() const { return m_Lexemes; }
+        
+        /// \brief A cursor referring to the node with the specified index
+        inline cursor at(int index) const { return cursor(this, index); }
+        
+        /// \brief A cursor referring to the root of this tree (the last node to be added)
+        inline cursor root() const { return cursor(this, size() - 1); }
+        
+        ///
+        /// \brief Calls visitor(cursor) for every node in this tree, in post-order
+        ///
+        /// This just walks through the node array, so it is the fastest way to visit every node.
+        ///
+        template<typename visitor_type> void visit_post_order(visitor_type& visitor) const {
+            for (int index = 0; index < size(); ++index) {
+                visitor(cursor(this, index));
+            }
+        }
+        
+        ///
+        /// \brief Calls visitor.enter(cursor) and visitor.leave(cursor) for every node in the subtree starting at the specified node
+        ///
+        /// Nodes are entered before their children and left after them. Returning false from enter() skips the children of a node.
+        /// This doesn't use any storage other than the tree itself.
+        ///
+        template<typename visitor_type> void visit(const cursor& subtree, visitor_type& visitor) const {
+            cursor current = subtree;
+            
+            while (current.valid()) {
+                // Enter this node, and move to its first child if there is one
+                if (visitor.enter(current) && current.first_child().valid()) {
+                    current.to_first_child();
+                    continue;
+                }
+                
+                // Leave nodes until one with a sibling is found
+                for (;;) {
+                    visitor.leave(current);
+                    if (current == subtree) return;
+                    
+                    if (current.next_sibling().valid()) {
+                        current.to_next_sibling();
+                        break;
+                    }
+                    
+                    current.to_parent();
+                }
+            }
+        }
+    };
+}
+
+#endif
@@ -27,3 +27,13 @@
 
 #include "TameParse/Util/syntax_ptr.h"
 
+
+using namespace util;
+
+/// \brief The reference used by all syntax_ptr objects that refer to NULL
+syntax_ptr_reference syntax_ptr_reference::s_Null;
+
+/// \brief Frees a reference that is not embedded in its value
+void syntax_ptr_reference::free_reference(syntax_ptr_reference* ref) {
+    delete ref;
+}
@@ -30,21 +30,28 @@
 
 #include <cstdlib>
 
+#include "TameParse/Util/arena.h"
+
 namespace util {
     /// \brief Definition of a reference to a pointer of the given type
     ///
-    /// This is an internal structure used by the syntax_ptr class
+    /// This is an internal structure used by the syntax_ptr class. A single shared reference is used for all of the
+    /// syntax_ptr objects that refer to NULL: it is never counted, so it can be used by many threads at once.
     struct syntax_ptr_reference {
         /// \brief Creates a reference to NULL
         syntax_ptr_reference()
         : usageCount(1)
-        , value(NULL) {
+        , value(NULL)
+        , inArena(false)
+        , embedded(false) {
         }
         
         /// \brief Creates a reference to a value
-        syntax_ptr_reference(const void* newValue)
+        syntax_ptr_reference(const void* newValue, bool isInArena = false)
         : usageCount(1)
-        , value(newValue) {
+        , value(newValue)
+        , inArena(isInArena)
+        , embedded(false) {
         }
         
         /// \brief Number of syntax_ptr objects that refer to this reference
@@ -53,33 +60,110 @@ namespace util {
         /// \brief The value in this reference
         const void* value;
         
+        /// \brief True if this reference and its value were allocated in an arena (and will be freed along with it)
+        bool inArena;
+        
+        /// \brief True if this reference is part of the value that it refers to (see syntax_ptr_item)
+        bool embedded;
+        
+        /// \brief The reference used by all syntax_ptr objects that refer to NULL
+        static syntax_ptr_reference s_Null;
+        
+        /// \brief Frees a reference that is not embedded in its value
+        ///
+        /// This isn't inline so compilers that can't prove that the reference isn't embedded don't warn about the delete.
+        static void free_reference(syntax_ptr_reference* ref);
+        
     private:
         syntax_ptr_reference(const syntax_ptr_reference& noCopying);
         syntax_ptr_reference& operator=(const syntax_ptr_reference& noAssign);
     };
+    
+    ///
+    /// \brief Base class for values that hold their own syntax_ptr reference count
+    ///
+    /// A syntax_ptr to a value derived from this class keeps its reference count in the value rather than allocating
+    /// a separate reference for it.
+    ///
+    class syntax_ptr_item {
+    private:
+        /// \brief The reference used by the syntax_ptr objects that refer to this value
+        syntax_ptr_reference m_SyntaxReference;
+        
+        /// \brief Returns the reference embedded in the specified value
+        friend inline syntax_ptr_reference* embedded_syntax_reference(const syntax_ptr_item* value) {
+            return const_cast<syntax_ptr_reference*>(&value->m_SyntaxReference);
+        }
+        
+    public:
+        /// \brief Creates a value that is not yet referred to by a syntax_ptr
+        inline syntax_ptr_item() {
+            m_SyntaxReference.embedded = true;
+        }
+        
+        /// \brief Copying a value does not copy its reference count
+        inline syntax_ptr_item(const syntax_ptr_item&) {
+            m_SyntaxReference.embedded = true;
+        }
+        
+        /// \brief Assigning a value does not change its reference count
+        inline syntax_ptr_item& operator=(const syntax_ptr_item&) {
+            return *this;
+        }
+    };
+    
+    /// \brief Values that are not derived from syntax_ptr_item do not have an embedded reference
+    inline syntax_ptr_reference* embedded_syntax_reference(const void*) {
+        return NULL;
+    }
 
     /// \brief Shared pointer class similar to container, except without the requirements for cloning and comparisons 
     ///
     /// This will initialise to NULL if called with the default constructor. Once a given pointer is set to be managed by
     /// one of these objects, it cannot be deleted any way other than by destroying all of the referencing objects.
+    ///
+    /// Pointers to NULL do not allocate anything, and neither do pointers to values derived from syntax_ptr_item.
     template<typename ptr_type> class syntax_ptr {
     private:
         /// \brief The value that is being pointed at
         syntax_ptr_reference* m_Reference;
         
+        /// \brief Creates a reference to a value (which may be allocated in an arena)
+        inline static syntax_ptr_reference* create_reference(const ptr_type* value, arena* owner) {
+            // All NULL values share the same reference
+            if (!value) {
+                return &syntax_ptr_reference::s_Null;
+            }
+            
+            // Use the value's own reference if it has one
+            syntax_ptr_reference* ref = embedded_syntax_reference(value);
+            if (ref) {
+                ref->usageCount = 1;
+                ref->value      = value;
+                ref->inArena    = owner != NULL;
+            } else {
+                ref = new (owner) syntax_ptr_reference(value, owner != NULL);
+            }
+            
+            // The arena will destroy values allocated in it
+            if (owner) owner->own(const_cast<ptr_type*>(value));
+            
+            return ref;
+        }
+        
     public:
         /// \brief Constructs a syntax_ptr from a reference
         ///
         /// Generally, you should not use this constructor, it's mainly here to support pointer casting (the cast_to() function)
         inline explicit syntax_ptr(syntax_ptr_reference* ref)
         : m_Reference(ref) {
-            ++m_Reference->usageCount;
+            retain();
         }
         
     public:
         /// \brief Default constructor, assigns the pointer to NULL
         inline syntax_ptr()
-        : m_Reference(new syntax_ptr_reference()) {
+        : m_Reference(&syntax_ptr_reference::s_Null) {
         }
         
         /// \brief Set to a specific pointer value
@@ -87,14 +171,24 @@ namespace util {
         /// The pointer will be freed when this class is freed: it is invalid to assign a given pointer to more than
         /// one of these objects simultaneously.
         explicit inline syntax_ptr(const ptr_type* value)
-        : m_Reference(new syntax_ptr_reference(value)) {
+        : m_Reference(create_reference(value, NULL)) {
+        }
+        
+        /// \brief Set to a pointer to a value allocated in the specified arena
+        ///
+        /// If the arena is NULL, this is the same as the constructor that just takes a value. Otherwise, the value
+        /// should have been allocated using new (arena), and will be destroyed when the arena is cleared rather
+        /// than when the last syntax_ptr that refers to it is destroyed. A syntax_ptr that refers to an object in
+        /// an arena must not be used after that arena is cleared.
+        inline syntax_ptr(const ptr_type* value, arena* owner)
+        : m_Reference(create_reference(value, owner)) {
         }
         
         /// \brief Copy constructor
         inline syntax_ptr(const syntax_ptr<ptr_type>& copyFrom)
         : m_Reference(copyFrom.m_Reference) {
             // Increase the reference count for this object
-            ++m_Reference->usageCount;
+            retain();
         }
         
         /// \brief Assignment
@@ -103,30 +197,63 @@ namespace util {
             if (m_Reference == assignFrom.m_Reference) return *this;
             
             // Deallocate the reference
-            m_Reference->usageCount--;
-            if (m_Reference->usageCount <= 0) {
-                delete (ptr_type*) m_Reference->value;
-                m_Reference->value = NULL;
-                delete m_Reference;
-            }
-            m_Reference = NULL;
+            release();
             
             // Switch to the reference in the other object
             m_Reference = assignFrom.m_Reference;
-            ++m_Reference->usageCount;
+            retain();
             
             return *this;
         }
         
+#if __cplusplus >= 201103L
+        /// \brief Move constructor (the pointer that is moved from is left referring to NULL)
+        inline syntax_ptr(syntax_ptr<ptr_type>&& moveFrom)
+        : m_Reference(moveFrom.m_Reference) {
+            moveFrom.m_Reference = &syntax_ptr_reference::s_Null;
+        }
+        
+        /// \brief Move assignment
+        syntax_ptr<ptr_type>& operator=(syntax_ptr<ptr_type>&& moveFrom) {
+            if (m_Reference == moveFrom.m_Reference) return *this;
+            
+            release();
+            
+            m_Reference             = moveFrom.m_Reference;
+            moveFrom.m_Reference    = &syntax_ptr_reference::s_Null;
+            
+            return *this;
+        }
+#endif
+        
         /// \brief Destructs a syntax_ptr
         ~syntax_ptr() {
-            m_Reference->usageCount--;
-            if (m_Reference->usageCount <= 0) {
-                delete (ptr_type*) m_Reference->value;
-                m_Reference->value = NULL;
-                delete m_Reference;
-                m_Reference = NULL;
+            release();
+        }
+        
+    private:
+        /// \brief Increases the usage count of the reference used by this object
+        inline void retain() {
+            if (m_Reference != &syntax_ptr_reference::s_Null) {
+                ++m_Reference->usageCount;
+            }
+        }
+        
+        /// \brief Releases the reference used by this object
+        inline void release() {
+            if (m_Reference != &syntax_ptr_reference::s_Null) {
+                m_Reference->usageCount--;
+                if (m_Reference->usageCount <= 0 && !m_Reference->inArena) {
+                    // An embedded reference is destroyed along with its value, so it can't be used after this point
+                    const void* value = m_Reference->value;
+                    
+                    if (!m_Reference->embedded) {
+                        syntax_ptr_reference::free_reference(m_Reference);
+                    }
+                    delete (ptr_type*) value;
+                }
             }
+            m_Reference = NULL;
         }
         
     public:
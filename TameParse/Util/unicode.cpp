@@ -48,65 +48,90 @@ static bool compare_map_entries(const map_entry& first, const map_entry& second)
     return first.upper < second.upper;
 }
 
-/// \brief Converts a range using the specified map
-static symbol_set convert_range(const symbol_range& range, const map_entry* map, int count) {
-    // Start building the result
-    symbol_set result;
+/// \brief Finds the first entry in a map that might contain the specified character
+static inline const map_entry* first_entry(int chr, const map_entry* map, int count) {
+    // The first item with an upper bound > chr
+    map_entry searchItem = { chr, chr, 0, 1 };
+    return upper_bound(map, map + count, searchItem, compare_map_entries);
+}
 
+/// \brief Converts a range using the specified map
+static void convert_range(const symbol_range& range, const map_entry* map, int count, symbol_set& result) {
     // Current lower and upper bounds remaining to be processed
     int lowerChar = range.lower();
     int upperChar = range.upper();
 
-    // Search for the first item that is >= lower
-    map_entry searchItem        = { lowerChar, lowerChar, 0 };
-    const map_entry* curItem    = upper_bound(map, map + count, searchItem, compare_map_entries);
-    const map_entry* lastItem   = map + count;
-
-    // Iterate until we have processed all of the items in this range
-    while (upperChar > lowerChar) {
-        // Create a new range using the current item
-        if (curItem == lastItem) {
-            // Reached the end of the array - (lower, upper) should be copied in directly
-            result |= symbol_range(lowerChar, upperChar);
-            lowerChar = upperChar;
-            break;
+    // Iterate through the entries that overlap this range
+    const map_entry* lastItem = map + count;
+    
+    for (const map_entry* curItem = first_entry(lowerChar, map, count); curItem != lastItem && curItem->lower < upperChar; ++curItem) {
+        // Characters before the current item do not have a mapped equivalent
+        if (curItem->lower > lowerChar) {
+            result |= symbol_range(lowerChar, curItem->lower);
+            lowerChar = curItem->lower;
         }
 
-        // If the current item's lower bound is > lowerChar, then this range is does not have a mapped equivalent
-        if (curItem->lower > lowerChar) {
-            // Get the final character of this range
-            int endChar = curItem->lower;
-            if (endChar > upperChar) {
-                endChar = upperChar;
-            }
+        // The part of the range covered by this item
+        int endChar = curItem->upper;
+        if (endChar > upperChar) {
+            endChar = upperChar;
+        }
 
-            // Merge in this range
-            result |= symbol_range(lowerChar, endChar);
+        int offset = curItem->map_to - curItem->lower;
 
-            // Move on
-            lowerChar = endChar;
+        if (curItem->stride == 1) {
+            // Map in the equivalent character range
+            result |= symbol_range(lowerChar + offset, endChar + offset);
         } else {
-            // Map in the equivalent character range from the map
+            // Only every stride'th character is mapped: the ones in between have no equivalent
+            for (int chr = lowerChar; chr < endChar; ++chr) {
+                if ((chr - curItem->lower) % curItem->stride == 0) {
+                    result |= symbol_range(chr + offset, chr + offset + 1);
+                } else {
+                    result |= symbol_range(chr, chr + 1);
+                }
+            }
+        }
 
-            // The mapped character that's equivalent to lowerChar
-            int initialChar = curItem->map_to + (lowerChar - curItem->lower);
+        // Move on
+        lowerChar = endChar;
+    }
 
-            // The number of characters to map
-            int numChars = curItem->upper - curItem->lower;
-            if (numChars > upperChar - lowerChar) {
-                numChars = upperChar - lowerChar;
-            }
+    // Anything left over has no mapped equivalent
+    if (lowerChar < upperChar) {
+        result |= symbol_range(lowerChar, upperChar);
+    }
+}
 
-            // Merge in the mapped range
-            result |= symbol_range(initialChar, initialChar + numChars);
+/// \brief Adds the mapped equivalents of the characters in the source to the target
+static void add_mapped(symbol_set& target, const symbol_set& source, const map_entry* map, int count) {
+    const map_entry* lastItem = map + count;
 
-            // Move on
-            ++curItem;
-            lowerChar += numChars;
+    for (symbol_set::iterator toMap = source.begin(); toMap != source.end(); ++toMap) {
+        for (const map_entry* curItem = first_entry(toMap->lower(), map, count); curItem != lastItem && curItem->lower < toMap->upper(); ++curItem) {
+            // The part of the range covered by this item
+            int lowerChar   = max(toMap->lower(), curItem->lower);
+            int upperChar   = min(toMap->upper(), curItem->upper);
+            int offset      = curItem->map_to - curItem->lower;
+
+            // Nothing to do if the equivalent characters are already in the target (this is very likely for large sets)
+            if (target.contains(symbol_range(lowerChar + offset, upperChar + offset))) continue;
+
+            if (curItem->stride == 1) {
+                target |= symbol_range(lowerChar + offset, upperChar + offset);
+            } else {
+                // Move to the first character that has a mapping
+                int remainder = (lowerChar - curItem->lower) % curItem->stride;
+                if (remainder != 0) {
+                    lowerChar += curItem->stride - remainder;
+                }
+
+                for (int chr = lowerChar; chr < upperChar; chr += curItem->stride) {
+                    target |= symbol_range(chr + offset, chr + offset + 1);
+                }
+            }
         }
     }
-
-    return result;
 }
 
 /// \brief Returns the uppercase equivalent of the specified symbol set
@@ -116,7 +141,7 @@ symbol_set unicode::to_upper(const symbol_set& source) {
     // Iterate through the symbols in the source
     for (symbol_set::iterator toMap = source.begin(); toMap != source.end(); ++toMap) {
         // Map this range and merge it into the result
-        result |= convert_range(*toMap, s_UppercaseMap, s_UppercaseMapSize);
+        convert_range(*toMap, s_UppercaseMap, s_UppercaseMapSize, result);
     }
 
     return result;
@@ -129,7 +154,47 @@ symbol_set unicode::to_lower(const symbol_set& source) {
     // Iterate through the symbols in the source
     for (symbol_set::iterator toMap = source.begin(); toMap != source.end(); ++toMap) {
         // Map this range and merge it into the result
-        result |= convert_range(*toMap, s_LowercaseMap, s_LowercaseMapSize);
+        convert_range(*toMap, s_LowercaseMap, s_LowercaseMapSize, result);
+    }
+
+    return result;
+}
+
+/// \brief Adds the uppercase equivalents of the symbols in the source set to the target set
+void unicode::add_uppercase(symbol_set& target, const symbol_set& source) const {
+    add_mapped(target, source, s_UppercaseMap, s_UppercaseMapSize);
+}
+
+/// \brief Adds the lowercase equivalents of the symbols in the source set to the target set
+void unicode::add_lowercase(symbol_set& target, const symbol_set& source) const {
+    add_mapped(target, source, s_LowercaseMap, s_LowercaseMapSize);
+}
+
+/// \brief Returns the symbols in the specified category
+const symbol_set& unicode::category(const std::string& type) const {
+    // Use the cached set if there is one
+    map<string, symbol_set>::const_iterator found = m_Categories.find(type);
+    if (found != m_Categories.end()) {
+        return found->second;
+    }
+
+    // Build the set from the blocks
+    symbol_set& result = m_Categories[type];
+    if (type.empty()) {
+        return result;
+    }
+
+    for (iterator block = begin(); block != end(); ++block) {
+        // Main category must match
+        if (block->type[0] != type[0]) continue;
+
+        // If the category has two parts, then the rest must match too
+        if (type.size() > 1 && block->type[1] != type[1]) continue;
+
+        // This matches: add the symbols ranges
+        for (const range* r = block->ranges; r->lower >= 0; ++r) {
+            result |= symbol_range(r->lower, r->upper);
+        }
     }
 
     return result;
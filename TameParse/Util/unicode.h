@@ -28,6 +28,9 @@
 #ifndef _UTIL_UNICODE_H
 #define _UTIL_UNICODE_H
 
+#include <map>
+#include <string>
+
 #include "TameParse/Dfa/symbol_set.h"
 
 namespace util {
@@ -55,10 +58,14 @@ namespace util {
         typedef const block* iterator;
 
         /// \brief Entry in a character map table
+        ///
+        /// Every stride'th character from lower up to (but not including) upper is mapped, starting at lower,
+        /// which maps to map_to. The characters in between have no equivalent.
         struct map_entry {
             int lower;
             int upper;
             int map_to;
+            int stride;
         };
     
     private:
@@ -80,6 +87,9 @@ namespace util {
         /// \brief Sorted array mapping uppercase characters to their lowercase equivalent
         static const map_entry s_LowercaseMap[];
         
+        /// \brief The symbol sets for the categories that have been looked up so far
+        mutable std::map<std::string, dfa::symbol_set> m_Categories;
+        
     public:
         /// \brief The first character range
         inline iterator begin() const { return s_Blocks; }
@@ -92,6 +102,23 @@ namespace util {
 
         /// \brief Returns the lowercase equivalent of the specified symbol set
         dfa::symbol_set to_lower(const dfa::symbol_set& source);
+        
+        /// \brief Adds the uppercase equivalents of the symbols in the source set to the target set
+        ///
+        /// This has the same result as target |= to_upper(source) if source is a subset of target, but
+        /// is much faster for large sets, as no work is done for characters whose equivalent is already
+        /// in the target.
+        void add_uppercase(dfa::symbol_set& target, const dfa::symbol_set& source) const;
+        
+        /// \brief Adds the lowercase equivalents of the symbols in the source set to the target set
+        void add_lowercase(dfa::symbol_set& target, const dfa::symbol_set& source) const;
+        
+        /// \brief Returns the symbols in the specified category
+        ///
+        /// The category is as in the UnicodeData.txt file. It can also be a single character to specify
+        /// all of the categories with that main category (so 'Lu' is uppercase letters and 'L' is all letters).
+        /// The set is built the first time a category is requested and is cached in this object afterwards.
+        const dfa::symbol_set& category(const std::string& type) const;
     };
 }
 
@@ -0,0 +1,260 @@
+//
+//  compiler_lexer_cache.cpp
+//  Parse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <memory>
+
+#include "compiler_lexer_cache.h"
+
+#include "TameParse/Compiler/std_console.h"
+#include "TameParse/Compiler/parser_stage.h"
+#include "TameParse/Compiler/import_stage.h"
+#include "TameParse/Compiler/language_builder_stage.h"
+#include "TameParse/Compiler/lexer_stage.h"
+
+using namespace std;
+using namespace dfa;
+using namespace contextfree;
+using namespace lr;
+using namespace compiler;
+
+/// \brief Definition of the language whose lexer is cached
+static const char* s_CacheDefinition =
+    "language Cache {\n"
+    "    weak keywords { replace }\n"
+    "    keywords { while if }\n"
+    "    lexer {\n"
+    "        identifier = /[A-Za-z_][A-Za-z0-9_]*/\n"
+    "        number = /[0-9]+/\n"
+    "    }\n"
+    "    ignore { whitespace = /[ \\t\\r\\n]/ }\n"
+    "    grammar {\n"
+    "        <Program> = <Statement>*\n"
+    "        <Statement> = while identifier | if number | replace identifier\n"
+    "    }\n"
+    "}\n";
+
+///
+/// \brief Console that reads the language definition from memory and writes the lexer cache to the current directory
+///
+class cache_test_console : public std_console {
+private:
+    /// \brief The verbose messages written by the compiler
+    wostringstream m_Verbose;
+    
+    /// \brief The cache file that was written, or the empty string if none has been written
+    wstring m_CacheFile;
+    
+public:
+    cache_test_console()
+    : std_console(L"lexer-cache-test.tp") {
+    }
+    
+    virtual wstring get_option(const wstring& name) const {
+        if (name == L"lexer-cache")     return L".";
+        if (name == L"keyword-hash")    return L"keyword-hash";
+        return std_console::get_option(name);
+    }
+    
+    virtual wostream& verbose_stream() {
+        return m_Verbose;
+    }
+    
+    virtual istream* open_file(const wstring& filename) {
+        if (filename == input_file()) return new stringstream(s_CacheDefinition);
+        return std_console::open_file(filename);
+    }
+    
+    virtual bool rename_file(const wstring& oldName, const wstring& newName) {
+        m_CacheFile = newName;
+        return std_console::rename_file(oldName, newName);
+    }
+    
+    /// \brief True if the lexer was loaded from the cache
+    bool loaded_from_cache() const { return m_Verbose.str().find(L"Loaded the lexer DFA") != wstring::npos; }
+    
+    /// \brief The cache file that was written
+    const wstring& cache_file() const { return m_CacheFile; }
+};
+
+///
+/// \brief Runs the compiler stages needed to build the lexer for the cache test language
+///
+class cache_test_compiler {
+private:
+    cache_test_console      m_Console;
+    console_container       m_Container;
+    parser_stage            m_Parser;
+    auto_ptr<import_stage>  m_Import;
+    auto_ptr<language_builder_stage> m_Builder;
+    auto_ptr<lexer_stage>   m_Lexer;
+    
+public:
+    cache_test_compiler()
+    : m_Container(&m_Console, false)
+    , m_Parser(m_Container, m_Console.input_file()) {
+        m_Parser.compile();
+        
+        m_Import = auto_ptr<import_stage>(new import_stage(m_Container, m_Console.input_file(), m_Parser.definition_file()));
+        m_Import->compile();
+        
+        m_Builder = auto_ptr<language_builder_stage>(new language_builder_stage(m_Container, m_Console.input_file(), m_Import.get()));
+        m_Builder->compile();
+        
+        m_Lexer = auto_ptr<lexer_stage>(new lexer_stage(m_Container, m_Console.input_file(), m_Builder->language_with_name(L"Cache")));
+        m_Lexer->compile();
+    }
+    
+    cache_test_console& cons() { return m_Console; }
+    const lexer_stage& lexer() const { return *m_Lexer; }
+};
+
+/// \brief True if two lexer DFAs have the same symbol sets, transitions and accept actions
+static bool same_dfa(const ndfa& a, const ndfa& b) {
+    if (a.count_states() != b.count_states()) return false;
+    if (a.symbols().count_sets() != b.symbols().count_sets()) return false;
+    
+    for (int symbolId = 0; symbolId < a.symbols().count_sets(); ++symbolId) {
+        if (a.symbols()[symbolId] != b.symbols()[symbolId]) return false;
+    }
+    
+    for (int stateId = 0; stateId < a.count_states(); ++stateId) {
+        const state& stateA = a.get_state(stateId);
+        const state& stateB = b.get_state(stateId);
+        
+        if (stateA.count_transitions() != stateB.count_transitions()) return false;
+        for (state::iterator transitA = stateA.begin(), transitB = stateB.begin(); transitA != stateA.end(); ++transitA, ++transitB) {
+            if (*transitA != *transitB) return false;
+        }
+        
+        const ndfa::accept_action_list& actionsA = a.actions_for_state(stateId);
+        const ndfa::accept_action_list& actionsB = b.actions_for_state(stateId);
+        
+        if (actionsA.size() != actionsB.size()) return false;
+        for (size_t actionId = 0; actionId < actionsA.size(); ++actionId) {
+            if (!(*actionsA[actionId] == actionsB[actionId])) return false;
+        }
+    }
+    
+    return true;
+}
+
+/// \brief True if two weak symbol objects map the same strong symbols to the same weak symbols
+static bool same_weak_symbols(const weak_symbols& a, const weak_symbols& b) {
+    weak_symbols::strong_iterator strongA = a.begin_strong();
+    weak_symbols::strong_iterator strongB = b.begin_strong();
+    
+    for (; strongA != a.end_strong() && strongB != b.end_strong(); ++strongA, ++strongB) {
+        if (strongA->first->symbol() != strongB->first->symbol()) return false;
+        if (strongA->second.size() != strongB->second.size()) return false;
+        
+        for (item_set::const_iterator weakA = strongA->second.begin(), weakB = strongB->second.begin(); weakA != strongA->second.end(); ++weakA, ++weakB) {
+            if ((*weakA)->symbol() != (*weakB)->symbol()) return false;
+        }
+    }
+    
+    return strongA == a.end_strong() && strongB == b.end_strong();
+}
+
+/// \brief True if two keyword tables contain the same keywords
+static bool same_keywords(const keyword_table* a, const keyword_table* b) {
+    if (!a || !b) return false;
+    if (a->count_entries() != b->count_entries()) return false;
+    
+    for (int keywordId = 0; keywordId < a->count_entries(); ++keywordId) {
+        const keyword_table::entry& entryA = a->entries()[keywordId];
+        const keyword_table::entry& entryB = b->entries()[keywordId];
+        
+        if (entryA.matched != entryB.matched || entryA.symbol != entryB.symbol || entryA.length != entryB.length) return false;
+        for (int chrId = 0; chrId < entryA.length; ++chrId) {
+            if (a->text()[entryA.offset + chrId] != b->text()[entryB.offset + chrId]) return false;
+        }
+    }
+    
+    return true;
+}
+
+/// \brief Replaces the contents of a file
+static void write_file(const string& filename, const string& contents) {
+    ofstream file(filename.c_str(), ios::out | ios::binary | ios::trunc);
+    file << contents;
+}
+
+void test_compiler_lexer_cache::run_tests() {
+    // Build the lexer and write it to the cache
+    cache_test_compiler built;
+    wstring             cacheFile = built.cons().cache_file();
+    
+    report("BuildNoErrors", built.cons().exit_code() == 0);
+    report("NotLoaded", !built.cons().loaded_from_cache());
+    report("CacheWritten", !cacheFile.empty());
+    report("HasWeakSymbols", built.lexer().weak_symbols()->begin_strong() != built.lexer().weak_symbols()->end_strong());
+    
+    // Load it into a new set of stages
+    {
+        cache_test_compiler loaded;
+        
+        report("Loaded", loaded.cons().loaded_from_cache());
+        report("SameDfa", same_dfa(*built.lexer().dfa(), *loaded.lexer().dfa()));
+        report("SameWeakSymbols", same_weak_symbols(*built.lexer().weak_symbols(), *loaded.lexer().weak_symbols()));
+        report("SameKeywords", same_keywords(built.lexer().keywords(), loaded.lexer().keywords()));
+    }
+    
+    // Read the cache file so it can be damaged
+    string latin1CacheFile(cacheFile.begin(), cacheFile.end());
+    string contents;
+    {
+        ifstream cache(latin1CacheFile.c_str(), ios::in | ios::binary);
+        contents.assign((istreambuf_iterator<char>(cache)), istreambuf_iterator<char>());
+    }
+    
+    // A file that was cut short should be rejected and rebuilt
+    write_file(latin1CacheFile, contents.substr(0, contents.size() / 2));
+    {
+        cache_test_compiler truncated;
+        
+        report("TruncatedNotLoaded", !truncated.cons().loaded_from_cache());
+        report("TruncatedSameDfa", same_dfa(*built.lexer().dfa(), *truncated.lexer().dfa()));
+    }
+    
+    // As should a file that's complete apart from the checksum at the end
+    write_file(latin1CacheFile, contents.substr(0, contents.rfind("\nend ") + 1));
+    {
+        cache_test_compiler noEnd;
+        report("NoEndNotLoaded", !noEnd.cons().loaded_from_cache());
+    }
+    
+    // The rebuilt file should be complete again
+    {
+        cache_test_compiler reloaded;
+        report("RewrittenLoaded", reloaded.cons().loaded_from_cache());
+    }
+    
+    remove(latin1CacheFile.c_str());
+}
@@ -0,0 +1,145 @@
+//
+//  dfa_keyword_table.cpp
+//  Parse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include <string>
+#include <sstream>
+
+#include "dfa_keyword_table.h"
+
+#include "TameParse/Dfa/lexer.h"
+#include "TameParse/Dfa/keyword_table.h"
+
+using namespace std;
+using namespace dfa;
+
+/// \brief Converts a string to a set of symbols
+static keyword_table::symbols to_symbols(const string& text) {
+    return keyword_table::symbols(text.begin(), text.end());
+}
+
+/// \brief Lexes a string and returns the symbol it matched
+static int lex(const lexer& theLexer, const string& text) {
+    stringstream    in(text);
+    lexeme_stream*  stream = theLexer.create_stream_from(in);
+    lexeme*         result = NULL;
+    
+    (*stream) >> result;
+    delete stream;
+    
+    if (!result) return -2;
+    
+    int matched = result->matched();
+    delete result;
+    return matched;
+}
+
+void test_dfa_keyword_table::run_tests() {
+    // Build a table containing lots of keywords
+    keyword_table   keywords;
+    bool            allAdded = true;
+    
+    for (int keywordId = 0; keywordId < 200; ++keywordId) {
+        stringstream name;
+        name << "kw" << keywordId;
+        
+        allAdded = keywords.add_keyword(to_symbols(name.str()), 1, 100 + keywordId, false) && allAdded;
+    }
+    
+    allAdded = keywords.add_keyword(to_symbols("Begin"), 1, 400, true) && allAdded;
+    bool compiled = keywords.compile();
+    
+    report("all-added", allAdded);
+    report("compiled", compiled);
+    report("count", keywords.count_entries() == 201);
+    
+    // Every keyword should be found
+    bool allFound = true;
+    for (int keywordId = 0; keywordId < 200; ++keywordId) {
+        stringstream name;
+        name << "kw" << keywordId;
+        
+        if (keywords.find(1, to_symbols(name.str())) != 100 + keywordId) allFound = false;
+    }
+    report("all-found", allFound);
+    
+    // Things that aren't keywords shouldn't be found
+    report("not-keyword", keywords.find(1, to_symbols("kw200")) == -1);
+    report("not-keyword-prefix", keywords.find(1, to_symbols("kw")) == -1);
+    report("wrong-matched", keywords.find(2, to_symbols("kw1")) == -1);
+    report("case-sensitive", keywords.find(1, to_symbols("KW1")) == -1);
+    
+    // Case insensitive keywords match any case
+    report("case-insensitive1", keywords.find(1, to_symbols("begin")) == 400);
+    report("case-insensitive2", keywords.find(1, to_symbols("BEGIN")) == 400);
+    report("case-insensitive3", keywords.find(1, to_symbols("BeGiN")) == 400);
+    
+    // Duplicates and non-ASCII keywords are rejected
+    report("reject-duplicate", !keywords.add_keyword(to_symbols("BEGIN"), 1, 401, false));
+    
+    keyword_table::symbols unicode = to_symbols("caf");
+    unicode += 0xe9;
+    report("reject-unicode", !keywords.add_keyword(unicode, 1, 402, false));
+    
+    // A table built from the generated tables should behave the same way
+    keyword_table copy(keywords.entries(), keywords.count_entries(), keywords.displacement(), keywords.count_buckets(), keywords.text());
+    report("copy-found", copy.find(1, to_symbols("kw42")) == 142 && copy.find(1, to_symbols("BEGIN")) == 400);
+    report("copy-not-found", copy.find(1, to_symbols("kw200")) == -1);
+    
+    // An empty table finds nothing
+    keyword_table empty;
+    empty.compile();
+    report("empty", empty.find(1, to_symbols("kw1")) == -1);
+    
+    // If no seed within the limit fits a bucket, compiling fails and leaves the table empty
+    keyword_table limited;
+    for (int keywordId = 0; keywordId < 200; ++keywordId) {
+        stringstream name;
+        name << "kw" << keywordId;
+        
+        limited.add_keyword(to_symbols(name.str()), 1, 100 + keywordId, false);
+    }
+    
+    report("seed-limit", !limited.compile(1));
+    report("seed-limit-empty", limited.empty() && limited.find(1, to_symbols("kw1")) == -1);
+    
+    // Use the table with a lexer whose DFA only recognises identifiers and numbers
+    ndfa_regex identifiers;
+    identifiers.add_regex(0, "[a-zA-Z][a-zA-Z0-9]*", accept_action(1));
+    identifiers.add_regex(0, "[0-9]+", accept_action(2));
+    
+    ndfa* unique = identifiers.to_ndfa_with_unique_symbols();
+    ndfa* dfa    = unique->to_dfa();
+    delete unique;
+    
+    lexer withKeywords(*dfa, &keywords);
+    delete dfa;
+    
+    report("lexer-keyword", lex(withKeywords, "kw12 ") == 112);
+    report("lexer-keyword-case", lex(withKeywords, "BEGIN+") == 400);
+    report("lexer-identifier", lex(withKeywords, "kw12a") == 1);
+    report("lexer-number", lex(withKeywords, "12") == 2);
+}
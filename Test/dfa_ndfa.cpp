@@ -32,6 +32,32 @@
 
 using namespace dfa;
 
+/// \brief Returns true if two DFAs have exactly the same states, transitions and accept actions
+static bool same_dfa(const ndfa& a, const ndfa& b) {
+    if (a.count_states() != b.count_states()) return false;
+    if (a.symbols().count_sets() != b.symbols().count_sets()) return false;
+    
+    for (int stateId = 0; stateId < a.count_states(); ++stateId) {
+        const state& stateA = a.get_state(stateId);
+        const state& stateB = b.get_state(stateId);
+        
+        if (stateA.count_transitions() != stateB.count_transitions()) return false;
+        for (state::iterator transitA = stateA.begin(), transitB = stateB.begin(); transitA != stateA.end(); ++transitA, ++transitB) {
+            if (*transitA != *transitB) return false;
+        }
+        
+        const ndfa::accept_action_list& actionsA = a.actions_for_state(stateId);
+        const ndfa::accept_action_list& actionsB = b.actions_for_state(stateId);
+        
+        if (actionsA.size() != actionsB.size()) return false;
+        for (size_t actionId = 0; actionId < actionsA.size(); ++actionId) {
+            if (!(*actionsA[actionId] == actionsB[actionId])) return false;
+        }
+    }
+    
+    return true;
+}
+
 void test_dfa_ndfa::run_tests() {
     // NDFA with two transitions on 'a'
     ndfa twoAs;
@@ -127,4 +153,73 @@ void test_dfa_ndfa::run_tests() {
     // Should be 5 states
     numStates = aaOrBbAsDfa->count_states();
     report("regex3", numStates == 5);
+    
+    // The parallel subset construction should produce exactly the same DFA as the serial one
+    ndfa_regex manyExpressions;
+    manyExpressions.add_regex(0, "[a-zA-Z_][a-zA-Z0-9_]*", 0);
+    manyExpressions.add_regex(0, "[0-9]+(\\.[0-9]+)?([eE][+\\-]?[0-9]+)?", 1);
+    manyExpressions.add_regex(0, "0x[0-9a-fA-F]+", 2);
+    manyExpressions.add_literal(0, "while", 3);
+    manyExpressions.add_literal(0, "whilst", 4);
+    manyExpressions.add_literal(0, "if", 5);
+    manyExpressions.add_regex(0, "\"([^\"\\\\]|\\\\.)*\"", 6);
+    manyExpressions.add_regex(0, "(ab|ac|ad)*(b|c)?d+", 7);
+    
+    ndfa* uniqueExpressions = manyExpressions.to_ndfa_with_unique_symbols();
+    ndfa* serialDfa         = uniqueExpressions->to_dfa();
+    ndfa* parallelDfa       = uniqueExpressions->to_dfa_parallel(0, 4);
+    
+    report("parallel1", parallelDfa->is_dfa());
+    report("parallel2", parallelDfa->verify_is_dfa());
+    report("parallel3", same_dfa(*serialDfa, *parallelDfa));
+    
+    delete parallelDfa;
+    delete serialDfa;
+    delete uniqueExpressions;
+    
+    // This should also be true when the parallel construction runs first, on an NDFA with no epsilon symbol set
+    ndfa noEpsilon;
+    noEpsilon >> 'a' >> accept_action(0);
+    noEpsilon >> 'a' >> 'b' >> accept_action(1);
+    
+    ndfa* parallelSource    = noEpsilon.to_ndfa_with_unique_symbols();
+    ndfa* serialSource      = noEpsilon.to_ndfa_with_unique_symbols();
+    parallelDfa             = parallelSource->to_dfa_parallel(0, 4);
+    serialDfa               = serialSource->to_dfa();
+    
+    report("parallel4", same_dfa(*serialDfa, *parallelDfa));
+    
+    delete parallelDfa;
+    delete serialDfa;
+    delete parallelSource;
+    delete serialSource;
+    
+    // Named expressions are compiled once and copied: this should recognise the same language as writing them out
+    ndfa_regex namedExpressions;
+    namedExpressions.define_expression("digit", "[0-9]");
+    namedExpressions.define_expression("number", "{digit}+(\\.{digit}+)?");
+    namedExpressions.add_regex(0, "{number}(,{number})*", 0);
+    namedExpressions.add_regex(0, "x{digit}{digit}", 1);
+    
+    ndfa_regex inlineExpressions;
+    inlineExpressions.add_regex(0, "[0-9]+(\\.[0-9]+)?(,[0-9]+(\\.[0-9]+)?)*", 0);
+    inlineExpressions.add_regex(0, "x[0-9][0-9]", 1);
+    
+    ndfa* namedUnique       = namedExpressions.to_ndfa_with_unique_symbols();
+    ndfa* inlineUnique      = inlineExpressions.to_ndfa_with_unique_symbols();
+    ndfa* namedExpanded     = namedUnique->to_dfa();
+    ndfa* inlineExpanded    = inlineUnique->to_dfa();
+    ndfa* namedDfa          = namedExpanded->to_compact_dfa();
+    ndfa* inlineDfa         = inlineExpanded->to_compact_dfa();
+    
+    report("named1", namedDfa->verify_is_dfa());
+    report("named2", namedDfa->count_states() == inlineDfa->count_states());
+    report("named3", same_dfa(*namedDfa, *inlineDfa));
+    
+    delete namedDfa;
+    delete inlineDfa;
+    delete namedExpanded;
+    delete inlineExpanded;
+    delete namedUnique;
+    delete inlineUnique;
 }
@@ -40,6 +40,10 @@ void test_dfa_symbol_set::run_tests() {
     report("Contains2", testSet[19]);
     report("Contains3", !testSet[9]);
     report("Contains4", !testSet[20]);
+    report("Contains5", testSet.contains(r(10, 20)));
+    report("Contains6", testSet.contains(r(12, 15)));
+    report("Contains7", !testSet.contains(r(9, 15)));
+    report("Contains8", !testSet.contains(r(15, 21)));
     
     symbol_set disjointSet = testSet | r(40, 50);
 
@@ -134,4 +138,24 @@ void test_dfa_symbol_set::run_tests() {
     report("ToLower2", uc.to_lower(a_to_z) == a_to_z);
     report("ToLower3", uc.to_lower(A_to_Z_to_0) == a_to_z_to_0);
     report("ToLower4", uc.to_lower(M_to_O) == m_to_o);
+    
+    // Ranges that start part of the way through an entry in the case tables
+    report("ToUpper5", uc.to_upper(symbol_set(r(0x2d09, 0x2d30))) == (symbol_set(r(0x10a9, 0x10c6)) | r(0x2d26, 0x2d30)));
+    report("ToUpper6", uc.to_upper(symbol_set(r(0x103, 0x106))) == (symbol_set(r(0x102, 0x103)) | r(0x104, 0x105)));
+    report("ToLower5", uc.to_lower(symbol_set(r(0x102, 0x104))) == symbol_set(r(0x103, 0x104)));
+    
+    symbol_set latinA(r(0x100, 0x180));
+    symbol_set latinAUpper = latinA;
+    uc.add_uppercase(latinAUpper, latinA);
+    report("AddUpper1", latinAUpper == (latinA | uc.to_upper(latinA)));
+    
+    symbol_set lettersAndLower = a_to_z;
+    uc.add_lowercase(lettersAndLower, A_to_Z);
+    report("AddLower1", lettersAndLower == a_to_z);
+    uc.add_uppercase(lettersAndLower, a_to_z);
+    report("AddUpper2", lettersAndLower == (a_to_z | A_to_Z));
+    
+    report("Category1", uc.category("Lu")['A'] && !uc.category("Lu")['a']);
+    report("Category2", uc.category("L")['A'] && uc.category("L")['a'] && !uc.category("L")['0']);
+    report("Category3", uc.category("Nd").contains(r('0', '9' + 1)));
 }
@@ -34,6 +34,13 @@
 #include "TameParse/ContextFree/grammar.h"
 #include "TameParse/Lr/lalr_builder.h"
 #include "TameParse/Lr/parser.h"
+#include "TameParse/Lr/ast_parser.h"
+#include "TameParse/Lr/event_parser.h"
+#include "TameParse/Lr/glr_parser.h"
+#include "TameParse/Lr/batch_parser.h"
+#include "TameParse/Lr/segmented_parser.h"
+#include "TameParse/Lr/incremental_parser.h"
+#include "TameParse/Lr/profiling_parser_trace.h"
 #include "TameParse/Lr/conflict.h"
 #include "TameParse/Language/formatter.h"
 
@@ -255,6 +262,356 @@ static bool can_parse(int_string& symbols, simple_parser& p, character_lexer& le
     return result;
 }
 
+typedef parser<int, simple_parser_actions, profiling_parser_trace> profiled_parser;
+
+/// \brief Parses a string with a profiling parser, and stores the counters it collected in profile
+static bool profile_parse(int_string& symbols, simple_parser& p, character_lexer& lex, parser_profile& profile) {
+    profiled_parser             profiled(p.get_tables());
+    int_stringstream            stream(symbols);
+    profiled_parser::state*     state = profiled.create_parser(new simple_parser_actions(lex.create_stream_from(stream)));
+    
+    bool result = state->parse();
+    profile     = state->get_trace().profile();
+    
+    delete state;
+    return result;
+}
+
+typedef parser<int, simple_parser_actions, no_parser_trace, parser_features::none> lalr_only_parser;
+
+/// \brief Parses a string with a parser that only supports plain LALR(1) tables
+static bool lalr_only_parse(int_string& symbols, simple_parser& p, character_lexer& lex) {
+    lalr_only_parser            lalrOnly(&p.get_tables(), false);
+    int_stringstream            stream(symbols);
+    lalr_only_parser::state*    state = lalrOnly.create_parser(new simple_parser_actions(lex.create_stream_from(stream)));
+    
+    bool result = state->parse();
+    
+    delete state;
+    return result;
+}
+
+/// \brief Stands in for the code written out by the parser generator for a direct-coded parser
+///
+/// This looks up the actions in the tables rather than having them written out as code, but performs them in
+/// the same way, leaving anything other than a lone shift, reduce or accept action to the table interpreter.
+class table_direct_code {
+public:
+    /// \brief The tables that are being 'compiled'
+    static const parser_tables* s_Tables;
+    
+    static int goto_state(int state, int nonterminalId) {
+        return s_Tables->find_goto(state, nonterminalId);
+    }
+    
+    static parser_result::result step(profiled_parser::state& parserState) {
+        for (;;) {
+            const dfa::lexeme_container&    la      = parserState.look();
+            int                             state   = parserState.current_state();
+            parser_tables::action_iterator  act;
+            parser_tables::action_iterator  end;
+            int                             symbol;
+            
+            if (la.item()) {
+                symbol  = la->matched();
+                act     = s_Tables->find_terminal(state, symbol);
+                end     = s_Tables->last_terminal_action(state);
+            } else {
+                symbol  = s_Tables->end_of_input();
+                act     = s_Tables->find_nonterminal(state, symbol);
+                end     = s_Tables->last_nonterminal_action(state);
+            }
+            
+            // Only single actions are performed directly
+            if (act == end || act->symbolId != symbol || (act+1 != end && (act+1)->symbolId == symbol)) {
+                return parserState.process();
+            }
+            
+            switch (act->type) {
+                case lr_action::act_shift:
+                    parserState.shift_direct(la, act->nextState);
+                    continue;
+                    
+                case lr_action::act_reduce:
+                {
+                    const parser_tables::reduce_rule& rule = s_Tables->rule(act->nextState);
+                    parserState.reduce_direct<table_direct_code>(rule.identifier, rule.ruleId, rule.length);
+                    continue;
+                }
+                    
+                case lr_action::act_accept:
+                    return parser_result::accept;
+                    
+                default:
+                    return parserState.process();
+            }
+        }
+    }
+};
+
+const parser_tables* table_direct_code::s_Tables = NULL;
+
+/// \brief Returns true if parse_direct performs the same actions as parse for the specified string
+static bool direct_matches_parse(int_string& symbols, simple_parser& p, character_lexer& lex, bool expectAccept) {
+    parser_profile tableProfile;
+    bool tableResult = profile_parse(symbols, p, lex, tableProfile);
+    
+    profiled_parser             profiled(p.get_tables());
+    int_stringstream            stream(symbols);
+    profiled_parser::state*     state = profiled.create_parser(new simple_parser_actions(lex.create_stream_from(stream)));
+    
+    table_direct_code::s_Tables = &p.get_tables();
+    bool directResult = state->parse_direct<table_direct_code>();
+    
+    const parser_profile& directProfile = state->get_trace().profile();
+    bool matches = directResult == tableResult && directResult == expectAccept
+                && directProfile.shifts() == tableProfile.shifts()
+                && directProfile.rule_reductions() == tableProfile.rule_reductions()
+                && directProfile.guards().size() == tableProfile.guards().size()
+                && directProfile.rejected() == tableProfile.rejected();
+    
+    delete state;
+    return matches;
+}
+
+/// \brief Batch handler that parses a list of strings of symbols
+class string_batch {
+private:
+    character_lexer&            m_Lexer;
+    const vector<int_string>&   m_Documents;
+    vector<int_stringstream*>   m_Streams;
+    
+public:
+    /// \brief Non-zero for the documents that were accepted
+    vector<char> accepted;
+    
+    string_batch(character_lexer& lexer, const vector<int_string>& documents)
+    : m_Lexer(lexer)
+    , m_Documents(documents)
+    , m_Streams(documents.size(), (int_stringstream*) NULL)
+    , accepted(documents.size(), 2) {
+    }
+    
+    simple_parser_actions* begin_document(int document) {
+        m_Streams[document] = new int_stringstream(m_Documents[document]);
+        return new simple_parser_actions(m_Lexer.create_stream_from(*m_Streams[document]));
+    }
+    
+    void end_document(int document, simple_parser::state& state, bool wasAccepted) {
+        accepted[document] = wasAccepted ? 1 : 0;
+    }
+    
+    void release_document(int document) {
+        delete m_Streams[document];
+        m_Streams[document] = NULL;
+    }
+};
+
+/// \brief Parses a list of documents with parse_all and checks the results against parsing them one at a time
+static bool batch_matches_serial(vector<int_string>& documents, simple_parser& p, character_lexer& lex, int numThreads) {
+    string_batch batch(lex, documents);
+    parse_all(p, batch, (int) documents.size(), numThreads);
+    
+    for (size_t document = 0; document < documents.size(); ++document) {
+        if (batch.accepted[document] != (can_parse(documents[document], p, lex) ? 1 : 0)) return false;
+    }
+    return true;
+}
+
+/// \brief Splits a string of symbols at a synchronising terminal and parses the segments concurrently
+static bool parse_segments_of(int_string& symbols, ast_parser& p, character_lexer& lex, int syncTerminal, int initialState, vector<util::astnode_container>& items) {
+    int_stringstream    stream(symbols);
+    lexeme_stream*      lexemes = lex.create_stream_from(stream);
+    
+    bool result = parse_segments(p, *lexemes, syncTerminal, initialState, items, 4);
+    
+    delete lexemes;
+    return result;
+}
+
+/// \brief Counts the segments in a string of symbols
+static int count_segments(int_string& symbols, ast_parser& p, character_lexer& lex, int syncTerminal, bool syncEndsSegment) {
+    int_stringstream    stream(symbols);
+    lexeme_stream*      lexemes = lex.create_stream_from(stream);
+    int                 result;
+    
+    {
+        segmented_parse<ast_parser> segments(p.get_tables(), 1, *lexemes, syncTerminal, syncEndsSegment);
+        result = segments.size();
+    }
+    
+    delete lexemes;
+    return result;
+}
+
+/// \brief Converts a string of symbols into a list of tokens
+static void lex_tokens(int_string& symbols, character_lexer& lex, incremental_parse::token_list& tokens) {
+    int_stringstream    stream(symbols);
+    lexeme_stream*      lexemes = lex.create_stream_from(stream);
+    
+    for (;;) {
+        lexeme* next = NULL;
+        (*lexemes) >> next;
+        if (!next) break;
+        
+        tokens.push_back(lexeme_container(next, true));
+    }
+    
+    delete lexemes;
+}
+
+/// \brief True if two incremental syntax trees have the same structure
+static bool same_tree(const incremental_node_container& a, const incremental_node_container& b) {
+    if (a.item() == NULL || b.item() == NULL) return a.item() == b.item();
+    
+    if (a->item_identifier() != b->item_identifier()) return false;
+    if (a->rule() != b->rule()) return false;
+    if (a->length() != b->length()) return false;
+    if (a->children().size() != b->children().size()) return false;
+    if (a->lexeme().item() && a->lexeme()->matched() != b->lexeme()->matched()) return false;
+    
+    for (size_t child = 0; child < a->children().size(); ++child) {
+        if (a->child_offset((int) child) != b->child_offset((int) child)) return false;
+        if (!same_tree(a->children()[child], b->children()[child])) return false;
+    }
+    
+    return true;
+}
+
+/// \brief Reparses after an edit, and checks that the result is the same as parsing the new tokens from scratch
+static bool reparse_matches(const incremental_parser& p, incremental_parse& previous, const incremental_edit& edit, incremental_parse& result) {
+    bool                accepted = p.reparse(previous, edit, result);
+    incremental_parse   fromScratch;
+    
+    return p.parse(result.tokens(), fromScratch) == accepted && same_tree(result.root(), fromScratch.root());
+}
+
+/// \brief Runs the GLR parser over a string of symbols
+static bool glr_parse(int_string& symbols, const glr_parser& p, character_lexer& lex, glr_forest& forest) {
+    int_stringstream    stream(symbols);
+    lexeme_stream*      lexemes = lex.create_stream_from(stream);
+    
+    bool result = p.parse(*lexemes, forest);
+    
+    delete lexemes;
+    return result;
+}
+
+/// \brief Counts the distinct parse trees that are represented by a node in a GLR forest
+static long count_derivations(const glr_forest& forest, int nodeIndex) {
+    const glr_forest::node& thisNode = forest.get_node(nodeIndex);
+    if (thisNode.lexeme >= 0) return 1;
+    
+    long result = 0;
+    for (int altIndex = thisNode.firstAlternative; altIndex >= 0; altIndex = forest.get_alternative(altIndex).nextAlternative) {
+        const glr_forest::alternative&  alt         = forest.get_alternative(altIndex);
+        const int*                      children    = forest.children(alt);
+        long                            derivations = 1;
+        
+        for (int child = 0; child < alt.numChildren; ++child) {
+            derivations *= count_derivations(forest, children[child]);
+        }
+        
+        result += derivations;
+    }
+    
+    return result;
+}
+
+/// \brief Appends the symbols matched by the leaves of an arena AST to a string
+static void arena_leaves(const util::arena_astnode* node, int_string& leaves) {
+    if (node->lexeme()) {
+        leaves += (wchar_t) node->lexeme()->matched();
+    }
+    
+    for (util::arena_astnode::iterator child = node->begin(); child != node->end(); ++child) {
+        arena_leaves(*child, leaves);
+    }
+}
+
+/// \brief Visitor that records the symbols matched by the leaves of a flat AST, and checks that nodes are entered and left in order
+class flat_leaves {
+public:
+    int_string      leaves;
+    vector<int>     entered;
+    bool            ordered;
+    
+    flat_leaves() : ordered(true) { }
+    
+    bool enter(const util::flat_ast::cursor& node) {
+        if (node.lexeme()) leaves += (wchar_t) node.lexeme()->matched();
+        entered.push_back(node.index());
+        return true;
+    }
+    
+    void leave(const util::flat_ast::cursor& node) {
+        if (entered.empty() || entered.back() != node.index()) ordered = false;
+        if (!entered.empty()) entered.pop_back();
+    }
+};
+
+/// \brief Event handler that counts the events it receives
+class counting_handler : public parser_event_handler {
+public:
+    int_string  shifted;
+    int         numReduced;
+    int         numAccepted;
+    event_span  accepted;
+    
+    counting_handler() : numReduced(0), numAccepted(0) { }
+    
+    void shift(const lexeme_container& lexeme, const event_span& span) {
+        if (span.firstLexeme == (int) shifted.size()) shifted += (wchar_t) lexeme->matched();
+    }
+    
+    void reduce(int nonterminal, int rule, const event_span& span) {
+        ++numReduced;
+    }
+    
+    void accept(const event_span& span) {
+        ++numAccepted;
+        accepted = span;
+    }
+};
+
+/// \brief Returns the first action for a symbol, or the end of the action list if there isn't one
+static parser_tables::action_iterator first_action(parser_tables::action_iterator found, parser_tables::action_iterator end, int symbol) {
+    if (found != end && found->symbolId != symbol) return end;
+    return found;
+}
+
+/// \brief Checks that the comb tables in a set of parser tables find the same actions as searching the action lists
+static bool combs_match_search(const parser_tables& tables, int maxSymbol) {
+    if (!tables.terminal_comb() || !tables.nonterminal_comb() || !tables.gotos()) return false;
+    
+    // Create tables with no combs (so actions are found by searching)
+    parser_tables searched(tables.count_states(), tables.end_of_input(), tables.end_of_guard(), 
+                           const_cast<parser_tables::action**>(tables.terminal_actions()), 
+                           const_cast<parser_tables::action**>(tables.nonterminal_actions()), 
+                           const_cast<parser_tables::action_count*>(tables.action_counts()), 
+                           const_cast<int*>(tables.end_of_guard_states()), tables.count_end_of_guards(), 
+                           tables.count_reduce_rules(), const_cast<parser_tables::reduce_rule*>(tables.reduce_rules()), 
+                           tables.count_weak_to_strong(), const_cast<parser_tables::symbol_equivalent*>(tables.weak_to_strong()));
+    
+    for (int stateId = 0; stateId < tables.count_states(); ++stateId) {
+        for (int symbol = -1; symbol <= maxSymbol; ++symbol) {
+            if (tables.find_terminal(stateId, symbol) != first_action(searched.find_terminal(stateId, symbol), searched.last_terminal_action(stateId), symbol)) {
+                return false;
+            }
+            
+            if (tables.find_nonterminal(stateId, symbol) != first_action(searched.find_nonterminal(stateId, symbol), searched.last_nonterminal_action(stateId), symbol)) {
+                return false;
+            }
+            
+            if (tables.find_goto(stateId, symbol) != searched.find_goto(stateId, symbol)) {
+                return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
 void test_lalr_general::run_tests() {
     // Grammar specified in example 4.46 of the dragon book
     grammar             dragon446;
@@ -355,10 +712,76 @@ void test_lalr_general::run_tests() {
     conflict::find_conflicts(builder, conflicts);
     
     report("NoConflicts1", conflicts.size() == 0);
+    report("CombTables1", combs_match_search(p.get_tables(), 20));
+    
+    // This grammar is plain LALR(1), so a parser without support for guards or weak symbols can parse it
+    int_string notAccepted = test2;
+    notAccepted += equalsId;
+    
+    report("FeaturesNone", p.get_tables().features() == parser_features::none);
+    report("LalrOnlySupported", lalr_only_parser::supports_tables(p.get_tables()));
+    report("LalrOnlyAccept", lalr_only_parse(test1, p, lex) && lalr_only_parse(test2, p, lex));
+    report("LalrOnlyReject", !lalr_only_parse(notAccepted, p, lex));
 
     delete parse1;
     delete parse2;
     
+    // Build an AST in an arena
+    util::arena         astArena;
+    arena_ast_parser    arenaParser(builder, NULL);
+    
+    int_stringstream    stream3(test2);
+    int_string          leaves;
+    
+    arena_ast_parser::state* parse3 = arenaParser.create_parser(new arena_ast_parser_actions(lex.create_stream_from(stream3), astArena));
+    bool arenaAccepted = parse3->parse();
+    
+    if (arenaAccepted && parse3->get_item() != NULL) {
+        arena_leaves(parse3->get_item(), leaves);
+    }
+    delete parse3;
+    
+    report("ArenaAst", arenaAccepted && leaves == test2 && astArena.bytes_allocated() > 0);
+    
+    astArena.clear();
+    report("ArenaClear", astArena.bytes_allocated() == 0);
+    
+    // Record the same parse in a flat AST
+    util::flat_ast      flatAst;
+    flat_ast_parser     flatParser(builder, NULL);
+    int_stringstream    stream4(test2);
+    
+    flat_ast_parser::state* parse4 = flatParser.create_parser(new flat_ast_parser_actions(lex.create_stream_from(stream4), flatAst));
+    bool flatAccepted = parse4->parse();
+    
+    report("FlatAstAccept", flatAccepted && parse4->get_item() == flatAst.root().index());
+    delete parse4;
+    
+    flat_leaves flatVisitor;
+    flatAst.visit(flatAst.root(), flatVisitor);
+    
+    report("FlatAstVisit", flatVisitor.leaves == test2 && flatVisitor.ordered && flatVisitor.entered.empty());
+    report("FlatAstSpan", flatAst.root().get().firstLexeme == 0 && flatAst.root().get().numLexemes == (int) test2.size() && !flatAst.root().parent().valid());
+    
+    // Parse again, sending events instead of building a tree
+    typedef event_parser_actions<counting_handler>::parser_type counting_parser;
+    
+    counting_handler    counter;
+    counting_parser     eventParser(builder, NULL);
+    int_stringstream    stream5(test2);
+    
+    counting_parser::state* parse5 = eventParser.create_parser(new event_parser_actions<counting_handler>(lex.create_stream_from(stream5), counter));
+    bool eventsAccepted = parse_events(parse5, counter);
+    delete parse5;
+    
+    int numNonterminals = 0;
+    for (util::flat_ast::node_list::const_iterator flatNode = flatAst.nodes().begin(); flatNode != flatAst.nodes().end(); ++flatNode) {
+        if (flatNode->itemIdentifier >= 0) ++numNonterminals;
+    }
+    
+    report("EventsAccept", eventsAccepted && counter.numAccepted == 1 && counter.shifted == test2);
+    report("EventsReduce", counter.numReduced == numNonterminals && counter.accepted.firstLexeme == 0 && counter.accepted.numLexemes == (int) test2.size());
+    
     // Create another parser, this one with a particular type of empty production (accepts arbitrary strings of ids)
     grammar emptyProd;
 
@@ -462,6 +885,7 @@ void test_lalr_general::run_tests() {
     int_string csDoesntMatch2;
     int_string csDoesntMatch3;
     int_string oneD;
+    int_string fortyOfEach;
     
     for (int x=0; x<3; ++x) threeOfEach += aId;
     for (int x=0; x<3; ++x) threeOfEach += bId;
@@ -480,14 +904,458 @@ void test_lalr_general::run_tests() {
     for (int x=0; x<3; ++x) csDoesntMatch3 += cId;
     
     oneD += dId;
+    
+    for (int x=0; x<40; ++x) fortyOfEach += aId;
+    for (int x=0; x<40; ++x) fortyOfEach += bId;
+    for (int x=0; x<40; ++x) fortyOfEach += cId;
 
     // Now test it out
+    report("FeaturesGuards", (simpleCsParser.get_tables().features() & parser_features::guards) != 0);
+    report("LalrOnlyRejectsGuards", !lalr_only_parser::supports_tables(simpleCsParser.get_tables()));
+    report("GuardsSupported", simple_parser::supports_tables(simpleCsParser.get_tables()));
     report("ContextSensitive1", can_parse(threeOfEach, simpleCsParser, lex));
     report("ContextSensitive2", !can_parse(csDoesntMatch1, simpleCsParser, lex));
     report("ContextSensitive3", !can_parse(csDoesntMatch2, simpleCsParser, lex));
     report("ContextSensitive4", !can_parse(csDoesntMatch3, simpleCsParser, lex));
+    
+    // The guard stack gets deeper than the inline storage in the stacks used to check it
+    report("ContextSensitiveDeepGuard", can_parse(fortyOfEach, simpleCsParser, lex));
 
     // Also test [=> [=> 'd' ] ] 'd'
     // This actually tests two things: do multiple guards in one state work, and do recursive guards work?
     report("ContextSensitiveRecursiveGuards1", can_parse(oneD, simpleCsParser, lex));
+    
+    // The comb tables should find the same actions as a search, including the guard actions
+    report("CombTables2", combs_match_search(simpleCsParser.get_tables(), 40));
+    
+    // Guards that are regular should be matched by an automaton instead of the parser
+    grammar regularGuards;
+    
+    nonterminal guarded(regularGuards.id_for_nonterminal(L"<Guarded>"));
+    nonterminal unguarded(regularGuards.id_for_nonterminal(L"<Unguarded>"));
+    nonterminal regularLan(regularGuards.id_for_nonterminal(L"<Regular-Guard>"));
+    
+    ebnf_repeating_optional anyBs;
+    (*anyBs.get_rule()) << b;
+    
+    guard matchGuarded;
+    (*matchGuarded.get_rule()) << a << anyBs << c;
+    
+    (regularGuards += L"<Guarded>") << a << anyBs << c;
+    (regularGuards += L"<Unguarded>") << a << anyBs << d;
+    (regularGuards += L"<Regular-Guard>") << matchGuarded << guarded;
+    (regularGuards += L"<Regular-Guard>") << unguarded;
+    
+    lalr_builder regularBuilder(regularGuards, terms);
+    regularBuilder.add_initial_state(regularLan);
+    regularBuilder.complete_parser();
+    
+    simple_parser regularParser(regularBuilder, NULL);
+    
+    int guardState = regularBuilder.guard_states().empty() ? -1 : regularBuilder.guard_states().begin()->second;
+    report("RegularGuardCompiled", guardState >= 0 && regularParser.get_tables().regular_guard(guardState) >= 0);
+    
+    // The context-sensitive parser has both kinds of guard
+    int csRegular       = 0;
+    int csNotRegular    = 0;
+    for (map<int, int>::const_iterator csGuard = csBuilder.guard_states().begin(); csGuard != csBuilder.guard_states().end(); ++csGuard) {
+        if (simpleCsParser.get_tables().regular_guard(csGuard->second) >= 0) {
+            ++csRegular;
+        } else {
+            ++csNotRegular;
+        }
+    }
+    report("RegularGuardMixed", csRegular == 1 && csNotRegular == 2);
+    
+    int_string regular1;
+    int_string regular2;
+    int_string regular3;
+    int_string regular4;
+    
+    regular1 += aId; regular1 += bId; regular1 += bId; regular1 += cId;
+    regular2 += aId; regular2 += bId; regular2 += bId; regular2 += bId; regular2 += dId;
+    regular3 += aId; regular3 += cId;
+    regular4 += aId; regular4 += bId; regular4 += bId;
+    
+    report("RegularGuard1", can_parse(regular1, regularParser, lex));
+    report("RegularGuard2", can_parse(regular2, regularParser, lex));
+    report("RegularGuard3", can_parse(regular3, regularParser, lex));
+    report("RegularGuard4", !can_parse(regular4, regularParser, lex));
+    
+    // The profiling trace should count the actions performed by the parser
+    parser_profile dragonProfile;
+    parser_profile guardProfile;
+    parser_profile rejectProfile;
+    
+    bool dragonProfiled = profile_parse(test2, p, lex, dragonProfile);
+    bool guardProfiled  = profile_parse(regular1, regularParser, lex, guardProfile);
+    bool rejectProfiled = profile_parse(regular4, regularParser, lex, rejectProfile);
+    
+    report("ProfileShifts", dragonProfiled && dragonProfile.total_shifts() == 4 && dragonProfile.rejected() == 0);
+    report("ProfileReductions", dragonProfile.total_reductions() == 6 && dragonProfile.nonterminal_reductions(dragon446.identifier_for_item(l)) == 3 && dragonProfile.nonterminal_reductions(dragon446.identifier_for_item(r)) == 2);
+    report("ProfileGuards", guardProfiled && guardProfile.guards().size() == 1 && guardProfile.guards().begin()->second.matches == 1 && guardProfile.guards().begin()->second.maxLookahead == 4);
+    report("ProfileReject", !rejectProfiled && rejectProfile.rejected() == 1 && rejectProfile.guards().size() == 1 && rejectProfile.guards().begin()->second.matches == 0);
+    
+    parser_profile mergedProfile(guardProfile);
+    mergedProfile.merge(rejectProfile);
+    report("ProfileMerge", mergedProfile.guards().size() == 1 && !rejectProfile.guards().empty() && mergedProfile.guards().begin()->second.checks == guardProfile.guards().begin()->second.checks + rejectProfile.guards().begin()->second.checks && mergedProfile.max_buffered_lookahead() >= 4);
+    
+    // Guard results are re-used: the inner guard here is checked by the outer guard and then again by the parser at the
+    // same position, but should only be run once for each position
+    grammar repeatedGuards;
+    
+    nonterminal repeatedLan(repeatedGuards.id_for_nonterminal(L"<Repeated-Guards>"));
+    nonterminal guardedPair(repeatedGuards.id_for_nonterminal(L"<Guarded-Pair>"));
+    
+    guard innerGuard;
+    guard outerGuard;
+    (*innerGuard.get_rule()) << a;
+    (*outerGuard.get_rule()) << innerGuard << a << b;
+    
+    ebnf_repeating somePairs;
+    (*somePairs.get_rule()) << guardedPair;
+    
+    (repeatedGuards += L"<Guarded-Pair>") << outerGuard << innerGuard << a << b;
+    (repeatedGuards += L"<Repeated-Guards>") << somePairs;
+    
+    lalr_builder repeatedBuilder(repeatedGuards, terms);
+    repeatedBuilder.add_initial_state(repeatedLan);
+    repeatedBuilder.complete_parser();
+    
+    simple_parser   repeatedParser(repeatedBuilder, NULL);
+    int             innerState = repeatedBuilder.guard_states().find(innerGuard.get_rule()->identifier(repeatedGuards))->second;
+    int             outerState = repeatedBuilder.guard_states().find(outerGuard.get_rule()->identifier(repeatedGuards))->second;
+    
+    int_string threePairs;
+    for (int x=0; x<3; ++x) {
+        threePairs += aId;
+        threePairs += bId;
+    }
+    
+    profiled_parser             repeatedProfiled(repeatedParser.get_tables());
+    int_stringstream            repeatedStream(threePairs);
+    profiled_parser::state*     repeatedState = repeatedProfiled.create_parser(new simple_parser_actions(lex.create_stream_from(repeatedStream)));
+    
+    bool repeatedAccepted = repeatedState->parse();
+    
+    const parser_profile::guard_map& repeatedCounters = repeatedState->get_trace().profile().guards();
+    parser_profile::guard_map::const_iterator innerCounters = repeatedCounters.find(innerState);
+    parser_profile::guard_map::const_iterator outerCounters = repeatedCounters.find(outerState);
+    
+    report("GuardResultsAccept", repeatedAccepted);
+    report("GuardResultsOuterRuns", outerCounters != repeatedCounters.end() && outerCounters->second.checks == 3 && outerCounters->second.runs == 3);
+    report("GuardResultsInnerReused", innerCounters != repeatedCounters.end() && innerCounters->second.checks == 3 && innerCounters->second.runs == 3);
+    
+    // The results are discarded when the lookahead is trimmed
+    report("GuardResultsTrimmed", repeatedState->count_guard_results() == 0);
+    
+    delete repeatedState;
+    
+    // The lookahead buffer has to grow while its contents wrap around if a guard looks a long way ahead after some
+    // symbols have already been consumed
+    grammar wrappedGuards;
+    
+    nonterminal wrappedLan(wrappedGuards.id_for_nonterminal(L"<Wrapped-Lookahead>"));
+    nonterminal longGuarded(wrappedGuards.id_for_nonterminal(L"<Long-Guarded>"));
+    nonterminal longUnguarded(wrappedGuards.id_for_nonterminal(L"<Long-Unguarded>"));
+    
+    ebnf_repeating_optional manyBs;
+    (*manyBs.get_rule()) << b;
+    
+    ebnf_repeating someDs;
+    (*someDs.get_rule()) << d;
+    
+    guard longGuard;
+    (*longGuard.get_rule()) << a << manyBs << c;
+    
+    (wrappedGuards += L"<Long-Guarded>") << a << manyBs << c;
+    (wrappedGuards += L"<Long-Unguarded>") << a << manyBs << d;
+    (wrappedGuards += L"<Wrapped-Lookahead>") << someDs << longGuard << longGuarded;
+    (wrappedGuards += L"<Wrapped-Lookahead>") << someDs << longUnguarded;
+    
+    lalr_builder wrappedBuilder(wrappedGuards, terms);
+    wrappedBuilder.add_initial_state(wrappedLan);
+    wrappedBuilder.complete_parser();
+    
+    simple_parser wrappedParser(wrappedBuilder, NULL);
+    
+    int_string wrappedGuarded;
+    int_string wrappedUnguarded;
+    int_string wrappedUnfinished;
+    
+    for (int x=0; x<5; ++x) wrappedGuarded += dId;
+    wrappedGuarded += aId;
+    for (int x=0; x<20; ++x) wrappedGuarded += bId;
+    
+    wrappedUnfinished   = wrappedGuarded;
+    wrappedUnguarded    = wrappedGuarded;
+    wrappedUnguarded    += dId;
+    wrappedGuarded      += cId;
+    
+    report("WrappedLookaheadGuarded", can_parse(wrappedGuarded, wrappedParser, lex));
+    report("WrappedLookaheadUnguarded", can_parse(wrappedUnguarded, wrappedParser, lex));
+    report("WrappedLookaheadReject", !can_parse(wrappedUnfinished, wrappedParser, lex));
+    
+    // Read the same input directly: consume the 'd's to move the start of the buffer, then look past its initial size
+    int_stringstream        wrappedStream(wrappedGuarded);
+    simple_parser::state*   wrappedState = wrappedParser.create_parser(new simple_parser_actions(lex.create_stream_from(wrappedStream)));
+    
+    for (int x=0; x<5; ++x) {
+        wrappedState->look();
+        wrappedState->next();
+    }
+    
+    bool wrappedInOrder = wrappedState->look(21).item() != NULL;
+    for (int offset = 0; offset < 22 && wrappedInOrder; ++offset) {
+        const dfa::lexeme_container& la = wrappedState->look(offset);
+        int expected = offset == 0 ? aId : offset == 21 ? cId : bId;
+        
+        if (la.item() == NULL || la->matched() != expected || la->pos().offset() != 5 + offset) {
+            wrappedInOrder = false;
+        }
+    }
+    
+    report("WrappedLookaheadInOrder", wrappedInOrder && wrappedState->look(22).item() == NULL);
+    
+    delete wrappedState;
+    
+    // Direct-coded parsers should behave the same as the table interpreter, including when it falls back to it for guards
+    report("DirectParse", direct_matches_parse(test2, p, lex, true));
+    report("DirectReject", direct_matches_parse(regular4, regularParser, lex, false));
+    report("DirectGuards", direct_matches_parse(regular1, regularParser, lex, true) && direct_matches_parse(regular2, regularParser, lex, true));
+    
+    // The GLR parser should find all of the parses of an ambiguous grammar
+    grammar ambiguous;
+    
+    nonterminal ePrime(ambiguous.id_for_nonterminal(L"E'"));
+    nonterminal e(ambiguous.id_for_nonterminal(L"E"));
+    
+    (ambiguous += ePrime) << e;
+    (ambiguous += e) << e << times << e;
+    (ambiguous += e) << id;
+    
+    lalr_builder ambiguousBuilder(ambiguous, terms);
+    ambiguousBuilder.add_initial_state(ePrime);
+    ambiguousBuilder.complete_parser();
+    
+    simple_parser   ambiguousParser(ambiguousBuilder, NULL);
+    glr_parser      glr(ambiguousParser.get_tables());
+    glr_forest      forest;
+    
+    int_string oneTimes;
+    int_string twoTimes;
+    int_string threeTimes;
+    int_string badTimes;
+    
+    oneTimes    += idId; oneTimes   += timesId; oneTimes    += idId;
+    twoTimes    = oneTimes; twoTimes    += timesId; twoTimes    += idId;
+    threeTimes  = twoTimes; threeTimes  += timesId; threeTimes  += idId;
+    badTimes    = oneTimes; badTimes    += timesId;
+    
+    report("GlrUnambiguous", glr_parse(oneTimes, glr, lex, forest) && forest.count_ambiguities() == 0);
+    report("GlrAmbiguous1", glr_parse(twoTimes, glr, lex, forest) && forest.count_ambiguities() == 1 && !forest.is_ambiguous(forest.root()));
+    report("GlrAmbiguous2", glr_parse(threeTimes, glr, lex, forest) && forest.count_ambiguities() == 3 && forest.get_node(forest.root()).endLexeme == (int) threeTimes.size());
+    
+    // id*id*id*id can be bracketed in 5 ways: the two E nodes covering three ids have 2 alternatives each, and the E
+    // covering all four has 3
+    report("GlrDerivations", count_derivations(forest, forest.root()) == 5);
+    report("GlrReject", !glr_parse(badTimes, glr, lex, forest) && forest.root() < 0);
+    
+    // Empty productions should work too
+    glr_parser glrEmpty(emptyParser.get_tables());
+    report("GlrEmpty1", glr_parse(empty, glrEmpty, lex, forest));
+    report("GlrEmpty2", glr_parse(manyIds, glrEmpty, lex, forest) && forest.count_ambiguities() == 0);
+    
+    // Batches of documents should give the same results as parsing them one at a time, whether or not the
+    // parser states are re-used by a single thread or spread across several
+    vector<int_string> dragonBatch;
+    vector<int_string> regularBatch;
+    
+    for (int document = 0; document < 64; ++document) {
+        switch (document % 3) {
+            case 0: dragonBatch.push_back(test1); break;
+            case 1: dragonBatch.push_back(test2); break;
+            case 2: dragonBatch.push_back(badTimes); break;
+        }
+        
+        switch (document % 4) {
+            case 0: regularBatch.push_back(regular1); break;
+            case 1: regularBatch.push_back(regular2); break;
+            case 2: regularBatch.push_back(regular3); break;
+            case 3: regularBatch.push_back(regular4); break;
+        }
+    }
+    
+    report("BatchSerial", batch_matches_serial(dragonBatch, p, lex, 1));
+    report("BatchParallel", batch_matches_serial(dragonBatch, p, lex, 4));
+    report("BatchGuards", batch_matches_serial(regularBatch, regularParser, lex, 4));
+    
+    // An input that is a series of R items separated by '=' can be parsed in segments from the R start state
+    lalr_builder segmentBuilder(dragon446, terms);
+    segmentBuilder.add_initial_state(s);
+    segmentBuilder.add_initial_state(r);
+    segmentBuilder.complete_parser();
+    
+    ast_parser                  segmentParser(segmentBuilder, NULL);
+    vector<util::astnode_container>   segmentItems;
+    int_string                  segmentInput;
+    int_string                  badSegmentInput;
+    int_string                  emptySegments;
+    
+    for (int item = 0; item < 100; ++item) {
+        for (int deref = 0; deref < item % 3; ++deref) {
+            segmentInput += timesId;
+        }
+        segmentInput += idId;
+        segmentInput += equalsId;
+    }
+    
+    badSegmentInput += timesId; badSegmentInput += equalsId; badSegmentInput += idId;
+    emptySegments   += idId; emptySegments += equalsId; emptySegments += equalsId; emptySegments += idId; emptySegments += equalsId;
+    
+    bool segmentsAccepted   = parse_segments_of(segmentInput, segmentParser, lex, equalsId, 1, segmentItems);
+    bool segmentsAreR       = true;
+    int  rIdentifier        = dragon446.identifier_for_item(r);
+    for (vector<util::astnode_container>::const_iterator item = segmentItems.begin(); item != segmentItems.end(); ++item) {
+        if ((*item)->item_identifier() != rIdentifier) segmentsAreR = false;
+    }
+    report("SegmentsAccept", segmentsAccepted && segmentItems.size() == 100 && segmentsAreR);
+    
+    segmentItems.clear();
+    report("SegmentsReject", !parse_segments_of(badSegmentInput, segmentParser, lex, equalsId, 1, segmentItems) && segmentItems.size() == 1);
+    report("SegmentsSkipEmpty", count_segments(emptySegments, segmentParser, lex, equalsId, false) == 2);
+    report("SegmentsKeepSync", count_segments(emptySegments, segmentParser, lex, equalsId, true) == 3);
+    
+    // The incremental parser should reuse the parts of a list of assignments that aren't affected by an edit
+    grammar assignments;
+    
+    nonterminal listPrime(assignments.id_for_nonterminal(L"P'"));
+    nonterminal list(assignments.id_for_nonterminal(L"P"));
+    nonterminal assignment(assignments.id_for_nonterminal(L"A"));
+    nonterminal value(assignments.id_for_nonterminal(L"V"));
+    
+    (assignments += listPrime) << list;
+    (assignments += list) << list << assignment;
+    (assignments += list) << assignment;
+    (assignments += assignment) << value << equals << value;
+    (assignments += value) << times << value;
+    (assignments += value) << id;
+    
+    lalr_builder assignmentBuilder(assignments, terms);
+    assignmentBuilder.add_initial_state(listPrime);
+    assignmentBuilder.complete_parser();
+    
+    simple_parser       assignmentParser(assignmentBuilder, NULL);
+    incremental_parser  incremental(assignmentParser.get_tables());
+    
+    int_string                      manyAssignments;
+    incremental_parse::token_list   assignmentTokens;
+    incremental_parse               beforeEdit;
+    incremental_parse               edited;
+    
+    for (int item = 0; item < 50; ++item) {
+        manyAssignments += idId; manyAssignments += equalsId; manyAssignments += idId;
+    }
+    lex_tokens(manyAssignments, lex, assignmentTokens);
+    
+    report("IncrementalParse", incremental.can_reuse() && incremental.parse(assignmentTokens, beforeEdit) && beforeEdit.root()->length() == 150);
+    
+    // Dereference the value on the left of the 26th assignment
+    int_string          derefString;
+    incremental_edit    deref;
+    
+    derefString += timesId;
+    deref.firstToken = 75;
+    deref.numRemoved = 0;
+    lex_tokens(derefString, lex, deref.inserted);
+    
+    report("IncrementalInsert", reparse_matches(incremental, beforeEdit, deref, edited) && edited.accepted() && edited.reused_tokens() >= 140);
+    
+    // Remove an '=' so the input is rejected
+    incremental_edit removeEquals;
+    
+    removeEquals.firstToken = 31;
+    removeEquals.numRemoved = 1;
+    
+    report("IncrementalReject", reparse_matches(incremental, beforeEdit, removeEquals, edited) && !edited.accepted());
+    
+    // Add another assignment at the end, reusing the old result as the new one
+    int_string          appendString;
+    incremental_edit    append;
+    
+    appendString += idId; appendString += equalsId; appendString += idId;
+    append.firstToken = 150;
+    append.numRemoved = 0;
+    lex_tokens(appendString, lex, append.inserted);
+    
+    edited = beforeEdit;
+    report("IncrementalAppend", reparse_matches(incremental, edited, append, edited) && edited.accepted() && edited.root()->length() == 153 && edited.reused_tokens() >= 147);
+    
+    // A series of pseudo-random edits should always give the same result as parsing from scratch
+    incremental_parse   current;
+    unsigned int        seed            = 12345;
+    bool                randomMatches   = incremental.parse(assignmentTokens, current);
+    int                 randomAccepted  = 0;
+    int                 terminalIds[]   = { idId, equalsId, timesId, idId, equalsId, idId };
+    
+    for (int editNum = 0; editNum < 200 && randomMatches; ++editNum) {
+        incremental_edit    randomEdit;
+        int_string          inserted;
+        int                 numTokens = (int) current.tokens().size();
+        
+        seed = seed * 1103515245 + 12345;
+        randomEdit.firstToken = (int) ((seed >> 8) % (numTokens + 1));
+        seed = seed * 1103515245 + 12345;
+        randomEdit.numRemoved = (int) ((seed >> 8) % 4);
+        if (randomEdit.firstToken + randomEdit.numRemoved > numTokens) randomEdit.numRemoved = numTokens - randomEdit.firstToken;
+        
+        seed = seed * 1103515245 + 12345;
+        int numInserted = (int) ((seed >> 8) % 4);
+        for (int insert = 0; insert < numInserted; ++insert) {
+            seed = seed * 1103515245 + 12345;
+            inserted += terminalIds[(seed >> 8) % 6];
+        }
+        lex_tokens(inserted, lex, randomEdit.inserted);
+        
+        randomMatches = reparse_matches(incremental, current, randomEdit, current);
+        if (current.accepted()) ++randomAccepted;
+    }
+    
+    report("IncrementalRandomEdits", randomMatches && randomAccepted > 0);
+    
+    // Forked parser stacks should share their common entries but otherwise behave independently
+    typedef parser_stack<int, 4> int_stack;
+    
+    int_stack original;
+    for (int x = 1; x <= 100; ++x) original.push(x, x * 10);
+    
+    int_stack forked(original);
+    for (int x = 0; x < 50; ++x) forked.pop();
+    forked.push(1000, 1);
+    
+    bool stacksIndependent = original->state == 100 && original[-99].state == 1 && forked->state == 1000 && forked[-1].state == 50;
+    for (int x = 0; x < 100; ++x) original.pop();
+    stacksIndependent = stacksIndependent && !original.pop() && forked[-1].item == 500 && forked[-50].state == 1;
+    
+    report("StackFork", stacksIndependent);
+    
+    // Entries freed by one stack should be re-used
+    int_stack   reused;
+    size_t      chunksAfterFirst    = 0;
+    bool        chunksGrew          = false;
+    
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        for (int x = 1; x <= 1000; ++x) reused.push(x, x);
+        for (int x = 1; x <= 1000; ++x) reused.pop();
+        
+        if (repeat == 0) {
+            chunksAfterFirst = reused.count_chunks();
+        } else if (reused.count_chunks() != chunksAfterFirst) {
+            chunksGrew = true;
+        }
+    }
+    reused.push(1, 2);
+    
+    report("StackReuse", reused->item == 2 && reused[-1].state == -1 && reused.pop() && !reused.pop());
+    report("StackReuseChunks", chunksAfterFirst > 1 && !chunksGrew && reused.count_chunks() == chunksAfterFirst);
 }
@@ -29,6 +29,7 @@
 
 #include "TameParse/Dfa/ndfa_regex.h"
 #include "TameParse/Lr/weak_symbols.h"
+#include "TameParse/Lr/parser_tables.h"
 
 using namespace dfa;
 using namespace contextfree;
@@ -139,6 +140,37 @@ void test_lr_weaksymbols::run_tests() {
     report("IntegerIsWeakForId", identifierWeak.contains(icInteger));
     report("IdentifierIsNotWeak", !identifierWeak.contains(icIdentifier));
     
+    // Parser tables should map weak symbols to their strong equivalent (and leave everything else alone)
+    parser_tables::symbol_equivalent equivalents[] = { { integer, identifier }, { real, identifier } };
+    parser_tables weakTables(0, -1, -2, NULL, NULL, NULL, NULL, 0, 0, NULL, 2, equivalents);
+    
+    report("StrongForInteger", weakTables.strong_for_weak(integer) == identifier);
+    report("StrongForReal", weakTables.strong_for_weak(real) == identifier);
+    report("StrongForIdentifier", weakTables.strong_for_weak(identifier) == identifier);
+    report("StrongForUnknown", weakTables.strong_for_weak(identifier + 100) == identifier + 100 && weakTables.strong_for_weak(-1) == -1);
+    
+    // Lexemes shifted as their strong equivalent share their content with the original lexeme
+    lexeme::symbols     realSymbols;
+    realSymbols += 'r';
+    realSymbols += 'e';
+    realSymbols += 'a';
+    realSymbols += 'l';
+    
+    lexeme_container    weakLexeme(new lexeme(realSymbols, position(4, 1, 5), real), true);
+    lexeme_container    strongLexeme(new lexeme(weakLexeme, identifier), true);
+    
+    report("StrongLexemeMatched", strongLexeme->matched() == identifier);
+    report("StrongLexemeContent", strongLexeme->content() == realSymbols && strongLexeme->pos() == weakLexeme->pos());
+    report("StrongLexemeShared", &strongLexeme->content() == &weakLexeme->content());
+    
+    // The content should still be there once the original lexeme is released
+    weakLexeme = lexeme_container((lexeme*) NULL);
+    report("StrongLexemeKept", strongLexeme->content<char>() == "real");
+    
+    // Copies of a lexeme share their content too
+    lexeme_container    strongCopy(strongLexeme->clone(), true);
+    report("StrongLexemeCopy", &strongCopy->content() == &strongLexeme->content() && strongCopy->matched() == identifier);
+    
     // Tidy up the lexers
     delete simpleLexerDeduped;
     delete simpleLexer;
@@ -40,6 +40,9 @@
 #include "language_bootstrap.h"
 #include "language_primary.h"
 #include "dfa_multi_regex.h"
+#include "dfa_keyword_table.h"
+#include "util_container.h"
+#include "compiler_lexer_cache.h"
 
 using namespace std;
 
@@ -62,6 +65,7 @@ int main (int argc, const char * argv[])
     test_dfa_symbol_translator  trans;          run(trans);
     test_dfa_single_regex       singleregex;    run(singleregex);
     test_dfa_multi_regex        multiregex;     run(multiregex);
+    test_dfa_keyword_table      keywords;       run(keywords);
     
     test_contextfree_firstset   firstset;       run(firstset);
     test_contextfree_followset  followset;      run(followset);
@@ -72,6 +76,10 @@ int main (int argc, const char * argv[])
     test_language_bootstrap     bootstrap;      run(bootstrap);
     test_language_primary       primary;        run(primary);
     
+    test_util_container         container;      run(container);
+    
+    test_compiler_lexer_cache   lexerCache;     run(lexerCache);
+    
     int exitCode = 0;
     if (s_Failed > 0) {
         cerr << endl << s_Failed << "/" << s_Run << " tests failed" << endl;
@@ -0,0 +1,162 @@
+//
+//  util_container.cpp
+//  Parse
+//
+//  Created by Andrew Hunter on 19/10/2026.
+//
+//  Copyright (c) 2011-2012 Andrew Hunter
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the \"Software\"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED \"AS IS\", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include "util_container.h"
+#include "TameParse/Util/container.h"
+#include "TameParse/Util/syntax_ptr.h"
+#include "TameParse/Dfa/lexeme.h"
+
+using namespace util;
+using namespace dfa;
+
+/// \brief Item that counts how many instances of it exist
+template<typename base_class> class counted_item : public base_class {
+public:
+    static int s_Count;
+    
+    counted_item()                              { ++s_Count; }
+    counted_item(const counted_item& copyFrom)  { ++s_Count; }
+    ~counted_item()                             { --s_Count; }
+    
+    counted_item* clone() const                                 { return new counted_item(*this); }
+    static bool compare(const counted_item* a, const counted_item* b)  { return a < b; }
+    bool operator==(const counted_item& compareTo) const        { return this == &compareTo; }
+};
+
+template<typename base_class> int counted_item<base_class>::s_Count = 0;
+
+/// \brief Item with no base class
+class plain_base { };
+
+typedef counted_item<plain_base>        plain_item;
+typedef counted_item<container_item>    embedded_item;
+typedef counted_item<syntax_ptr_item>   embedded_syntax;
+
+void test_util_container::run_tests() {
+    // Containers that refer to NULL should all be ordered equally
+    container<lexeme> nullLexeme((lexeme*) NULL);
+    container<lexeme> otherNull((const lexeme*) NULL);
+    
+    report("NullContainer", nullLexeme.item() == NULL);
+    report("NullEqual", !(nullLexeme < otherNull) && !(otherNull < nullLexeme));
+    
+    // Copying a NULL container shouldn't change anything
+    container<lexeme> nullCopy = nullLexeme;
+    nullCopy = otherNull;
+    report("NullCopy", nullCopy.item() == NULL);
+    
+    // Containers should delete their item when the last one is released
+    {
+        container<plain_item> plain;
+        container<plain_item> plainCopy = plain;
+        
+        report("PlainCreated", plain_item::s_Count == 1);
+        report("PlainShared", plain.item() == plainCopy.item());
+    }
+    report("PlainDestroyed", plain_item::s_Count == 0);
+    
+    // Same with items that store their own reference count
+    {
+        container<embedded_item> embedded;
+        container<embedded_item> embeddedCopy = embedded;
+        
+        report("EmbeddedCreated", embedded_item::s_Count == 1);
+        report("EmbeddedShared", embedded.item() == embeddedCopy.item());
+        
+        embedded = container<embedded_item>();
+        report("EmbeddedReassigned", embedded_item::s_Count == 2);
+        report("EmbeddedDistinct", embedded.item() != embeddedCopy.item());
+        
+        // A container that doesn't own an item shouldn't use its embedded reference
+        {
+            container<embedded_item> notOwned(embedded.item(), false);
+            report("EmbeddedNotOwned", notOwned.item() == embedded.item());
+        }
+        report("EmbeddedNotOwnedKept", embedded_item::s_Count == 2);
+    }
+    report("EmbeddedDestroyed", embedded_item::s_Count == 0);
+    
+    // Lexemes keep their own reference count
+    {
+        lexeme::symbols syms;
+        syms.push_back(1);
+        syms.push_back(2);
+        
+        container<lexeme> lex(new lexeme(syms, position(0, 0, 0), 3), true);
+        container<lexeme> lexCopy = lex;
+        report("Lexeme", lexCopy->matched() == 3 && lexCopy->content<char>() == std::string("\1\2"));
+    }
+
+#if __cplusplus >= 201103L
+    // Moving a container should leave the original referring to NULL
+    {
+        container<embedded_item> moveFrom;
+        embedded_item* item = moveFrom.item();
+        
+        container<embedded_item> moveTo(std::move(moveFrom));
+        report("ContainerMove1", moveFrom.item() == NULL && moveTo.item() == item);
+        
+        container<embedded_item> assignTo;
+        assignTo = std::move(moveTo);
+        report("ContainerMove2", moveTo.item() == NULL && assignTo.item() == item && embedded_item::s_Count == 1);
+    }
+    report("ContainerMoveDestroyed", embedded_item::s_Count == 0);
+#endif
+
+    // syntax_ptr objects that refer to NULL
+    syntax_ptr<embedded_syntax> nullPtr;
+    syntax_ptr<embedded_syntax> nullPtr2((const embedded_syntax*) NULL);
+    report("SyntaxNull", !nullPtr && !nullPtr2 && nullPtr.item() == NULL);
+
+    // syntax_ptr objects with an embedded reference
+    {
+        syntax_ptr<embedded_syntax> ptr(new embedded_syntax());
+        syntax_ptr<embedded_syntax> ptrCopy = ptr;
+        
+        nullPtr2 = ptr;
+        nullPtr2 = nullPtr;
+        report("SyntaxEmbedded", embedded_syntax::s_Count == 1 && ptr.item() == ptrCopy.item());
+        
+#if __cplusplus >= 201103L
+        syntax_ptr<embedded_syntax> moved(std::move(ptr));
+        report("SyntaxMove", !ptr && moved.item() == ptrCopy.item());
+#endif
+    }
+    report("SyntaxEmbeddedDestroyed", embedded_syntax::s_Count == 0);
+    
+    // syntax_ptr objects in an arena
+    {
+        arena owner;
+        {
+            syntax_ptr<embedded_syntax> inArena(new (&owner) embedded_syntax(), &owner);
+            syntax_ptr<embedded_syntax> inArenaCopy = inArena;
+            report("SyntaxArena", embedded_syntax::s_Count == 1);
+        }
+        report("SyntaxArenaKept", embedded_syntax::s_Count == 1);
+    }
+    report("SyntaxArenaDestroyed", embedded_syntax::s_Count == 0);
+}
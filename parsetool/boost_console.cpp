@@ -68,7 +68,8 @@ boost_console::boost_console(int argc, const char** argv)
         ("class-name,C",        po::value<string>(),            "specifies the name of the class to generate (overriding anything defined in the parser block of the input file)")
         ("namespace-name,N",    po::value<string>(),            "specifies the namespace to put the target class into.")
         ("run-tests",                                           "if the language contains any tests, then run them")
-        ("test",                                                "specifies that no output should be generated. This tool will instead try to read from stdin and indicate whether or not it can be accepted.");
+        ("test",                                                "specifies that no output should be generated. This tool will instead try to read from stdin and indicate whether or not it can be accepted.")
+        ("profile",                                             "as for --test, but also reports how often each rule and state was used by the parser, and how much time was spent checking guards.");
 
     po::options_description infoOptions("Information");
     
@@ -86,6 +87,15 @@ boost_console::boost_console(int argc, const char** argv)
         ("compile-language,L",  po::value<string>(),            "specifies the name of the language block to compile (overriding anything defined in the parser block of the input file)")
         ("start-symbol,S",      po::value< vector<string> >(),  "specifies the name of the start symbol (overriding anything defined in the parser block of the input file)")
         ("enable-lr1-resolver",                                 "attempt to resolve reduce/reduce conflicts that would be allowed by a LR(1) parser")
+        ("lexer-threads",       po::value<string>(),            "specifies the number of threads to use when building the lexer DFA (0 uses one thread per processor). The lexer that is generated is the same regardless of this setting.")
+        ("lexer-cache",         po::value<string>(),            "specifies a directory where compiled lexers are stored. A lexer is only rebuilt if its definition has changed since it was last stored.")
+        ("keyword-hash",                                        "leaves keywords that are also matched by another symbol (such as an identifier) out of the lexer DFA, and recognises them by looking up the text of the lexeme in a perfect hash table instead")
+        ("direct-parser",                                       "writes out the states of the parser as code instead of as tables. Guards and weak reductions are still handled by the table interpreter. The generated code is larger than the tables.")
+        ("dense-parser-tables",                                 "generates tables that let the parser find the actions for a state and symbol with a single lookup instead of a binary search. The tables are larger, but the parser is faster.")
+        ("elide-terminal",      po::value< vector<string> >(),  "leaves the specified terminal symbol out of the generated AST. Literal symbols can be named with or without their quotes.")
+        ("elide-punctuation",                                   "leaves every literal terminal symbol that contains no letters or digits (such as '{' or ';') out of the generated AST")
+        ("collapse-nonterminal",po::value< vector<string> >(),  "rules for the specified nonterminal that have only one item in the generated AST return that item instead of creating a new node")
+        ("collapse-unit-rules",                                 "as for --collapse-nonterminal, but applies to every nonterminal in the grammar")
         ("show-parser",                                         "writes the generated parser to standard out");
     
     po::options_description errorOptions("Error reporting");
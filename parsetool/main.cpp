@@ -95,6 +95,7 @@ int main (int argc, const char * argv[])
                 && console.get_option(L"start-symbol").empty()
                 && console.get_option(L"output-language").empty()
                 && console.get_option(L"test").empty()
+                && console.get_option(L"profile").empty()
                 && console.get_option(L"show-parser").empty()) {
                 return console.exit_code();
             }
@@ -297,6 +298,11 @@ int main (int argc, const char * argv[])
             targetLanguage = L"test";
         }
         
+        // The --profile option sets the target language to 'test-profile'
+        if (!console.get_option(L"profile").empty()) {
+            targetLanguage = L"test-profile";
+        }
+        
         // Target language is C++ if no language is specified
         if (targetLanguage.empty()) {
             targetLanguage = L"cplusplus";
@@ -362,6 +368,31 @@ int main (int argc, const char * argv[])
                     console.verbose_stream() << formatter::to_string(*stack->item, *compileLanguageStage->grammar(), *compileLanguageStage->terminals()) << endl;
                 } while (stack.pop());
             }
+        } else if (targetLanguage == L"test-profile") {
+            // Special case: same as for test, but count the actions performed by the parser and report on them
+            typedef parser<astnode_container, ast_parser_actions, profiling_parser_trace> profile_parser;
+            profile_parser parser(*lrParserStage.get_tables());
+            
+            // Create the parser
+            lexeme_stream* stdinStream          = lexerStage.get_lexer()->create_stream_from(wcin);
+            profile_parser::state* stdInParser  = parser.create_parser(new ast_parser_actions(stdinStream));
+            
+            // Parse stdin
+            if (stdInParser->parse()) {
+                console.verbose_stream() << formatter::to_string(*stdInParser->get_item(), *compileLanguageStage->grammar(), *compileLanguageStage->terminals()) << endl;
+            } else {
+                position failPos(-1, -1, -1);
+                if (stdInParser->look().item()) {
+                    failPos = stdInParser->look()->pos();
+                }
+                
+                console.report_error(error(error::sev_error, L"stdin", L"TEST_PARSER_ERROR", L"Syntax error", failPos));
+            }
+            
+            // Report on the parser's activity whether or not the input was accepted
+            console.message_stream() << endl << formatter::to_string(stdInParser->get_trace().profile(), *compileLanguageStage->grammar(), *compileLanguageStage->terminals());
+            
+            delete stdInParser;
         } else {
             // Unknown target language
             wstringstream msg;